@@ -11,6 +11,7 @@
 #define PREFILTER_MIP_LEVELS 5
 #define PREFILTER_WORK_GROUP_SIZE 8
 #define MAX_PREFILTER_SAMPLES 64
+#define GRAPHICS_READ_STAGES (VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR)
 
 namespace dw
 {
@@ -2751,35 +2752,11 @@ void CubemapPrefiler::update(
 #if defined(DWSF_VULKAN)
     auto backend = cmd_buf->backend().lock();
 
-    VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, PREFILTER_MIP_LEVELS, 0, 6 };
-
-    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, m_image, subresource_range);
-
-    backend->flush_barriers(cmd_buf);
+    record(cmd_buf);
 
-    int32_t start_level = (m_size / PREFILTER_MAP_SIZE) - 1;
-
-    for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
-    {
-        uint32_t mip_width  = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
-        uint32_t mip_height = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
-
-        vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline->handle());
-
-        PushConstants push_constants;
-
-        push_constants.roughness       = (float)mip / (float)(PREFILTER_MIP_LEVELS - 1);
-        push_constants.size            = mip_height;
-        push_constants.start_mip_level = start_level;
-        push_constants.sample_count    = m_sample_count;
-
-        vkCmdPushConstants(cmd_buf->handle(), m_pipeline_layout->handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
-        vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout->handle(), 0, 1, &m_ds[mip]->handle(), 0, nullptr);
-
-        vkCmdDispatch(cmd_buf->handle(), mip_width / PREFILTER_WORK_GROUP_SIZE, mip_height / PREFILTER_WORK_GROUP_SIZE, 6);
-    }
+    VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, PREFILTER_MIP_LEVELS, 0, 6 };
 
-    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_image, subresource_range);
+    backend->use_resource(GRAPHICS_READ_STAGES, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_image, subresource_range);
 
     backend->flush_barriers(cmd_buf);
 #else
@@ -2815,6 +2792,59 @@ void CubemapPrefiler::update(
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+#if defined(DWSF_VULKAN)
+void CubemapPrefiler::update_async(vk::CommandBuffer::Ptr compute_cmd_buf, vk::CommandBuffer::Ptr acquire_cmd_buf)
+{
+    auto backend = compute_cmd_buf->backend().lock();
+
+    VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, PREFILTER_MIP_LEVELS, 0, 6 };
+
+    // Every mip is rewritten, see CubemapSHProjection::update_async().
+    backend->track_resource(VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, m_image.get(), subresource_range);
+
+    record(compute_cmd_buf);
+
+    backend->transfer_ownership(compute_cmd_buf, vk::QUEUE_TYPE_COMPUTE, acquire_cmd_buf, vk::QUEUE_TYPE_GRAPHICS, GRAPHICS_READ_STAGES, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_image, subresource_range);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void CubemapPrefiler::record(vk::CommandBuffer::Ptr cmd_buf)
+{
+    auto backend = cmd_buf->backend().lock();
+
+    VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, PREFILTER_MIP_LEVELS, 0, 6 };
+
+    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, m_image, subresource_range);
+
+    backend->flush_barriers(cmd_buf);
+
+    int32_t start_level = (m_size / PREFILTER_MAP_SIZE) - 1;
+
+    for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
+    {
+        uint32_t mip_width  = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
+        uint32_t mip_height = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
+
+        vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline->handle());
+
+        PushConstants push_constants;
+
+        push_constants.roughness       = (float)mip / (float)(PREFILTER_MIP_LEVELS - 1);
+        push_constants.size            = mip_height;
+        push_constants.start_mip_level = start_level;
+        push_constants.sample_count    = m_sample_count;
+
+        vkCmdPushConstants(cmd_buf->handle(), m_pipeline_layout->handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+        vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout->handle(), 0, 1, &m_ds[mip]->handle(), 0, nullptr);
+
+        vkCmdDispatch(cmd_buf->handle(), mip_width / PREFILTER_WORK_GROUP_SIZE, mip_height / PREFILTER_WORK_GROUP_SIZE, 6);
+    }
+}
+#endif
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void CubemapPrefiler::set_sample_count(const uint32_t& count)
 {
     if (m_sample_count != count)
@@ -24,6 +24,11 @@ public:
 #endif
     );
 
+#if defined(DWSF_VULKAN)
+    // Same contract as CubemapSHProjection::update_async().
+    void update_async(vk::CommandBuffer::Ptr compute_cmd_buf, vk::CommandBuffer::Ptr acquire_cmd_buf);
+#endif
+
 #if defined(DWSF_VULKAN)
     inline vk::Image::Ptr image()
     {
@@ -39,6 +44,9 @@ public:
 
 private:
     void precompute_prefilter_constants();
+#if defined(DWSF_VULKAN)
+    void record(vk::CommandBuffer::Ptr cmd_buf);
+#endif
 
 private:
     int m_sample_count = 32;
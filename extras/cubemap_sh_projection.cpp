@@ -8,6 +8,7 @@
 #define IRRADIANCE_CUBEMAP_SIZE 128
 #define IRRADIANCE_WORK_GROUP_SIZE 8
 #define SH_INTERMEDIATE_SIZE (IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE)
+#define GRAPHICS_READ_STAGES (VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR)
 
 namespace dw
 {
@@ -4767,14 +4768,17 @@ CubemapSHProjection::CubemapSHProjection(
     projection_comp_desc.set_pipeline_layout(m_projection_pipeline_layout);
     projection_comp_desc.set_shader_stage(projection_module, "main");
 
-    m_projection_pipeline = dw::vk::ComputePipeline::create(backend, projection_comp_desc);
-
     vk::ComputePipeline::Desc add_comp_desc;
 
     add_comp_desc.set_pipeline_layout(m_add_pipeline_layout);
     add_comp_desc.set_shader_stage(add_module, "main");
 
-    m_add_pipeline = dw::vk::ComputePipeline::create(backend, add_comp_desc);
+    // Compile both pipelines in parallel. The shader modules stay alive until the futures are resolved.
+    auto projection_pipeline = backend->pipeline_compiler()->compile(projection_comp_desc);
+    auto add_pipeline        = backend->pipeline_compiler()->compile(add_comp_desc);
+
+    m_projection_pipeline = projection_pipeline.get();
+    m_add_pipeline        = add_pipeline.get();
 #else
     m_texture_intermediate = gl::Texture2D::create(SH_INTERMEDIATE_SIZE * 9, SH_INTERMEDIATE_SIZE, 6, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
     m_texture              = gl::Texture2D::create(9, 1, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
@@ -4854,32 +4858,11 @@ void CubemapSHProjection::update(
 #if defined(DWSF_VULKAN)
     auto backend = cmd_buf->backend().lock();
 
-    VkImageSubresourceRange intermediate_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6 };
-
-    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, m_intermediate_image, intermediate_subresource_range);
-
-    backend->flush_barriers(cmd_buf);
-
-    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_projection_pipeline->handle());
-    vkCmdPushConstants(cmd_buf->handle(), m_projection_pipeline_layout->handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float), &m_size);
-    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_projection_pipeline_layout->handle(), 0, 1, &m_projection_ds->handle(), 0, nullptr);
-
-    vkCmdDispatch(cmd_buf->handle(), IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE, IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE, 6);
-
-    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_intermediate_image, intermediate_subresource_range);
+    record(cmd_buf);
 
     VkImageSubresourceRange sh_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
 
-    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, m_image, sh_subresource_range);
-
-    backend->flush_barriers(cmd_buf);
-
-    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_add_pipeline->handle());
-    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_add_pipeline_layout->handle(), 0, 1, &m_add_ds->handle(), 0, nullptr);
-
-    vkCmdDispatch(cmd_buf->handle(), 9, 1, 1);
-
-    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_image, sh_subresource_range);
+    backend->use_resource(GRAPHICS_READ_STAGES, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_image, sh_subresource_range);
 
     backend->flush_barriers(cmd_buf);
 #else
@@ -4910,5 +4893,61 @@ void CubemapSHProjection::update(
 #endif
 }
 
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(DWSF_VULKAN)
+void CubemapSHProjection::update_async(vk::CommandBuffer::Ptr compute_cmd_buf, vk::CommandBuffer::Ptr acquire_cmd_buf)
+{
+    auto backend = compute_cmd_buf->backend().lock();
+
+    VkImageSubresourceRange sh_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    // The previous result is discarded. Its readers on the graphics queue are ordered by the wait of the compute submission,
+    // and a compute queue barrier can't wait on graphics stages anyway.
+    backend->track_resource(VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, m_image.get(), sh_subresource_range);
+
+    record(compute_cmd_buf);
+
+    backend->transfer_ownership(compute_cmd_buf, vk::QUEUE_TYPE_COMPUTE, acquire_cmd_buf, vk::QUEUE_TYPE_GRAPHICS, GRAPHICS_READ_STAGES, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_image, sh_subresource_range);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void CubemapSHProjection::record(vk::CommandBuffer::Ptr cmd_buf)
+{
+    auto backend = cmd_buf->backend().lock();
+
+    VkImageSubresourceRange intermediate_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6 };
+
+    // The intermediate image is rewritten every time and may last have been used on the other queue family, so its contents
+    // are discarded instead of transitioned from the tracked layout. The previous add pass still has to finish reading it.
+    backend->track_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, m_intermediate_image.get(), intermediate_subresource_range);
+
+    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, m_intermediate_image, intermediate_subresource_range);
+
+    backend->flush_barriers(cmd_buf);
+
+    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_projection_pipeline->handle());
+    vkCmdPushConstants(cmd_buf->handle(), m_projection_pipeline_layout->handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float), &m_size);
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_projection_pipeline_layout->handle(), 0, 1, &m_projection_ds->handle(), 0, nullptr);
+
+    vkCmdDispatch(cmd_buf->handle(), IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE, IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE, 6);
+
+    // Only read by the add pass, which keeps the barrier valid on a compute queue.
+    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_intermediate_image, intermediate_subresource_range);
+
+    VkImageSubresourceRange sh_subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    backend->use_resource(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, m_image, sh_subresource_range);
+
+    backend->flush_barriers(cmd_buf);
+
+    vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_add_pipeline->handle());
+    vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_add_pipeline_layout->handle(), 0, 1, &m_add_ds->handle(), 0, nullptr);
+
+    vkCmdDispatch(cmd_buf->handle(), 9, 1, 1);
+}
+#endif
+
 // -----------------------------------------------------------------------------------------------------------------------------------
 } // namespace dw
\ No newline at end of file
@@ -24,6 +24,14 @@ public:
 #endif
     );
 
+#if defined(DWSF_VULKAN)
+    // Records the work into a compute queue command buffer so that it can overlap with graphics work. The cubemap has to be
+    // readable on the compute queue, see Backend::transfer_ownership(). The result is released to the graphics queue and
+    // acquired in acquire_cmd_buf, which has to be submitted on the graphics queue waiting for compute_cmd_buf. The previous
+    // result must not be read by graphics work submitted after the one compute_cmd_buf waits for.
+    void update_async(vk::CommandBuffer::Ptr compute_cmd_buf, vk::CommandBuffer::Ptr acquire_cmd_buf);
+#endif
+
 #if defined(DWSF_VULKAN)
     inline vk::Image::Ptr image()
     {
@@ -34,6 +42,11 @@ public:
     inline gl::Texture2D::Ptr texture() { return m_texture; }
 #endif
 
+private:
+#if defined(DWSF_VULKAN)
+    void record(vk::CommandBuffer::Ptr cmd_buf);
+#endif
+
 private:
 #if defined(DWSF_VULKAN)
     vk::ImageView::Ptr           m_cubemap_image_view;
@@ -2658,7 +2658,7 @@ void HosekWilkieSkyModel::render(
     m_render_program->use();
     m_vao->bind();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl::Framebuffer::bind_default();
     glViewport(0, 0, width, height);
 
     m_render_program->set_uniform("u_View", view_mat);
@@ -8,8 +8,14 @@
 #include <profiler.h>
 #include <assimp/scene.h>
 
-#define MAX_MATERIAL_COUNT 1024
-#define MAX_INSTANCES 1024
+// Capacities start here and double whenever they run out.
+#define INITIAL_INSTANCE_CAPACITY 64
+#define INITIAL_MATERIAL_CAPACITY 64
+#define INITIAL_TEXTURE_CAPACITY 256
+// Upper bounds of the bindless arrays in the descriptor set layouts. The sets are allocated with the current mesh count and
+// texture capacity.
+#define MAX_MESHES 1024
+#define MAX_TEXTURES 16384
 
 #if defined(DWSF_VULKAN)
 namespace dw
@@ -41,66 +47,51 @@ void transformed_aabb(const RayTracedScene::Instance& instance, glm::vec3& min_e
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-RayTracedScene::Ptr RayTracedScene::create(vk::Backend::Ptr backend, std::vector<Instance> instances)
+static uint32_t grow_capacity(uint32_t capacity, uint32_t required)
 {
-    return std::shared_ptr<RayTracedScene>(new RayTracedScene(backend, instances));
+    while (capacity < required)
+        capacity *= 2;
+
+    return capacity;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-RayTracedScene::RayTracedScene(vk::Backend::Ptr backend, std::vector<Instance> instances) :
-    m_backend(backend), m_instances(instances), m_id(g_last_scene_idx++)
+// A set holding a single partially bound array, whose size is picked when the set is allocated.
+static vk::DescriptorSetLayout::Ptr create_bindless_layout(vk::Backend::Ptr backend, VkDescriptorType type, uint32_t max_count, VkShaderStageFlags stages)
 {
-    // Allocate device instance buffer
-    m_tlas_instance_buffer = vk::Buffer::create_with_alignment(backend, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, sizeof(VkAccelerationStructureInstanceKHR) * MAX_INSTANCES, 16, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
-    m_tlas_instance_buffer->set_name("TLAS Instance Buffer");
-
-    VkDeviceOrHostAddressConstKHR instance_device_address {};
-    instance_device_address.deviceAddress = m_tlas_instance_buffer->device_address();
+    VkDescriptorBindingFlags binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
 
-    // Create TLAS
-    VkAccelerationStructureGeometryKHR tlas_geometry;
-    DW_ZERO_MEMORY(tlas_geometry);
-
-    tlas_geometry.sType                              = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-    tlas_geometry.geometryType                       = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-    tlas_geometry.geometry.instances.sType           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-    tlas_geometry.geometry.instances.arrayOfPointers = VK_FALSE;
-    tlas_geometry.geometry.instances.data            = instance_device_address;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo set_layout_binding_flags;
+    DW_ZERO_MEMORY(set_layout_binding_flags);
 
-    vk::AccelerationStructure::Desc desc;
+    set_layout_binding_flags.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    set_layout_binding_flags.bindingCount  = 1;
+    set_layout_binding_flags.pBindingFlags = &binding_flags;
 
-    desc.set_geometry_count(1);
-    desc.set_geometries({ tlas_geometry });
-    desc.set_max_primitive_counts({ MAX_INSTANCES });
-    desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR);
-    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR);
+    vk::DescriptorSetLayout::Desc desc;
 
-    m_tlas = vk::AccelerationStructure::create(backend, desc);
-    m_tlas->set_name("TLAS");
+    desc.set_next_ptr(&set_layout_binding_flags);
+    desc.add_binding(0, type, max_count, stages);
 
-    // Allocate scratch buffer
-    m_tlas_scratch_buffer = vk::Buffer::create_with_alignment(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, m_tlas->build_sizes().buildScratchSize, backend->acceleration_structure_properties().minAccelerationStructureScratchOffsetAlignment, VMA_MEMORY_USAGE_GPU_ONLY, 0);
-    m_tlas_scratch_buffer->set_name("TLAS Scratch Buffer");
+    return vk::DescriptorSetLayout::create(backend, desc);
+}
 
-    // Create material data buffer
-    m_material_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(MaterialData) * MAX_MATERIAL_COUNT, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
-    m_material_data_buffer->set_name("Material Data Buffer");
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    // Create instance data buffer
-    m_instance_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(InstanceData) * MAX_INSTANCES, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
-    m_instance_data_buffer->set_name("Instance Data Buffer");
+RayTracedScene::Ptr RayTracedScene::create(vk::Backend::Ptr backend, std::vector<Instance> instances)
+{
+    return std::shared_ptr<RayTracedScene>(new RayTracedScene(backend, instances));
+}
 
-    vk::DescriptorPool::Desc dp_desc;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    dp_desc.set_max_sets(1)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2048)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * MAX_INSTANCES)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 10);
+RayTracedScene::RayTracedScene(vk::Backend::Ptr backend, std::vector<Instance> instances) :
+    m_backend(backend), m_id(g_last_scene_idx++)
+{
+    const VkPhysicalDeviceLimits& limits = backend->physical_device_properties().limits;
 
-    m_descriptor_pool = vk::DescriptorPool::create(backend, dp_desc);
-    m_descriptor_pool->set_name("Scene Descriptor Pool");
+    m_max_textures = std::min<uint32_t>(std::min(limits.maxPerStageDescriptorSampledImages, limits.maxPerStageDescriptorSamplers), MAX_TEXTURES);
 
     vk::DescriptorSetLayout::Desc scene_ds_layout_desc;
 
@@ -108,17 +99,14 @@ RayTracedScene::RayTracedScene(vk::Backend::Ptr backend, std::vector<Instance> i
         VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
         VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
         VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
-        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
-        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
-        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
-        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
     };
 
     VkDescriptorSetLayoutBindingFlagsCreateInfo set_layout_binding_flags;
     DW_ZERO_MEMORY(set_layout_binding_flags);
 
     set_layout_binding_flags.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
-    set_layout_binding_flags.bindingCount  = 7;
+    set_layout_binding_flags.bindingCount  = 4;
     set_layout_binding_flags.pBindingFlags = descriptor_binding_flags.data();
 
     scene_ds_layout_desc.set_next_ptr(&set_layout_binding_flags);
@@ -128,64 +116,47 @@ RayTracedScene::RayTracedScene(vk::Backend::Ptr backend, std::vector<Instance> i
     scene_ds_layout_desc.add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
     // Acceleration Structures
     scene_ds_layout_desc.add_binding(2, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
-    // Vertex Buffers
-    scene_ds_layout_desc.add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_INSTANCES, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
-    // Index Buffers
-    scene_ds_layout_desc.add_binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_INSTANCES, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
-    // Material Indices Buffers
-    scene_ds_layout_desc.add_binding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_INSTANCES, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
     // Textures
-    scene_ds_layout_desc.add_binding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2048, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
+    scene_ds_layout_desc.add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_max_textures, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
 
-    m_ds_layout = vk::DescriptorSetLayout::create(backend, scene_ds_layout_desc);
-    m_ds_layout->set_name("Scene Descriptor Set Layout");
+    m_ds_layouts.resize(DESCRIPTOR_SET_COUNT);
 
-    m_ds = vk::DescriptorSet::create(backend, m_ds_layout, m_descriptor_pool);
-    m_ds->set_name("Scene Descriptor Set");
+    m_ds_layouts[DESCRIPTOR_SET_SCENE] = vk::DescriptorSetLayout::create(backend, scene_ds_layout_desc);
+    m_ds_layouts[DESCRIPTOR_SET_SCENE]->set_name("Scene Descriptor Set Layout");
 
-    create_gpu_resources();
-
-    // Compute scene bounds
-    if (m_instances.size() > 0)
-    {
-        transformed_aabb(m_instances[0], m_min_extents, m_max_extents);
-
-        for (auto instance : m_instances)
-        {
-            glm::vec3 min_extents, max_extents;
+    // Vertex Buffers
+    m_ds_layouts[DESCRIPTOR_SET_VERTEX_BUFFERS] = create_bindless_layout(backend, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_MESHES, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
+    m_ds_layouts[DESCRIPTOR_SET_VERTEX_BUFFERS]->set_name("Scene Vertex Buffers Descriptor Set Layout");
+    // Index Buffers
+    m_ds_layouts[DESCRIPTOR_SET_INDEX_BUFFERS] = create_bindless_layout(backend, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_MESHES, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
+    m_ds_layouts[DESCRIPTOR_SET_INDEX_BUFFERS]->set_name("Scene Index Buffers Descriptor Set Layout");
+    // Material Indices Buffers
+    m_ds_layouts[DESCRIPTOR_SET_MATERIAL_INDICES] = create_bindless_layout(backend, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_MESHES, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT);
+    m_ds_layouts[DESCRIPTOR_SET_MATERIAL_INDICES]->set_name("Scene Material Indices Descriptor Set Layout");
 
-            transformed_aabb(instance, min_extents, max_extents);
+    reserve_instances(std::max<uint32_t>(instances.size(), INITIAL_INSTANCE_CAPACITY));
+    reserve_materials(INITIAL_MATERIAL_CAPACITY);
 
-            if (max_extents.x > m_max_extents.x)
-                m_max_extents.x = max_extents.x;
-            if (max_extents.y > m_max_extents.y)
-                m_max_extents.y = max_extents.y;
-            if (max_extents.z > m_max_extents.z)
-                m_max_extents.z = max_extents.z;
-
-            if (min_extents.x < m_min_extents.x)
-                m_min_extents.x = min_extents.x;
-            if (min_extents.y < m_min_extents.y)
-                m_min_extents.y = min_extents.y;
-            if (min_extents.z < m_min_extents.z)
-                m_min_extents.z = min_extents.z;
-        }
-    }
+    m_texture_capacity = std::min<uint32_t>(INITIAL_TEXTURE_CAPACITY, m_max_textures);
 
-    m_rt_instances.reserve(m_instances.size());
-    m_instance_datas.reserve(m_instances.size());
+    for (const auto& instance : instances)
+        add_instance(instance);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 RayTracedScene::~RayTracedScene()
 {
-    m_ds.reset();
-    m_ds_layout.reset();
+    m_ds.clear();
+    m_ds_layouts.clear();
     m_descriptor_pool.reset();
     m_material_data_buffer.reset();
     m_instance_data_buffer.reset();
     m_material_indices_buffers.clear();
+    m_vbo_descriptors.clear();
+    m_ibo_descriptors.clear();
+    m_material_indices_descriptors.clear();
+    m_image_descriptors.clear();
     m_tlas_instance_buffer.reset();
     m_tlas_scratch_buffer.reset();
     m_tlas.reset();
@@ -195,13 +166,32 @@ RayTracedScene::~RayTracedScene()
 
 void RayTracedScene::build_tlas(vk::CommandBuffer::Ptr cmd_buf)
 {
+    mark_replaced_blas_dirty();
+
+    m_tlas_stats.instances_written = copy_tlas_data();
+
+    if (m_descriptors_dirty)
+        update_descriptor_set();
+
+    // Nothing moved, the TLAS built earlier is still valid.
+    if (m_tlas_built && !m_rebuild_tlas && m_tlas_stats.instances_written == 0)
+    {
+        m_tlas_stats.skipped_count++;
+        return;
+    }
+
     DW_SCOPED_SAMPLE("Build TLAS", cmd_buf);
 
     auto backend = m_backend.lock();
 
-    copy_tlas_data();
+    const bool refit = m_tlas_built && !m_rebuild_tlas && m_refits < m_max_refits;
+
+    // A refit reads the current structure as its source.
+    if (refit)
+        backend->use_resource(VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, m_tlas->buffer());
+    else
+        backend->use_resource(VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, m_tlas->buffer());
 
-    backend->use_resource(VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, m_tlas->buffer());
     backend->use_resource(VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, m_tlas_scratch_buffer);
     backend->use_resource(VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_SHADER_READ_BIT, m_tlas_instance_buffer);
     
@@ -222,8 +212,8 @@ void RayTracedScene::build_tlas(vk::CommandBuffer::Ptr cmd_buf)
     build_info.sType                     = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
     build_info.type                      = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
     build_info.flags                     = m_tlas->flags();
-    build_info.mode                      = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-    build_info.srcAccelerationStructure  = VK_NULL_HANDLE;
+    build_info.mode                      = refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    build_info.srcAccelerationStructure  = refit ? m_tlas->handle() : VK_NULL_HANDLE;
     build_info.dstAccelerationStructure  = m_tlas->handle();
     build_info.geometryCount             = 1;
     build_info.pGeometries               = &geometry;
@@ -244,18 +234,90 @@ void RayTracedScene::build_tlas(vk::CommandBuffer::Ptr cmd_buf)
 
     backend->flush_barriers(cmd_buf);
 
-    m_tlas_built = true;
+    if (refit)
+    {
+        m_refits++;
+        m_tlas_stats.refit_count++;
+    }
+    else
+    {
+        m_refits = 0;
+        m_tlas_stats.build_count++;
+    }
+
+    m_tlas_built   = true;
+    m_rebuild_tlas = false;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 RayTracedScene::Instance& RayTracedScene::fetch_instance(const uint32_t& idx)
 {
+    mark_dirty(idx);
+
     return m_instances[idx];
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void RayTracedScene::set_transform(const uint32_t& idx, const glm::mat4& transform)
+{
+    m_instances[idx].transform = transform;
+
+    mark_dirty(idx);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RayTracedScene::request_rebuild()
+{
+    m_rebuild_tlas = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RayTracedScene::mark_dirty(uint32_t idx)
+{
+    if (m_instance_dirty[idx])
+        return;
+
+    m_instance_dirty[idx] = 1;
+    m_dirty_instances.push_back(idx);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RayTracedScene::mark_replaced_blas_dirty()
+{
+    bool replaced = false;
+
+    for (uint32_t i = 0; i < m_meshes.size(); i++)
+    {
+        auto mesh = m_meshes[i].lock();
+
+        if (mesh && mesh->acceleration_structure()->generation() != m_blas_generations[i])
+        {
+            m_blas_generations[i] = mesh->acceleration_structure()->generation();
+            replaced              = true;
+        }
+    }
+
+    if (!replaced)
+        return;
+
+    for (uint32_t i = 0; i < m_instances.size(); i++)
+    {
+        auto mesh = m_instances[i].mesh.lock();
+
+        if (mesh && m_rt_instances[i].accelerationStructureReference != mesh->acceleration_structure()->device_address())
+            mark_dirty(i);
+    }
+
+    m_rebuild_tlas = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 int32_t RayTracedScene::material_index(const uint32_t& id)
 {
     if (m_local_to_global_mat_idx.find(id) != m_local_to_global_mat_idx.end())
@@ -266,161 +328,369 @@ int32_t RayTracedScene::material_index(const uint32_t& id)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void RayTracedScene::create_gpu_resources()
+uint32_t RayTracedScene::add_instance(const Instance& instance)
 {
-    auto backend = m_backend.lock();
+    auto mesh = instance.mesh.lock();
+
+    if (m_local_to_global_mesh_idx.find(mesh->id()) == m_local_to_global_mesh_idx.end())
+        register_mesh(mesh);
 
-    std::unordered_set<uint32_t> processed_meshes;
-    std::unordered_set<uint32_t> processed_materials;
-    std::vector<MaterialData>    material_datas;
+    const uint32_t idx = m_instances.size();
 
-    std::vector<VkDescriptorBufferInfo> vbo_descriptors;
-    std::vector<VkDescriptorBufferInfo> ibo_descriptors;
-    std::vector<VkDescriptorBufferInfo> material_indices_descriptors;
-    std::vector<VkDescriptorImageInfo>  image_descriptors;
+    if (idx == m_instance_capacity)
+        reserve_instances(grow_capacity(m_instance_capacity, idx + 1));
 
-    m_material_indices_buffers.reserve(m_instances.size());
+    m_instances.push_back(instance);
+    m_rt_instances.push_back({});
+    m_instance_datas.push_back({});
+    m_instance_dirty.push_back(0);
 
-    for (auto& instance : m_instances)
+    mark_dirty(idx);
+
+    // Expand scene bounds
+    glm::vec3 min_extents, max_extents;
+
+    transformed_aabb(instance, min_extents, max_extents);
+
+    if (idx == 0)
+    {
+        m_min_extents = min_extents;
+        m_max_extents = max_extents;
+    }
+    else
+    {
+        m_min_extents = glm::min(m_min_extents, min_extents);
+        m_max_extents = glm::max(m_max_extents, max_extents);
+    }
+
+    // The instance count is part of the build, a refit can't add instances.
+    m_rebuild_tlas = true;
+
+    return idx;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool RayTracedScene::remove_instance(const uint32_t& idx)
+{
+    if (idx >= m_instances.size())
     {
-        auto mesh = instance.mesh.lock();
+        DW_LOG_ERROR("(RayTracedScene) Instance " + std::to_string(idx) + " out of range, the scene has " + std::to_string(m_instances.size()) + " instances.");
+        return false;
+    }
 
-        const std::vector<SubMesh>& submeshes = mesh->sub_meshes();
+    const uint32_t last = m_instances.size() - 1;
 
-        uint32_t mesh_id = mesh->id();
+    if (m_instance_dirty[last])
+        m_dirty_instances.erase(std::find(m_dirty_instances.begin(), m_dirty_instances.end(), last));
 
-        if (processed_meshes.find(mesh_id) == processed_meshes.end())
+    m_instances[idx] = m_instances[last];
+
+    m_instances.pop_back();
+    m_rt_instances.pop_back();
+    m_instance_datas.pop_back();
+    m_instance_dirty.pop_back();
+
+    if (idx != last)
+        mark_dirty(idx);
+
+    // The meshes and materials of the instance stay registered, they are reused if it is added again.
+    m_rebuild_tlas = true;
+
+    // Recompute scene bounds
+    if (m_instances.size() > 0)
+    {
+        transformed_aabb(m_instances[0], m_min_extents, m_max_extents);
+
+        for (const auto& instance : m_instances)
         {
-            processed_meshes.insert(mesh_id);
-            m_local_to_global_mesh_idx[mesh_id] = m_meshes.size();
-            m_meshes.push_back(instance.mesh);
+            glm::vec3 min_extents, max_extents;
 
-            VkDescriptorBufferInfo ibo_info;
+            transformed_aabb(instance, min_extents, max_extents);
 
-            ibo_info.buffer = mesh->index_buffer()->handle();
-            ibo_info.offset = 0;
-            ibo_info.range  = VK_WHOLE_SIZE;
+            m_min_extents = glm::min(m_min_extents, min_extents);
+            m_max_extents = glm::max(m_max_extents, max_extents);
+        }
+    }
 
-            ibo_descriptors.push_back(ibo_info);
+    return true;
+}
 
-            VkDescriptorBufferInfo vbo_info;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-            vbo_info.buffer = mesh->vertex_buffer()->handle();
-            vbo_info.offset = 0;
-            vbo_info.range  = VK_WHOLE_SIZE;
+const std::vector<vk::DescriptorSet::Ptr>& RayTracedScene::descriptor_sets()
+{
+    if (m_descriptors_dirty)
+        update_descriptor_set();
 
-            vbo_descriptors.push_back(vbo_info);
+    return m_ds;
+}
 
-            vk::Buffer::Ptr material_indices_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(glm::uvec2) * submeshes.size(), VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
-            glm::uvec2*     material_indices        = (glm::uvec2*)material_indices_buffer->mapped_ptr();
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-            VkDescriptorBufferInfo material_indice_info;
+void RayTracedScene::reserve_instances(uint32_t capacity)
+{
+    auto backend = m_backend.lock();
+
+    // Allocate device instance buffer
+    m_tlas_instance_buffer = vk::Buffer::create_with_alignment(backend, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, sizeof(VkAccelerationStructureInstanceKHR) * capacity, 16, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    m_tlas_instance_buffer->set_name("TLAS Instance Buffer");
 
-            material_indice_info.buffer = material_indices_buffer->handle();
-            material_indice_info.offset = 0;
-            material_indice_info.range  = VK_WHOLE_SIZE;
+    // Create instance data buffer
+    m_instance_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(InstanceData) * capacity, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    m_instance_data_buffer->set_name("Instance Data Buffer");
 
-            material_indices_descriptors.push_back(material_indice_info);
+    // The new buffers start out empty, the instances written so far are copied over from their CPU side copies.
+    if (m_instances.size() > 0)
+    {
+        memcpy(m_tlas_instance_buffer->mapped_ptr(), m_rt_instances.data(), sizeof(VkAccelerationStructureInstanceKHR) * m_rt_instances.size());
+        memcpy(m_instance_data_buffer->mapped_ptr(), m_instance_datas.data(), sizeof(InstanceData) * m_instance_datas.size());
+    }
 
-            m_material_indices_buffers.push_back(material_indices_buffer);
+    VkDeviceOrHostAddressConstKHR instance_device_address {};
+    instance_device_address.deviceAddress = m_tlas_instance_buffer->device_address();
 
-            const auto& materials = mesh->materials();
+    // Create TLAS
+    VkAccelerationStructureGeometryKHR tlas_geometry;
+    DW_ZERO_MEMORY(tlas_geometry);
 
-            for (uint32_t submesh_idx = 0; submesh_idx < submeshes.size(); submesh_idx++)
-            {
-                const auto&   submesh = submeshes[submesh_idx];
-                Material::Ptr mat     = materials[submesh.mat_idx];
+    tlas_geometry.sType                              = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    tlas_geometry.geometryType                       = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    tlas_geometry.geometry.instances.sType           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    tlas_geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+    tlas_geometry.geometry.instances.data            = instance_device_address;
 
-                if (processed_materials.find(mat->id()) == processed_materials.end())
-                {
-                    processed_materials.insert(mat->id());
-                    m_local_to_global_mat_idx[mat->id()] = material_datas.size();
+    vk::AccelerationStructure::Desc desc;
 
-                    MaterialData material_data;
+    desc.set_geometry_count(1);
+    desc.set_geometries({ tlas_geometry });
+    desc.set_max_primitive_counts({ capacity });
+    desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR);
+    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR);
 
-                    material_data.albedo = mat->albedo_value();
-                    // Covert from sRGB to Linear
-                    material_data.albedo             = glm::vec4(glm::pow(glm::vec3(material_data.albedo[0], material_data.albedo[1], material_data.albedo[2]), glm::vec3(2.2f)), material_data.albedo.a);
-                    material_data.roughness_metallic = glm::vec4(mat->roughness_value(), mat->metallic_value(), 0.0f, 0.0f);
-                    material_data.emissive           = glm::vec4(mat->emissive_value(), 0.0f);
+    m_tlas = vk::AccelerationStructure::create(backend, desc);
+    m_tlas->set_name("TLAS");
 
-                    if (mat->albedo_image_view())
-                    {
-                        VkDescriptorImageInfo image_info;
+    // Allocate scratch buffer, large enough for both builds and refits.
+    m_tlas_scratch_buffer = vk::Buffer::create_with_alignment(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, std::max(m_tlas->build_sizes().buildScratchSize, m_tlas->build_sizes().updateScratchSize), backend->acceleration_structure_properties().minAccelerationStructureScratchOffsetAlignment, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_tlas_scratch_buffer->set_name("TLAS Scratch Buffer");
 
-                        image_info.sampler     = Material::common_sampler()->handle();
-                        image_info.imageView   = mat->albedo_image_view()->handle();
-                        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    m_instance_capacity = capacity;
+    m_tlas_built        = false;
+    m_rebuild_tlas      = true;
+    m_descriptors_dirty = true;
+}
 
-                        material_data.texture_indices0.x = image_descriptors.size();
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                        image_descriptors.push_back(image_info);
-                    }
+void RayTracedScene::reserve_materials(uint32_t capacity)
+{
+    auto backend = m_backend.lock();
 
-                    if (mat->normal_image_view())
-                    {
-                        VkDescriptorImageInfo image_info;
+    // Create material data buffer
+    vk::Buffer::Ptr material_data_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(MaterialData) * capacity, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    material_data_buffer->set_name("Material Data Buffer");
+
+    if (m_material_data_buffer)
+        memcpy(material_data_buffer->mapped_ptr(), m_material_data_buffer->mapped_ptr(), sizeof(MaterialData) * m_material_count);
+
+    m_material_data_buffer = material_data_buffer;
+    m_material_capacity    = capacity;
+    m_descriptors_dirty    = true;
+}
 
-                        image_info.sampler     = Material::common_sampler()->handle();
-                        image_info.imageView   = mat->normal_image_view()->handle();
-                        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int32_t RayTracedScene::add_texture(const VkDescriptorImageInfo& image_info)
+{
+    if (m_image_descriptors.size() == m_max_textures)
+    {
+        DW_LOG_ERROR("(RayTracedScene) Texture limit of " + std::to_string(m_max_textures) + " reached.");
+        return -1;
+    }
 
-                        material_data.texture_indices0.y = image_descriptors.size();
+    if (m_image_descriptors.size() == m_texture_capacity)
+        m_texture_capacity = std::min(grow_capacity(m_texture_capacity, m_image_descriptors.size() + 1), m_max_textures);
 
-                        image_descriptors.push_back(image_info);
-                    }
+    m_image_descriptors.push_back(image_info);
 
-                    if (mat->roughness_image_view())
-                    {
-                        VkDescriptorImageInfo image_info;
+    return m_image_descriptors.size() - 1;
+}
 
-                        image_info.sampler     = Material::common_sampler()->handle();
-                        image_info.imageView   = mat->roughness_image_view()->handle();
-                        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                        material_data.texture_indices0.z = image_descriptors.size();
-                        material_data.texture_indices1.z = mat->roughness_channel();
+void RayTracedScene::register_mesh(Mesh::Ptr mesh)
+{
+    auto backend = m_backend.lock();
 
-                        image_descriptors.push_back(image_info);
-                    }
+    if (m_meshes.size() == MAX_MESHES)
+    {
+        DW_LOG_FATAL("(RayTracedScene) Mesh limit of " + std::to_string(MAX_MESHES) + " reached.");
+        throw std::runtime_error("(RayTracedScene) Mesh limit of " + std::to_string(MAX_MESHES) + " reached.");
+    }
 
-                    if (mat->metallic_image_view())
-                    {
-                        VkDescriptorImageInfo image_info;
+    const std::vector<SubMesh>& submeshes = mesh->sub_meshes();
 
-                        image_info.sampler     = Material::common_sampler()->handle();
-                        image_info.imageView   = mat->metallic_image_view()->handle();
-                        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    m_local_to_global_mesh_idx[mesh->id()] = m_meshes.size();
+    m_meshes.push_back(mesh);
+    m_blas_generations.push_back(mesh->acceleration_structure()->generation());
 
-                        material_data.texture_indices0.w = image_descriptors.size();
-                        material_data.texture_indices1.w = mat->metallic_channel();
+    VkDescriptorBufferInfo ibo_info;
 
-                        image_descriptors.push_back(image_info);
-                    }
+    ibo_info.buffer = mesh->index_buffer()->handle();
+    ibo_info.offset = 0;
+    ibo_info.range  = VK_WHOLE_SIZE;
 
-                    if (mat->emissive_image_view())
-                    {
-                        VkDescriptorImageInfo image_info;
+    m_ibo_descriptors.push_back(ibo_info);
 
-                        image_info.sampler     = Material::common_sampler()->handle();
-                        image_info.imageView   = mat->emissive_image_view()->handle();
-                        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkDescriptorBufferInfo vbo_info;
 
-                        material_data.texture_indices1.x = image_descriptors.size();
+    vbo_info.buffer = mesh->vertex_buffer()->handle();
+    vbo_info.offset = 0;
+    vbo_info.range  = VK_WHOLE_SIZE;
 
-                        image_descriptors.push_back(image_info);
-                    }
+    m_vbo_descriptors.push_back(vbo_info);
 
-                    material_datas.push_back(material_data);
-                }
+    vk::Buffer::Ptr material_indices_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(glm::uvec2) * submeshes.size(), VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    glm::uvec2*     material_indices        = (glm::uvec2*)material_indices_buffer->mapped_ptr();
 
-                glm::uvec2 pair               = glm::uvec2(submesh.base_index / 3, m_local_to_global_mat_idx[mat->id()]);
-                material_indices[submesh_idx] = pair;
+    VkDescriptorBufferInfo material_indice_info;
+
+    material_indice_info.buffer = material_indices_buffer->handle();
+    material_indice_info.offset = 0;
+    material_indice_info.range  = VK_WHOLE_SIZE;
+
+    m_material_indices_descriptors.push_back(material_indice_info);
+
+    m_material_indices_buffers.push_back(material_indices_buffer);
+
+    const auto& materials = mesh->materials();
+
+    for (uint32_t submesh_idx = 0; submesh_idx < submeshes.size(); submesh_idx++)
+    {
+        const auto&   submesh = submeshes[submesh_idx];
+        Material::Ptr mat     = materials[submesh.mat_idx];
+
+        if (m_local_to_global_mat_idx.find(mat->id()) == m_local_to_global_mat_idx.end())
+        {
+            if (m_material_count == m_material_capacity)
+                reserve_materials(grow_capacity(m_material_capacity, m_material_count + 1));
+
+            m_local_to_global_mat_idx[mat->id()] = m_material_count;
+
+            MaterialData material_data;
+
+            material_data.albedo = mat->albedo_value();
+            // Covert from sRGB to Linear
+            material_data.albedo             = glm::vec4(glm::pow(glm::vec3(material_data.albedo[0], material_data.albedo[1], material_data.albedo[2]), glm::vec3(2.2f)), material_data.albedo.a);
+            material_data.roughness_metallic = glm::vec4(mat->roughness_value(), mat->metallic_value(), 0.0f, 0.0f);
+            material_data.emissive           = glm::vec4(mat->emissive_value(), 0.0f);
+
+            if (mat->albedo_image_view())
+            {
+                VkDescriptorImageInfo image_info;
+
+                image_info.sampler     = Material::common_sampler()->handle();
+                image_info.imageView   = mat->albedo_image_view()->handle();
+                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+                material_data.texture_indices0.x = add_texture(image_info);
             }
+
+            if (mat->normal_image_view())
+            {
+                VkDescriptorImageInfo image_info;
+
+                image_info.sampler     = Material::common_sampler()->handle();
+                image_info.imageView   = mat->normal_image_view()->handle();
+                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+                material_data.texture_indices0.y = add_texture(image_info);
+            }
+
+            if (mat->roughness_image_view())
+            {
+                VkDescriptorImageInfo image_info;
+
+                image_info.sampler     = Material::common_sampler()->handle();
+                image_info.imageView   = mat->roughness_image_view()->handle();
+                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+                material_data.texture_indices0.z = add_texture(image_info);
+                material_data.texture_indices1.z = mat->roughness_channel();
+            }
+
+            if (mat->metallic_image_view())
+            {
+                VkDescriptorImageInfo image_info;
+
+                image_info.sampler     = Material::common_sampler()->handle();
+                image_info.imageView   = mat->metallic_image_view()->handle();
+                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+                material_data.texture_indices0.w = add_texture(image_info);
+                material_data.texture_indices1.w = mat->metallic_channel();
+            }
+
+            if (mat->emissive_image_view())
+            {
+                VkDescriptorImageInfo image_info;
+
+                image_info.sampler     = Material::common_sampler()->handle();
+                image_info.imageView   = mat->emissive_image_view()->handle();
+                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+                material_data.texture_indices1.x = add_texture(image_info);
+            }
+
+            ((MaterialData*)m_material_data_buffer->mapped_ptr())[m_material_count++] = material_data;
         }
+
+        glm::uvec2 pair               = glm::uvec2(submesh.base_index / 3, m_local_to_global_mat_idx[mat->id()]);
+        material_indices[submesh_idx] = pair;
     }
 
-    memcpy(m_material_data_buffer->mapped_ptr(), material_datas.data(), sizeof(MaterialData) * material_datas.size());
+    m_descriptors_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RayTracedScene::update_descriptor_set()
+{
+    auto backend = m_backend.lock();
+
+    // Descriptors can't be written while submitted work may still use the sets, so changed sets are replaced with new ones.
+    // The previous pool and sets are released through the deletion queue.
+    m_ds.clear();
+
+    // Partially bound arrays may be allocated with zero descriptors, but pool sizes can't be zero.
+    const uint32_t mesh_count = std::max<uint32_t>(m_meshes.size(), 1);
+
+    vk::DescriptorPool::Desc dp_desc;
+
+    dp_desc.set_max_sets(DESCRIPTOR_SET_COUNT)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_texture_capacity)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 + 3 * mesh_count)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1);
+
+    m_descriptor_pool = vk::DescriptorPool::create(backend, dp_desc);
+    m_descriptor_pool->set_name("Scene Descriptor Pool");
+
+    const uint32_t    variable_counts[DESCRIPTOR_SET_COUNT] = { m_texture_capacity, mesh_count, mesh_count, mesh_count };
+    const char* const set_names[DESCRIPTOR_SET_COUNT]       = { "Scene Descriptor Set", "Scene Vertex Buffers Descriptor Set", "Scene Index Buffers Descriptor Set", "Scene Material Indices Descriptor Set" };
+
+    for (uint32_t i = 0; i < DESCRIPTOR_SET_COUNT; i++)
+    {
+        VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_info;
+        DW_ZERO_MEMORY(variable_count_info);
+
+        variable_count_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        variable_count_info.descriptorSetCount = 1;
+        variable_count_info.pDescriptorCounts  = &variable_counts[i];
+
+        m_ds.push_back(vk::DescriptorSet::create(backend, m_ds_layouts[i], m_descriptor_pool, &variable_count_info));
+        m_ds.back()->set_name(set_names[i]);
+    }
 
     std::vector<VkWriteDescriptorSet> write_datas;
 
@@ -443,7 +713,7 @@ void RayTracedScene::create_gpu_resources()
     write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     write_data.pBufferInfo     = &material_buffer_info;
     write_data.dstBinding      = 0;
-    write_data.dstSet          = m_ds->handle();
+    write_data.dstSet          = m_ds[DESCRIPTOR_SET_SCENE]->handle();
 
     write_datas.push_back(write_data);
 
@@ -464,7 +734,7 @@ void RayTracedScene::create_gpu_resources()
     write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     write_data.pBufferInfo     = &instance_buffer_info;
     write_data.dstBinding      = 1;
-    write_data.dstSet          = m_ds->handle();
+    write_data.dstSet          = m_ds[DESCRIPTOR_SET_SCENE]->handle();
 
     write_datas.push_back(write_data);
 
@@ -488,7 +758,7 @@ void RayTracedScene::create_gpu_resources()
     write_data.descriptorCount = 1;
     write_data.descriptorType  = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
     write_data.dstBinding      = 2;
-    write_data.dstSet          = m_ds->handle();
+    write_data.dstSet          = m_ds[DESCRIPTOR_SET_SCENE]->handle();
 
     write_datas.push_back(write_data);
 
@@ -496,16 +766,16 @@ void RayTracedScene::create_gpu_resources()
     // Vertex Buffers
     // ------------------------------------------------------------------------------------------
 
-    if (vbo_descriptors.size() > 0)
+    if (m_vbo_descriptors.size() > 0)
     {
         DW_ZERO_MEMORY(write_data);
 
         write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write_data.descriptorCount = vbo_descriptors.size();
+        write_data.descriptorCount = m_vbo_descriptors.size();
         write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write_data.pBufferInfo     = vbo_descriptors.data();
-        write_data.dstBinding      = 3;
-        write_data.dstSet          = m_ds->handle();
+        write_data.pBufferInfo     = m_vbo_descriptors.data();
+        write_data.dstBinding      = 0;
+        write_data.dstSet          = m_ds[DESCRIPTOR_SET_VERTEX_BUFFERS]->handle();
 
         write_datas.push_back(write_data);
     }
@@ -514,16 +784,16 @@ void RayTracedScene::create_gpu_resources()
     // Index Buffers
     // ------------------------------------------------------------------------------------------
 
-    if (ibo_descriptors.size() > 0)
+    if (m_ibo_descriptors.size() > 0)
     {
         DW_ZERO_MEMORY(write_data);
 
         write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write_data.descriptorCount = ibo_descriptors.size();
+        write_data.descriptorCount = m_ibo_descriptors.size();
         write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write_data.pBufferInfo     = ibo_descriptors.data();
-        write_data.dstBinding      = 4;
-        write_data.dstSet          = m_ds->handle();
+        write_data.pBufferInfo     = m_ibo_descriptors.data();
+        write_data.dstBinding      = 0;
+        write_data.dstSet          = m_ds[DESCRIPTOR_SET_INDEX_BUFFERS]->handle();
 
         write_datas.push_back(write_data);
     }
@@ -532,16 +802,16 @@ void RayTracedScene::create_gpu_resources()
     // Material Indices Buffers
     // ------------------------------------------------------------------------------------------
 
-    if (material_indices_descriptors.size() > 0)
+    if (m_material_indices_descriptors.size() > 0)
     {
         DW_ZERO_MEMORY(write_data);
 
         write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write_data.descriptorCount = material_indices_descriptors.size();
+        write_data.descriptorCount = m_material_indices_descriptors.size();
         write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write_data.pBufferInfo     = material_indices_descriptors.data();
-        write_data.dstBinding      = 5;
-        write_data.dstSet          = m_ds->handle();
+        write_data.pBufferInfo     = m_material_indices_descriptors.data();
+        write_data.dstBinding      = 0;
+        write_data.dstSet          = m_ds[DESCRIPTOR_SET_MATERIAL_INDICES]->handle();
 
         write_datas.push_back(write_data);
     }
@@ -550,32 +820,34 @@ void RayTracedScene::create_gpu_resources()
     // Images
     // ------------------------------------------------------------------------------------------
 
-    if (image_descriptors.size() > 0)
+    if (m_image_descriptors.size() > 0)
     {
         DW_ZERO_MEMORY(write_data);
 
         write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write_data.descriptorCount = image_descriptors.size();
+        write_data.descriptorCount = m_image_descriptors.size();
         write_data.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        write_data.pImageInfo      = image_descriptors.data();
-        write_data.dstBinding      = 6;
-        write_data.dstSet          = m_ds->handle();
+        write_data.pImageInfo      = m_image_descriptors.data();
+        write_data.dstBinding      = 3;
+        write_data.dstSet          = m_ds[DESCRIPTOR_SET_SCENE]->handle();
 
         write_datas.push_back(write_data);
     }
 
     if (write_datas.size() > 0)
         vkUpdateDescriptorSets(backend->device(), write_datas.size(), write_datas.data(), 0, nullptr);
+
+    m_descriptors_dirty = false;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void RayTracedScene::copy_tlas_data()
+uint32_t RayTracedScene::copy_tlas_data()
 {
-    m_instance_datas.clear();
-    m_rt_instances.clear();
+    InstanceData*                       instance_datas = (InstanceData*)m_instance_data_buffer->mapped_ptr();
+    VkAccelerationStructureInstanceKHR* rt_instances   = (VkAccelerationStructureInstanceKHR*)m_tlas_instance_buffer->mapped_ptr();
 
-    for (uint32_t i = 0; i < m_instances.size(); i++)
+    for (uint32_t i : m_dirty_instances)
     {
         const Instance& instance = m_instances[i];
         const auto&     mesh     = instance.mesh.lock();
@@ -583,34 +855,43 @@ void RayTracedScene::copy_tlas_data()
         // ------------------------------------------------------------------------------------------
         // Instance Data
         // ------------------------------------------------------------------------------------------
-        InstanceData instance_data;
+        InstanceData& instance_data = m_instance_datas[i];
 
         // Set mesh data index
         instance_data.mesh_index   = m_local_to_global_mesh_idx[mesh->id()];
         instance_data.model_matrix = instance.transform;
 
-        m_instance_datas.emplace_back(instance_data);
+        instance_datas[i] = instance_data;
 
         // ------------------------------------------------------------------------------------------
         // VkAccelerationStructureInstanceKHR
         // ------------------------------------------------------------------------------------------
-        VkAccelerationStructureInstanceKHR rt_instance;
+        VkAccelerationStructureInstanceKHR& rt_instance = m_rt_instances[i];
+
+        // A refit can only move instances, pointing one at a different BLAS needs a full build.
+        if (m_tlas_built && rt_instance.accelerationStructureReference != mesh->acceleration_structure()->device_address())
+            m_rebuild_tlas = true;
 
         glm::mat3x4 transform = glm::mat3x4(glm::transpose(instance.transform));
 
         memcpy(&rt_instance.transform, &transform, sizeof(rt_instance.transform));
 
-        rt_instance.instanceCustomIndex                    = m_rt_instances.size();
+        rt_instance.instanceCustomIndex                    = i;
         rt_instance.mask                                   = 0xFF;
         rt_instance.instanceShaderBindingTableRecordOffset = 0;
         rt_instance.flags                                  = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
         rt_instance.accelerationStructureReference         = mesh->acceleration_structure()->device_address();
 
-        m_rt_instances.emplace_back(rt_instance);
+        rt_instances[i] = rt_instance;
+
+        m_instance_dirty[i] = 0;
     }
 
-    memcpy(m_instance_data_buffer->mapped_ptr(), m_instance_datas.data(), sizeof(InstanceData) * m_instance_datas.size());
-    memcpy(m_tlas_instance_buffer->mapped_ptr(), m_rt_instances.data(), sizeof(VkAccelerationStructureInstanceKHR) * m_rt_instances.size());
+    const uint32_t written = m_dirty_instances.size();
+
+    m_dirty_instances.clear();
+
+    return written;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
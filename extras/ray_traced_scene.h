@@ -18,26 +18,72 @@ public:
         std::weak_ptr<Mesh> mesh;
     };
 
+    // Only the last binding of a set can have a variable descriptor count, so every bindless array gets a set of its own. The
+    // sets are bound in this order.
+    enum DescriptorSetIndex
+    {
+        DESCRIPTOR_SET_SCENE            = 0, // Material data, instance data, the TLAS and the textures.
+        DESCRIPTOR_SET_VERTEX_BUFFERS   = 1,
+        DESCRIPTOR_SET_INDEX_BUFFERS    = 2,
+        DESCRIPTOR_SET_MATERIAL_INDICES = 3,
+        DESCRIPTOR_SET_COUNT            = 4
+    };
+
+    struct TLASStats
+    {
+        uint32_t instances_written = 0; // Instances written by the last build_tlas() call.
+        uint32_t build_count       = 0;
+        uint32_t refit_count       = 0;
+        uint32_t skipped_count     = 0; // Calls where nothing had changed.
+    };
+
     static RayTracedScene::Ptr create(vk::Backend::Ptr backend, std::vector<Instance> instances);
 
     ~RayTracedScene();
 
+    // Meshes and materials seen for the first time are registered, the GPU buffers grow as needed. Returns the instance index.
+    uint32_t  add_instance(const Instance& instance);
+    // The last instance is moved into the removed slot and takes over its index. Meshes and materials stay registered. Returns
+    // false if the index is out of range.
+    bool      remove_instance(const uint32_t& idx);
+
+    // Only the instances that changed since the last call are written. When only transforms changed the TLAS is refit in
+    // place, a full build is done after a number of consecutive refits to limit the loss of trace quality.
     void      build_tlas(vk::CommandBuffer::Ptr cmd_buffer);
+    // The instance is marked as changed, since the returned reference may be used to modify it.
     Instance& fetch_instance(const uint32_t& idx);
+    void      set_transform(const uint32_t& idx, const glm::mat4& transform);
+    // Forces the next build_tlas() call to do a full build.
+    void      request_rebuild();
     int32_t   material_index(const uint32_t& id);
-    
+
+    inline void             set_max_refits(uint32_t count) { m_max_refits = count; }
+    inline const TLASStats& tlas_stats() { return m_tlas_stats; }
+
     inline uint32_t id() { return m_id; }
     inline glm::vec3 min_extents() { return m_min_extents; }
     inline glm::vec3 max_extents() { return m_max_extents; }
-    inline const std::vector<Instance>&   instances() { return m_instances; }
-    inline vk::DescriptorSetLayout::Ptr   descriptor_set_layout() { return m_ds_layout; }
-    inline vk::DescriptorSet::Ptr         descriptor_set() { return m_ds; }
-    inline vk::AccelerationStructure::Ptr acceleration_structure() { return m_tlas; }
+    inline const std::vector<Instance>&                     instances() { return m_instances; }
+    inline const std::vector<vk::DescriptorSetLayout::Ptr>& descriptor_set_layouts() { return m_ds_layouts; }
+    inline vk::AccelerationStructure::Ptr                   acceleration_structure() { return m_tlas; }
+
+    // The sets are replaced when a capacity grew or a mesh was registered, so they should be fetched every frame. Indexed by
+    // DescriptorSetIndex.
+    const std::vector<vk::DescriptorSet::Ptr>& descriptor_sets();
 
 private:
     RayTracedScene(vk::Backend::Ptr backend, std::vector<Instance> instances);
-    void create_gpu_resources();
-    void copy_tlas_data();
+    void    reserve_instances(uint32_t capacity);
+    void    reserve_materials(uint32_t capacity);
+    // Returns -1 when the texture limit is reached.
+    int32_t add_texture(const VkDescriptorImageInfo& image_info);
+    void    register_mesh(Mesh::Ptr mesh);
+    void    update_descriptor_set();
+    void    mark_dirty(uint32_t idx);
+    // Marks the instances of meshes whose BLAS was replaced since the last call, since the TLAS still points at the old one.
+    void    mark_replaced_blas_dirty();
+    // Returns the number of instances written.
+    uint32_t copy_tlas_data();
 
 private:
     struct InstanceData
@@ -52,16 +98,33 @@ private:
     glm::vec3                                       m_min_extents;
     glm::vec3                                       m_max_extents;
     vk::DescriptorPool::Ptr                         m_descriptor_pool;
-    vk::DescriptorSetLayout::Ptr                    m_ds_layout;
-    vk::DescriptorSet::Ptr                          m_ds;
+    std::vector<vk::DescriptorSetLayout::Ptr>       m_ds_layouts;
+    std::vector<vk::DescriptorSet::Ptr>             m_ds;
     vk::Buffer::Ptr                                 m_material_data_buffer;
     vk::Buffer::Ptr                                 m_instance_data_buffer;
     std::vector<vk::Buffer::Ptr>                    m_material_indices_buffers;
     std::vector<Instance>                           m_instances;
     std::vector<std::weak_ptr<Mesh>>                m_meshes;
+    std::vector<uint32_t>                           m_blas_generations; // Generation of each mesh's BLAS when last written.
     std::vector<VkAccelerationStructureInstanceKHR> m_rt_instances;
     std::vector<InstanceData>                       m_instance_datas;
-    bool                                            m_tlas_built = false;
+    std::vector<uint8_t>                            m_instance_dirty;
+    std::vector<uint32_t>                           m_dirty_instances;
+    std::vector<VkDescriptorBufferInfo>             m_vbo_descriptors;
+    std::vector<VkDescriptorBufferInfo>             m_ibo_descriptors;
+    std::vector<VkDescriptorBufferInfo>             m_material_indices_descriptors;
+    std::vector<VkDescriptorImageInfo>              m_image_descriptors;
+    uint32_t                                        m_instance_capacity = 0;
+    uint32_t                                        m_material_capacity = 0;
+    uint32_t                                        m_material_count    = 0;
+    uint32_t                                        m_texture_capacity  = 0;
+    uint32_t                                        m_max_textures      = 0;
+    bool                                            m_descriptors_dirty = true;
+    bool                                            m_tlas_built     = false;
+    bool                                            m_rebuild_tlas   = true;
+    uint32_t                                        m_refits         = 0; // Consecutive refits since the last full build.
+    uint32_t                                        m_max_refits     = 64;
+    TLASStats                                       m_tlas_stats;
     vk::AccelerationStructure::Ptr                  m_tlas;
     vk::Buffer::Ptr                                 m_tlas_instance_buffer;
     vk::Buffer::Ptr                                 m_tlas_scratch_buffer;
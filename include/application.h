@@ -3,6 +3,7 @@
 #include <debug_draw.h>
 #include <stdint.h>
 #include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 #ifdef __EMSCRIPTEN__
@@ -38,12 +39,18 @@ struct AppSettings
     int         width      = 800;
     int         height     = 600;
     std::string title      = "dwSampleFramwork";
+    // Renders offscreen without a window. Vulkan uses vk::Backend::create_headless(), OpenGL an EGL context (Linux only).
+    bool        headless             = false;
+    uint32_t    headless_frame_count = 0; // Headless applications exit after this many frames, 0 runs until request_exit().
 
 #if defined(DWSF_VULKAN)
     std::vector<const char*> device_extensions;
     bool                     enable_validation       = false;
     bool                     enable_nsight_aftermath = false;
     bool                     ray_tracing             = false;
+    std::string              pipeline_cache_path     = "pipeline_cache.bin"; // Empty disables the pipeline cache.
+    uint32_t                 frames_in_flight        = vk::Backend::kMaxFramesInFlight; // 1 to kMaxFramesInFlight, fewer lowers the latency.
+    bool                     present_wait            = false; // Waits until the previous frame is displayed, needs VK_KHR_present_wait.
 #else
     int  major_ver             = 4;
     bool enable_debug_callback = false;
@@ -95,6 +102,9 @@ protected:
     void request_exit() const;
     bool exit_requested() const;
 
+    // Seconds since the application was initialized. Unlike glfwGetTime() this also works for headless applications.
+    double elapsed_time() const;
+
     // Life cycle hooks. Override these!
     virtual bool init(int argc, const char* argv[]);
     virtual void update(double delta);
@@ -105,6 +115,13 @@ protected:
     void render_gui(vk::CommandBuffer::Ptr cmd_buf);
 #    endif
     void submit_and_present(const std::vector<vk::CommandBuffer::Ptr>& cmd_bufs);
+#else
+    // Binds the framebuffer that stands in for the default framebuffer. Headless applications have no default framebuffer and
+    // render into an offscreen one instead, which can be read back through back_buffer_texture().
+    void bind_back_buffer();
+
+    inline gl::Framebuffer::Ptr back_buffer() { return m_back_buffer; } // Null when rendering to a window.
+    inline gl::Texture2D::Ptr   back_buffer_texture() { return m_back_buffer_color; }
 #endif
 
 private:
@@ -120,32 +137,52 @@ private:
     // Load config from file method
     void load_initial_settings_from_file(AppSettings& settings);
 
+#if defined(DWSF_VULKAN)
+    void create_render_complete_semaphores();
+#else
+    // Headless OpenGL
+    bool create_headless_context(int major_ver, int minor_ver);
+    void destroy_headless_context();
+#endif
+
 protected:
-    uint32_t                            m_width;
-    uint32_t                            m_height;
-    bool                                m_vsync = false;
-    double                              m_mouse_x;
-    double                              m_mouse_y;
-    double                              m_last_mouse_x;
-    double                              m_last_mouse_y;
-    double                              m_mouse_delta_x;
-    double                              m_mouse_delta_y;
-    double                              m_delta;
-    double                              m_delta_seconds;
-    uint32_t                            m_frame_index = 0;
-    std::string                         m_title;
-    std::array<bool, MAX_KEYS>          m_keys;
-    std::array<bool, MAX_MOUSE_BUTTONS> m_mouse_buttons;
-    GLFWwindow*                         m_window;
-    Timer                               m_timer;
-    DebugDraw                           m_debug_draw;
+    uint32_t                              m_width;
+    uint32_t                              m_height;
+    bool                                  m_vsync = false;
+    double                                m_mouse_x;
+    double                                m_mouse_y;
+    double                                m_last_mouse_x;
+    double                                m_last_mouse_y;
+    double                                m_mouse_delta_x;
+    double                                m_mouse_delta_y;
+    double                                m_delta;
+    double                                m_delta_seconds;
+    uint32_t                              m_frame_index = 0;
+    std::string                           m_title;
+    std::array<bool, MAX_KEYS>            m_keys;
+    std::array<bool, MAX_MOUSE_BUTTONS>   m_mouse_buttons;
+    GLFWwindow*                           m_window;
+    Timer                                 m_timer;
+    DebugDraw                             m_debug_draw;
+    bool                                  m_headless             = false;
+    uint32_t                              m_headless_frame_count = 0;
+    mutable bool                          m_exit_requested       = false; // Set by request_exit() when there is no window to close.
+    std::chrono::steady_clock::time_point m_start_time;
 
 #if defined(DWSF_VULKAN)
     bool                            m_should_recreate_swap_chain = false;
     vk::Backend::Ptr                m_vk_backend;
-    std::vector<vk::Fence::Ptr>     m_render_complete_fences;
+    std::vector<vk::Ticket>         m_frame_tickets;
     std::vector<vk::Semaphore::Ptr> m_present_complete_semaphores;
     std::vector<vk::Semaphore::Ptr> m_render_complete_semaphores;
+#else
+    // EGL handles, kept opaque so that the EGL headers are only needed by the implementation.
+    void*                m_egl_display = nullptr;
+    void*                m_egl_context = nullptr;
+    void*                m_egl_surface = nullptr;
+    gl::Texture2D::Ptr   m_back_buffer_color;
+    gl::Texture2D::Ptr   m_back_buffer_depth;
+    gl::Framebuffer::Ptr m_back_buffer;
 #endif
 };
 } // namespace dw
@@ -90,7 +90,8 @@ public:
     void frustum(const glm::mat4& proj, const glm::mat4& view, const glm::vec3& c);
     void transform(const glm::mat4& trans, const float& axis_length = 5.0f);
 
-    // Render method. Pass in target Framebuffer, viewport size and view-projection matrix.
+    // Render method. Pass in target Framebuffer, viewport size and view-projection matrix. A null Framebuffer renders to the
+    // back buffer, which is an offscreen one for headless OpenGL contexts.
 #if defined(DWSF_VULKAN)
     void render(vk::Backend::Ptr backend, vk::CommandBuffer::Ptr cmd_buffer, int width, int height, const glm::mat4& view_proj, const glm::vec3& view_pos);
 #else
@@ -5,6 +5,7 @@
 #include <glm.hpp>
 #include <ogl.h>
 #include <vk.h>
+#include <mip_generator.h>
 #include <memory>
 
 namespace dw
@@ -24,7 +25,12 @@ public:
         const int32_t&                  normal_idx,
         const glm::ivec2&               roughness_idx,
         const glm::ivec2&               metallic_idx,
-        const int32_t&                  emissive_idx);
+        const int32_t&                  emissive_idx
+#if defined(DWSF_VULKAN)
+        ,
+        vk::BatchUploader* uploader = nullptr
+#endif
+    );
 
     // Custom factory method for creating a material from provided data.
     static Material::Ptr create(glm::vec4 albedo    = glm::vec4(1.0f),
@@ -34,6 +40,13 @@ public:
 
     static bool is_loaded(const std::string& name);
 
+    // Total number of texture bytes that did not have to be allocated because an identical file was already loaded under a different path.
+    static inline uint64_t deduplicated_texture_bytes() { return m_deduplicated_texture_bytes; }
+
+    // Makes subsequently loaded textures build their mip chains on the CPU with the given settings. Pass nullptr to go back to GPU generated mips.
+    // The sRGB flag is derived from each texture, and alpha coverage is only preserved for albedo textures.
+    static void set_mip_generation(const mip_generator::Desc* desc);
+
     ~Material();
 
     inline uint32_t  id() { return m_id; }
@@ -51,10 +64,10 @@ public:
     inline int32_t roughness_channel() { return m_roughness_channel; }
     inline int32_t metallic_channel() { return m_metallic_channel; }
 
-    inline void set_albedo_value(const glm::vec4& value) { m_albedo_color = value; }
-    inline void set_roughness_value(const float& value) { m_roughness = value; }
-    inline void set_metallic_value(const float& value) { m_metallic = value; }
-    inline void set_emissive_value(const glm::vec3& value) { m_emissive_color = value; }
+    void        set_albedo_value(const glm::vec4& value);
+    void        set_roughness_value(const float& value);
+    void        set_metallic_value(const float& value);
+    void        set_emissive_value(const glm::vec3& value);
     inline void set_alpha_test(const bool& value) { m_alpha_test = value; }
 
     // Texture factory methods.
@@ -73,9 +86,21 @@ public:
     inline vk::Image::Ptr                      roughness_image() { return m_roughness_idx != -1 ? m_images[m_roughness_idx] : nullptr; }
     inline vk::Image::Ptr                      metallic_image() { return m_metallic_idx != -1 ? m_images[m_metallic_idx] : nullptr; }
     inline vk::Image::Ptr                      emissive_image() { return m_emissive_idx != -1 ? m_images[m_emissive_idx] : nullptr; }
-    inline vk::DescriptorSet::Ptr              descriptor_set() { return m_descriptor_set; }
+    // Allocated on first use, materials that are only drawn through the bindless table never allocate one.
+    vk::DescriptorSet::Ptr                     descriptor_set();
     static inline vk::Sampler::Ptr             common_sampler() { return m_common_sampler; }
     static inline vk::DescriptorSetLayout::Ptr descriptor_set_layout() { return m_common_ds_layout; }
+
+    // Bindless material table. Every Material owns an entry in a global material storage buffer (binding 0) and its
+    // textures are written into a descriptor-indexed texture array (binding 1), so a scene can be drawn with one bind.
+    // The buffer holds one copy of the table per frame in flight, each with its own set. Material changes are written into
+    // the copy of a frame when its set is fetched, which must happen after the frame was begun so the GPU has retired it.
+    static const uint32_t                      kMaxBindlessMaterials = 4096;
+    static const uint32_t                      kMaxBindlessTextures  = 4096;
+    static inline vk::DescriptorSetLayout::Ptr bindless_descriptor_set_layout() { return m_bindless_ds_layout; }
+    static vk::DescriptorSet::Ptr              bindless_descriptor_set();
+    static inline vk::Buffer::Ptr              bindless_material_buffer() { return m_bindless_material_buffer; }
+    inline int32_t                             bindless_idx() { return m_bindless_idx; }
 #else
     // Rendering related getters.
     inline gl::Texture2D::Ptr       albedo_texture() { return m_albedo_idx != -1 ? m_textures[m_albedo_idx] : nullptr; }
@@ -88,10 +113,16 @@ public:
 
 private:
 #if defined(DWSF_VULKAN)
-    static vk::Image::Ptr     load_image(vk::Backend::Ptr backend, const std::string& path, bool srgb = false);
-    static vk::ImageView::Ptr load_image_view(vk::Backend::Ptr backend, const std::string& path, vk::Image::Ptr image);
+    static vk::Image::Ptr     load_image(vk::Backend::Ptr backend, const std::string& path, bool srgb = false, vk::BatchUploader* uploader = nullptr);
+    static vk::ImageView::Ptr load_image_view(vk::Backend::Ptr backend, vk::Image::Ptr image);
 
-    vk::DescriptorSet::Ptr create_descriptor_set(vk::Backend::Ptr backend);
+    vk::DescriptorSet::Ptr create_descriptor_set();
+
+    void           register_bindless();
+    void           unregister_bindless();
+    void           write_bindless_data();
+    static int32_t acquire_bindless_texture(vk::ImageView::Ptr image_view);
+    static void    release_bindless_texture(vk::ImageView::Ptr image_view);
 #else
     static gl::Texture2D::Ptr       load_texture(const std::string& path, bool srgb = false);
 #endif
@@ -107,12 +138,30 @@ private:
         const int32_t&                  normal_idx,
         const glm::ivec2&               roughness_idx,
         const glm::ivec2&               metallic_idx,
-        const int32_t&                  emissive_idx);
+        const int32_t&                  emissive_idx
+#if defined(DWSF_VULKAN)
+        ,
+        vk::BatchUploader* uploader
+#endif
+    );
     Material();
 
 private:
+    // Content cache entry. A hash hit is only used if the size, color space and bytes of the file it was loaded from all match.
+    template <typename T>
+    struct ContentCacheEntry
+    {
+        size_t           size;
+        bool             srgb;
+        std::string      path;
+        std::weak_ptr<T> texture;
+    };
+
     // Material cache.
     static std::unordered_map<std::string, std::weak_ptr<Material>> m_cache;
+    static uint64_t                                                 m_deduplicated_texture_bytes;
+    static bool                                                     m_cpu_mip_generation;
+    static mip_generator::Desc                                      m_mip_generation_desc;
 
     int32_t   m_albedo_idx        = -1;
     int32_t   m_normal_idx        = -1;
@@ -135,19 +184,37 @@ private:
     std::vector<vk::ImageView::Ptr> m_image_views;
 
     vk::DescriptorSet::Ptr m_descriptor_set;
-
-    // Texture cache.
-    static std::unordered_map<std::string, std::weak_ptr<vk::Image>>     m_image_cache;
-    static std::unordered_map<std::string, std::weak_ptr<vk::ImageView>> m_image_view_cache;
-    static vk::DescriptorSetLayout::Ptr                                  m_common_ds_layout;
-    static vk::Sampler::Ptr                                              m_common_sampler;
-    static vk::Image::Ptr                                                m_default_image;
-    static vk::ImageView::Ptr                                            m_default_image_view;
+    int32_t                m_bindless_idx            = -1;
+    int32_t                m_bindless_texture_idx[5] = { -1, -1, -1, -1, -1 };
+
+    // Texture cache. Images are looked up by path first and then by a hash of the file contents.
+    static std::unordered_map<std::string, std::weak_ptr<vk::Image>>       m_image_cache;
+    static std::unordered_multimap<uint64_t, ContentCacheEntry<vk::Image>> m_image_hash_cache;
+    static std::unordered_map<vk::Image*, std::weak_ptr<vk::ImageView>>    m_image_view_cache;
+    static vk::DescriptorSetLayout::Ptr                                    m_common_ds_layout;
+    static vk::Sampler::Ptr                                                m_common_sampler;
+    static vk::Image::Ptr                                                  m_default_image;
+    static vk::ImageView::Ptr                                              m_default_image_view;
+
+    // Bindless material table.
+    static vk::DescriptorPool::Ptr                        m_bindless_descriptor_pool;
+    static vk::DescriptorSetLayout::Ptr                   m_bindless_ds_layout;
+    static std::vector<vk::DescriptorSet::Ptr>            m_bindless_ds; // One per frame in flight.
+    static vk::Buffer::Ptr                                m_bindless_material_buffer;
+    static size_t                                         m_bindless_table_size;
+    static std::vector<std::vector<uint32_t>>             m_bindless_pending_slots; // Slots to write per frame in flight.
+    static uint32_t                                       m_bindless_material_count;
+    static std::vector<uint32_t>                          m_bindless_free_material_slots;
+    static uint32_t                                       m_bindless_texture_count;
+    static std::vector<uint32_t>                          m_bindless_free_texture_slots;
+    static std::unordered_map<vk::ImageView*, glm::uvec2> m_bindless_texture_slots; // x: slot, y: reference count
+    static uint32_t                                       m_bindless_generation; // Slots freed before a shutdown aren't returned to the next table.
 #else
     std::vector<gl::Texture2D::Ptr> m_textures;
 
-    // Texture cache.
-    static std::unordered_map<std::string, std::weak_ptr<gl::Texture2D>> m_texture_cache;
+    // Texture cache. Textures are looked up by path first and then by a hash of the file contents.
+    static std::unordered_map<std::string, std::weak_ptr<gl::Texture2D>>       m_texture_cache;
+    static std::unordered_multimap<uint64_t, ContentCacheEntry<gl::Texture2D>> m_texture_hash_cache;
 #endif
 };
 } // namespace dw
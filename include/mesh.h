@@ -27,6 +27,7 @@ struct SubMesh
 {
     std::string name;
     uint32_t    mat_idx;
+    int32_t     bindless_mat_idx = -1; // Index of the material in the global bindless material table (Vulkan only).
     uint32_t    index_count;
     uint32_t    base_vertex;
     uint32_t    base_index;
@@ -42,14 +43,21 @@ public:
 
     static bool is_loaded(const std::string& name);
 
-    // Static factory methods.
+    // Static factory methods. When an uploader is given every upload of the load is only recorded into it, so that the caller
+    // can submit it with submit_async() and poll the ticket instead of blocking. The mesh must not be drawn before then.
+    // Otherwise the uploads are submitted and waited for before returning.
     static Mesh::Ptr load(
 #if defined(DWSF_VULKAN)
         vk::Backend::Ptr backend,
 #endif
         const std::string& path,
         bool               load_materials = true,
-        bool               is_orca_mesh   = false);
+        bool               is_orca_mesh   = false
+#if defined(DWSF_VULKAN)
+        ,
+        vk::BatchUploader* uploader = nullptr
+#endif
+    );
     // Custom factory method for creating a mesh from provided data.
     static Mesh::Ptr load(
 #if defined(DWSF_VULKAN)
@@ -61,14 +69,21 @@ public:
         std::vector<SubMesh>                   sub_meshes,
         std::vector<std::shared_ptr<Material>> materials,
         glm::vec3                              max_extents,
-        glm::vec3                              min_extents);
+        glm::vec3                              min_extents
+#if defined(DWSF_VULKAN)
+        ,
+        vk::BatchUploader* uploader = nullptr
+#endif
+    );
 
     bool set_submesh_material(std::string name, std::shared_ptr<Material> material);
     bool set_submesh_material(uint32_t mesh_idx, std::shared_ptr<Material> material);
     void set_global_material(std::shared_ptr<Material> material);
 
 #if defined(DWSF_VULKAN)
-    void initialize_for_ray_tracing(vk::Backend::Ptr backend);
+    // When an uploader is given the BLAS build is only recorded into it, so that the builds of many meshes are submitted
+    // together. Otherwise it is built and compacted immediately.
+    void initialize_for_ray_tracing(vk::Backend::Ptr backend, vk::BatchUploader* uploader = nullptr);
 
     // Rendering-related getters.
     inline vk::Buffer::Ptr                 vertex_buffer() { return m_vbo; }
@@ -98,6 +113,8 @@ public:
     inline std::shared_ptr<Material>&                    material(uint32_t idx) { return m_materials[idx]; }
     inline const glm::vec3&                              max_extents() { return m_max_extents; }
     inline const glm::vec3&                              min_extents() { return m_min_extents; }
+    inline uint64_t                                      deduplicated_texture_bytes() { return m_deduplicated_texture_bytes; }
+    inline uint32_t                                      upload_submit_count() { return m_upload_submit_count; } // 0 when loaded into a caller's uploader.
     ~Mesh();
 
 private:
@@ -105,7 +122,8 @@ private:
     Mesh();
     Mesh(
 #if defined(DWSF_VULKAN)
-        vk::Backend::Ptr backend,
+        vk::Backend::Ptr   backend,
+        vk::BatchUploader* uploader,
 #endif
         const std::string& path,
         bool               load_materials,
@@ -114,18 +132,24 @@ private:
     // Internal initialization methods.
     void create_gpu_objects(
 #if defined(DWSF_VULKAN)
-        vk::Backend::Ptr backend
+        vk::Backend::Ptr   backend,
+        vk::BatchUploader* uploader
 #endif
     );
 
     void load_from_disk(
 #if defined(DWSF_VULKAN)
-        vk::Backend::Ptr backend,
+        vk::Backend::Ptr   backend,
+        vk::BatchUploader* uploader,
 #endif
         const std::string& path,
         bool               load_materials,
         bool               is_orca_mesh);
 
+#if defined(DWSF_VULKAN)
+    void update_bindless_material_indices();
+#endif
+
 private:
     // Mesh cache. Used to prevent multiple loads.
     static std::unordered_map<std::string, std::weak_ptr<Mesh>> m_cache;
@@ -138,6 +162,8 @@ private:
     std::vector<SubMesh>                   m_sub_meshes;
     glm::vec3                              m_max_extents;
     glm::vec3                              m_min_extents;
+    uint64_t                               m_deduplicated_texture_bytes = 0;
+    uint32_t                               m_upload_submit_count        = 0;
 
     // GPU resources.
 #if defined(DWSF_VULKAN)
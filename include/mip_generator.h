@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace dw
+{
+namespace mip_generator
+{
+enum MipFilter
+{
+    MIP_FILTER_BOX     = 0,
+    MIP_FILTER_KAISER  = 1,
+    MIP_FILTER_LANCZOS = 2
+};
+
+struct Desc
+{
+    MipFilter filter                  = MIP_FILTER_KAISER;
+    bool      srgb                    = false; // Color channels are stored in sRGB and are filtered in linear space.
+    bool      wrap                    = true;  // Sample across the image edges as if the texture tiles, otherwise clamp.
+    bool      preserve_alpha_coverage = false; // Rescale alpha per level so that the alpha tested coverage matches the top level.
+    float     alpha_cutoff            = 0.5f;
+    uint32_t  mip_levels              = 0; // Number of levels including the top level. 0 generates the full chain.
+    uint32_t  num_threads             = 0; // 0 uses every hardware thread.
+
+    Desc& set_filter(MipFilter value);
+    Desc& set_srgb(bool value);
+    Desc& set_wrap(bool value);
+    Desc& set_preserve_alpha_coverage(bool value, float cutoff = 0.5f);
+    Desc& set_mip_levels(uint32_t value);
+    Desc& set_num_threads(uint32_t value);
+};
+
+// A single tightly packed mip level in the same pixel format as the source.
+struct MipLevel
+{
+    uint32_t             width  = 0;
+    uint32_t             height = 0;
+    std::vector<uint8_t> data;
+};
+
+// Returns the number of levels in a full mip chain for the given extents.
+extern uint32_t full_mip_chain_length(uint32_t width, uint32_t height);
+
+// Generates the mip chain of an 8-bit per channel image. The top level is copied into the first entry of the output.
+extern bool generate(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, const Desc& desc, std::vector<MipLevel>& out_levels);
+
+// Generates the mip chain of a 32-bit float per channel image. The sRGB flag is ignored and negative filter lobes are clamped to zero.
+extern bool generate(const float* pixels, uint32_t width, uint32_t height, uint32_t channels, const Desc& desc, std::vector<MipLevel>& out_levels);
+} // namespace mip_generator
+} // namespace dw
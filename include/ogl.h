@@ -54,6 +54,11 @@
 
 namespace dw
 {
+namespace mip_generator
+{
+struct Desc;
+} // namespace mip_generator
+
 namespace gl
 {
 class Object
@@ -162,7 +167,8 @@ public:
     using Ptr = std::shared_ptr<Texture2D>;
 
     static Texture2D::Ptr create(uint32_t w, uint32_t h, uint32_t array_size, int32_t mip_levels, uint32_t num_samples, GLenum internal_format, GLenum format, GLenum type);
-    static Texture2D::Ptr create_from_file(std::string path, bool flip_vertical = true, bool srgb = false);
+    // When a mip generator desc is given the mip chain is filtered on the CPU instead of using glGenerateMipmap.
+    static Texture2D::Ptr create_from_file(std::string path, bool flip_vertical = true, bool srgb = false, const mip_generator::Desc* mip_desc = nullptr);
 
     ~Texture2D();
     void     write_data(int array_index, int mip_level, void* data);
@@ -338,6 +344,12 @@ public:
 
     void set_name(const std::string& name);
 
+    // Stands in for the default framebuffer of contexts that have no usable one, such as headless contexts. Only a weak
+    // reference is kept.
+    static void set_default(Framebuffer::Ptr fbo);
+    // Binds the framebuffer set through set_default(), or the default framebuffer if there is none.
+    static void bind_default();
+
 private:
     Framebuffer(std::vector<Texture::Ptr> color_attachments, Texture::Ptr depth_stencil_attachment);
 
@@ -346,6 +358,8 @@ private:
 
 private:
     GLuint m_gl_fbo;
+
+    static std::weak_ptr<Framebuffer> m_default;
 };
 
 class Shader : public Object
@@ -0,0 +1,229 @@
+#pragma once
+
+#if defined(DWSF_VULKAN)
+
+#    include <vk.h>
+#    include <functional>
+
+namespace dw
+{
+namespace vk
+{
+// A frame graph over the backend. Passes declare the resources they read and write, and the graph then works out the order
+// of barriers, culls passes whose results are never used and places transient resources with disjoint lifetimes into shared
+// memory. Passes execute in declaration order.
+//
+// compile() only looks at the declarations and the memory requirements of the transient resources, so it can run without a
+// device when the requirement callbacks are provided. execute() creates the transient resources and records the passes.
+//
+// Accesses always cover every subresource of a resource.
+class RenderGraph
+{
+public:
+    using Ptr            = std::shared_ptr<RenderGraph>;
+    using ResourceHandle = uint32_t;
+
+    static const ResourceHandle kInvalidHandle = UINT32_MAX;
+
+    struct ImageDesc
+    {
+        VkImageType           type         = VK_IMAGE_TYPE_2D;
+        uint32_t              width        = 1;
+        uint32_t              height       = 1;
+        uint32_t              depth        = 1;
+        uint32_t              mip_levels   = 1;
+        uint32_t              array_size   = 1;
+        VkFormat              format       = VK_FORMAT_UNDEFINED;
+        VkImageUsageFlags     usage        = 0;
+        VkSampleCountFlagBits sample_count = VK_SAMPLE_COUNT_1_BIT;
+        VkImageCreateFlags    flags        = 0;
+
+        ImageDesc& set_type(VkImageType value);
+        ImageDesc& set_extents(uint32_t w, uint32_t h, uint32_t d = 1);
+        ImageDesc& set_mip_levels(uint32_t value);
+        ImageDesc& set_array_size(uint32_t value);
+        ImageDesc& set_format(VkFormat value);
+        ImageDesc& set_usage(VkImageUsageFlags value);
+        ImageDesc& set_sample_count(VkSampleCountFlagBits value);
+        ImageDesc& set_flags(VkImageCreateFlags value);
+    };
+
+    struct BufferDesc
+    {
+        size_t             size  = 0;
+        VkBufferUsageFlags usage = 0;
+
+        BufferDesc& set_size(size_t value);
+        BufferDesc& set_usage(VkBufferUsageFlags value);
+    };
+
+    using ExecuteCallback            = std::function<void(CommandBuffer::Ptr cmd_buf, RenderGraph* graph)>;
+    using ImageRequirementsCallback  = std::function<VkMemoryRequirements(const ImageDesc& desc)>;
+    using BufferRequirementsCallback = std::function<VkMemoryRequirements(const BufferDesc& desc)>;
+
+    // A pass that both reads and writes a resource has a single access with both flags set.
+    struct Access
+    {
+        ResourceHandle        resource;
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2        access;
+        VkImageLayout         layout;
+        bool                  read;
+        bool                  write;
+    };
+
+    class Pass
+    {
+    public:
+        Pass& read_texture(ResourceHandle resource, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        Pass& read_storage_image(ResourceHandle resource, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        Pass& write_storage_image(ResourceHandle resource, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        Pass& write_color(ResourceHandle resource);
+        Pass& read_depth(ResourceHandle resource);
+        Pass& write_depth(ResourceHandle resource);
+        Pass& read_buffer(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        Pass& write_buffer(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+        Pass& read(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+        Pass& write(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+        // Passes with side effects outside of the graph (e.g. readbacks) are never culled.
+        Pass& set_side_effect(bool value = true);
+
+        inline const std::string&         name() { return m_name; }
+        inline const std::vector<Access>& accesses() { return m_accesses; }
+
+    private:
+        friend class RenderGraph;
+
+        Pass& add_access(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access, VkImageLayout layout, bool write);
+
+    private:
+        std::string         m_name;
+        ExecuteCallback     m_execute;
+        std::vector<Access> m_accesses;
+        bool                m_side_effect = false;
+        bool                m_culled      = false;
+    };
+
+    struct Barrier
+    {
+        ResourceHandle        resource;
+        VkPipelineStageFlags2 src_stage;
+        VkAccessFlags2        src_access;
+        VkPipelineStageFlags2 dst_stage;
+        VkAccessFlags2        dst_access;
+        VkImageLayout         old_layout;
+        VkImageLayout         new_layout;
+    };
+
+    // The barriers recorded before a pass, merged into a single pipeline barrier.
+    struct CompiledPass
+    {
+        uint32_t             pass;
+        std::vector<Barrier> barriers;
+    };
+
+    // Transient resources are placed into heaps, images and buffers never share a heap.
+    struct Heap
+    {
+        VkDeviceSize size             = 0;
+        VkDeviceSize alignment        = 1;
+        uint32_t     memory_type_bits = UINT32_MAX;
+        bool         images           = true;
+    };
+
+    struct Placement
+    {
+        uint32_t     heap   = UINT32_MAX;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size   = 0;
+    };
+
+    struct Stats
+    {
+        uint32_t     pass_count        = 0;
+        uint32_t     culled_pass_count = 0;
+        uint32_t     barrier_count     = 0;
+        uint32_t     transient_count   = 0;
+        VkDeviceSize transient_bytes   = 0; // Memory the transient resources would need without aliasing.
+        VkDeviceSize heap_bytes        = 0; // Memory actually allocated for them.
+    };
+
+    // The backend may be null when only compile() is used, the requirement callbacks must be set in that case.
+    static RenderGraph::Ptr create(Backend::Ptr backend);
+
+    ~RenderGraph();
+
+    ResourceHandle create_image(const std::string& name, const ImageDesc& desc);
+    ResourceHandle create_buffer(const std::string& name, const BufferDesc& desc);
+    // Imported resources keep their state in the backend resource tracker and are never aliased. Writing one keeps the pass
+    // alive.
+    ResourceHandle import_image(const std::string& name, Image::Ptr image);
+    ResourceHandle import_buffer(const std::string& name, Buffer::Ptr buffer);
+    // The returned reference is valid until the next pass is added.
+    Pass& add_pass(const std::string& name, ExecuteCallback execute);
+    // Removes all passes and resources. The heaps are kept and reused if they are large enough.
+    void reset();
+    void set_memory_requirements_callbacks(ImageRequirementsCallback image_callback, BufferRequirementsCallback buffer_callback);
+    void compile();
+    void execute(CommandBuffer::Ptr cmd_buf);
+
+    Image::Ptr     image(ResourceHandle resource);
+    ImageView::Ptr image_view(ResourceHandle resource);
+    Buffer::Ptr    buffer(ResourceHandle resource);
+    bool           is_culled(uint32_t pass);
+
+    inline const std::vector<CompiledPass>& compiled_passes() { return m_compiled_passes; }
+    inline const std::vector<Heap>&         heaps() { return m_heaps; }
+    inline const Placement&                 placement(ResourceHandle resource) { return m_resources[resource].placement; }
+    inline const Stats&                     stats() { return m_stats; }
+
+private:
+    struct Resource
+    {
+        std::string    name;
+        bool           is_image;
+        bool           imported;
+        ImageDesc      image_desc;
+        BufferDesc     buffer_desc;
+        Image::Ptr     image;
+        ImageView::Ptr image_view;
+        Buffer::Ptr    buffer;
+        uint32_t       first_pass = UINT32_MAX;
+        uint32_t       last_pass  = 0;
+        Placement      placement;
+        VkDeviceSize   alignment        = 1;
+        uint32_t       memory_type_bits = UINT32_MAX;
+    };
+
+    struct HeapAllocation
+    {
+        VmaAllocation_T* allocation = nullptr;
+        Heap             heap;
+    };
+
+    RenderGraph(Backend::Ptr backend);
+    void                 cull_passes();
+    void                 compute_lifetimes();
+    void                 place_transient_resources();
+    void                 build_barriers();
+    void                 realize();
+    void                 release_heaps();
+    VkMemoryRequirements memory_requirements(Resource& resource);
+
+private:
+    std::weak_ptr<Backend>      m_backend;
+    std::vector<Resource>       m_resources;
+    std::vector<Pass>           m_passes;
+    std::vector<CompiledPass>   m_compiled_passes;
+    std::vector<Heap>           m_heaps;
+    std::vector<HeapAllocation> m_heap_allocations;
+    ImageRequirementsCallback   m_image_requirements;
+    BufferRequirementsCallback  m_buffer_requirements;
+    Stats                       m_stats;
+    bool                        m_compiled = false;
+    bool                        m_realized = false;
+};
+} // namespace vk
+} // namespace dw
+
+#endif
@@ -4,6 +4,7 @@
 #include <vector>
 #include <sstream>
 #include <cassert>
+#include <cstdint>
 #include <algorithm>
 #include <stdio.h>
 #include <ogl.h>
@@ -21,6 +22,15 @@ extern std::string executable_path();
 // Reads the contents of a text file into an std::string. Returns false if file does not exist.
 extern bool read_text(std::string path, std::string& out);
 
+// Reads the contents of a binary file into a byte vector. Returns false if file does not exist.
+extern bool read_binary(const std::string& path, std::vector<uint8_t>& out);
+
+// Writes a block of memory to a binary file, replacing any existing contents. Returns false if the file could not be opened.
+extern bool write_binary(const std::string& path, const void* data, size_t size);
+
+// Computes a fast non-cryptographic 64-bit hash (XXH64) of a block of memory.
+extern uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
 // Reads the specified shader source.
 extern bool read_shader(const std::string& path, std::string& out, std::vector<std::string> defines = std::vector<std::string>());
 
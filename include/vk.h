@@ -9,6 +9,14 @@
 #    include <stack>
 #    include <deque>
 #    include <unordered_map>
+#    include <algorithm>
+#    include <chrono>
+#    include <mutex>
+#    include <thread>
+#    include <future>
+#    include <functional>
+#    include <condition_variable>
+#    include <atomic>
 
 struct GLFWwindow;
 struct VmaAllocator_T;
@@ -17,6 +25,11 @@ enum VmaMemoryUsage;
 
 namespace dw
 {
+namespace mip_generator
+{
+struct Desc;
+} // namespace mip_generator
+
 namespace vk
 {
 class Object;
@@ -32,6 +45,11 @@ class Sampler;
 class DescriptorSet;
 class DescriptorSetLayout;
 class DescriptorPool;
+class DescriptorAllocator;
+class BatchUploader;
+class StagingRingBuffer;
+class FrameAllocator;
+class PipelineCompiler;
 class PipelineLayout;
 
 struct SwapChainSupportDetails
@@ -62,14 +80,123 @@ struct QueueInfos
     bool transfer();
 };
 
+enum QueueType
+{
+    QUEUE_TYPE_GRAPHICS = 0,
+    QUEUE_TYPE_COMPUTE  = 1,
+    QUEUE_TYPE_TRANSFER = 2,
+    QUEUE_TYPE_COUNT    = 3
+};
+
+// Identifies a queue submission by the value its queue timeline semaphore is signaled to once the submission completes.
+// A default constructed ticket is always complete.
+struct Ticket
+{
+    QueueType queue = QUEUE_TYPE_GRAPHICS;
+    uint64_t  value = 0;
+};
+
+// What an allocation is used for, for memory accounting. Images and buffers derive it from their usage flags unless it is
+// set explicitly.
+enum MemoryCategory
+{
+    MEMORY_CATEGORY_OTHER                  = 0,
+    MEMORY_CATEGORY_MESH                   = 1,
+    MEMORY_CATEGORY_TEXTURE                = 2,
+    MEMORY_CATEGORY_RENDER_TARGET          = 3,
+    MEMORY_CATEGORY_ACCELERATION_STRUCTURE = 4,
+    MEMORY_CATEGORY_UNIFORM                = 5,
+    MEMORY_CATEGORY_STAGING                = 6,
+    MEMORY_CATEGORY_COUNT                  = 7
+};
+
+// Describes the render pass or dynamic rendering scope a secondary command buffer continues. Leave both the render pass and
+// the attachment formats empty for secondaries that are executed outside of rendering.
+struct CommandBufferInheritanceDesc
+{
+    VkRenderPass          render_pass                   = nullptr;
+    uint32_t              subpass                       = 0;
+    VkFramebuffer         framebuffer                   = nullptr;
+    uint32_t              color_attachment_format_count = 0;
+    VkFormat              color_attachment_formats[8];
+    VkFormat              depth_attachment_format   = VK_FORMAT_UNDEFINED;
+    VkFormat              stencil_attachment_format = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples                   = VK_SAMPLE_COUNT_1_BIT;
+
+    CommandBufferInheritanceDesc& set_render_pass(VkRenderPass value, uint32_t subpass_idx = 0, VkFramebuffer framebuffer_handle = nullptr);
+    CommandBufferInheritanceDesc& add_color_attachment_format(VkFormat format);
+    CommandBufferInheritanceDesc& set_depth_attachment_format(VkFormat format);
+    CommandBufferInheritanceDesc& set_stencil_attachment_format(VkFormat format);
+    CommandBufferInheritanceDesc& set_samples(VkSampleCountFlagBits value);
+};
+
 class Backend : public std::enable_shared_from_this<Backend>
 {
 public:
-    static const uint32_t kMaxFramesInFlight = 3;
+    // Upper bound of the frames in flight, per-frame resources can be sized with it. The actual count is chosen at creation.
+    static const uint32_t kMaxFramesInFlight        = 3;
+    static const size_t   kStagingRingPartitionSize = 32 * 1024 * 1024;
+    static const size_t   kFrameAllocatorPageSize   = 4 * 1024 * 1024;
 
     using Ptr = std::shared_ptr<Backend>;
 
-    static Backend::Ptr create(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enable_validation_layers = false, bool enable_nsight_aftermath = false, bool require_ray_tracing = false, std::vector<const char*> additional_device_extensions = std::vector<const char*>());
+    struct PipelineStats
+    {
+        bool     cache_loaded     = false; // A cache file matching this device was found at startup.
+        size_t   cache_size       = 0;     // Size of the cache data loaded at startup.
+        uint32_t pipeline_count   = 0;
+        double   creation_time_ms = 0.0;
+    };
+
+    struct MemoryHeapStats
+    {
+        VkDeviceSize usage        = 0; // Usage of the whole process as reported by the driver, including other allocators.
+        VkDeviceSize budget       = 0;
+        VkDeviceSize block_bytes  = 0; // Device memory allocated by VMA.
+        bool         device_local = false;
+    };
+
+    struct MemoryStats
+    {
+        VkDeviceSize                 category_bytes[MEMORY_CATEGORY_COUNT]  = {};
+        uint32_t                     category_counts[MEMORY_CATEGORY_COUNT] = {};
+        std::vector<MemoryHeapStats> heaps;
+    };
+
+    struct LatencyStats
+    {
+        double   frame_wait_ms      = 0.0; // Time the CPU blocked in wait_for_frame() during the last frame.
+        double   present_wait_ms    = 0.0; // Part of frame_wait_ms spent waiting for the previous frame to be displayed.
+        double   acquire_ms         = 0.0; // Time the CPU blocked acquiring the last swap chain image.
+        double   present_latency_ms = 0.0; // From acquire to display of the last displayed frame, 0 without present ids.
+        uint64_t presented_count    = 0;   // Frames known to be displayed.
+    };
+
+    struct BarrierStats
+    {
+        uint32_t emitted_count = 0; // Barriers recorded during the last completed frame.
+        uint32_t skipped_count = 0; // Transitions that needed no barrier, e.g. repeated reads in the same layout.
+        uint32_t flush_count   = 0; // Calls to vkCmdPipelineBarrier2.
+    };
+
+    // Samplers and layouts created from identical descriptions are shared, the reuse counts are the creations that were avoided.
+    struct ObjectCacheStats
+    {
+        uint32_t sampler_count               = 0;
+        uint32_t sampler_reuse_count         = 0;
+        uint32_t ds_layout_count             = 0;
+        uint32_t ds_layout_reuse_count       = 0;
+        uint32_t pipeline_layout_count       = 0;
+        uint32_t pipeline_layout_reuse_count = 0;
+    };
+
+    // The pipeline cache is loaded from and saved to the given path. An empty path disables the cache.
+    // Frames in flight are clamped to [1, kMaxFramesInFlight]. Fewer frames lower the latency at the cost of throughput.
+    static Backend::Ptr create(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enable_validation_layers = false, bool enable_nsight_aftermath = false, bool require_ray_tracing = false, std::vector<const char*> additional_device_extensions = std::vector<const char*>(), std::string pipeline_cache_path = "pipeline_cache.bin", uint32_t frames_in_flight = kMaxFramesInFlight);
+    // Creates a backend without a window, surface or swap chain. Frames are rendered into a chain of offscreen images that take
+    // the place of the swap chain images, acquire and present cycle through them. Software rasterizers such as lavapipe are
+    // accepted when no GPU is available.
+    static Backend::Ptr create_headless(uint32_t width, uint32_t height, bool srgb_swapchain, bool enable_validation_layers = false, bool require_ray_tracing = false, std::vector<const char*> additional_device_extensions = std::vector<const char*>(), std::string pipeline_cache_path = "pipeline_cache.bin", uint32_t frames_in_flight = kMaxFramesInFlight);
 
     ~Backend();
 
@@ -80,8 +207,18 @@ public:
     std::shared_ptr<CommandPool>            graphics_command_pool();
     std::shared_ptr<CommandPool>            compute_command_pool();
     std::shared_ptr<CommandPool>            transfer_command_pool();
+    // Per-thread graphics command buffers for the current frame. Every recording thread passes its own index, the pools of a
+    // frame are reset together the first time the frame comes around again after the GPU has retired it.
+    std::shared_ptr<CommandBuffer>          allocate_thread_command_buffer(uint32_t thread_idx, bool begin = false);
+    std::shared_ptr<CommandBuffer>          allocate_secondary_command_buffer(uint32_t thread_idx, const CommandBufferInheritanceDesc& desc);
+    void                                    execute_secondary_command_buffers(const std::shared_ptr<CommandBuffer>& cmd_buf, const std::vector<std::shared_ptr<CommandBuffer>>& secondary_cmd_bufs);
+    uint32_t                                thread_command_pool_count();
     std::shared_ptr<DescriptorSet>          allocate_descriptor_set(std::shared_ptr<DescriptorSetLayout> layout);
-    std::shared_ptr<DescriptorPool>         descriptor_pool();
+    std::shared_ptr<DescriptorSet>          allocate_transient_descriptor_set(std::shared_ptr<DescriptorSetLayout> layout);
+    void                                    reset_transient_descriptor_allocator();
+    std::shared_ptr<DescriptorAllocator>    descriptor_allocator();
+    std::shared_ptr<DescriptorAllocator>    transient_descriptor_allocator();
+    std::shared_ptr<DescriptorAllocator>    transient_descriptor_allocator(uint32_t idx);
     void                                    use_resource(VkPipelineStageFlags2          _stage,
                                                          VkAccessFlags2                 _access,
                                                          const std::shared_ptr<Buffer>& _buffer,
@@ -92,42 +229,97 @@ public:
                                                          VkImageLayout                 _layout,
                                                          const std::shared_ptr<Image>& _image, 
                                                          VkImageSubresourceRange       _range);
+    // Raw pointer versions for objects that can't hand out a shared pointer to themselves yet, e.g. an Image uploading its
+    // data from its constructor. No barrier is queued when the resource is already readable in the requested layout and stages.
     void                                    use_resource(VkPipelineStageFlags2          _stage,
                                                          VkAccessFlags2                 _access,
-                                                         VkBuffer                       _buffer,
+                                                         Buffer*                        _buffer,
                                                          size_t                         _offset = 0,
                                                          size_t                         _size = 0);
     void                                    use_resource(VkPipelineStageFlags2         _stage,
                                                          VkAccessFlags2                _access,
                                                          VkImageLayout                 _layout,
-                                                         VkImage                       _image,
-                                                         VkImageSubresourceRange       _range,
-                                                         uint32_t                      _num_layers,
-                                                         uint32_t                      _num_levels);
+                                                         Image*                        _image,
+                                                         VkImageSubresourceRange       _range);
+    // Records the new state of a subresource range without emitting a barrier, for transitions that were recorded manually (e.g. queue family ownership transfers).
+    void                                    track_resource(VkPipelineStageFlags2         _stage,
+                                                           VkAccessFlags2                _access,
+                                                           VkImageLayout                 _layout,
+                                                           Image*                        _image,
+                                                           VkImageSubresourceRange       _range);
+    // Tracked layout of the first subresource of the range.
+    VkImageLayout                           tracked_layout(Image* _image, VkImageSubresourceRange _range);
+    // Moves a subresource range from the queue family of one queue to the one of another and into the given state. The release
+    // is recorded into the source command buffer and the acquire into the destination one, whose submission has to wait for the
+    // source submission. Between queues of the same family this is a regular barrier recorded into the destination command buffer.
+    void                                    transfer_ownership(const std::shared_ptr<CommandBuffer>& _src_cmd_buf,
+                                                               QueueType                             _src_queue,
+                                                               const std::shared_ptr<CommandBuffer>& _dst_cmd_buf,
+                                                               QueueType                             _dst_queue,
+                                                               VkPipelineStageFlags2                 _stage,
+                                                               VkAccessFlags2                        _access,
+                                                               VkImageLayout                         _layout,
+                                                               const std::shared_ptr<Image>&         _image,
+                                                               VkImageSubresourceRange               _range);
     void                                    flush_barriers(const std::shared_ptr<CommandBuffer>& _cmd_buf);
-    void                                    submit_graphics(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
+    // Flushes the tracked barriers together with barriers built by the caller in a single pipeline barrier.
+    void                                    flush_barriers(const std::shared_ptr<CommandBuffer>&     _cmd_buf,
+                                                           const std::vector<VkImageMemoryBarrier2>&  _image_barriers,
+                                                           const std::vector<VkBufferMemoryBarrier2>& _buffer_barriers);
+    // Records a global memory barrier straight away, for dependencies that aren't tied to a tracked resource (e.g. acceleration
+    // structure builds sharing a scratch buffer).
+    void                                    memory_barrier(const std::shared_ptr<CommandBuffer>& _cmd_buf,
+                                                           VkPipelineStageFlags2                 _src_stage,
+                                                           VkAccessFlags2                        _src_access,
+                                                           VkPipelineStageFlags2                 _dst_stage,
+                                                           VkAccessFlags2                        _dst_access);
+    Ticket                                  submit_graphics(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
                                                             const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
                                                             const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                                                            const std::shared_ptr<Fence>&                      signal_fence);
-    void                                    submit_compute(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
+                                                            const std::shared_ptr<Fence>&                      signal_fence,
+                                                            const std::vector<Ticket>&                         wait_tickets = {});
+    Ticket                                  submit_compute(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
                                                            const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
                                                            const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                                                           const std::shared_ptr<Fence>&                      signal_fence);
-    void                                    submit_transfer(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
+                                                           const std::shared_ptr<Fence>&                      signal_fence,
+                                                           const std::vector<Ticket>&                         wait_tickets = {});
+    Ticket                                  submit_transfer(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
                                                             const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
                                                             const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                                                            const std::shared_ptr<Fence>&                      signal_fence);
+                                                            const std::shared_ptr<Fence>&                      signal_fence,
+                                                            const std::vector<Ticket>&                         wait_tickets = {});
     void                                    flush_graphics(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs);
     void                                    flush_compute(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs);
     void                                    flush_transfer(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs);
+    bool                                    is_complete(const Ticket& ticket);
+    // Returns false if the timeout expired before the ticket completed.
+    bool                                    wait(const Ticket& ticket, uint64_t timeout = UINT64_MAX);
+    uint64_t                                completed_value(QueueType queue);
+    // Value the last submission to the queue signals its timeline to.
+    uint64_t                                submitted_value(QueueType queue);
+    // Waits for the ticket of the frame whose slot is about to be reused and records the time spent blocking. With present wait
+    // enabled it also waits until the previous frame has been displayed.
+    void                                    wait_for_frame(const Ticket& ticket);
+    // Only has an effect when VK_KHR_present_wait is supported, see present_wait_supported().
+    void                                    set_present_wait_enabled(bool value);
     bool                                    acquire_next_swap_chain_image(const std::shared_ptr<Semaphore>& semaphore);
     void                                    present(const std::vector<std::shared_ptr<Semaphore>>& semaphores);
+    // Objects released while submitted work may still use them are destroyed through this queue. A deleter runs once every
+    // queue has completed the submissions made up to the end of the frame it was queued in. Safe to call from any thread.
+    void                                    queue_deletion(std::function<void()> deleter);
+    // Ends the current frame for the deletion queue and runs the deleters that are safe to run. Called by present().
+    void                                    process_deletion_queue();
     std::shared_ptr<Image>                  swapchain_image();
     std::shared_ptr<ImageView>              swapchain_image_view();
     std::vector<std::shared_ptr<ImageView>> swapchain_image_views();
     std::shared_ptr<Image>                  swapchain_depth_image();
     std::shared_ptr<ImageView>              swapchain_depth_image_view();
     void                                    recreate_swapchain(bool vsync);
+    // Headless only. While enabled, present() copies every frame into host memory before retiring it.
+    void                                    set_readback_enabled(bool value);
+    // Waits for the copy of the last presented frame and returns its texels tightly packed in swap_chain_image_format().
+    // Returns false if no frame was read back yet.
+    bool                                    read_back_last_frame(std::vector<uint8_t>& texels);
 
     void             wait_idle();
     uint32_t         swap_image_count();
@@ -141,6 +333,17 @@ public:
     size_t           min_dynamic_ubo_alignment();
     size_t           aligned_dynamic_ubo_size(size_t size);
     VkFormat         find_supported_format(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+    void             save_pipeline_cache();
+    void             record_pipeline_creation(double time_ms);
+    void             track_allocation(MemoryCategory category, VkDeviceSize size);
+    void             untrack_allocation(MemoryCategory category, VkDeviceSize size);
+    MemoryStats      memory_stats();
+    // Writes the category totals and heap budgets as JSON.
+    bool             write_memory_stats(const std::string& path);
+    // A warning is logged when the usage of a device local heap goes above this fraction of its budget.
+    void             set_memory_budget_warning_threshold(float fraction);
+
+    static const char* memory_category_name(MemoryCategory category);
 
     inline VkPhysicalDeviceProperties                         physical_device_properties() { return m_device_properties; }
     inline VkPhysicalDeviceRayTracingPipelinePropertiesKHR    ray_tracing_pipeline_properties() { return m_ray_tracing_pipeline_properties; }
@@ -149,6 +352,22 @@ public:
     inline VkFormat                                           swap_chain_depth_format() { return m_swap_chain_depth_format; }
     inline VkExtent2D                                         swap_chain_extents() { return m_swap_chain_extent; }
     inline uint32_t                                           current_frame_idx() { return m_current_frame; }
+    inline uint32_t                                           current_swap_image_idx() { return m_image_index; } // Image returned by the last acquire.
+    inline bool                                               is_headless() { return m_headless; }
+    inline uint32_t                                           frames_in_flight() { return m_frames_in_flight; }
+    inline const LatencyStats&                                latency_stats() { return m_latency_stats; }
+    inline bool                                               present_wait_supported() { return m_present_wait_supported; }
+    inline bool                                               present_wait_enabled() { return m_present_wait_enabled; }
+    inline bool                                               push_descriptors_supported() { return m_push_descriptors_supported; }
+    inline bool                                               readback_enabled() { return m_readback_enabled; }
+    inline uint64_t                                           queue_submit_count() { return m_queue_submit_count; }
+    inline std::shared_ptr<StagingRingBuffer>                 staging_ring() { return m_staging_ring; }
+    inline std::shared_ptr<FrameAllocator>                    frame_allocator() { return m_frame_allocator; }
+    inline VkPipelineCache                                    pipeline_cache() { return m_vk_pipeline_cache; }
+    inline const PipelineStats&                               pipeline_stats() { return m_pipeline_stats; }
+    inline const BarrierStats&                                barrier_stats() { return m_barrier_stats; }
+    inline const ObjectCacheStats&                            object_cache_stats() { return m_object_cache_stats; }
+    inline std::shared_ptr<PipelineCompiler>                  pipeline_compiler() { return m_pipeline_compiler; }
     inline uint32_t                                           swapchain_size() { return m_swap_chain_images.size(); }
     inline const QueueInfos&                                  queue_infos() { return m_selected_queues; }
     inline std::shared_ptr<Sampler>                           bilinear_sampler() { return m_bilinear_sampler; }
@@ -157,8 +376,9 @@ public:
     inline std::shared_ptr<ImageView>                         default_cubemap() { return m_default_cubemap_image_view; }
 
 private:
-    Backend(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enable_validation_layers, bool enable_nsight_aftermath, bool require_ray_tracing, std::vector<const char*> additional_device_extensions);
+    Backend(GLFWwindow* window, VkExtent2D headless_extent, bool vsync, bool srgb_swapchain, bool enable_validation_layers, bool enable_nsight_aftermath, bool require_ray_tracing, std::vector<const char*> additional_device_extensions, std::string pipeline_cache_path, uint32_t frames_in_flight);
     void                     initialize();
+    void                     load_pipeline_cache();
     VkFormat                 find_depth_format();
     bool                     check_validation_layer_support(std::vector<const char*> layers);
     bool                     check_device_extension_support(VkPhysicalDevice device, std::vector<const char*> extensions);
@@ -173,31 +393,79 @@ private:
     bool                     is_queue_compatible(VkQueueFlags current_queue_flags, int32_t graphics, int32_t compute, int32_t transfer);
     bool                     create_logical_device(std::vector<const char*> extensions, bool require_ray_tracing, bool _use_nsight_aftermath);
     bool                     create_swapchain();
+    bool                     create_offscreen_images();
+    void                     create_swapchain_depth();
+    void                     read_back_frame(const std::vector<std::shared_ptr<Semaphore>>& semaphores);
+    void                     advance_frame();
+    void                     update_present_latency();
     VkSurfaceFormatKHR       choose_swap_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats);
     VkPresentModeKHR         choose_swap_present_mode(const std::vector<VkPresentModeKHR>& available_modes);
     VkExtent2D               choose_swap_extent(const VkSurfaceCapabilitiesKHR& capabilities);
-    void                     submit(VkQueue                                            queue,
+    VkQueue                  queue(QueueType type);
+    uint32_t                 queue_family_index(QueueType type);
+    Ticket                   submit(QueueType                                          type,
                                     const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
                                     const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
                                     const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                                    const std::shared_ptr<Fence>&                      signal_fence);
-    void                     flush(VkQueue queue, const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs);
+                                    const std::shared_ptr<Fence>&                      signal_fence,
+                                    const std::vector<Ticket>&                         wait_tickets);
+    void                     flush(QueueType type, const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs);
+
+private:
+    struct ThreadCommandPool
+    {
+        std::shared_ptr<CommandPool>                pool;
+        std::vector<std::shared_ptr<CommandBuffer>> primary_cmd_bufs;
+        std::vector<std::shared_ptr<CommandBuffer>> secondary_cmd_bufs;
+        uint32_t                                    primary_count   = 0;
+        uint32_t                                    secondary_count = 0;
+    };
+
+    struct ThreadCommandPoolFrame
+    {
+        // Held by pointer so that adding a thread never moves a pool another thread is recording from.
+        std::vector<std::unique_ptr<ThreadCommandPool>> threads;
+        uint32_t                                        frame_idx    = UINT32_MAX; // Frame the pools were last reset for.
+        uint64_t                                        retire_value = 0;          // Graphics timeline value that retires the frame.
+    };
+
+    ThreadCommandPool* thread_command_pool(uint32_t thread_idx);
 
 private:
-    struct BufferUsageInfo
+    friend class Image;
+    friend class Buffer;
+    friend class Sampler;
+    friend class DescriptorSetLayout;
+    friend class PipelineLayout;
+
+    // Last known state of a buffer or of a single image subresource. Every Image and Buffer owns a contiguous range of these in
+    // a flat table, images with one entry per subresource ordered by layer and then by mip level.
+    struct ResourceState
+    {
+        VkPipelineStageFlags2 stage          = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2        access         = VK_ACCESS_2_NONE;
+        VkImageLayout         layout         = VK_IMAGE_LAYOUT_UNDEFINED;
+        uint32_t              last_frame_idx = 0;
+    };
+
+    // Frames presented with an id whose display time is not known yet.
+    struct PendingPresent
     {
-        VkPipelineStageFlags2 stage;
-        VkAccessFlags2        access;
+        uint64_t                              id;
+        std::chrono::steady_clock::time_point frame_start;
     };
 
-    struct ImageUsageInfo
+    struct DeletionBatch
     {
-        VkPipelineStageFlags2 stage;
-        VkAccessFlags2        access;
-        VkImageLayout         layout;
-        uint32_t              last_frame_idx;
+        uint64_t                           retire_values[QUEUE_TYPE_COUNT]; // Timeline values of each queue at the end of the frame.
+        std::vector<std::function<void()>> deleters;
     };
 
+    uint32_t allocate_resource_states(uint32_t count);
+    void     release_resource_states(uint32_t first, uint32_t count);
+    void     flush_deletion_queue();
+    void     check_memory_budget();
+
     GLFWwindow*                                               m_window                = nullptr;
     VkInstance                                                m_vk_instance           = nullptr;
     VkDevice                                                  m_vk_device             = nullptr;
@@ -217,15 +485,21 @@ private:
     VkExtent2D                                                m_swap_chain_extent;
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR           m_ray_tracing_pipeline_properties;
     VkPhysicalDeviceAccelerationStructurePropertiesKHR        m_acceleration_structure_properties;
-    std::shared_ptr<DescriptorPool>                           m_descriptor_pool;
+    std::shared_ptr<DescriptorAllocator>                      m_descriptor_allocator;
+    std::vector<std::shared_ptr<DescriptorAllocator>>         m_transient_descriptor_allocators;
     std::vector<std::shared_ptr<CommandPool>>                 m_graphics_command_pools;
     std::vector<std::shared_ptr<CommandPool>>                 m_compute_command_pools;
     std::vector<std::shared_ptr<CommandPool>>                 m_transfer_command_pools;
     std::vector<std::shared_ptr<CommandBuffer>>               m_graphics_command_buffers;
     std::vector<std::shared_ptr<CommandBuffer>>               m_compute_command_buffers;
     std::vector<std::shared_ptr<CommandBuffer>>               m_transfer_command_buffers;
+    std::vector<ThreadCommandPoolFrame>                       m_thread_command_pool_frames;
+    std::mutex                                                m_thread_command_pool_mutex;
     std::vector<std::shared_ptr<Image>>                       m_swap_chain_images;
     std::vector<std::shared_ptr<ImageView>>                   m_swap_chain_image_views;
+    std::vector<std::shared_ptr<Buffer>>                      m_readback_buffers;
+    Ticket                                                    m_readback_ticket;
+    int32_t                                                   m_readback_image_index = -1; // Image copied by the last readback.
     std::shared_ptr<Sampler>                                  m_bilinear_sampler;
     std::shared_ptr<Sampler>                                  m_trilinear_sampler;
     std::shared_ptr<Sampler>                                  m_nearest_sampler;
@@ -234,22 +508,64 @@ private:
     uint32_t                                                  m_image_index   = 0;
     uint32_t                                                  m_current_frame = 0;
     uint32_t                                                  m_frame_idx             = 0;
+    uint32_t                                                  m_frames_in_flight      = kMaxFramesInFlight;
+    LatencyStats                                              m_latency_stats;
+    std::chrono::steady_clock::time_point                     m_frame_start;
+    uint64_t                                                  m_present_id            = 0;
+    std::deque<PendingPresent>                                m_pending_presents;
+    bool                                                      m_present_wait_supported = false;
+    bool                                                      m_present_wait_enabled   = false;
+    bool                                                      m_push_descriptors_supported = false;
+    uint64_t                                                  m_queue_submit_count    = 0;
+    std::shared_ptr<StagingRingBuffer>                        m_staging_ring;
+    std::shared_ptr<FrameAllocator>                           m_frame_allocator;
+    std::shared_ptr<Semaphore>                                m_timeline_semaphores[QUEUE_TYPE_COUNT];
+    uint64_t                                                  m_timeline_values[QUEUE_TYPE_COUNT]  = {};
+    uint64_t                                                  m_completed_values[QUEUE_TYPE_COUNT] = {};
+    VkPipelineCache                                           m_vk_pipeline_cache                  = nullptr;
+    std::string                                               m_pipeline_cache_path;
+    PipelineStats                                             m_pipeline_stats;
+    std::mutex                                                m_pipeline_stats_mutex;
+    // Keyed by desc hash. Descs with colliding hashes get separate entries, a hit is only used if the stored desc is equal.
+    std::unordered_multimap<uint64_t, std::weak_ptr<Sampler>>             m_sampler_cache;
+    std::unordered_multimap<uint64_t, std::weak_ptr<DescriptorSetLayout>> m_ds_layout_cache;
+    std::unordered_multimap<uint64_t, std::weak_ptr<PipelineLayout>>      m_pipeline_layout_cache;
+    ObjectCacheStats                                          m_object_cache_stats;
+    std::mutex                                                m_object_cache_mutex;
+    std::shared_ptr<PipelineCompiler>                         m_pipeline_compiler;
     std::shared_ptr<Image>                                    m_swap_chain_depth      = nullptr;
     std::shared_ptr<ImageView>                                m_swap_chain_depth_view = nullptr;
     VkPhysicalDeviceProperties                                m_device_properties;
-    std::unordered_map<uint64_t, BufferUsageInfo>             m_buffer_usage_info;
-    std::unordered_map<uint64_t, std::vector<ImageUsageInfo>> m_image_usage_info;
+    std::vector<ResourceState>                                m_resource_states;
+    std::vector<std::pair<uint32_t, uint32_t>>                m_free_resource_states; // Released ranges as (count, first).
     std::vector<VkBufferMemoryBarrier2>                       m_buffer_memory_barriers;
     std::vector<VkImageMemoryBarrier2>                        m_image_memory_barriers;
+    BarrierStats                                              m_barrier_stats;
+    BarrierStats                                              m_pending_barrier_stats;
+    std::vector<VkSemaphoreSubmitInfo>                        m_submit_wait_infos;
+    std::vector<VkCommandBufferSubmitInfo>                    m_submit_cmd_buf_infos;
+    std::vector<VkSemaphoreSubmitInfo>                        m_submit_signal_infos;
+    std::vector<VkSemaphore>                                  m_present_wait_semaphores;
+    std::vector<std::function<void()>>                        m_frame_deletions;
+    std::deque<DeletionBatch>                                 m_deletion_queue;
+    std::mutex                                                m_deletion_mutex;
+    std::atomic<uint64_t>                                     m_category_bytes[MEMORY_CATEGORY_COUNT]  = {};
+    std::atomic<uint32_t>                                     m_category_counts[MEMORY_CATEGORY_COUNT] = {};
+    float                                                     m_memory_budget_warning_threshold        = 0.9f;
+    bool                                                      m_memory_budget_warned                   = false;
+    bool                                                      m_memory_budget_supported                = false;
     bool                                                      m_ray_tracing_enabled = false;
     bool                                                      m_vsync               = false;
     bool                                                      m_srgb_swapchain      = false;
+    bool                                                      m_headless            = false;
+    bool                                                      m_readback_enabled    = false;
 };
 
 class Object
 {
 public:
     Object(Backend::Ptr backend);
+    Object(std::weak_ptr<Backend> backend);
 
     inline std::weak_ptr<Backend> backend() { return m_vk_backend; }
 
@@ -264,14 +580,28 @@ public:
 
     static Image::Ptr create(Backend::Ptr backend, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VmaMemoryUsage memory_usage, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageLayout initial_layout = VK_IMAGE_LAYOUT_UNDEFINED, size_t size = 0, void* data = nullptr, VkImageCreateFlags flags = 0, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
     static Image::Ptr create_from_swapchain(Backend::Ptr backend, VkImage image, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VmaMemoryUsage memory_usage, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count);
-    static Image::Ptr create_from_file(Backend::Ptr backend, std::string path, bool flip_vertical = false, bool srgb = false);
+    // Binds a new image to a region of an allocation owned by someone else, e.g. a render graph heap shared by several transient
+    // resources. Destroying the image leaves the allocation untouched.
+    static Image::Ptr create_aliased(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageCreateFlags flags = 0);
+    // When an uploader is given the pixel data and mip generation are recorded into its batch instead of being submitted immediately.
+    // When a mip generator desc is given the mip chain is filtered on the CPU instead of being blitted on the GPU.
+    static Image::Ptr create_from_file(Backend::Ptr backend, std::string path, bool flip_vertical = false, bool srgb = false, BatchUploader* uploader = nullptr, const mip_generator::Desc* mip_desc = nullptr);
 
     ~Image();
 
+    // Goes through the staging ring like upload_data_async() and submits right away without waiting, so the tracked layout is
+    // up to date on return and later submissions are ordered after the copy.
     void upload_data(int array_index, int mip_level, void* data, size_t size, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Stages the data in the backend staging ring without submitting. The copy executes ahead of the next queue submission,
+    // and the tracked layout only changes once it has been submitted.
+    void upload_data_async(int array_index, int mip_level, void* data, size_t size, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     void generate_mipmaps(std::shared_ptr<CommandBuffer> cmd_buf, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VkImageAspectFlags aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT, VkFilter filter = VK_FILTER_LINEAR);
+    // Like generate_mipmaps_async(), but submits right away.
     void generate_mipmaps(VkImageLayout dst_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VkImageAspectFlags aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT, VkFilter filter = VK_FILTER_LINEAR);
+    // Records the blits into the staging ring, after any upload_data_async() made before them.
+    void generate_mipmaps_async(VkImageLayout dst_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VkImageAspectFlags aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT, VkFilter filter = VK_FILTER_LINEAR);
     void set_name(const std::string& name);
+    void set_memory_category(MemoryCategory category);
 
     inline VkImageType        type() { return m_type; }
     inline const VkImage&     handle() { return m_vk_image; }
@@ -286,10 +616,15 @@ public:
     inline VkSampleCountFlags sample_count() { return m_sample_count; }
     inline VkImageTiling      tiling() { return m_tiling; }
     inline void*              mapped_ptr() { return m_mapped_ptr; }
+    inline VkDeviceSize       allocation_size() { return m_allocation_size; }
+    inline uint32_t           state_idx() { return m_state_idx; }
+    inline bool               is_swap_chain_image() { return m_swap_chain_image; }
+    inline MemoryCategory     memory_category() { return m_memory_category; }
 
 private:
     Image(Backend::Ptr backend, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VmaMemoryUsage memory_usage, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageLayout initial_layout, size_t size, void* data, VkImageCreateFlags flags = 0, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
     Image(Backend::Ptr backend, VkImage image, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VmaMemoryUsage memory_usage, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count);
+    Image(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageCreateFlags flags);
 
 private:
     uint32_t              m_width;
@@ -309,6 +644,11 @@ private:
     VmaAllocator_T*       m_vma_allocator    = nullptr;
     VmaAllocation_T*      m_vma_allocation   = nullptr;
     void*                 m_mapped_ptr       = nullptr;
+    VkDeviceSize          m_allocation_size  = 0;
+    uint32_t              m_state_idx        = UINT32_MAX;
+    MemoryCategory        m_memory_category  = MEMORY_CATEGORY_OTHER;
+    bool                  m_aliased          = false;
+    bool                  m_swap_chain_image = false;
 };
 
 class ImageView : public Object
@@ -338,20 +678,31 @@ public:
 
     static Buffer::Ptr create(Backend::Ptr backend, VkBufferUsageFlags usage, size_t size, VmaMemoryUsage memory_usage, VkFlags create_flags, void* data = nullptr);
     static Buffer::Ptr create_with_alignment(Backend::Ptr backend, VkBufferUsageFlags usage, size_t size, size_t alignment, VmaMemoryUsage memory_usage, VkFlags create_flags, void* data = nullptr);
+    // Binds a new buffer to a region of an allocation owned by someone else. Destroying the buffer leaves the allocation untouched.
+    static Buffer::Ptr create_aliased(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkBufferUsageFlags usage, size_t size);
 
     ~Buffer();
 
     void set_name(const std::string& name);
+    void set_memory_category(MemoryCategory category);
 
+    // Device local buffers are copied through the staging ring and submitted right away without waiting.
     void upload_data(void* data, size_t size, size_t offset);
+    // Copies through the backend staging ring ahead of the next queue submission, without submitting.
+    void upload_data_async(void* data, size_t size, size_t offset);
+    // Makes device writes visible through the mapped pointer. Only does work for memory that isn't host coherent.
+    void invalidate();
 
     inline const VkBuffer& handle() { return m_vk_buffer; }
     inline size_t          size() { return m_size; }
     inline void*           mapped_ptr() { return m_mapped_ptr; }
     inline VkDeviceAddress device_address() { return m_device_address; }
+    inline uint32_t        state_idx() { return m_state_idx; }
+    inline MemoryCategory  memory_category() { return m_memory_category; }
 
 private:
     Buffer(Backend::Ptr backend, VkBufferUsageFlags usage, size_t size, size_t alignment, VmaMemoryUsage memory_usage, VkFlags create_flags, void* data);
+    Buffer(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkBufferUsageFlags usage, size_t size);
 
 private:
     size_t                m_size;
@@ -364,6 +715,9 @@ private:
     VmaMemoryUsage        m_vma_memory_usage;
     VkMemoryPropertyFlags m_vk_memory_property;
     VkBufferUsageFlags    m_vk_usage_flags;
+    VkDeviceSize          m_allocation_size = 0;
+    MemoryCategory        m_memory_category = MEMORY_CATEGORY_OTHER;
+    uint32_t              m_state_idx       = UINT32_MAX;
 };
 
 class CommandPool : public Object
@@ -393,19 +747,21 @@ class CommandBuffer : public Object
 public:
     using Ptr = std::shared_ptr<CommandBuffer>;
 
-    static CommandBuffer::Ptr create(Backend::Ptr backend, CommandPool::Ptr pool);
+    static CommandBuffer::Ptr create(Backend::Ptr backend, CommandPool::Ptr pool, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
     ~CommandBuffer();
 
     void set_name(const std::string& name);
 
     inline const VkCommandBuffer& handle() { return m_vk_command_buffer; }
+    inline VkCommandBufferLevel   level() { return m_vk_level; }
 
 private:
-    CommandBuffer(Backend::Ptr backend, CommandPool::Ptr pool);
+    CommandBuffer(Backend::Ptr backend, CommandPool::Ptr pool, VkCommandBufferLevel level);
 
 private:
     VkCommandBuffer            m_vk_command_buffer;
+    VkCommandBufferLevel       m_vk_level;
     std::weak_ptr<CommandPool> m_vk_pool;
 };
 
@@ -619,7 +975,11 @@ public:
     void set_name(const std::string& name);
 
 private:
+    friend class PipelineCompiler;
+
     GraphicsPipeline(Backend::Ptr backend, Desc desc);
+    GraphicsPipeline(std::weak_ptr<Backend> backend, VkPipeline pipeline);
+    static VkPipeline create_handle(Backend* backend, Desc& desc);
 
 private:
     VkPipeline m_vk_pipeline;
@@ -651,12 +1011,56 @@ public:
     void set_name(const std::string& name);
 
 private:
+    friend class PipelineCompiler;
+
     ComputePipeline(Backend::Ptr backend, Desc desc);
+    ComputePipeline(std::weak_ptr<Backend> backend, VkPipeline pipeline);
+    static VkPipeline create_handle(Backend* backend, Desc& desc);
 
 private:
     VkPipeline m_vk_pipeline;
 };
 
+// Creates graphics and compute pipelines on a pool of worker threads. The pipeline cache is internally synchronized so
+// every worker shares the backend's cache. Descs are copied, but the shader modules, pipeline layouts and state descs they
+// point to must stay alive until the returned future is ready. Workers only hold a non-owning pointer to the backend, which
+// shuts the compiler down before it releases the device.
+class PipelineCompiler
+{
+public:
+    using Ptr = std::shared_ptr<PipelineCompiler>;
+
+    static PipelineCompiler::Ptr create(Backend::Ptr backend, uint32_t num_threads = 0);
+
+    ~PipelineCompiler();
+
+    std::shared_future<GraphicsPipeline::Ptr> compile(GraphicsPipeline::Desc desc);
+    std::shared_future<ComputePipeline::Ptr>  compile(ComputePipeline::Desc desc);
+    // Blocks until every queued pipeline has finished compiling.
+    void     wait_all();
+    // Finishes the queued pipelines and joins the workers. Compiling afterwards throws.
+    void     shutdown();
+    uint32_t pending_count();
+
+    inline uint32_t num_threads() { return m_threads.size(); }
+
+private:
+    PipelineCompiler(Backend::Ptr backend, uint32_t num_threads);
+    void enqueue(std::function<void()> task);
+    void worker();
+
+private:
+    Backend*                          m_backend;
+    std::weak_ptr<Backend>            m_weak_backend;
+    std::vector<std::thread>          m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_task_available;
+    std::condition_variable           m_idle;
+    uint32_t                          m_active_count = 0;
+    bool                              m_stop         = false;
+};
+
 class ShaderBindingTable : public Object
 {
 public:
@@ -772,7 +1176,8 @@ public:
         Desc& set_max_primitive_counts(const std::vector<uint32_t>& primitive_counts);
         Desc& set_geometry_count(uint32_t count);
         Desc& set_flags(VkBuildAccelerationStructureFlagsKHR flags);
-        Desc& set_compacted_size(uint32_t size);
+        // Creates a structure of the given size without querying build sizes, as the destination of a compacting copy.
+        Desc& set_compacted_size(VkDeviceSize size);
         Desc& set_device_address(VkDeviceAddress address);
     };
 
@@ -784,13 +1189,19 @@ public:
     inline VkDeviceAddress                          device_address() { return m_device_address; }
     inline VkBuildAccelerationStructureFlagsKHR     flags() { return m_flags; }
     inline VkAccelerationStructureBuildSizesInfoKHR build_sizes() { return m_build_sizes; }
+    // Incremented whenever the underlying structure is replaced, e.g. by compaction, which also changes the device address.
+    inline uint32_t                                 generation() { return m_generation; }
 
     ~AccelerationStructure();
 
     void set_name(const std::string& name);
 
 private:
+    friend class BatchUploader;
+
     AccelerationStructure(Backend::Ptr backend, Desc desc);
+    // Exchanges the underlying structures, so that references held elsewhere see the compacted copy.
+    void swap(AccelerationStructure& other);
 
 private:
     Buffer::Ptr                              m_buffer;
@@ -799,6 +1210,7 @@ private:
     VkAccelerationStructureBuildSizesInfoKHR m_build_sizes;
     VkAccelerationStructureCreateInfoKHR     m_vk_acceleration_structure_info;
     VkAccelerationStructureKHR               m_vk_acceleration_structure = nullptr;
+    uint32_t                                 m_generation                = 0;
 };
 
 class Sampler : public Object
@@ -824,21 +1236,28 @@ public:
         float                max_lod;
         VkBorderColor        border_color;
         VkBool32             unnormalized_coordinates = VK_FALSE;
+
+        uint64_t hash() const;
+        bool     operator==(const Desc& other) const;
     };
 
     inline const VkSampler& handle() { return m_vk_sampler; }
 
+    // Returns the existing sampler if one was already created from an identical desc and is still alive.
     static Sampler::Ptr create(Backend::Ptr backend, Desc desc);
 
     ~Sampler();
 
+    // Samplers are shared, so only the first name given is applied. Later calls are ignored.
     void set_name(const std::string& name);
 
 private:
     Sampler(Backend::Ptr backend, Desc desc);
 
 private:
-    VkSampler m_vk_sampler;
+    VkSampler         m_vk_sampler;
+    Desc              m_desc;
+    std::atomic<bool> m_named { false };
 };
 
 class DescriptorSetLayout : public Object
@@ -848,28 +1267,55 @@ public:
 
     struct Desc
     {
-        std::vector<VkDescriptorSetLayoutBinding> bindings;
-        VkSampler                                 binding_samplers[32][8];
-        void*                                     pnext_ptr = nullptr;
+        std::vector<VkDescriptorSetLayoutBinding>    bindings;
+        std::vector<VkDescriptorUpdateTemplateEntry> template_entries;
+        VkSampler                                    binding_samplers[32][8];
+        void*                                        pnext_ptr    = nullptr;
+        VkDescriptorSetLayoutCreateFlags             create_flags = 0;
 
         Desc& set_next_ptr(void* pnext);
+        Desc& set_create_flags(VkDescriptorSetLayoutCreateFlags flags);
         Desc& add_binding(uint32_t binding, VkDescriptorType descriptor_type, uint32_t descriptor_count, VkShaderStageFlags stage_flags);
         Desc& add_binding(uint32_t binding, VkDescriptorType descriptor_type, uint32_t descriptor_count, VkShaderStageFlags stage_flags, Sampler::Ptr samplers[]);
+        // Tells update() and push() where the descriptors of an already added binding are found in the data they are given:
+        // VkDescriptorImageInfo, VkDescriptorBufferInfo, VkBufferView or VkAccelerationStructureKHR depending on the type. A
+        // descriptor count of 0 covers the whole binding and a stride of 0 packs the descriptors tightly.
+        Desc& add_template_entry(uint32_t binding, size_t offset, size_t stride = 0, uint32_t array_element = 0, uint32_t descriptor_count = 0);
+
+        // Both cover everything but the pNext chain.
+        uint64_t hash() const;
+        bool     operator==(const Desc& other) const;
     };
 
+    // Layouts are shared between identical descs like samplers are. Descs with a pNext chain always create a new layout.
     static DescriptorSetLayout::Ptr create(Backend::Ptr backend, Desc desc);
 
     ~DescriptorSetLayout();
 
+    // Only the first name given to a shared layout is applied, layouts created with a pNext chain can always be renamed.
     void set_name(const std::string& name);
+    // Writes all template entries of a set in one call.
+    void update(const std::shared_ptr<DescriptorSet>& ds, const void* data);
+    // For layouts created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR, which are never allocated. The
+    // descriptors are recorded into the command buffer instead, see Backend::push_descriptors_supported().
+    void push(const std::shared_ptr<CommandBuffer>& cmd_buf, VkPipelineBindPoint bind_point, const std::shared_ptr<PipelineLayout>& pipeline_layout, uint32_t set, const void* data);
 
     inline const VkDescriptorSetLayout& handle() { return m_vk_ds_layout; }
+    inline VkDescriptorUpdateTemplate   update_template() { return m_vk_update_template; }
 
 private:
+    friend class PipelineLayout;
+
     DescriptorSetLayout(Backend::Ptr backend, Desc desc);
 
 private:
-    VkDescriptorSetLayout m_vk_ds_layout;
+    VkDescriptorSetLayout                        m_vk_ds_layout;
+    VkDescriptorUpdateTemplate                   m_vk_update_template = VK_NULL_HANDLE;
+    std::vector<VkDescriptorUpdateTemplateEntry> m_template_entries;
+    bool                                         m_push_descriptor = false;
+    Desc                                         m_desc;
+    bool                                         m_cached = false;
+    std::atomic<bool>                            m_named { false };
 };
 
 class PipelineLayout : public Object
@@ -884,21 +1330,44 @@ public:
 
         Desc& add_descriptor_set_layout(DescriptorSetLayout::Ptr layout);
         Desc& add_push_constant_range(VkShaderStageFlags stage_flags, uint32_t offset, uint32_t size);
+
+        // Set layouts are hashed and compared by handle, so descs built from shared set layouts match.
+        uint64_t hash() const;
+        bool     operator==(const Desc& other) const;
     };
 
+    // Returns the existing layout if one was already created from an identical desc and is still alive.
     static PipelineLayout::Ptr create(Backend::Ptr backend, Desc desc);
 
     ~PipelineLayout();
 
+    // Pipeline layouts are shared, so only the first name given is applied. Later calls are ignored.
     void set_name(const std::string& name);
 
     inline const VkPipelineLayout& handle() { return m_vk_pipeline_layout; }
 
 private:
+    friend class DescriptorSetLayout;
+
+    // Push templates are bound to a pipeline layout, so they live in it and are destroyed with it.
+    struct PushTemplate
+    {
+        VkPipelineBindPoint        bind_point;
+        uint32_t                   set;
+        VkDescriptorUpdateTemplate handle;
+    };
+
     PipelineLayout(Backend::Ptr backend, Desc desc);
+    // Returns the push descriptor template of a set, creating it the first time it is pushed. Shared layouts can be pushed
+    // with from several threads.
+    VkDescriptorUpdateTemplate push_template(VkPipelineBindPoint bind_point, uint32_t set);
 
 private:
-    VkPipelineLayout m_vk_pipeline_layout;
+    VkPipelineLayout          m_vk_pipeline_layout;
+    Desc                      m_desc; // Its set layouts also keep the handles used as cache keys from being reused.
+    std::vector<PushTemplate> m_push_templates;
+    std::mutex                m_push_template_mutex;
+    std::atomic<bool>         m_named { false };
 };
 
 class DescriptorPool : public Object
@@ -922,16 +1391,24 @@ public:
     ~DescriptorPool();
 
     void set_name(const std::string& name);
+    void reset();
 
     inline VkDescriptorPoolCreateFlags create_flags() { return m_vk_create_flags; }
     inline const VkDescriptorPool&     handle() { return m_vk_ds_pool; }
+    inline uint32_t                    reset_count() { return m_reset_count; }
+    // Sets that were neither freed nor released by a reset yet.
+    inline uint32_t                    allocated_sets() { return m_allocated_sets; }
 
 private:
+    friend class DescriptorSet;
+
     DescriptorPool(Backend::Ptr backend, Desc desc);
 
 private:
     VkDescriptorPoolCreateFlags m_vk_create_flags;
     VkDescriptorPool            m_vk_ds_pool;
+    uint32_t                    m_reset_count = 0;
+    std::atomic<uint32_t>       m_allocated_sets { 0 };
 };
 
 class DescriptorSet : public Object
@@ -940,6 +1417,8 @@ public:
     using Ptr = std::shared_ptr<DescriptorSet>;
 
     static DescriptorSet::Ptr create(Backend::Ptr backend, DescriptorSetLayout::Ptr layout, DescriptorPool::Ptr pool, void* pnext = nullptr);
+    // Same as create() but returns nullptr instead of throwing when the pool is out of memory.
+    static DescriptorSet::Ptr try_create(Backend::Ptr backend, DescriptorSetLayout::Ptr layout, DescriptorPool::Ptr pool, void* pnext = nullptr);
 
     ~DescriptorSet();
 
@@ -949,6 +1428,7 @@ public:
 
 private:
     DescriptorSet(Backend::Ptr backend, DescriptorSetLayout::Ptr layout, DescriptorPool::Ptr pool, void* pnext);
+    DescriptorSet(Backend::Ptr backend, VkDescriptorSet ds, DescriptorPool::Ptr pool);
 
 private:
     bool                          m_should_destroy = false;
@@ -956,6 +1436,65 @@ private:
     std::weak_ptr<DescriptorPool> m_vk_pool;
 };
 
+// Allocates descriptor sets from a chain of pools, creating a new pool whenever the current ones are exhausted. Pool sizes
+// are expressed as a number of descriptors per set for each descriptor type.
+class DescriptorAllocator : public Object
+{
+public:
+    using Ptr = std::shared_ptr<DescriptorAllocator>;
+
+    struct Desc
+    {
+        uint32_t                                        sets_per_pool     = 512;
+        uint32_t                                        max_sets_per_pool = 4096;
+        float                                           growth_factor     = 2.0f;
+        VkDescriptorPoolCreateFlags                     create_flags      = 0;
+        std::vector<std::pair<VkDescriptorType, float>> pool_size_ratios;
+
+        Desc& set_sets_per_pool(uint32_t num);
+        Desc& set_max_sets_per_pool(uint32_t num);
+        Desc& set_growth_factor(float factor);
+        Desc& set_create_flags(VkDescriptorPoolCreateFlags flags);
+        Desc& add_pool_size_ratio(VkDescriptorType type, float ratio);
+    };
+
+    struct Stats
+    {
+        uint32_t pool_count       = 0;
+        uint32_t set_capacity     = 0;
+        uint32_t allocated_sets   = 0; // Live sets, freed sets and sets released by a reset are not counted.
+        uint32_t peak_sets        = 0;
+        uint32_t exhaustion_count = 0;
+        uint32_t reset_count      = 0;
+    };
+
+    static DescriptorAllocator::Ptr create(Backend::Ptr backend, Desc desc);
+
+    ~DescriptorAllocator();
+
+    DescriptorSet::Ptr allocate(DescriptorSetLayout::Ptr layout, void* pnext = nullptr);
+    // Resets every pool in the chain at once. Sets allocated before the reset must no longer be in use by the GPU.
+    void reset();
+    void set_name(const std::string& name);
+
+    const Stats&                                   stats();
+    inline const std::string&                      name() { return m_name; }
+    inline const std::vector<DescriptorPool::Ptr>& pools() { return m_pools; }
+
+private:
+    DescriptorAllocator(Backend::Ptr backend, Desc desc);
+    DescriptorPool::Ptr create_pool();
+    uint32_t            allocated_sets();
+
+private:
+    Desc                             m_desc;
+    std::string                      m_name;
+    uint32_t                         m_next_pool_size = 0;
+    uint32_t                         m_current_pool   = 0;
+    std::vector<DescriptorPool::Ptr> m_pools;
+    Stats                            m_stats;
+};
+
 class Fence : public Object
 {
 public:
@@ -983,19 +1522,24 @@ class Semaphore : public Object
 public:
     using Ptr = std::shared_ptr<Semaphore>;
 
-    static Semaphore::Ptr create(Backend::Ptr backend);
+    static Semaphore::Ptr create(Backend::Ptr backend, bool timeline = false, uint64_t initial_value = 0);
 
     ~Semaphore();
 
     void set_name(const std::string& name);
+    // Timeline semaphores only.
+    uint64_t value();
+    bool     wait(uint64_t value, uint64_t timeout = UINT64_MAX);
 
     inline const VkSemaphore& handle() { return m_vk_semaphore; }
+    inline bool               is_timeline() { return m_timeline; }
 
 private:
-    Semaphore(Backend::Ptr backend);
+    Semaphore(Backend::Ptr backend, bool timeline, uint64_t initial_value);
 
 private:
     VkSemaphore m_vk_semaphore;
+    bool        m_timeline;
 };
 
 class QueryPool : public Object
@@ -1032,15 +1576,17 @@ public:
     static StagingBuffer::Ptr create(Backend::Ptr backend, const size_t& size);
 
     // Insert the given data into the mapped staging buffer and returns the offset to said data from the start of the buffer.
-    size_t insert_data(void* data, const size_t& size);
+    size_t insert_data(void* data, const size_t& size, const size_t& alignment = 1);
     ~StagingBuffer();
 
     inline size_t      remaining_size() { return m_total_size - m_current_size; }
+    inline size_t      remaining_size(const size_t& alignment) { return m_total_size - std::min(m_total_size, aligned_offset(alignment)); }
     inline size_t      total_size() { return m_total_size; }
     inline Buffer::Ptr buffer() { return m_buffer; }
 
 private:
     StagingBuffer(Backend::Ptr backend, const size_t& size);
+    inline size_t aligned_offset(const size_t& alignment) { return ((m_current_size + alignment - 1) / alignment) * alignment; }
 
 private:
     uint8_t*    m_mapped_ptr;
@@ -1049,6 +1595,212 @@ private:
     Buffer::Ptr m_buffer;
 };
 
+// Backend-owned, persistently mapped staging memory split into one partition per frame in flight. Uploads are recorded into
+// command buffers that are submitted ahead of the next queue submission, so uploading never blocks the CPU. A partition is
+// only waited on when the ring wraps around to it while the GPU is still consuming it. Uploads that do not fit in the current
+// partition get a dedicated staging buffer, which is reused by later overflows once the submission reading it has completed.
+//
+// If the device has a transfer queue family separate from the graphics one, copies run on the transfer queue. Their destinations
+// are released to the graphics queue family and acquired by a graphics submission that waits on the ticket of the copies, so
+// the copies overlap rendering that is already in flight. Buffer copies on the transfer queue wait for the graphics work
+// submitted before them, which may still read the old contents. Images the graphics queue has already used are copied on the
+// graphics queue instead.
+class StagingRingBuffer
+{
+public:
+    using Ptr = std::shared_ptr<StagingRingBuffer>;
+
+    struct Allocation
+    {
+        Buffer::Ptr buffer;
+        size_t      offset     = 0;
+        uint8_t*    mapped_ptr = nullptr;
+    };
+
+    struct Stats
+    {
+        uint64_t frame_bytes           = 0; // Bytes staged during the last completed frame, including dedicated allocations.
+        uint64_t frame_dedicated_bytes = 0;
+        uint32_t frame_uploads         = 0;
+        uint32_t frame_submissions     = 0;
+        uint64_t total_bytes           = 0;
+        uint32_t wait_count            = 0; // Times a partition was still in use by the GPU when the ring wrapped around to it.
+        double   wait_time_ms          = 0.0;
+        double   average_latency_ms    = 0.0; // Time from submission until the CPU observed completion, at frame granularity.
+    };
+
+    static StagingRingBuffer::Ptr create(Backend::Ptr backend, size_t partition_size, uint32_t partition_count);
+
+    ~StagingRingBuffer();
+
+    Allocation allocate(size_t size, size_t alignment = 16);
+    // Copies the data into staging memory and returns where it was placed.
+    Allocation stage(void* data, size_t size, size_t alignment = 16);
+    // Only copies that overwrite the whole buffer run on the transfer queue, partial updates are recorded on the graphics queue
+    // so the rest of the contents stays owned by it.
+    void       copy_buffer(const Allocation& src, Buffer* dst, size_t dst_offset, size_t size);
+    // The range is transitioned from its current layout. The tracked state of the range is only updated once the copy is
+    // submitted by flush().
+    void       copy_image(const Allocation& src, Image* dst, const std::vector<VkBufferImageCopy>& regions, VkImageSubresourceRange range, VkImageLayout dst_layout);
+    // Blits every level from the first one, on the graphics queue. Like copy_image() the tracked state changes on flush().
+    void       generate_mipmaps(Image* image, VkImageLayout dst_layout, VkImageAspectFlags aspect_flags, VkFilter filter);
+    // Forgets tracked state updates still waiting for a flush, for images destroyed before their upload was submitted.
+    void       discard_pending_states(Image* image);
+    // Graphics queue command buffer that executes after the copies recorded before the next flush, for work that the transfer
+    // queue cannot do such as mip generation. It stays valid until the next flush.
+    CommandBuffer::Ptr command_buffer();
+    // Submits the recorded upload commands and returns the graphics queue ticket that completes once they have executed. If
+    // nothing was pending the ticket of the previous flush is returned.
+    Ticket flush(bool wait = false);
+    // Called once per presented frame to move on to the next partition.
+    void   next_frame();
+
+    inline const Stats& stats() { return m_stats; }
+    inline size_t       partition_size() { return m_partition_size; }
+    inline uint32_t     partition_count() { return m_partitions.size(); }
+    inline bool         async_transfer() { return m_async_transfer; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Partition
+    {
+        size_t                          begin = 0;
+        size_t                          head  = 0;
+        CommandPool::Ptr                cmd_pool;
+        CommandPool::Ptr                transfer_cmd_pool;
+        std::vector<CommandBuffer::Ptr> cmd_bufs;
+        std::vector<CommandBuffer::Ptr> transfer_cmd_bufs;
+        std::vector<Ticket>             tickets;
+        std::vector<Clock::time_point>  submit_times;
+        uint32_t                        num_submitted = 0;
+    };
+
+    // Layout an image range is left in by commands recorded into the ring but not submitted yet.
+    struct PendingState
+    {
+        Image*                  image;
+        VkImageSubresourceRange range;
+        VkImageLayout           layout;
+    };
+
+    struct DedicatedBuffer
+    {
+        Buffer::Ptr buffer;
+        Ticket      ticket;
+    };
+
+    // Idle dedicated buffers kept around for later overflows.
+    static const uint32_t kMaxFreeDedicatedBuffers = 4;
+
+    StagingRingBuffer(Backend::Ptr backend, size_t partition_size, uint32_t partition_count);
+    CommandBuffer::Ptr transfer_command_buffer();
+    void               ensure_slot();
+    void               retire(Partition& partition);
+    void               poll_completion();
+    VkImageLayout      current_layout(Image* image, VkImageSubresourceRange range);
+
+private:
+    std::weak_ptr<Backend>       m_backend;
+    Buffer::Ptr                  m_buffer;
+    uint8_t*                     m_mapped_ptr        = nullptr;
+    size_t                       m_partition_size;
+    std::vector<Partition>       m_partitions;
+    uint32_t                     m_current_partition = 0;
+    CommandBuffer::Ptr           m_recording_cmd;
+    CommandBuffer::Ptr           m_recording_transfer_cmd;
+    bool                         m_async_transfer    = false;
+    uint32_t                     m_graphics_queue_family;
+    uint32_t                     m_transfer_queue_family;
+    bool                         m_flushing          = false;
+    bool                         m_transfer_waits    = false; // The recorded transfer commands overwrite data the graphics queue may still read.
+    Ticket                       m_last_ticket;
+    std::vector<PendingState>    m_pending_states;
+    std::vector<Buffer::Ptr>     m_dedicated_recording; // Allocated since the last flush.
+    std::vector<DedicatedBuffer> m_dedicated_in_flight;
+    std::vector<Buffer::Ptr>     m_dedicated_free;
+    uint64_t                     m_sampled_value     = 0; // Graphics timeline value up to which submission latency has been sampled.
+    uint64_t                     m_latency_samples   = 0;
+    double                       m_latency_total_ms  = 0.0;
+    Stats                        m_pending_stats;
+    Stats                        m_stats;
+};
+
+// Hands out persistently mapped memory for uniform and storage data that the CPU rewrites every frame. Each frame in flight
+// bump allocates from its own list of pages, which is rewound the first time the frame comes around again once the GPU has
+// retired it. When the pages of a frame run out a new one is added and kept for later frames. Safe to call from any thread.
+//
+// The buffer of an allocation can differ between allocations, descriptors have to be written against the returned buffer.
+class FrameAllocator
+{
+public:
+    using Ptr = std::shared_ptr<FrameAllocator>;
+
+    struct Allocation
+    {
+        Buffer::Ptr buffer;
+        size_t      offset     = 0;
+        uint8_t*    mapped_ptr = nullptr;
+    };
+
+    struct Stats
+    {
+        uint64_t frame_bytes       = 0; // Bytes allocated during the last completed frame, including alignment padding.
+        uint32_t frame_allocations = 0;
+        uint32_t page_count        = 0; // Pages across all frames.
+        uint64_t capacity          = 0;
+    };
+
+    static FrameAllocator::Ptr create(Backend::Ptr backend, size_t page_size, uint32_t frame_count);
+
+    ~FrameAllocator();
+
+    // An alignment of zero uses the larger of the uniform and storage buffer offset alignments of the device.
+    Allocation allocate(size_t size, size_t alignment = 0);
+    // Copies the data into frame memory and returns where it was placed.
+    Allocation upload(const void* data, size_t size, size_t alignment = 0);
+    // Called once per presented frame with the timeline values that retire the frame that just ended.
+    void       next_frame(const uint64_t* retire_values);
+
+    template <typename T>
+    inline Allocation upload(const T& value) { return upload(&value, sizeof(T)); }
+
+    inline Stats    stats() { std::lock_guard<std::mutex> lock(m_mutex); return m_stats; }
+    inline size_t   page_size() { return m_page_size; }
+    inline uint32_t frame_count() { return m_frames.size(); }
+
+private:
+    struct Page
+    {
+        Buffer::Ptr buffer;
+        uint8_t*    mapped_ptr = nullptr;
+        size_t      size       = 0;
+    };
+
+    struct Frame
+    {
+        std::vector<Page> pages;
+        uint32_t          current_page                    = 0;
+        size_t            head                            = 0;
+        bool              retired                         = true; // Rewound since the GPU last used it.
+        uint64_t          retire_values[QUEUE_TYPE_COUNT] = {};
+    };
+
+    FrameAllocator(Backend::Ptr backend, size_t page_size, uint32_t frame_count);
+    void add_page(Frame& frame, size_t min_size);
+
+private:
+    std::weak_ptr<Backend> m_backend;
+    size_t                 m_page_size;
+    size_t                 m_min_alignment;
+    std::vector<Frame>     m_frames;
+    uint32_t               m_current_frame = 0;
+    std::mutex             m_mutex;
+    Stats                  m_pending_stats;
+    Stats                  m_stats;
+};
+
+// Records a group of uploads and BLAS builds into the backend staging ring so that they reach the GPU in as few submissions as possible.
 class BatchUploader
 {
 private:
@@ -1060,23 +1812,58 @@ private:
     };
 
 public:
+    // Builds whose scratch memory doesn't fit into the arena together are split into groups that reuse it.
+    static const VkDeviceSize kMaxBLASScratchArenaSize = 128 * 1024 * 1024;
+
+    struct BLASStats
+    {
+        uint32_t     build_count     = 0;
+        uint32_t     build_groups    = 0; // Build commands recorded, builds in a group run without barriers in between.
+        VkDeviceSize scratch_bytes   = 0; // Largest scratch arena used.
+        uint32_t     compacted_count = 0;
+        VkDeviceSize original_bytes  = 0; // Size of the compacted structures before compaction.
+        VkDeviceSize compacted_bytes = 0;
+    };
+
     BatchUploader(Backend::Ptr backend);
     ~BatchUploader();
 
     void upload_buffer_data(Buffer::Ptr buffer, void* data, const size_t& offset, const size_t& size);
+    // Mip levels are copied in order for each array layer. If fewer sizes than levels are given, only the leading levels are uploaded.
     void upload_image_data(Image::Ptr image, void* data, const std::vector<size_t>& mip_level_sizes, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    void generate_mipmaps(Image::Ptr image, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VkImageAspectFlags aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT, VkFilter filter = VK_FILTER_LINEAR);
+    // All pending BLAS builds are recorded together when the batch is submitted. Structures created with
+    // VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR are compacted in a second submission once the builds have
+    // completed, and keep their uncompacted storage until then.
     void build_blas(AccelerationStructure::Ptr acceleration_structure, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR> build_ranges);
+    // Submits everything recorded so far and waits for it to complete.
     void submit();
+    // Submits without waiting and returns the ticket of the submission. Resources owned by the batch are kept alive until
+    // wait() is called or the uploader is destroyed. Pending compactions are only recorded by is_complete() and wait(), so
+    // poll is_complete() until it returns true.
+    Ticket submit_async();
+    bool   is_complete();
+    void   wait();
+
+    inline uint32_t         upload_count() { return m_upload_count; }
+    inline Ticket           ticket() { return m_ticket; }
+    inline const BLASStats& blas_stats() { return m_blas_stats; }
 
 private:
-    Buffer::Ptr insert_data(void* data, const size_t& size);
-    void        add_staging_buffer(const size_t& size);
+    void record_blas_builds(CommandBuffer::Ptr cmd);
+    void record_blas_compaction(CommandBuffer::Ptr cmd);
+    bool submit_compaction(bool wait);
 
 private:
-    CommandBuffer::Ptr             m_cmd;
-    std::weak_ptr<Backend>         m_backend;
-    std::stack<StagingBuffer::Ptr> m_staging_buffers;
-    std::vector<BLASBuildRequest>  m_blas_build_requests;
+    std::weak_ptr<Backend>                  m_backend;
+    std::vector<BLASBuildRequest>           m_blas_build_requests;
+    std::vector<AccelerationStructure::Ptr> m_compaction_requests;
+    QueryPool::Ptr                          m_compaction_query_pool;
+    Buffer::Ptr                             m_blas_scratch_buffer;
+    BLASStats                               m_blas_stats;
+    Ticket                                  m_ticket;
+    uint32_t                                m_upload_count = 0;
+    bool                                    m_pending      = false;
 };
 
 namespace utilities
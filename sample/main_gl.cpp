@@ -218,7 +218,7 @@ private:
         DW_SCOPED_SAMPLE("render");
 
         // Bind framebuffer and set viewport.
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        bind_back_buffer();
         glViewport(0, 0, m_width, m_height);
 
         // Clear default framebuffer.
@@ -262,7 +262,7 @@ private:
 
         m_transforms.model      = glm::mat4(1.0f);
         m_transforms.model      = glm::translate(m_transforms.model, glm::vec3(0.0f, -20.0f, 0.0f));
-        m_transforms.model      = glm::rotate(m_transforms.model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
+        m_transforms.model      = glm::rotate(m_transforms.model, (float)elapsed_time(), glm::vec3(0.0f, 1.0f, 0.0f));
         m_transforms.model      = glm::scale(m_transforms.model, glm::vec3(0.6f));
         m_transforms.view       = m_main_camera->m_view;
         m_transforms.projection = m_main_camera->m_projection;
@@ -287,7 +287,8 @@ private:
         dw::vk::PipelineLayout::Desc pl_desc;
 
         pl_desc.add_descriptor_set_layout(m_per_frame_ds_layout)
-            .add_descriptor_set_layout(dw::Material::descriptor_set_layout());
+            .add_descriptor_set_layout(dw::Material::bindless_descriptor_set_layout())
+            .add_push_constant_range(VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(int32_t));
 
         m_pipeline_layout = dw::vk::PipelineLayout::create(m_vk_backend, pl_desc);
 
@@ -380,6 +381,9 @@ private:
 
         vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout->handle(), 0, 1, &m_per_frame_ds->handle(), 1, &dynamic_offset);
 
+        // All materials live in the bindless material table, so it only needs to be bound once.
+        vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout->handle(), 1, 1, &dw::Material::bindless_descriptor_set()->handle(), 0, nullptr);
+
         VkDeviceSize offset = 0;
         vkCmdBindVertexBuffers(cmd_buf->handle(), 0, 1, &m_mesh->vertex_buffer()->handle(), &offset);
         vkCmdBindIndexBuffer(cmd_buf->handle(), m_mesh->index_buffer()->handle(), 0, VK_INDEX_TYPE_UINT32);
@@ -389,9 +393,8 @@ private:
         for (uint32_t i = 0; i < submeshes.size(); i++)
         {
             auto& submesh = submeshes[i];
-            auto& mat     = m_mesh->material(submesh.mat_idx);
 
-            vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout->handle(), 1, 1, &mat->descriptor_set()->handle(), 0, nullptr);
+            vkCmdPushConstants(cmd_buf->handle(), m_pipeline_layout->handle(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(int32_t), &submesh.bindless_mat_idx);
 
             // Issue draw call.
             vkCmdDrawIndexed(cmd_buf->handle(), submesh.index_count, 1, submesh.base_index, submesh.base_vertex, 0);
@@ -410,7 +413,7 @@ private:
 
         m_transforms.model      = glm::mat4(1.0f);
         m_transforms.model      = glm::translate(m_transforms.model, glm::vec3(0.0f, -20.0f, 0.0f));
-        m_transforms.model      = glm::rotate(m_transforms.model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
+        m_transforms.model      = glm::rotate(m_transforms.model, (float)elapsed_time(), glm::vec3(0.0f, 1.0f, 0.0f));
         m_transforms.model      = glm::scale(m_transforms.model, glm::vec3(0.6f));
         m_transforms.view       = m_main_camera->m_view;
         m_transforms.projection = m_main_camera->m_projection;
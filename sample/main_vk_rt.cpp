@@ -7,6 +7,8 @@
 #include <assimp/scene.h>
 #include <vk_mem_alloc.h>
 #include <ray_traced_scene.h>
+#include <hosek_wilkie_sky_model.h>
+#include <cubemap_prefilter.h>
 
 // Uniform buffer data structure.
 struct Transforms
@@ -35,6 +37,7 @@ protected:
         if (!load_mesh())
             return false;
 
+        create_environment();
         create_output_image();
         create_descriptor_set_layout();
         create_descriptor_set();
@@ -52,16 +55,21 @@ protected:
 
     void update(double delta) override
     {
+        update_environment();
+
         dw::vk::CommandBuffer::Ptr cmd_buf = m_vk_backend->allocate_graphics_command_buffer(true);
 
         {
             DW_SCOPED_SAMPLE("update", cmd_buf);
 
+            // Polling records the BLAS compaction once the build has completed, the TLAS picks up the compacted BLAS after that.
+            if (m_uploader && m_uploader->is_complete())
+                m_uploader.reset();
+
             m_scene->build_tlas(cmd_buf);
 
-            // Render profiler.
 #if defined(DWSF_IMGUI)
-            dw::profiler::ui();
+            ui();
 #endif
 
             // Update camera.
@@ -98,8 +106,11 @@ protected:
         m_output_view.reset();
         m_output_image.reset();
         m_sbt.reset();
+        m_prefilter.reset();
+        m_sky_model.reset();
 
         // Unload assets.
+        m_uploader.reset();
         m_scene.reset();
         m_mesh.reset();
     }
@@ -175,6 +186,7 @@ private:
 
             desc.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_RAYGEN_BIT_NV);
             desc.add_binding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_RAYGEN_BIT_NV);
+            desc.add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_MISS_BIT_KHR);
 
             m_ray_tracing_layout = dw::vk::DescriptorSetLayout::create(m_vk_backend, desc);
         }
@@ -213,9 +225,10 @@ private:
         }
 
         {
-            VkWriteDescriptorSet write_data[2];
+            VkWriteDescriptorSet write_data[3];
             DW_ZERO_MEMORY(write_data[0]);
             DW_ZERO_MEMORY(write_data[1]);
+            DW_ZERO_MEMORY(write_data[2]);
 
             VkDescriptorImageInfo output_image;
             output_image.sampler     = VK_NULL_HANDLE;
@@ -242,7 +255,19 @@ private:
             write_data[1].dstBinding      = 1;
             write_data[1].dstSet          = m_ray_tracing_ds->handle();
 
-            vkUpdateDescriptorSets(m_vk_backend->device(), 2, &write_data[0], 0, nullptr);
+            VkDescriptorImageInfo environment_image;
+            environment_image.sampler     = dw::Material::common_sampler()->handle();
+            environment_image.imageView   = m_prefilter->image_view()->handle();
+            environment_image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+            write_data[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write_data[2].descriptorCount = 1;
+            write_data[2].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write_data[2].pImageInfo      = &environment_image;
+            write_data[2].dstBinding      = 2;
+            write_data[2].dstSet          = m_ray_tracing_ds->handle();
+
+            vkUpdateDescriptorSets(m_vk_backend->device(), 3, &write_data[0], 0, nullptr);
         }
     }
 
@@ -289,7 +314,9 @@ private:
 
         dw::vk::PipelineLayout::Desc pl_desc;
 
-        pl_desc.add_descriptor_set_layout(m_scene->descriptor_set_layout());
+        for (const auto& ds_layout : m_scene->descriptor_set_layouts())
+            pl_desc.add_descriptor_set_layout(ds_layout);
+
         pl_desc.add_descriptor_set_layout(m_ray_tracing_layout);
 
         m_raytracing_pipeline_layout = dw::vk::PipelineLayout::create(m_vk_backend, pl_desc);
@@ -303,8 +330,17 @@ private:
 
     bool load_mesh()
     {
-        m_mesh = dw::Mesh::load(m_vk_backend, "teapot.obj");
-        m_mesh->initialize_for_ray_tracing(m_vk_backend);
+        // Upload the mesh and build the BLAS in one submission without stalling the CPU, the first frames trace the
+        // uncompacted structure.
+        m_uploader = std::make_unique<dw::vk::BatchUploader>(m_vk_backend);
+
+        m_mesh = dw::Mesh::load(m_vk_backend, "teapot.obj", true, false, m_uploader.get());
+
+        if (!m_mesh)
+            return false;
+
+        m_mesh->initialize_for_ray_tracing(m_vk_backend, m_uploader.get());
+        m_uploader->submit_async();
 
         dw::RayTracedScene::Instance instance;
 
@@ -313,8 +349,74 @@ private:
 
         m_scene = dw::RayTracedScene::create(m_vk_backend, { instance });
 
-        return m_mesh != nullptr;
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_environment()
+    {
+        m_sky_model = std::make_unique<dw::HosekWilkieSkyModel>(m_vk_backend);
+        m_prefilter = std::make_unique<dw::CubemapPrefiler>(m_vk_backend, m_sky_model->image());
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Renders the sky on the graphics queue and prefilters it on the compute queue. The ray tracing of this frame reads the
+    // result, so the graphics queue waits for the compute submission through the acquire command buffer.
+    void update_environment()
+    {
+        if (!m_environment_dirty)
+            return;
+
+        m_environment_dirty = false;
+
+        dw::vk::CommandBuffer::Ptr sky_cmd_buf     = m_vk_backend->allocate_graphics_command_buffer(true);
+        dw::vk::CommandBuffer::Ptr compute_cmd_buf = m_vk_backend->allocate_compute_command_buffer(true);
+        dw::vk::CommandBuffer::Ptr acquire_cmd_buf = m_vk_backend->allocate_graphics_command_buffer(true);
+
+        dw::vk::Image::Ptr      sky_image         = m_sky_model->image();
+        VkImageSubresourceRange subresource_range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, sky_image->mip_levels(), 0, 6 };
+
+        // The sky is redrawn from scratch. The last prefilter already finished reading it, the graphics queue waited for it.
+        m_vk_backend->track_resource(VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, sky_image.get(), subresource_range);
+
+        const float sun_angle = glm::radians(m_sun_angle);
+
+        m_sky_model->update(sky_cmd_buf, glm::normalize(glm::vec3(0.0f, std::sin(sun_angle), std::cos(sun_angle))));
+        sky_image->generate_mipmaps(sky_cmd_buf);
+
+        m_vk_backend->transfer_ownership(sky_cmd_buf, dw::vk::QUEUE_TYPE_GRAPHICS, compute_cmd_buf, dw::vk::QUEUE_TYPE_COMPUTE, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sky_image, subresource_range);
+
+        m_prefilter->update_async(compute_cmd_buf, acquire_cmd_buf);
+
+        vkEndCommandBuffer(sky_cmd_buf->handle());
+        vkEndCommandBuffer(compute_cmd_buf->handle());
+        vkEndCommandBuffer(acquire_cmd_buf->handle());
+
+        dw::vk::Ticket sky_ticket     = m_vk_backend->submit_graphics({ sky_cmd_buf }, {}, {}, nullptr);
+        dw::vk::Ticket compute_ticket = m_vk_backend->submit_compute({ compute_cmd_buf }, {}, {}, nullptr, { sky_ticket });
+
+        m_vk_backend->submit_graphics({ acquire_cmd_buf }, {}, {}, nullptr, { compute_ticket });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(DWSF_IMGUI)
+    void ui()
+    {
+        // Render profiler.
+        dw::profiler::ui();
+
+        if (ImGui::Begin("Environment"))
+        {
+            if (ImGui::SliderFloat("Sun Angle", &m_sun_angle, 0.0f, 180.0f))
+                m_environment_dirty = true;
+        }
+
+        ImGui::End();
     }
+#endif
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
@@ -346,12 +448,17 @@ private:
 
         const uint32_t dynamic_offset = m_ubo_size * m_vk_backend->current_frame_idx();
 
+        const auto& scene_descriptor_sets = m_scene->descriptor_sets();
+
         VkDescriptorSet descriptor_sets[] = {
-            m_scene->descriptor_set()->handle(),
+            scene_descriptor_sets[dw::RayTracedScene::DESCRIPTOR_SET_SCENE]->handle(),
+            scene_descriptor_sets[dw::RayTracedScene::DESCRIPTOR_SET_VERTEX_BUFFERS]->handle(),
+            scene_descriptor_sets[dw::RayTracedScene::DESCRIPTOR_SET_INDEX_BUFFERS]->handle(),
+            scene_descriptor_sets[dw::RayTracedScene::DESCRIPTOR_SET_MATERIAL_INDICES]->handle(),
             m_ray_tracing_ds->handle(),
         };
 
-        vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_raytracing_pipeline_layout->handle(), 0, 2, descriptor_sets, 1, &dynamic_offset);
+        vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_raytracing_pipeline_layout->handle(), 0, 5, descriptor_sets, 1, &dynamic_offset);
 
         VkDeviceSize group_size   = dw::vk::utilities::aligned_size(rt_pipeline_props.shaderGroupHandleSize, rt_pipeline_props.shaderGroupBaseAlignment);
         VkDeviceSize group_stride = group_size;
@@ -442,14 +549,12 @@ private:
         m_transforms.proj_inverse = glm::inverse(m_main_camera->m_projection);
         m_transforms.view_inverse = glm::inverse(m_main_camera->m_view);
 
-        dw::RayTracedScene::Instance& instance = m_scene->fetch_instance(0);
-
         glm::mat4 model = glm::mat4(1.0f);
         model           = glm::translate(model, glm::vec3(0.0f, -20.0f, 0.0f));
-        model           = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
+        model           = glm::rotate(model, (float)elapsed_time(), glm::vec3(0.0f, 1.0f, 0.0f));
         model           = glm::scale(model, glm::vec3(0.6f));
 
-        instance.transform = model;
+        m_scene->set_transform(0, model);
 
         uint8_t* ptr = (uint8_t*)m_ubo->mapped_ptr();
         memcpy(ptr + m_ubo_size * m_vk_backend->current_frame_idx(), &m_transforms, sizeof(Transforms));
@@ -479,8 +584,15 @@ private:
     std::unique_ptr<dw::Camera> m_main_camera;
 
     // Assets.
-    dw::Mesh::Ptr           m_mesh;
-    dw::RayTracedScene::Ptr m_scene;
+    dw::Mesh::Ptr                          m_mesh;
+    dw::RayTracedScene::Ptr                m_scene;
+    std::unique_ptr<dw::vk::BatchUploader> m_uploader;
+
+    // Environment.
+    std::unique_ptr<dw::HosekWilkieSkyModel> m_sky_model;
+    std::unique_ptr<dw::CubemapPrefiler>     m_prefilter;
+    float                                    m_sun_angle         = 45.0f;
+    bool                                     m_environment_dirty = true;
 
     // Uniforms.
     Transforms m_transforms;
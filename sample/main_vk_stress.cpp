@@ -0,0 +1,613 @@
+#include <application.h>
+#include <camera.h>
+#include <mesh.h>
+#include <vk.h>
+#include <profiler.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vk_mem_alloc.h>
+
+// Uniform buffer data structure.
+struct Transforms
+{
+    DW_ALIGNED(16)
+    glm::mat4 view;
+    DW_ALIGNED(16)
+    glm::mat4 projection;
+};
+
+// Per draw data, pushed for every object so that recording stays CPU bound.
+struct PushConstants
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// Draws a large grid of meshes with one draw call per object. The grid is split into slices which are recorded in parallel
+// into secondary command buffers, each worker allocating from its own per-frame command pool. The workers live as long as the
+// sample and are woken once per frame.
+class Sample : public dw::Application
+{
+protected:
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool init(int argc, const char* argv[]) override
+    {
+        m_max_threads = std::max(1u, std::thread::hardware_concurrency());
+        m_num_threads = m_max_threads;
+
+        for (uint32_t i = 0; i < m_max_threads; i++)
+            m_workers.push_back(std::thread(&Sample::worker, this, i));
+
+        // Load mesh.
+        if (!load_mesh())
+            return false;
+
+        create_descriptor_set_layout();
+        create_pipeline_state();
+
+        // Create camera.
+        create_camera();
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void update(double delta) override
+    {
+        dw::vk::CommandBuffer::Ptr cmd_buf = m_vk_backend->allocate_graphics_command_buffer(true);
+
+        {
+            DW_SCOPED_SAMPLE("update", cmd_buf);
+
+#if defined(DWSF_IMGUI)
+            ui();
+#endif
+
+            // Update camera.
+            m_main_camera->update();
+
+            // Update uniforms.
+            update_uniforms(cmd_buf);
+
+            // Render.
+            render(cmd_buf);
+        }
+
+        vkEndCommandBuffer(cmd_buf->handle());
+
+        submit_and_present({ cmd_buf });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void shutdown() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_worker_mutex);
+            m_stop_workers = true;
+        }
+
+        m_work_available.notify_all();
+
+        for (auto& worker : m_workers)
+            worker.join();
+
+        m_workers.clear();
+        m_secondary_cmd_bufs.clear();
+
+        m_mesh.reset();
+        m_pso.reset();
+        m_pipeline_layout.reset();
+        m_per_frame_ds_layout.reset();
+        m_per_frame_ds.reset();
+        m_transforms_allocation = dw::vk::FrameAllocator::Allocation();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    dw::AppSettings intial_app_settings() override
+    {
+        // Set custom settings here...
+        dw::AppSettings settings;
+
+        settings.width       = 1280;
+        settings.height      = 720;
+        settings.title       = "Multi-threaded Command Recording (Vulkan)";
+        settings.ray_tracing = false;
+
+        return settings;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void window_resized(int width, int height) override
+    {
+        // Override window resized method to update camera projection.
+        m_main_camera->update_projection(60.0f, 0.1f, 1000.0f, float(m_width) / float(m_height));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+private:
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_descriptor_set_layout()
+    {
+        dw::vk::DescriptorSetLayout::Desc desc;
+
+        desc.add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT);
+
+        m_per_frame_ds_layout = dw::vk::DescriptorSetLayout::create(m_vk_backend, desc);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // The frame allocator may place the uniforms in a different page from one frame to the next, so a transient set is written
+    // against whichever buffer this frame's allocation landed in.
+    void write_descriptor_set()
+    {
+        m_per_frame_ds = m_vk_backend->allocate_transient_descriptor_set(m_per_frame_ds_layout);
+
+        VkDescriptorBufferInfo buffer_info;
+
+        buffer_info.buffer = m_transforms_allocation.buffer->handle();
+        buffer_info.offset = 0;
+        buffer_info.range  = sizeof(Transforms);
+
+        VkWriteDescriptorSet write_data;
+        DW_ZERO_MEMORY(write_data);
+
+        write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_data.descriptorCount = 1;
+        write_data.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        write_data.pBufferInfo     = &buffer_info;
+        write_data.dstBinding      = 0;
+        write_data.dstSet          = m_per_frame_ds->handle();
+
+        vkUpdateDescriptorSets(m_vk_backend->device(), 1, &write_data, 0, nullptr);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_pipeline_state()
+    {
+        // ---------------------------------------------------------------------------
+        // Create shader modules
+        // ---------------------------------------------------------------------------
+
+        dw::vk::ShaderModule::Ptr vs = dw::vk::ShaderModule::create_from_file(m_vk_backend, "shaders/stress.vert.spv");
+        dw::vk::ShaderModule::Ptr fs = dw::vk::ShaderModule::create_from_file(m_vk_backend, "shaders/stress.frag.spv");
+
+        dw::vk::GraphicsPipeline::Desc pso_desc;
+
+        pso_desc.add_shader_stage(VK_SHADER_STAGE_VERTEX_BIT, vs, "main")
+            .add_shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, fs, "main");
+
+        // ---------------------------------------------------------------------------
+        // Create vertex input state
+        // ---------------------------------------------------------------------------
+
+        pso_desc.set_vertex_input_state(m_mesh->vertex_input_state_desc());
+
+        // ---------------------------------------------------------------------------
+        // Create pipeline input assembly state
+        // ---------------------------------------------------------------------------
+
+        dw::vk::InputAssemblyStateDesc input_assembly_state_desc;
+
+        input_assembly_state_desc.set_primitive_restart_enable(false)
+            .set_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+        pso_desc.set_input_assembly_state(input_assembly_state_desc);
+
+        // ---------------------------------------------------------------------------
+        // Create viewport state
+        // ---------------------------------------------------------------------------
+
+        dw::vk::ViewportStateDesc vp_desc;
+
+        vp_desc.add_viewport(0.0f, 0.0f, m_width, m_height, 0.0f, 1.0f)
+            .add_scissor(0, 0, m_width, m_height);
+
+        pso_desc.set_viewport_state(vp_desc);
+
+        // ---------------------------------------------------------------------------
+        // Create rasterization state
+        // ---------------------------------------------------------------------------
+
+        dw::vk::RasterizationStateDesc rs_state;
+
+        rs_state.set_depth_clamp(VK_FALSE)
+            .set_rasterizer_discard_enable(VK_FALSE)
+            .set_polygon_mode(VK_POLYGON_MODE_FILL)
+            .set_line_width(1.0f)
+            .set_cull_mode(VK_CULL_MODE_BACK_BIT)
+            .set_front_face(VK_FRONT_FACE_COUNTER_CLOCKWISE)
+            .set_depth_bias(VK_FALSE);
+
+        pso_desc.set_rasterization_state(rs_state);
+
+        // ---------------------------------------------------------------------------
+        // Create multisample state
+        // ---------------------------------------------------------------------------
+
+        dw::vk::MultisampleStateDesc ms_state;
+
+        ms_state.set_sample_shading_enable(VK_FALSE)
+            .set_rasterization_samples(VK_SAMPLE_COUNT_1_BIT);
+
+        pso_desc.set_multisample_state(ms_state);
+
+        // ---------------------------------------------------------------------------
+        // Create depth stencil state
+        // ---------------------------------------------------------------------------
+
+        dw::vk::DepthStencilStateDesc ds_state;
+
+        ds_state.set_depth_test_enable(VK_TRUE)
+            .set_depth_write_enable(VK_TRUE)
+            .set_depth_compare_op(VK_COMPARE_OP_LESS)
+            .set_depth_bounds_test_enable(VK_FALSE)
+            .set_stencil_test_enable(VK_FALSE);
+
+        pso_desc.set_depth_stencil_state(ds_state);
+
+        // ---------------------------------------------------------------------------
+        // Create color blend state
+        // ---------------------------------------------------------------------------
+
+        dw::vk::ColorBlendAttachmentStateDesc blend_att_desc;
+
+        blend_att_desc.set_color_write_mask(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)
+            .set_blend_enable(VK_FALSE);
+
+        dw::vk::ColorBlendStateDesc blend_state;
+
+        blend_state.set_logic_op_enable(VK_FALSE)
+            .set_logic_op(VK_LOGIC_OP_COPY)
+            .set_blend_constants(0.0f, 0.0f, 0.0f, 0.0f)
+            .add_attachment(blend_att_desc);
+
+        pso_desc.set_color_blend_state(blend_state);
+
+        // ---------------------------------------------------------------------------
+        // Create pipeline layout
+        // ---------------------------------------------------------------------------
+
+        dw::vk::PipelineLayout::Desc pl_desc;
+
+        pl_desc.add_descriptor_set_layout(m_per_frame_ds_layout)
+            .add_push_constant_range(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants));
+
+        m_pipeline_layout = dw::vk::PipelineLayout::create(m_vk_backend, pl_desc);
+
+        pso_desc.set_pipeline_layout(m_pipeline_layout);
+
+        // ---------------------------------------------------------------------------
+        // Create dynamic state
+        // ---------------------------------------------------------------------------
+
+        pso_desc.add_dynamic_state(VK_DYNAMIC_STATE_VIEWPORT)
+            .add_dynamic_state(VK_DYNAMIC_STATE_SCISSOR);
+
+        // ---------------------------------------------------------------------------
+        // Create pipeline
+        // ---------------------------------------------------------------------------
+
+        pso_desc.add_color_attachment_format(m_vk_backend->swap_chain_image_format())
+            .set_depth_attachment_format(m_vk_backend->swap_chain_depth_format());
+
+        m_pso = dw::vk::GraphicsPipeline::create(m_vk_backend, pso_desc);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_mesh()
+    {
+        m_mesh = dw::Mesh::load(m_vk_backend, "teapot.obj");
+        return m_mesh != nullptr;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_camera()
+    {
+        m_main_camera = std::make_unique<dw::Camera>(
+            60.0f, 0.1f, 1000.0f, float(m_width) / float(m_height), glm::vec3(0.0f, 0.0f, 250.0f), glm::vec3(0.0f, 0.0, -1.0f));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(DWSF_IMGUI)
+    void ui()
+    {
+        // Render profiler.
+        dw::profiler::ui();
+
+        if (ImGui::Begin("Recording"))
+        {
+            ImGui::SliderInt("Objects", &m_num_objects, 1, 100000);
+            ImGui::SliderInt("Threads", &m_num_threads, 1, m_max_threads);
+            ImGui::Text("Record Time: %.3f ms", m_record_time_ms);
+            ImGui::Text("Thread Command Pools: %u", m_vk_backend->thread_command_pool_count());
+        }
+
+        ImGui::End();
+    }
+#endif
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    dw::vk::CommandBuffer::Ptr record_slice(uint32_t thread_idx, uint32_t first_object, uint32_t object_count)
+    {
+        dw::vk::CommandBufferInheritanceDesc inheritance_desc;
+
+        inheritance_desc.add_color_attachment_format(m_vk_backend->swap_chain_image_format())
+            .set_depth_attachment_format(m_vk_backend->swap_chain_depth_format());
+
+        dw::vk::CommandBuffer::Ptr cmd_buf = m_vk_backend->allocate_secondary_command_buffer(thread_idx, inheritance_desc);
+
+        // Secondary command buffers inherit no state from the primary.
+        vkCmdBindPipeline(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pso->handle());
+
+        VkViewport vp;
+
+        vp.x        = 0.0f;
+        vp.y        = (float)m_height;
+        vp.width    = (float)m_width;
+        vp.height   = -(float)m_height;
+        vp.minDepth = 0.0f;
+        vp.maxDepth = 1.0f;
+
+        vkCmdSetViewport(cmd_buf->handle(), 0, 1, &vp);
+
+        VkRect2D scissor_rect;
+
+        scissor_rect.extent.width  = m_width;
+        scissor_rect.extent.height = m_height;
+        scissor_rect.offset.x      = 0;
+        scissor_rect.offset.y      = 0;
+
+        vkCmdSetScissor(cmd_buf->handle(), 0, 1, &scissor_rect);
+
+        const uint32_t dynamic_offset = m_transforms_allocation.offset;
+
+        vkCmdBindDescriptorSets(cmd_buf->handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout->handle(), 0, 1, &m_per_frame_ds->handle(), 1, &dynamic_offset);
+
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(cmd_buf->handle(), 0, 1, &m_mesh->vertex_buffer()->handle(), &offset);
+        vkCmdBindIndexBuffer(cmd_buf->handle(), m_mesh->index_buffer()->handle(), 0, VK_INDEX_TYPE_UINT32);
+
+        const auto&    submeshes = m_mesh->sub_meshes();
+        const uint32_t grid_size = uint32_t(ceilf(sqrtf(float(m_num_objects))));
+        const float    spacing   = 400.0f / float(grid_size);
+
+        for (uint32_t i = first_object; i < first_object + object_count; i++)
+        {
+            const uint32_t x = i % grid_size;
+            const uint32_t y = i / grid_size;
+
+            PushConstants push_constants;
+
+            push_constants.model = glm::mat4(1.0f);
+            push_constants.model = glm::translate(push_constants.model, glm::vec3((float(x) - float(grid_size) * 0.5f) * spacing, (float(y) - float(grid_size) * 0.5f) * spacing, 0.0f));
+            push_constants.model = glm::rotate(push_constants.model, m_time + float(i) * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+            push_constants.model = glm::scale(push_constants.model, glm::vec3(0.01f * spacing));
+            push_constants.color = glm::vec4(float(x) / float(grid_size), float(y) / float(grid_size), 1.0f, 1.0f);
+
+            vkCmdPushConstants(cmd_buf->handle(), m_pipeline_layout->handle(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &push_constants);
+
+            for (uint32_t j = 0; j < submeshes.size(); j++)
+            {
+                auto& submesh = submeshes[j];
+
+                // Issue draw call.
+                vkCmdDrawIndexed(cmd_buf->handle(), submesh.index_count, 1, submesh.base_index, submesh.base_vertex, 0);
+            }
+        }
+
+        vkEndCommandBuffer(cmd_buf->handle());
+
+        return cmd_buf;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void worker(uint32_t thread_idx)
+    {
+        uint64_t generation = 0;
+
+        while (true)
+        {
+            uint32_t num_threads;
+
+            {
+                std::unique_lock<std::mutex> lock(m_worker_mutex);
+                m_work_available.wait(lock, [this, generation]() { return m_stop_workers || m_work_generation != generation; });
+
+                if (m_stop_workers)
+                    return;
+
+                generation  = m_work_generation;
+                num_threads = m_active_threads;
+            }
+
+            // Workers beyond the thread count chosen in the UI sit this frame out.
+            if (thread_idx >= num_threads)
+                continue;
+
+            const uint32_t first_object = (m_num_objects * thread_idx) / num_threads;
+            const uint32_t last_object  = (m_num_objects * (thread_idx + 1)) / num_threads;
+
+            m_secondary_cmd_bufs[thread_idx] = record_slice(thread_idx, first_object, last_object - first_object);
+
+            {
+                std::lock_guard<std::mutex> lock(m_worker_mutex);
+
+                if (--m_work_pending == 0)
+                    m_work_done.notify_one();
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void render(dw::vk::CommandBuffer::Ptr cmd_buf)
+    {
+        DW_SCOPED_SAMPLE("render", cmd_buf);
+
+        dw::vk::Image::Ptr color_image = m_vk_backend->swapchain_image();
+        dw::vk::Image::Ptr depth_image = m_vk_backend->swapchain_depth_image();
+
+        const VkFormat           depth_format = m_vk_backend->swap_chain_depth_format();
+        const bool               has_stencil  = depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT || depth_format == VK_FORMAT_D24_UNORM_S8_UINT;
+        const VkImageAspectFlags depth_aspect = has_stencil ? (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT) : VK_IMAGE_ASPECT_DEPTH_BIT;
+        VkImageSubresourceRange  color_range  = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        VkImageSubresourceRange  depth_range  = { depth_aspect, 0, 1, 0, 1 };
+
+        m_vk_backend->use_resource(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, color_image, color_range);
+        m_vk_backend->use_resource(VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, depth_image, depth_range);
+
+        m_vk_backend->flush_barriers(cmd_buf);
+
+        // ---------------------------------------------------------------------------
+        // Record the grid in parallel
+        // ---------------------------------------------------------------------------
+
+        m_time = (float)elapsed_time();
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // Each worker only writes its own slot, and the vector isn't touched again until all of them are done.
+        m_secondary_cmd_bufs.resize(m_num_threads);
+
+        {
+            std::lock_guard<std::mutex> lock(m_worker_mutex);
+            m_active_threads = m_num_threads;
+            m_work_pending   = m_num_threads;
+            m_work_generation++;
+        }
+
+        m_work_available.notify_all();
+
+        {
+            std::unique_lock<std::mutex> lock(m_worker_mutex);
+            m_work_done.wait(lock, [this]() { return m_work_pending == 0; });
+        }
+
+        m_record_time_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        // ---------------------------------------------------------------------------
+        // Execute the slices
+        // ---------------------------------------------------------------------------
+
+        VkRenderingAttachmentInfo color_attachment = {};
+
+        color_attachment.sType            = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        color_attachment.imageView        = m_vk_backend->swapchain_image_view()->handle();
+        color_attachment.imageLayout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        color_attachment.loadOp           = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        color_attachment.storeOp          = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.clearValue.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+        VkRenderingAttachmentInfo depth_attachment = {};
+
+        depth_attachment.sType                   = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        depth_attachment.imageView               = m_vk_backend->swapchain_depth_image_view()->handle();
+        depth_attachment.imageLayout             = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depth_attachment.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.storeOp                 = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.clearValue.depthStencil = { 1.0f, 0 };
+
+        VkRenderingInfo rendering_info = {};
+
+        rendering_info.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        rendering_info.flags                = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        rendering_info.renderArea           = { 0, 0, (uint32_t)m_width, (uint32_t)m_height };
+        rendering_info.layerCount           = 1;
+        rendering_info.colorAttachmentCount = 1;
+        rendering_info.pColorAttachments    = &color_attachment;
+        rendering_info.pDepthAttachment     = &depth_attachment;
+
+        vkCmdBeginRendering(cmd_buf->handle(), &rendering_info);
+
+        m_vk_backend->execute_secondary_command_buffers(cmd_buf, m_secondary_cmd_bufs);
+
+        vkCmdEndRendering(cmd_buf->handle());
+
+#if defined(DWSF_IMGUI)
+        // A scope that executes secondaries cannot also record inline commands, so the GUI gets its own.
+        color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+        rendering_info.flags            = 0;
+        rendering_info.pDepthAttachment = nullptr;
+
+        vkCmdBeginRendering(cmd_buf->handle(), &rendering_info);
+
+        render_gui(cmd_buf);
+
+        vkCmdEndRendering(cmd_buf->handle());
+#endif
+
+        m_vk_backend->use_resource(VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, color_image, color_range);
+
+        m_vk_backend->flush_barriers(cmd_buf);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void update_uniforms(dw::vk::CommandBuffer::Ptr cmd_buf)
+    {
+        DW_SCOPED_SAMPLE("update_uniforms", cmd_buf);
+
+        m_transforms.view       = m_main_camera->m_view;
+        m_transforms.projection = m_main_camera->m_projection;
+
+        m_transforms_allocation = m_vk_backend->frame_allocator()->upload(m_transforms);
+
+        write_descriptor_set();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+private:
+    // GPU resources.
+    dw::vk::GraphicsPipeline::Ptr      m_pso;
+    dw::vk::PipelineLayout::Ptr        m_pipeline_layout;
+    dw::vk::DescriptorSetLayout::Ptr   m_per_frame_ds_layout;
+    dw::vk::DescriptorSet::Ptr         m_per_frame_ds;
+    dw::vk::FrameAllocator::Allocation m_transforms_allocation;
+
+    // Camera.
+    std::unique_ptr<dw::Camera> m_main_camera;
+
+    // Assets.
+    dw::Mesh::Ptr m_mesh;
+
+    // Uniforms.
+    Transforms m_transforms;
+
+    // Recording.
+    int32_t m_num_objects    = 20000;
+    int32_t m_num_threads    = 1;
+    int32_t m_max_threads    = 1;
+    float   m_time           = 0.0f;
+    float   m_record_time_ms = 0.0f;
+
+    // Persistent recording workers.
+    std::vector<std::thread>                m_workers;
+    std::vector<dw::vk::CommandBuffer::Ptr> m_secondary_cmd_bufs;
+    std::mutex                              m_worker_mutex;
+    std::condition_variable                 m_work_available;
+    std::condition_variable                 m_work_done;
+    uint64_t                                m_work_generation = 0;
+    uint32_t                                m_work_pending    = 0;
+    uint32_t                                m_active_threads  = 0;
+    bool                                    m_stop_workers    = false;
+};
+
+DW_DECLARE_MAIN(Sample)
@@ -1,15 +1,33 @@
 #version 450
 
+#extension GL_EXT_nonuniform_qualifier : require
+
 layout (location = 0) in vec3 FS_IN_FragPos;
 layout (location = 1) in vec2 FS_IN_Texcoord;
 layout (location = 2) in vec3 FS_IN_Normal;
 
 layout (location = 0) out vec3 FS_OUT_Color;
 
-layout (set = 1, binding = 0) uniform sampler2D s_Diffuse;
-layout (set = 1, binding = 1) uniform sampler2D s_Normal;
-layout (set = 1, binding = 2) uniform sampler2D s_Metallic;
-layout (set = 1, binding = 3) uniform sampler2D s_Roughness;
+struct Material
+{
+    ivec4 texture_indices0; // x: albedo, y: normals, z: roughness, w: metallic
+    ivec4 texture_indices1; // x: emissive, z: roughness_channel, w: metallic_channel
+    vec4  albedo;
+    vec4  emissive;
+    vec4  roughness_metallic;
+};
+
+layout (set = 1, binding = 0, std430) readonly buffer MaterialBuffer
+{
+    Material data[];
+} Materials;
+
+layout (set = 1, binding = 1) uniform sampler2D s_Textures[];
+
+layout (push_constant) uniform PushConstants
+{
+    int material_index;
+} u_PushConstants;
 
 void main()
 {
@@ -20,7 +38,18 @@ void main()
 
 	float lambert = max(0.0f, dot(n, l));
 
-    vec3 diffuse = texture(s_Diffuse, FS_IN_Texcoord).xyz;
+    vec3 diffuse = vec3(1.0);
+
+    if (u_PushConstants.material_index != -1)
+    {
+        Material material = Materials.data[u_PushConstants.material_index];
+
+        if (material.texture_indices0.x != -1)
+            diffuse = texture(s_Textures[nonuniformEXT(material.texture_indices0.x)], FS_IN_Texcoord).xyz;
+        else
+            diffuse = material.albedo.xyz;
+    }
+
 	vec3 ambient = diffuse * 0.03;
 
 	vec3 color = diffuse * lambert + ambient;
@@ -31,4 +60,4 @@ void main()
     color = pow(color, vec3(1.0 / 2.2));
 
     FS_OUT_Color = color;
-}
\ No newline at end of file
+}
@@ -0,0 +1,34 @@
+#version 450
+
+layout (location = 0) in vec3 FS_IN_FragPos;
+layout (location = 1) in vec3 FS_IN_Normal;
+
+layout (location = 0) out vec3 FS_OUT_Color;
+
+layout (push_constant) uniform PushConstants
+{
+	mat4 model;
+	vec4 color;
+} u_PushConstants;
+
+void main()
+{
+    vec3 light_pos = vec3(-200.0, 200.0, 0.0);
+
+	vec3 n = normalize(FS_IN_Normal);
+	vec3 l = normalize(light_pos - FS_IN_FragPos);
+
+	float lambert = max(0.0f, dot(n, l));
+
+    vec3 diffuse = u_PushConstants.color.xyz;
+	vec3 ambient = diffuse * 0.03;
+
+	vec3 color = diffuse * lambert + ambient;
+
+	// HDR tonemapping
+    color = color / (color + vec3(1.0));
+    // gamma correct
+    color = pow(color, vec3(1.0 / 2.2));
+
+    FS_OUT_Color = color;
+}
@@ -0,0 +1,41 @@
+#version 450
+
+layout(location = 0) in vec4 VS_IN_Position;
+layout(location = 1) in vec4 VS_IN_Texcoord;
+layout(location = 2) in vec4 VS_IN_Normal;
+layout(location = 3) in vec4 VS_IN_Tangent;
+layout(location = 4) in vec4 VS_IN_Bitangent;
+
+layout (location = 0) out vec3 FS_IN_FragPos;
+layout (location = 1) out vec3 FS_IN_Normal;
+
+layout (set = 0, binding = 0) uniform PerFrameUBO 
+{
+	mat4 view;
+	mat4 projection;
+} ubo;
+
+layout (push_constant) uniform PushConstants
+{
+	mat4 model;
+	vec4 color;
+} u_PushConstants;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+    // Transform position into world space
+	vec4 world_pos = u_PushConstants.model * vec4(VS_IN_Position.xyz, 1.0);
+
+    FS_IN_FragPos = world_pos.xyz;
+
+    // Transform world position into clip space
+	gl_Position = ubo.projection * ubo.view * world_pos;
+
+    // Transform vertex normal into world space
+	FS_IN_Normal = mat3(u_PushConstants.model) * VS_IN_Normal.xyz;
+}
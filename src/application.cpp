@@ -8,6 +8,11 @@
 #else
 #    include <backends/imgui_impl_opengl3.h>
 #endif
+#if defined(DWSF_EGL)
+#    include <EGL/egl.h>
+#    include <EGL/eglext.h>
+#    include <cstring>
+#endif
 #include <profiler.h>
 #include <iostream>
 
@@ -159,6 +164,8 @@ bool Application::init_base(int argc, const char* argv[])
     logger::open_console_stream();
     logger::open_file_stream();
 
+    m_start_time = std::chrono::steady_clock::now();
+
     // Defaults
     AppSettings settings = intial_app_settings();
 
@@ -184,79 +191,122 @@ bool Application::init_base(int argc, const char* argv[])
     const char* imgui_glsl_version = "#version 130";
 #endif
 
-    if (glfwInit() != GLFW_TRUE)
+    m_headless             = settings.headless;
+    m_headless_frame_count = settings.headless_frame_count;
+
+#if !defined(DWSF_VULKAN) && !defined(DWSF_EGL)
+    if (m_headless)
     {
-        DW_LOG_FATAL("Failed to initialize GLFW");
-        return false;
+        DW_LOG_WARNING("Headless OpenGL requires EGL, falling back to a window.");
+        m_headless = false;
     }
+#endif
+
+    // Headless applications have no window, GLFW isn't initialized at all.
+    if (!m_headless)
+    {
+        if (glfwInit() != GLFW_TRUE)
+        {
+            DW_LOG_FATAL("Failed to initialize GLFW");
+            return false;
+        }
 
 #if defined(DWSF_VULKAN)
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 #else
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
 
 #    if !defined(__EMSCRIPTEN__)
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 8);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_SAMPLES, 8);
 #    endif
 
 #    if __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #    endif
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major_ver);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor_ver);
-    glfwSwapInterval(m_vsync ? 1 : 0);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major_ver);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor_ver);
+        glfwSwapInterval(m_vsync ? 1 : 0);
 #endif
-    glfwWindowHint(GLFW_RESIZABLE, false);
-    glfwWindowHint(GLFW_MAXIMIZED, maximized);
+        glfwWindowHint(GLFW_RESIZABLE, false);
+        glfwWindowHint(GLFW_MAXIMIZED, maximized);
 
-    m_window = glfwCreateWindow(m_width, m_height, m_title.c_str(), fullscreen ? glfwGetPrimaryMonitor() : nullptr, nullptr);
+        m_window = glfwCreateWindow(m_width, m_height, m_title.c_str(), fullscreen ? glfwGetPrimaryMonitor() : nullptr, nullptr);
 
-    if (!m_window)
-    {
-        DW_LOG_FATAL("Failed to create GLFW window!");
-        return false;
-    }
+        if (!m_window)
+        {
+            DW_LOG_FATAL("Failed to create GLFW window!");
+            return false;
+        }
 
-    glfwSetKeyCallback(m_window, key_callback_glfw);
-    glfwSetCursorPosCallback(m_window, mouse_callback_glfw);
-    glfwSetScrollCallback(m_window, scroll_callback_glfw);
-    glfwSetMouseButtonCallback(m_window, mouse_button_callback_glfw);
-    glfwSetCharCallback(m_window, char_callback_glfw);
-    glfwSetWindowSizeCallback(m_window, window_size_callback_glfw);
-    glfwSetWindowUserPointer(m_window, this);
+        glfwSetKeyCallback(m_window, key_callback_glfw);
+        glfwSetCursorPosCallback(m_window, mouse_callback_glfw);
+        glfwSetScrollCallback(m_window, scroll_callback_glfw);
+        glfwSetMouseButtonCallback(m_window, mouse_button_callback_glfw);
+        glfwSetCharCallback(m_window, char_callback_glfw);
+        glfwSetWindowSizeCallback(m_window, window_size_callback_glfw);
+        glfwSetWindowUserPointer(m_window, this);
 
-    glfwMakeContextCurrent(m_window);
+        glfwMakeContextCurrent(m_window);
+    }
 
     DW_LOG_INFO("Successfully initialized platform!");
 
 #if defined(DWSF_VULKAN)
-    m_vk_backend = vk::Backend::create(m_window,
-                                       m_vsync,
-                                       settings.srgb,
-                                       settings.enable_validation,
-                                       settings.enable_nsight_aftermath,
-                                       settings.ray_tracing,
-                                       settings.device_extensions);
+    if (m_headless)
+    {
+        m_vk_backend = vk::Backend::create_headless(m_width,
+                                                    m_height,
+                                                    settings.srgb,
+                                                    settings.enable_validation,
+                                                    settings.ray_tracing,
+                                                    settings.device_extensions,
+                                                    settings.pipeline_cache_path,
+                                                    settings.frames_in_flight);
+    }
+    else
+    {
+        m_vk_backend = vk::Backend::create(m_window,
+                                           m_vsync,
+                                           settings.srgb,
+                                           settings.enable_validation,
+                                           settings.enable_nsight_aftermath,
+                                           settings.ray_tracing,
+                                           settings.device_extensions,
+                                           settings.pipeline_cache_path,
+                                           settings.frames_in_flight);
+    }
+
+    m_vk_backend->set_present_wait_enabled(settings.present_wait);
 
     m_title += " - " + std::string(m_vk_backend->physical_device_properties().deviceName);
 
-    glfwSetWindowTitle(m_window, m_title.c_str());
+    if (!m_headless)
+        glfwSetWindowTitle(m_window, m_title.c_str());
 
-    const uint32_t max_frames_in_flights = m_vk_backend->swap_image_count();
+    const uint32_t max_frames_in_flights = m_vk_backend->frames_in_flight();
+
+    m_frame_tickets.resize(max_frames_in_flights);
 
     for (uint32_t i = 0; i < max_frames_in_flights; i++)
-    {
-        m_render_complete_fences.push_back(vk::Fence::create(m_vk_backend));
-        m_render_complete_semaphores.push_back(vk::Semaphore::create(m_vk_backend));
         m_present_complete_semaphores.push_back(vk::Semaphore::create(m_vk_backend));
-    }
+
+    create_render_complete_semaphores();
 
     Material::initialize_common_resources(m_vk_backend);
 #else
+    if (m_headless && !create_headless_context(major_ver, minor_ver))
+        return false;
+
 #    if !defined(__EMSCRIPTEN__)
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+#        if defined(DWSF_EGL)
+    GLADloadproc load_proc = m_headless ? (GLADloadproc)eglGetProcAddress : (GLADloadproc)glfwGetProcAddress;
+#        else
+    GLADloadproc load_proc = (GLADloadproc)glfwGetProcAddress;
+#        endif
+
+    if (!gladLoadGLLoader(load_proc))
         return false;
 #    endif
 
@@ -268,13 +318,29 @@ bool Application::init_base(int argc, const char* argv[])
 
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
+    // There is no default framebuffer without a surface, an offscreen one takes its place.
+    if (m_headless)
+    {
+        m_back_buffer_color = gl::Texture2D::create(m_width, m_height, 1, 1, 1, settings.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        m_back_buffer_color->set_name("Back Buffer Color");
+
+        m_back_buffer_depth = gl::Texture2D::create(m_width, m_height, 1, 1, 1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+        m_back_buffer_depth->set_name("Back Buffer Depth");
+
+        m_back_buffer = gl::Framebuffer::create({ m_back_buffer_color }, m_back_buffer_depth);
+        m_back_buffer->set_name("Back Buffer");
+
+        // Renderers that draw to the default framebuffer when given none, like DebugDraw, end up here instead.
+        gl::Framebuffer::set_default(m_back_buffer);
+    }
 #endif
 
 #if defined(DWSF_IMGUI)
     ImGui::CreateContext();
 
 #    if defined(DWSF_VULKAN)
-    ImGui_ImplGlfw_InitForVulkan(m_window, false);
+    if (!m_headless)
+        ImGui_ImplGlfw_InitForVulkan(m_window, false);
 
     VkFormat swapchain_format = m_vk_backend->swap_chain_image_format();
 
@@ -293,7 +359,7 @@ bool Application::init_base(int argc, const char* argv[])
     init_info.Device                      = m_vk_backend->device();
     init_info.QueueFamily                 = m_vk_backend->queue_infos().graphics_queue_index;
     init_info.Queue                       = m_vk_backend->graphics_queue();
-    init_info.PipelineCache               = nullptr;
+    init_info.PipelineCache               = m_vk_backend->pipeline_cache();
     init_info.DescriptorPoolSize          = 32;
     init_info.RenderPass                  = nullptr;
     init_info.Allocator                   = nullptr;
@@ -307,31 +373,36 @@ bool Application::init_base(int argc, const char* argv[])
 
     ImGui_ImplVulkan_CreateFontsTexture();
 #    else
-    ImGui_ImplGlfw_InitForOpenGL(m_window, false);
+    if (!m_headless)
+        ImGui_ImplGlfw_InitForOpenGL(m_window, false);
+
     ImGui_ImplOpenGL3_Init(imgui_glsl_version);
 #    endif
 
     ImGui::StyleColorsDark();
 #endif
 
-    GLFWmonitor* primary = glfwGetPrimaryMonitor();
+    if (!m_headless)
+    {
+        GLFWmonitor* primary = glfwGetPrimaryMonitor();
 
-    float xscale, yscale;
-    glfwGetMonitorContentScale(primary, &xscale, &yscale);
+        float xscale, yscale;
+        glfwGetMonitorContentScale(primary, &xscale, &yscale);
 
 #if defined(DWSF_IMGUI) && !defined(__APPLE__)
-    ImGuiStyle* style = &ImGui::GetStyle();
+        ImGuiStyle* style = &ImGui::GetStyle();
 
-    style->ScaleAllSizes(xscale > yscale ? xscale : yscale);
+        style->ScaleAllSizes(xscale > yscale ? xscale : yscale);
 
-    ImGuiIO& io        = ImGui::GetIO();
-    io.FontGlobalScale = xscale > yscale ? xscale : yscale;
+        ImGuiIO& io        = ImGui::GetIO();
+        io.FontGlobalScale = xscale > yscale ? xscale : yscale;
 #endif
 
-    int display_w, display_h;
-    glfwGetFramebufferSize(m_window, &display_w, &display_h);
-    m_width  = display_w;
-    m_height = display_h;
+        int display_w, display_h;
+        glfwGetFramebufferSize(m_window, &display_w, &display_h);
+        m_width  = display_w;
+        m_height = display_h;
+    }
 
     if (!m_debug_draw.init(
 #if defined(DWSF_VULKAN)
@@ -382,7 +453,7 @@ void Application::shutdown_base()
     ImGui_ImplVulkan_Shutdown();
 #    endif
 
-    m_render_complete_fences.clear();
+    m_frame_tickets.clear();
     m_render_complete_semaphores.clear();
     m_present_complete_semaphores.clear();
 
@@ -397,13 +468,31 @@ void Application::shutdown_base()
 #endif
 
 #if defined(DWSF_IMGUI)
-    ImGui_ImplGlfw_Shutdown();
+    if (!m_headless)
+        ImGui_ImplGlfw_Shutdown();
+
     ImGui::DestroyContext();
 #endif
 
+#if !defined(DWSF_VULKAN)
+    if (m_headless)
+    {
+        gl::Framebuffer::set_default(nullptr);
+
+        m_back_buffer.reset();
+        m_back_buffer_color.reset();
+        m_back_buffer_depth.reset();
+
+        destroy_headless_context();
+    }
+#endif
+
     // Shutdown GLFW.
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
+    if (!m_headless)
+    {
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+    }
 
     // Close logger streams.
     logger::close_file_stream();
@@ -426,14 +515,25 @@ void Application::render_gui(vk::CommandBuffer::Ptr cmd_buf)
 void Application::submit_and_present(const std::vector<vk::CommandBuffer::Ptr>& cmd_bufs)
 {
     const uint32_t semaphore_idx = m_frame_index % static_cast<uint32_t>(m_present_complete_semaphores.size());
-    const uint32_t fence_idx     = m_frame_index % static_cast<uint32_t>(m_render_complete_fences.size());
+    const uint32_t ticket_idx    = m_frame_index % static_cast<uint32_t>(m_frame_tickets.size());
+    const uint32_t image_idx     = m_vk_backend->current_swap_image_idx();
+
+    m_frame_tickets[ticket_idx] = m_vk_backend->submit_graphics(cmd_bufs,
+                                                                { m_present_complete_semaphores[semaphore_idx] },
+                                                                { m_render_complete_semaphores[image_idx] },
+                                                                nullptr);
 
-    m_vk_backend->submit_graphics(cmd_bufs,
-                                  { m_present_complete_semaphores[semaphore_idx] },
-                                  { m_render_complete_semaphores[semaphore_idx] },
-                                  m_render_complete_fences[fence_idx]);
+    m_vk_backend->present({ m_render_complete_semaphores[image_idx] });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    m_vk_backend->present({ m_render_complete_semaphores[semaphore_idx] });
+void Application::create_render_complete_semaphores()
+{
+    // A present only releases its wait semaphore once the image is acquired again, so these are per swap chain image rather
+    // than per frame in flight. Recreating the swap chain waits for the device, so the existing ones can be kept.
+    while (m_render_complete_semaphores.size() < m_vk_backend->swap_image_count())
+        m_render_complete_semaphores.push_back(vk::Semaphore::create(m_vk_backend));
 }
 
 #endif
@@ -444,22 +544,31 @@ void Application::begin_frame()
 {
     m_timer.start();
 
-    glfwPollEvents();
+    if (!m_headless)
+        glfwPollEvents();
 
 #if defined(DWSF_VULKAN)
     if (m_should_recreate_swap_chain)
     {
         m_vk_backend->recreate_swapchain(m_vsync);
+        create_render_complete_semaphores();
         m_should_recreate_swap_chain = false;
     }
 
     const uint32_t semaphore_idx = m_frame_index % static_cast<uint32_t>(m_present_complete_semaphores.size());
-    const uint32_t fence_idx     = m_frame_index % static_cast<uint32_t>(m_render_complete_fences.size());
+    const uint32_t ticket_idx    = m_frame_index % static_cast<uint32_t>(m_frame_tickets.size());
+
+    // Swap chain acquire and present only work with binary semaphores, frames are paced with the graphics timeline instead of fences.
+    m_vk_backend->wait_for_frame(m_frame_tickets[ticket_idx]);
 
-    m_render_complete_fences[fence_idx]->wait_for_completion();
+    // The GPU is done with the sets allocated the last time this frame slot was used.
+    m_vk_backend->reset_transient_descriptor_allocator();
 
     if (!m_vk_backend->acquire_next_swap_chain_image(m_present_complete_semaphores[semaphore_idx]))
+    {
         m_vk_backend->recreate_swapchain(m_vsync);
+        create_render_complete_semaphores();
+    }
 
 #    if defined(DWSF_IMGUI)
     ImGui_ImplVulkan_NewFrame();
@@ -471,7 +580,16 @@ void Application::begin_frame()
 #endif
 
 #if defined(DWSF_IMGUI)
-    ImGui_ImplGlfw_NewFrame();
+    if (m_headless)
+    {
+        // No platform backend to fill these in.
+        ImGuiIO& io    = ImGui::GetIO();
+        io.DisplaySize = ImVec2((float)m_width, (float)m_height);
+        io.DeltaTime   = m_delta_seconds > 0.0 ? (float)m_delta_seconds : 1.0f / 60.0f;
+    }
+    else
+        ImGui_ImplGlfw_NewFrame();
+
     ImGui::NewFrame();
 #endif
 
@@ -492,10 +610,18 @@ void Application::end_frame()
 
 #if !defined(DWSF_VULKAN)
 #    if defined(DWSF_IMGUI)
+    if (m_headless)
+        m_back_buffer->bind();
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 #    endif
-    glfwSwapBuffers(m_window);
+
+    // Nothing throttles the CPU without a swap, wait for the frame so that frame times include the GPU work.
+    if (m_headless)
+        glFinish();
+    else
+        glfwSwapBuffers(m_window);
 #endif
 
     m_timer.stop();
@@ -509,18 +635,31 @@ void Application::end_frame()
 
 void Application::request_exit() const
 {
-    glfwSetWindowShouldClose(m_window, true);
+    if (m_headless)
+        m_exit_requested = true;
+    else
+        glfwSetWindowShouldClose(m_window, true);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 bool Application::exit_requested() const
 {
+    if (m_headless)
+        return m_exit_requested || (m_headless_frame_count > 0 && m_frame_index >= m_headless_frame_count);
+
     return glfwWindowShouldClose(m_window);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+double Application::elapsed_time() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start_time).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 AppSettings Application::intial_app_settings() { return AppSettings(); }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -549,10 +688,169 @@ void Application::load_initial_settings_from_file(AppSettings& settings)
 
     if (j.find("vsync") != j.end())
         settings.vsync = j["vsync"];
+
+    if (j.find("headless") != j.end())
+        settings.headless = j["headless"];
+
+    if (j.find("headless_frame_count") != j.end())
+        settings.headless_frame_count = j["headless_frame_count"];
+
+#if defined(DWSF_VULKAN)
+    if (j.find("frames_in_flight") != j.end())
+        settings.frames_in_flight = j["frames_in_flight"];
+
+    if (j.find("present_wait") != j.end())
+        settings.present_wait = j["present_wait"];
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+#if !defined(DWSF_VULKAN)
+void Application::bind_back_buffer()
+{
+    gl::Framebuffer::bind_default();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+bool Application::create_headless_context(int major_ver, int minor_ver)
+{
+#    if defined(DWSF_EGL)
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // Prefer the surfaceless platform, it needs neither a display server nor a GPU device node and works with llvmpipe.
+    const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (client_extensions && strstr(client_extensions, "EGL_MESA_platform_surfaceless"))
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        if (get_platform_display)
+            display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint egl_major, egl_minor;
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &egl_major, &egl_minor))
+    {
+        DW_LOG_FATAL("Failed to initialize EGL display!");
+        return false;
+    }
+
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+
+    // Releases everything created after the display was initialized.
+    auto fail = [&](const std::string& message) {
+        DW_LOG_FATAL(message);
+
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+
+        eglTerminate(display);
+
+        return false;
+    };
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        return fail("EGL does not support desktop OpenGL!");
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint    config_count = 0;
+
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0)
+        return fail("Failed to find a suitable EGL config!");
+
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major_ver,
+        EGL_CONTEXT_MINOR_VERSION, minor_ver,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+
+    if (context == EGL_NO_CONTEXT)
+        return fail("Failed to create EGL context!");
+
+    // Rendering always goes to the offscreen back buffer, so a surface is only created when the context can't be made current
+    // without one.
+    const char* display_extensions = eglQueryString(display, EGL_EXTENSIONS);
+
+    if (!display_extensions || !strstr(display_extensions, "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint pbuffer_attributes[] = {
+            EGL_WIDTH, 1,
+            EGL_HEIGHT, 1,
+            EGL_NONE
+        };
+
+        surface = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+
+        if (surface == EGL_NO_SURFACE)
+            return fail("Failed to create EGL pbuffer surface!");
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+        return fail("Failed to make EGL context current!");
+
+    m_egl_display = display;
+    m_egl_context = context;
+    m_egl_surface = surface;
+
+    DW_LOG_INFO("Created headless OpenGL context (EGL " + std::to_string(egl_major) + "." + std::to_string(egl_minor) + ")");
+
+    return true;
+#    else
+    return false;
+#    endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Application::destroy_headless_context()
+{
+#    if defined(DWSF_EGL)
+    if (!m_egl_display)
+        return;
+
+    eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if (m_egl_surface)
+        eglDestroySurface(m_egl_display, m_egl_surface);
+
+    if (m_egl_context)
+        eglDestroyContext(m_egl_display, m_egl_context);
+
+    eglTerminate(m_egl_display);
+
+    m_egl_display = nullptr;
+    m_egl_context = nullptr;
+    m_egl_surface = nullptr;
+#    endif
+}
+#endif
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Application::window_resized(int width, int height) {}
 
 // -----------------------------------------------------------------------------------------------------------------------------------
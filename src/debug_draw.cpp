@@ -1614,7 +1614,7 @@ void DebugDraw::render(gl::Framebuffer::Ptr fbo, int width, int height, const gl
         if (fbo)
             fbo->bind();
         else
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            gl::Framebuffer::bind_default();
 
         glViewport(0, 0, width, height);
         m_line_program->use();
@@ -10,22 +10,74 @@
 namespace dw
 {
 std::unordered_map<std::string, std::weak_ptr<Material>> Material::m_cache;
+uint64_t                                                 Material::m_deduplicated_texture_bytes = 0;
+bool                                                     Material::m_cpu_mip_generation         = false;
+mip_generator::Desc                                      Material::m_mip_generation_desc;
 
 #if defined(DWSF_VULKAN)
-std::unordered_map<std::string, std::weak_ptr<vk::Image>>     Material::m_image_cache;
-std::unordered_map<std::string, std::weak_ptr<vk::ImageView>> Material::m_image_view_cache;
-vk::DescriptorSetLayout::Ptr                                  Material::m_common_ds_layout;
-vk::Sampler::Ptr                                              Material::m_common_sampler;
-vk::Image::Ptr                                                Material::m_default_image;
-vk::ImageView::Ptr                                            Material::m_default_image_view;
+std::unordered_map<std::string, std::weak_ptr<vk::Image>>                 Material::m_image_cache;
+std::unordered_multimap<uint64_t, Material::ContentCacheEntry<vk::Image>> Material::m_image_hash_cache;
+std::unordered_map<vk::Image*, std::weak_ptr<vk::ImageView>>              Material::m_image_view_cache;
+vk::DescriptorSetLayout::Ptr                                              Material::m_common_ds_layout;
+vk::Sampler::Ptr                                                          Material::m_common_sampler;
+vk::Image::Ptr                                                            Material::m_default_image;
+vk::ImageView::Ptr                                                        Material::m_default_image_view;
+vk::DescriptorPool::Ptr                                                   Material::m_bindless_descriptor_pool;
+vk::DescriptorSetLayout::Ptr                                              Material::m_bindless_ds_layout;
+std::vector<vk::DescriptorSet::Ptr>                                       Material::m_bindless_ds;
+vk::Buffer::Ptr                                                           Material::m_bindless_material_buffer;
+size_t                                                                    Material::m_bindless_table_size = 0;
+std::vector<std::vector<uint32_t>>                                        Material::m_bindless_pending_slots;
+uint32_t                                                                  Material::m_bindless_material_count = 0;
+std::vector<uint32_t>                                                     Material::m_bindless_free_material_slots;
+uint32_t                                                                  Material::m_bindless_texture_count = 0;
+std::vector<uint32_t>                                                     Material::m_bindless_free_texture_slots;
+std::unordered_map<vk::ImageView*, glm::uvec2>                            Material::m_bindless_texture_slots;
+uint32_t                                                                  Material::m_bindless_generation = 0;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// GPU-side layout of a bindless material table entry. Matches the material data used by RayTracedScene.
+struct BindlessMaterialData
+{
+    glm::ivec4 texture_indices0 = glm::ivec4(-1); // x: albedo, y: normals, z: roughness, w: metallic
+    glm::ivec4 texture_indices1 = glm::ivec4(-1); // x: emissive, z: roughness_channel, w: metallic_channel
+    glm::vec4  albedo;
+    glm::vec4  emissive;
+    glm::vec4  roughness_metallic;
+};
+
+// CPU copy of a table entry, written into the table copy of every frame in flight once the frame comes around again.
+struct BindlessMaterialSlot
+{
+    BindlessMaterialData data;
+    uint32_t             pending_frames = 0; // Bit per frame in flight whose table copy is out of date.
+};
+
+static std::vector<BindlessMaterialSlot> g_bindless_material_slots;
+
 #else
-std::unordered_map<std::string, std::weak_ptr<gl::Texture2D>> Material::m_texture_cache;
+std::unordered_map<std::string, std::weak_ptr<gl::Texture2D>>                 Material::m_texture_cache;
+std::unordered_multimap<uint64_t, Material::ContentCacheEntry<gl::Texture2D>> Material::m_texture_hash_cache;
 #endif
 
 static uint32_t g_last_mat_idx = 0;
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+// Returns true if the file at the given path holds exactly the given bytes.
+static bool file_contents_equal(const std::string& path, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> other;
+
+    if (!utility::read_binary(path, other))
+        return false;
+
+    return other == data;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Material::Ptr Material::load(
 #if defined(DWSF_VULKAN)
     vk::Backend::Ptr backend,
@@ -35,7 +87,12 @@ Material::Ptr Material::load(
     const int32_t&                  normal_idx,
     const glm::ivec2&               roughness_idx,
     const glm::ivec2&               metallic_idx,
-    const int32_t&                  emissive_idx)
+    const int32_t&                  emissive_idx
+#if defined(DWSF_VULKAN)
+    ,
+    vk::BatchUploader* uploader
+#endif
+)
 {
     std::string mat_id;
 
@@ -58,7 +115,12 @@ Material::Ptr Material::load(
             normal_idx,
             roughness_idx,
             metallic_idx,
-            emissive_idx));
+            emissive_idx
+#if defined(DWSF_VULKAN)
+            ,
+            uploader
+#endif
+            ));
         m_cache[mat_id] = mat;
         return mat;
     }
@@ -77,6 +139,10 @@ Material::Ptr Material::create(glm::vec4 albedo, float roughness, float metallic
     mat->m_metallic       = metallic;
     mat->m_emissive_color = emissive;
 
+#if defined(DWSF_VULKAN)
+    mat->register_bindless();
+#endif
+
     return mat;
 }
 
@@ -96,29 +162,86 @@ bool Material::is_loaded(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Material::set_mip_generation(const mip_generator::Desc* desc)
+{
+    m_cpu_mip_generation = desc != nullptr;
+
+    if (desc)
+        m_mip_generation_desc = *desc;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_albedo_value(const glm::vec4& value)
+{
+    m_albedo_color = value;
+
+#if defined(DWSF_VULKAN)
+    write_bindless_data();
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_roughness_value(const float& value)
+{
+    m_roughness = value;
+
+#if defined(DWSF_VULKAN)
+    write_bindless_data();
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_metallic_value(const float& value)
+{
+    m_metallic = value;
+
+#if defined(DWSF_VULKAN)
+    write_bindless_data();
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::set_emissive_value(const glm::vec3& value)
+{
+    m_emissive_color = value;
+
+#if defined(DWSF_VULKAN)
+    write_bindless_data();
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Material::~Material()
 {
+#if defined(DWSF_VULKAN)
+    unregister_bindless();
+#endif
 }
 
 #if defined(DWSF_VULKAN)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Material::Material(vk::Backend::Ptr backend, const std::vector<std::string>& textures, const int32_t& albedo_idx, const int32_t& normal_idx, const glm::ivec2& roughness_idx, const glm::ivec2& metallic_idx, const int32_t& emissive_idx) :
+Material::Material(vk::Backend::Ptr backend, const std::vector<std::string>& textures, const int32_t& albedo_idx, const int32_t& normal_idx, const glm::ivec2& roughness_idx, const glm::ivec2& metallic_idx, const int32_t& emissive_idx, vk::BatchUploader* uploader) :
     m_roughness_channel(roughness_idx.y), m_metallic_channel(metallic_idx.y)
 {
     m_id = g_last_mat_idx++;
 
     if (albedo_idx != -1 && textures[albedo_idx].size() > 0)
     {
-        auto image = load_image(backend, textures[albedo_idx], true);
+        auto image = load_image(backend, textures[albedo_idx], true, uploader);
 
         m_albedo_idx = m_images.size();
         m_images.push_back(image);
 
         if (image)
         {
-            auto image_view = load_image_view(backend, textures[albedo_idx], image);
+            auto image_view = load_image_view(backend, image);
             m_image_views.push_back(image_view);
         }
         else
@@ -127,14 +250,14 @@ Material::Material(vk::Backend::Ptr backend, const std::vector<std::string>& tex
 
     if (normal_idx != -1 && textures[normal_idx].size() > 0)
     {
-        auto image = load_image(backend, textures[normal_idx]);
+        auto image = load_image(backend, textures[normal_idx], false, uploader);
 
         m_normal_idx = m_images.size();
         m_images.push_back(image);
 
         if (image)
         {
-            auto image_view = load_image_view(backend, textures[normal_idx], image);
+            auto image_view = load_image_view(backend, image);
             m_image_views.push_back(image_view);
         }
         else
@@ -143,14 +266,14 @@ Material::Material(vk::Backend::Ptr backend, const std::vector<std::string>& tex
 
     if (roughness_idx.x != -1 && textures[roughness_idx.x].size() > 0)
     {
-        auto image = load_image(backend, textures[roughness_idx.x]);
+        auto image = load_image(backend, textures[roughness_idx.x], false, uploader);
 
         m_roughness_idx = m_images.size();
         m_images.push_back(image);
 
         if (image)
         {
-            auto image_view = load_image_view(backend, textures[roughness_idx.x], image);
+            auto image_view = load_image_view(backend, image);
             m_image_views.push_back(image_view);
         }
         else
@@ -159,14 +282,14 @@ Material::Material(vk::Backend::Ptr backend, const std::vector<std::string>& tex
 
     if (metallic_idx.x != -1 && textures[metallic_idx.x].size() > 0)
     {
-        auto image = load_image(backend, textures[metallic_idx.x]);
+        auto image = load_image(backend, textures[metallic_idx.x], false, uploader);
 
         m_metallic_idx = m_images.size();
         m_images.push_back(image);
 
         if (image)
         {
-            auto image_view = load_image_view(backend, textures[metallic_idx.x], image);
+            auto image_view = load_image_view(backend, image);
             m_image_views.push_back(image_view);
         }
         else
@@ -175,22 +298,22 @@ Material::Material(vk::Backend::Ptr backend, const std::vector<std::string>& tex
 
     if (emissive_idx != -1 && textures[emissive_idx].size() > 0)
     {
-        auto image = load_image(backend, textures[emissive_idx]);
+        auto image = load_image(backend, textures[emissive_idx], false, uploader);
 
         m_emissive_idx = m_images.size();
         m_images.push_back(image);
 
         if (image)
         {
-            auto image_view = load_image_view(backend, textures[emissive_idx], image);
+            auto image_view = load_image_view(backend, image);
             m_image_views.push_back(image_view);
         }
         else
             DW_LOG_ERROR("Failed to load image: " + textures[emissive_idx]);
     }
 
-    // Create descriptor set
-    m_descriptor_set = create_descriptor_set(backend);
+    // Add to the bindless material table
+    register_bindless();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -205,6 +328,10 @@ void Material::initialize_common_resources(vk::Backend::Ptr backend)
     ds_layout_desc.add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
     ds_layout_desc.add_binding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
 
+    // Every set is written from a VkDescriptorImageInfo[5], one per binding.
+    for (uint32_t i = 0; i < 5; i++)
+        ds_layout_desc.add_template_entry(i, sizeof(VkDescriptorImageInfo) * i);
+
     m_common_ds_layout = vk::DescriptorSetLayout::create(backend, ds_layout_desc);
 
     vk::Sampler::Desc sampler_desc;
@@ -231,12 +358,99 @@ void Material::initialize_common_resources(vk::Backend::Ptr backend)
 
     m_default_image      = vk::Image::create(backend, VK_IMAGE_TYPE_2D, 1, 1, 1, 1, 1, VK_FORMAT_R8G8B8A8_SNORM, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, sizeof(uint8_t) * 4, data);
     m_default_image_view = vk::ImageView::create(backend, m_default_image, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Bindless material table
+    vk::DescriptorPool::Desc dp_desc;
+
+    const uint32_t frames_in_flight = backend->frames_in_flight();
+
+    dp_desc.set_max_sets(frames_in_flight)
+        .set_create_flags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frames_in_flight)
+        .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxBindlessTextures * frames_in_flight);
+
+    m_bindless_descriptor_pool = vk::DescriptorPool::create(backend, dp_desc);
+    m_bindless_descriptor_pool->set_name("Bindless Material Descriptor Pool");
+
+    // Texture slots are written as materials are loaded, possibly while the set is bound by frames still in flight.
+    std::vector<VkDescriptorBindingFlags> descriptor_binding_flags = {
+        0,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo set_layout_binding_flags;
+    DW_ZERO_MEMORY(set_layout_binding_flags);
+
+    set_layout_binding_flags.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    set_layout_binding_flags.bindingCount  = 2;
+    set_layout_binding_flags.pBindingFlags = descriptor_binding_flags.data();
+
+    vk::DescriptorSetLayout::Desc bindless_ds_layout_desc;
+
+    bindless_ds_layout_desc.set_next_ptr(&set_layout_binding_flags);
+    bindless_ds_layout_desc.set_create_flags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+    // Material Data
+    bindless_ds_layout_desc.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+    // Textures
+    bindless_ds_layout_desc.add_binding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxBindlessTextures, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+
+    m_bindless_ds_layout = vk::DescriptorSetLayout::create(backend, bindless_ds_layout_desc);
+    m_bindless_ds_layout->set_name("Bindless Material Descriptor Set Layout");
+
+    // Frames in flight may still read the table while a material changes, so every frame gets its own copy of it.
+    const size_t alignment = backend->physical_device_properties().limits.minStorageBufferOffsetAlignment;
+
+    m_bindless_table_size = ((sizeof(BindlessMaterialData) * kMaxBindlessMaterials + alignment - 1) / alignment) * alignment;
+
+    m_bindless_material_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_bindless_table_size * frames_in_flight, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    m_bindless_material_buffer->set_name("Bindless Material Data Buffer");
+
+    m_bindless_ds.resize(frames_in_flight);
+    m_bindless_pending_slots.resize(frames_in_flight);
+
+    for (uint32_t i = 0; i < frames_in_flight; i++)
+    {
+        m_bindless_ds[i] = vk::DescriptorSet::create(backend, m_bindless_ds_layout, m_bindless_descriptor_pool);
+        m_bindless_ds[i]->set_name("Bindless Material Descriptor Set " + std::to_string(i));
+
+        VkDescriptorBufferInfo buffer_info;
+
+        buffer_info.buffer = m_bindless_material_buffer->handle();
+        buffer_info.offset = m_bindless_table_size * i;
+        buffer_info.range  = sizeof(BindlessMaterialData) * kMaxBindlessMaterials;
+
+        VkWriteDescriptorSet write_data;
+        DW_ZERO_MEMORY(write_data);
+
+        write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_data.descriptorCount = 1;
+        write_data.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write_data.pBufferInfo     = &buffer_info;
+        write_data.dstBinding      = 0;
+        write_data.dstSet          = m_bindless_ds[i]->handle();
+
+        vkUpdateDescriptorSets(backend->device(), 1, &write_data, 0, nullptr);
+    }
+
+    g_bindless_material_slots.resize(kMaxBindlessMaterials);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 void Material::shutdown_common_resources()
 {
+    m_bindless_texture_slots.clear();
+    m_bindless_free_texture_slots.clear();
+    m_bindless_free_material_slots.clear();
+    m_bindless_texture_count  = 0;
+    m_bindless_material_count = 0;
+    m_bindless_generation++;
+    m_bindless_material_buffer.reset();
+    m_bindless_ds.clear();
+    m_bindless_pending_slots.clear();
+    g_bindless_material_slots.clear();
+    m_bindless_ds_layout.reset();
+    m_bindless_descriptor_pool.reset();
     m_default_image_view.reset();
     m_default_image.reset();
     m_common_ds_layout.reset();
@@ -245,36 +459,115 @@ void Material::shutdown_common_resources()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-vk::Image::Ptr Material::load_image(vk::Backend::Ptr backend, const std::string& path, bool srgb)
+vk::Image::Ptr Material::load_image(vk::Backend::Ptr backend, const std::string& path, bool srgb, vk::BatchUploader* uploader)
 {
-    if (m_image_cache.find(path) == m_image_cache.end() || m_image_cache[path].expired())
+    if (m_image_cache.find(path) != m_image_cache.end() && !m_image_cache[path].expired())
+        return m_image_cache[path].lock();
+
+    // The same file contents loaded with a different color space end up in a different format, so fold that into the seed.
+    std::vector<uint8_t> data;
+    bool                 hashed = utility::read_binary(path, data);
+    uint64_t             hash   = hashed ? utility::hash64(data.data(), data.size(), srgb ? 1 : 0) : 0;
+
+    if (hashed)
     {
-        vk::Image::Ptr tex  = vk::Image::create_from_file(backend, path, false, srgb);
-        m_image_cache[path] = tex;
-        return tex;
+        auto range = m_image_hash_cache.equal_range(hash);
+
+        for (auto it = range.first; it != range.second;)
+        {
+            vk::Image::Ptr tex = it->second.texture.lock();
+
+            if (!tex)
+            {
+                it = m_image_hash_cache.erase(it);
+                continue;
+            }
+
+            // A 64-bit hash can still collide, so only share the image if the contents really are the same.
+            if (it->second.size == data.size() && it->second.srgb == srgb && file_contents_equal(it->second.path, data))
+            {
+                m_image_cache[path] = tex;
+
+                m_deduplicated_texture_bytes += tex->allocation_size();
+
+                return tex;
+            }
+
+            it++;
+        }
     }
-    else
-        return m_image_cache[path].lock();
+
+    // Only albedo textures are loaded as sRGB, and they are the only ones whose alpha is used for alpha testing.
+    mip_generator::Desc mip_desc     = m_mip_generation_desc;
+    mip_desc.preserve_alpha_coverage = mip_desc.preserve_alpha_coverage && srgb;
+
+    vk::Image::Ptr tex  = vk::Image::create_from_file(backend, path, false, srgb, uploader, m_cpu_mip_generation ? &mip_desc : nullptr);
+    m_image_cache[path] = tex;
+
+    if (hashed && tex)
+        m_image_hash_cache.insert({ hash, { data.size(), srgb, path, tex } });
+
+    return tex;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-vk::ImageView::Ptr Material::load_image_view(vk::Backend::Ptr backend, const std::string& path, vk::Image::Ptr image)
+vk::ImageView::Ptr Material::load_image_view(vk::Backend::Ptr backend, vk::Image::Ptr image)
 {
-    if (m_image_view_cache.find(path) == m_image_view_cache.end() || m_image_view_cache[path].expired())
+    // Keyed by image rather than path so that deduplicated images also share a single view.
+    if (m_image_view_cache.find(image.get()) == m_image_view_cache.end() || m_image_view_cache[image.get()].expired())
     {
-        vk::ImageView::Ptr image_view = vk::ImageView::create(backend, image, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 0, image->mip_levels());
-        m_image_view_cache[path]      = image_view;
+        vk::ImageView::Ptr image_view   = vk::ImageView::create(backend, image, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 0, image->mip_levels());
+        m_image_view_cache[image.get()] = image_view;
         return image_view;
     }
     else
-        return m_image_view_cache[path].lock();
+        return m_image_view_cache[image.get()].lock();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+vk::DescriptorSet::Ptr Material::descriptor_set()
+{
+    if (!m_descriptor_set)
+        m_descriptor_set = create_descriptor_set();
+
+    return m_descriptor_set;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+vk::DescriptorSet::Ptr Material::bindless_descriptor_set()
+{
+    if (m_bindless_ds.empty())
+        return nullptr;
+
+    auto backend = m_bindless_ds[0]->backend().lock();
+
+    const uint32_t frame     = backend->current_frame_idx();
+    const uint32_t frame_bit = 1 << frame;
+    uint8_t*       ptr       = (uint8_t*)m_bindless_material_buffer->mapped_ptr() + m_bindless_table_size * frame;
+
+    for (uint32_t slot : m_bindless_pending_slots[frame])
+    {
+        BindlessMaterialSlot& material_slot = g_bindless_material_slots[slot];
+
+        memcpy(ptr + sizeof(BindlessMaterialData) * slot, &material_slot.data, sizeof(BindlessMaterialData));
+
+        material_slot.pending_frames &= ~frame_bit;
+    }
+
+    m_bindless_pending_slots[frame].clear();
+
+    return m_bindless_ds[frame];
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-vk::DescriptorSet::Ptr Material::create_descriptor_set(vk::Backend::Ptr backend)
+vk::DescriptorSet::Ptr Material::create_descriptor_set()
 {
+    auto backend = m_common_ds_layout->backend().lock();
+
     vk::DescriptorSet::Ptr ds = backend->allocate_descriptor_set(m_common_ds_layout);
 
     VkDescriptorImageInfo image_info[5];
@@ -299,56 +592,181 @@ vk::DescriptorSet::Ptr Material::create_descriptor_set(vk::Backend::Ptr backend)
     image_info[4].imageView   = m_emissive_idx != -1 ? m_image_views[m_emissive_idx]->handle() : m_default_image_view->handle();
     image_info[4].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-    VkWriteDescriptorSet write_data[5];
+    m_common_ds_layout->update(ds, &image_info[0]);
+
+    return ds;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::register_bindless()
+{
+    if (m_bindless_ds.empty())
+        return;
+
+    if (m_bindless_free_material_slots.size() > 0)
+    {
+        m_bindless_idx = m_bindless_free_material_slots.back();
+        m_bindless_free_material_slots.pop_back();
+    }
+    else if (m_bindless_material_count < kMaxBindlessMaterials)
+        m_bindless_idx = m_bindless_material_count++;
+    else
+    {
+        DW_LOG_ERROR("(Vulkan) Bindless material table is full.");
+        return;
+    }
+
+    vk::ImageView::Ptr image_views[] = { albedo_image_view(), normal_image_view(), roughness_image_view(), metallic_image_view(), emissive_image_view() };
+
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        if (image_views[i])
+            m_bindless_texture_idx[i] = acquire_bindless_texture(image_views[i]);
+    }
+
+    write_bindless_data();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    DW_ZERO_MEMORY(write_data[0]);
+void Material::unregister_bindless()
+{
+    if (m_bindless_idx == -1 || m_bindless_ds.empty())
+        return;
 
-    write_data[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write_data[0].descriptorCount = 1;
-    write_data[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write_data[0].pImageInfo      = &image_info[0];
-    write_data[0].dstBinding      = 0;
-    write_data[0].dstSet          = ds->handle();
+    vk::ImageView::Ptr image_views[] = { albedo_image_view(), normal_image_view(), roughness_image_view(), metallic_image_view(), emissive_image_view() };
 
-    DW_ZERO_MEMORY(write_data[1]);
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        if (image_views[i] && m_bindless_texture_idx[i] != -1)
+            release_bindless_texture(image_views[i]);
 
-    write_data[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write_data[1].descriptorCount = 1;
-    write_data[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write_data[1].pImageInfo      = &image_info[1];
-    write_data[1].dstBinding      = 1;
-    write_data[1].dstSet          = ds->handle();
+        m_bindless_texture_idx[i] = -1;
+    }
 
-    DW_ZERO_MEMORY(write_data[2]);
+    // Frames still in flight may read the slot, so it only becomes free once they retire.
+    uint32_t slot    = m_bindless_idx;
+    auto     backend = m_bindless_ds[0]->backend().lock();
 
-    write_data[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write_data[2].descriptorCount = 1;
-    write_data[2].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write_data[2].pImageInfo      = &image_info[2];
-    write_data[2].dstBinding      = 2;
-    write_data[2].dstSet          = ds->handle();
+    backend->queue_deletion([slot, generation = m_bindless_generation]() {
+        if (generation == m_bindless_generation)
+            m_bindless_free_material_slots.push_back(slot);
+    });
 
-    DW_ZERO_MEMORY(write_data[3]);
+    m_bindless_idx = -1;
+}
 
-    write_data[3].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write_data[3].descriptorCount = 1;
-    write_data[3].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write_data[3].pImageInfo      = &image_info[3];
-    write_data[3].dstBinding      = 3;
-    write_data[3].dstSet          = ds->handle();
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    DW_ZERO_MEMORY(write_data[4]);
+void Material::write_bindless_data()
+{
+    if (m_bindless_idx == -1 || !m_bindless_material_buffer)
+        return;
 
-    write_data[4].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write_data[4].descriptorCount = 1;
-    write_data[4].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write_data[4].pImageInfo      = &image_info[4];
-    write_data[4].dstBinding      = 4;
-    write_data[4].dstSet          = ds->handle();
+    BindlessMaterialData material_data;
 
-    vkUpdateDescriptorSets(backend->device(), 5, write_data, 0, nullptr);
+    material_data.texture_indices0 = glm::ivec4(m_bindless_texture_idx[0], m_bindless_texture_idx[1], m_bindless_texture_idx[2], m_bindless_texture_idx[3]);
+    material_data.texture_indices1 = glm::ivec4(m_bindless_texture_idx[4], -1, m_roughness_channel, m_metallic_channel);
+    // Covert from sRGB to Linear
+    material_data.albedo             = glm::vec4(glm::pow(glm::vec3(m_albedo_color), glm::vec3(2.2f)), m_albedo_color.a);
+    material_data.emissive           = glm::vec4(m_emissive_color, 0.0f);
+    material_data.roughness_metallic = glm::vec4(m_roughness, m_metallic, 0.0f, 0.0f);
 
-    return ds;
+    BindlessMaterialSlot& slot = g_bindless_material_slots[m_bindless_idx];
+
+    slot.data = material_data;
+
+    for (uint32_t i = 0; i < m_bindless_pending_slots.size(); i++)
+    {
+        if ((slot.pending_frames & (1 << i)) == 0)
+        {
+            slot.pending_frames |= 1 << i;
+            m_bindless_pending_slots[i].push_back(m_bindless_idx);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int32_t Material::acquire_bindless_texture(vk::ImageView::Ptr image_view)
+{
+    auto it = m_bindless_texture_slots.find(image_view.get());
+
+    if (it != m_bindless_texture_slots.end())
+    {
+        it->second.y++;
+        return it->second.x;
+    }
+
+    uint32_t slot = 0;
+
+    if (m_bindless_free_texture_slots.size() > 0)
+    {
+        slot = m_bindless_free_texture_slots.back();
+        m_bindless_free_texture_slots.pop_back();
+    }
+    else if (m_bindless_texture_count < kMaxBindlessTextures)
+        slot = m_bindless_texture_count++;
+    else
+    {
+        DW_LOG_ERROR("(Vulkan) Bindless texture array is full.");
+        return -1;
+    }
+
+    m_bindless_texture_slots[image_view.get()] = glm::uvec2(slot, 1);
+
+    VkDescriptorImageInfo image_info;
+
+    image_info.sampler     = m_common_sampler->handle();
+    image_info.imageView   = image_view->handle();
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    std::vector<VkWriteDescriptorSet> write_datas(m_bindless_ds.size());
+
+    for (uint32_t i = 0; i < m_bindless_ds.size(); i++)
+    {
+        VkWriteDescriptorSet& write_data = write_datas[i];
+        DW_ZERO_MEMORY(write_data);
+
+        write_data.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_data.descriptorCount = 1;
+        write_data.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write_data.pImageInfo      = &image_info;
+        write_data.dstBinding      = 1;
+        write_data.dstArrayElement = slot;
+        write_data.dstSet          = m_bindless_ds[i]->handle();
+    }
+
+    auto backend = m_bindless_ds[0]->backend().lock();
+
+    vkUpdateDescriptorSets(backend->device(), write_datas.size(), write_datas.data(), 0, nullptr);
+
+    return slot;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Material::release_bindless_texture(vk::ImageView::Ptr image_view)
+{
+    auto it = m_bindless_texture_slots.find(image_view.get());
+
+    if (it == m_bindless_texture_slots.end())
+        return;
+
+    if (--it->second.y == 0)
+    {
+        // Reusing the slot rewrites the array element in every set, including the ones bound by frames still in flight.
+        uint32_t slot    = it->second.x;
+        auto     backend = m_bindless_ds[0]->backend().lock();
+
+        backend->queue_deletion([slot, generation = m_bindless_generation]() {
+            if (generation == m_bindless_generation)
+                m_bindless_free_texture_slots.push_back(slot);
+        });
+
+        m_bindless_texture_slots.erase(it);
+    }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -397,12 +815,52 @@ gl::Texture2D::Ptr Material::load_texture(const std::string& path, bool srgb)
 {
     if (m_texture_cache.find(path) != m_texture_cache.end() && !m_texture_cache[path].expired())
         return m_texture_cache[path].lock();
-    else
+
+    // The same file contents loaded with a different color space end up in a different format, so fold that into the seed.
+    std::vector<uint8_t> data;
+    bool                 hashed = utility::read_binary(path, data);
+    uint64_t             hash   = hashed ? utility::hash64(data.data(), data.size(), srgb ? 1 : 0) : 0;
+
+    if (hashed)
     {
-        gl::Texture2D::Ptr tex = gl::Texture2D::create_from_file(path, false, srgb);
-        m_texture_cache[path]  = tex;
-        return tex;
+        auto range = m_texture_hash_cache.equal_range(hash);
+
+        for (auto it = range.first; it != range.second;)
+        {
+            gl::Texture2D::Ptr tex = it->second.texture.lock();
+
+            if (!tex)
+            {
+                it = m_texture_hash_cache.erase(it);
+                continue;
+            }
+
+            // A 64-bit hash can still collide, so only share the texture if the contents really are the same.
+            if (it->second.size == data.size() && it->second.srgb == srgb && file_contents_equal(it->second.path, data))
+            {
+                m_texture_cache[path] = tex;
+
+                // GL does not expose the allocation size, so estimate it assuming RGBA8 with a full mip chain.
+                m_deduplicated_texture_bytes += (uint64_t(tex->width()) * uint64_t(tex->height()) * 4 * 4) / 3;
+
+                return tex;
+            }
+
+            it++;
+        }
     }
+
+    // Only albedo textures are loaded as sRGB, and they are the only ones whose alpha is used for alpha testing.
+    mip_generator::Desc mip_desc     = m_mip_generation_desc;
+    mip_desc.preserve_alpha_coverage = mip_desc.preserve_alpha_coverage && srgb;
+
+    gl::Texture2D::Ptr tex = gl::Texture2D::create_from_file(path, false, srgb, m_cpu_mip_generation ? &mip_desc : nullptr);
+    m_texture_cache[path]  = tex;
+
+    if (hashed && tex)
+        m_texture_hash_cache.insert({ hash, { data.size(), srgb, path, tex } });
+
+    return tex;
 }
 
 #endif
@@ -91,7 +91,12 @@ Mesh::Ptr Mesh::load(
 #endif
     const std::string& path,
     bool               load_materials,
-    bool               is_orca_mesh)
+    bool               is_orca_mesh
+#if defined(DWSF_VULKAN)
+    ,
+    vk::BatchUploader* uploader
+#endif
+)
 {
     std::filesystem::path absolute_file_path = std::filesystem::path(path);
 
@@ -105,6 +110,7 @@ Mesh::Ptr Mesh::load(
         Mesh::Ptr mesh = std::shared_ptr<Mesh>(new Mesh(
 #if defined(DWSF_VULKAN)
             backend,
+            uploader,
 #endif
             absolute_file_path_str,
             load_materials,
@@ -131,7 +137,12 @@ Mesh::Ptr Mesh::load(
     std::vector<SubMesh>                   sub_meshes,
     std::vector<std::shared_ptr<Material>> materials,
     glm::vec3                              max_extents,
-    glm::vec3                              min_extents)
+    glm::vec3                              min_extents
+#if defined(DWSF_VULKAN)
+    ,
+    vk::BatchUploader* uploader
+#endif
+)
 {
     if (m_cache.find(name) == m_cache.end() || m_cache[name].expired())
     {
@@ -145,12 +156,29 @@ Mesh::Ptr Mesh::load(
         mesh->m_max_extents = max_extents;
         mesh->m_min_extents = min_extents;
 
+#if defined(DWSF_VULKAN)
+        mesh->update_bindless_material_indices();
+#endif
+
         // ...then manually call the method to create GPU objects.
-        mesh->create_gpu_objects(
 #if defined(DWSF_VULKAN)
-            backend
+        if (uploader)
+            mesh->create_gpu_objects(backend, uploader);
+        else
+        {
+            uint64_t submits_before = backend->queue_submit_count();
+
+            vk::BatchUploader local_uploader(backend);
+
+            mesh->create_gpu_objects(backend, &local_uploader);
+
+            local_uploader.submit();
+
+            mesh->m_upload_submit_count = uint32_t(backend->queue_submit_count() - submits_before);
+        }
+#else
+        mesh->create_gpu_objects();
 #endif
-        );
 
         m_cache[name] = mesh;
         return mesh;
@@ -166,7 +194,7 @@ Mesh::Ptr Mesh::load(
 
 #if defined(DWSF_VULKAN)
 
-void Mesh::initialize_for_ray_tracing(vk::Backend::Ptr backend)
+void Mesh::initialize_for_ray_tracing(vk::Backend::Ptr backend, vk::BatchUploader* uploader)
 {
     std::vector<VkAccelerationStructureBuildRangeInfoKHR> build_ranges;
     std::vector<VkAccelerationStructureGeometryKHR>       geometries;
@@ -212,22 +240,39 @@ void Mesh::initialize_for_ray_tracing(vk::Backend::Ptr backend)
         build_ranges.push_back(build_range);
     }
 
-    vk::BatchUploader uploader(backend);
-
     // Create blas
     vk::AccelerationStructure::Desc desc;
 
     desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR);
-    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+    desc.set_flags(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR);
     desc.set_geometries(geometries);
     desc.set_geometry_count(geometries.size());
     desc.set_max_primitive_counts(max_primitive_counts);
 
     m_blas = vk::AccelerationStructure::create(backend, desc);
 
-    uploader.build_blas(m_blas, geometries, build_ranges);
+    if (uploader)
+        uploader->build_blas(m_blas, geometries, build_ranges);
+    else
+    {
+        vk::BatchUploader local_uploader(backend);
 
-    uploader.submit();
+        local_uploader.build_blas(m_blas, geometries, build_ranges);
+        local_uploader.submit();
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Mesh::update_bindless_material_indices()
+{
+    for (auto& submesh : m_sub_meshes)
+    {
+        if (submesh.mat_idx < m_materials.size() && m_materials[submesh.mat_idx])
+            submesh.bindless_mat_idx = m_materials[submesh.mat_idx]->bindless_idx();
+        else
+            submesh.bindless_mat_idx = -1;
+    }
 }
 
 #endif
@@ -243,7 +288,8 @@ bool Mesh::is_loaded(const std::string& name)
 
 void Mesh::load_from_disk(
 #if defined(DWSF_VULKAN)
-    vk::Backend::Ptr backend,
+    vk::Backend::Ptr   backend,
+    vk::BatchUploader* uploader,
 #endif
     const std::string& path,
     bool               load_materials,
@@ -270,6 +316,8 @@ void Mesh::load_from_disk(
     uint32_t vertex_count = 0;
     uint32_t index_count  = 0;
 
+    uint64_t deduplicated_bytes_before = Material::deduplicated_texture_bytes();
+
     // Iterate over submeshes and find materials
     for (int i = 0; i < m_sub_meshes.size(); i++)
     {
@@ -496,7 +544,12 @@ void Mesh::load_from_disk(
                     normal_idx,
                     roughness_idx,
                     metallic_idx,
-                    emissive_idx);
+                    emissive_idx
+#if defined(DWSF_VULKAN)
+                    ,
+                    uploader
+#endif
+                );
 
                 mat->set_albedo_value(albedo_value);
                 mat->set_roughness_value(roughness_value);
@@ -515,6 +568,15 @@ void Mesh::load_from_disk(
         }
     }
 
+    m_deduplicated_texture_bytes = Material::deduplicated_texture_bytes() - deduplicated_bytes_before;
+
+    if (m_deduplicated_texture_bytes > 0)
+        DW_LOG_INFO("(Mesh) Texture deduplication saved " + std::to_string(m_deduplicated_texture_bytes) + " bytes while loading " + path);
+
+#if defined(DWSF_VULKAN)
+    update_bindless_material_indices();
+#endif
+
     m_vertices.resize(vertex_count);
     m_indices.resize(index_count);
 
@@ -630,13 +692,17 @@ void Mesh::load_from_disk(
 
 void Mesh::create_gpu_objects(
 #if defined(DWSF_VULKAN)
-    vk::Backend::Ptr backend
+    vk::Backend::Ptr   backend,
+    vk::BatchUploader* uploader
 #endif
 )
 {
 #if defined(DWSF_VULKAN)
-    m_vbo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, sizeof(Vertex) * m_vertices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0, &m_vertices[0]);
-    m_ibo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, sizeof(uint32_t) * m_indices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0, &m_indices[0]);
+    m_vbo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, sizeof(Vertex) * m_vertices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_ibo = vk::Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, sizeof(uint32_t) * m_indices.size(), VMA_MEMORY_USAGE_GPU_ONLY, 0);
+
+    uploader->upload_buffer_data(m_vbo, &m_vertices[0], 0, sizeof(Vertex) * m_vertices.size());
+    uploader->upload_buffer_data(m_ibo, &m_indices[0], 0, sizeof(uint32_t) * m_indices.size());
 
     m_vertex_input_state_desc.add_binding_desc(0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX);
 
@@ -684,7 +750,8 @@ Mesh::Mesh()
 
 Mesh::Mesh(
 #if defined(DWSF_VULKAN)
-    vk::Backend::Ptr backend,
+    vk::Backend::Ptr   backend,
+    vk::BatchUploader* uploader,
 #endif
     const std::string& path,
     bool               load_materials,
@@ -692,18 +759,32 @@ Mesh::Mesh(
 {
     m_id = g_last_mesh_idx++;
 
-    load_from_disk(
-#if defined(DWSF_VULKAN)
-        backend,
-#endif
-        path,
-        load_materials,
-        is_orca_mesh);
-    create_gpu_objects(
 #if defined(DWSF_VULKAN)
-        backend
+    // The caller submits its own uploader.
+    if (uploader)
+    {
+        load_from_disk(backend, uploader, path, load_materials, is_orca_mesh);
+        create_gpu_objects(backend, uploader);
+        return;
+    }
+
+    uint64_t submits_before = backend->queue_submit_count();
+
+    // Record every texture, mip chain and geometry upload for this mesh into a single submission.
+    vk::BatchUploader local_uploader(backend);
+
+    load_from_disk(backend, &local_uploader, path, load_materials, is_orca_mesh);
+    create_gpu_objects(backend, &local_uploader);
+
+    local_uploader.submit();
+
+    m_upload_submit_count = uint32_t(backend->queue_submit_count() - submits_before);
+
+    DW_LOG_INFO("(Mesh) Uploaded " + path + " using " + std::to_string(m_upload_submit_count) + " queue submission(s).");
+#else
+    load_from_disk(path, load_materials, is_orca_mesh);
+    create_gpu_objects();
 #endif
-    );
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -729,6 +810,10 @@ bool Mesh::set_submesh_material(std::string name, std::shared_ptr<Material> mate
             m_sub_meshes[i].mat_idx = m_materials.size();
             m_materials.push_back(material);
 
+#if defined(DWSF_VULKAN)
+            m_sub_meshes[i].bindless_mat_idx = material->bindless_idx();
+#endif
+
             return true;
         }
     }
@@ -746,6 +831,10 @@ bool Mesh::set_submesh_material(uint32_t mesh_idx, std::shared_ptr<Material> mat
     m_sub_meshes[mesh_idx].mat_idx = m_materials.size();
     m_materials.push_back(material);
 
+#if defined(DWSF_VULKAN)
+    m_sub_meshes[mesh_idx].bindless_mat_idx = material->bindless_idx();
+#endif
+
     return true;
 }
 
@@ -757,6 +846,10 @@ void Mesh::set_global_material(std::shared_ptr<Material> material)
         m_sub_meshes[i].mat_idx = m_materials.size();
 
     m_materials.push_back(material);
+
+#if defined(DWSF_VULKAN)
+    update_bindless_material_indices();
+#endif
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,622 @@
+#include <mip_generator.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace dw
+{
+namespace mip_generator
+{
+// Kaiser window shape parameter. Higher values trade sharpness for less ringing.
+static const float kKaiserAlpha = 4.0f;
+static const float kPi          = 3.14159265358979323846f;
+
+// Rows handed to each worker. Below this there is not enough work to be worth a thread.
+static const uint32_t kMinRowsPerThread = 16;
+
+// Pre-computed filter taps for resampling one axis.
+struct FilterKernel
+{
+    std::vector<uint32_t> offsets; // Index of the first tap of each destination sample, plus one trailing entry.
+    std::vector<uint32_t> indices; // Source sample index of each tap.
+    std::vector<float>    weights; // Normalized weight of each tap.
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Desc& Desc::set_filter(MipFilter value)
+{
+    filter = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Desc& Desc::set_srgb(bool value)
+{
+    srgb = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Desc& Desc::set_wrap(bool value)
+{
+    wrap = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Desc& Desc::set_preserve_alpha_coverage(bool value, float cutoff)
+{
+    preserve_alpha_coverage = value;
+    alpha_cutoff            = cutoff;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Desc& Desc::set_mip_levels(uint32_t value)
+{
+    mip_levels = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Desc& Desc::set_num_threads(uint32_t value)
+{
+    num_threads = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t resolve_thread_count(const Desc& desc)
+{
+#if defined(__EMSCRIPTEN__)
+    return 1;
+#else
+    if (desc.num_threads > 0)
+        return desc.num_threads;
+
+    return std::max(1u, std::thread::hardware_concurrency());
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Fixed set of workers created once per generate() call and reused by every pass of every level. Each
+// parallel_for() splits [0, count) into contiguous ranges and the calling thread processes the last one.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(uint32_t num_threads) :
+        m_num_threads(std::max(1u, num_threads))
+    {
+        for (uint32_t i = 0; i < m_num_threads - 1; i++)
+            m_workers.emplace_back([this, i]() { worker_main(i); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_job_cv.notify_all();
+
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    template <typename F>
+    void parallel_for(uint32_t count, F&& fn)
+    {
+        uint32_t active = std::min(m_num_threads, std::max(1u, count / kMinRowsPerThread));
+
+        if (active <= 1)
+        {
+            fn(0, count);
+            return;
+        }
+
+        uint32_t chunk = (count + active - 1) / active;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            m_job     = [&fn](uint32_t begin, uint32_t end) { fn(begin, end); };
+            m_count   = count;
+            m_chunk   = chunk;
+            m_active  = active;
+            m_pending = active - 1;
+            m_generation++;
+        }
+
+        m_job_cv.notify_all();
+
+        uint32_t last_begin = std::min(count, (active - 1) * chunk);
+
+        if (last_begin < count)
+            fn(last_begin, count);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [this]() { return m_pending == 0; });
+
+        m_job = nullptr;
+    }
+
+private:
+    void worker_main(uint32_t idx)
+    {
+        uint64_t seen = 0;
+
+        while (true)
+        {
+            uint32_t begin = 0;
+            uint32_t end   = 0;
+
+            std::function<void(uint32_t, uint32_t)>* job = nullptr;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_job_cv.wait(lock, [this, seen]() { return m_stop || m_generation != seen; });
+
+                if (m_stop)
+                    return;
+
+                seen = m_generation;
+
+                // Workers beyond the active count sit this job out and are not waited on.
+                if (idx >= m_active - 1)
+                    continue;
+
+                begin = std::min(m_count, idx * m_chunk);
+                end   = std::min(m_count, begin + m_chunk);
+                job   = &m_job;
+            }
+
+            if (begin < end)
+                (*job)(begin, end);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending--;
+            }
+
+            m_done_cv.notify_one();
+        }
+    }
+
+private:
+    uint32_t                                m_num_threads;
+    std::vector<std::thread>                m_workers;
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_job_cv;
+    std::condition_variable                 m_done_cv;
+    std::function<void(uint32_t, uint32_t)> m_job;
+    uint32_t                                m_count      = 0;
+    uint32_t                                m_chunk      = 0;
+    uint32_t                                m_active     = 0;
+    uint32_t                                m_pending    = 0;
+    uint64_t                                m_generation = 0;
+    bool                                    m_stop       = false;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float sinc(float x)
+{
+    if (std::abs(x) < 1e-5f)
+        return 1.0f;
+
+    x *= kPi;
+
+    return std::sin(x) / x;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Zeroth order modified Bessel function of the first kind, evaluated with its power series.
+static float bessel_i0(float x)
+{
+    float sum    = 1.0f;
+    float term   = 1.0f;
+    float half_x = x * 0.5f;
+
+    for (int k = 1; k < 32; k++)
+    {
+        float f = half_x / float(k);
+        term *= f * f;
+        sum += term;
+
+        if (term < sum * 1e-8f)
+            break;
+    }
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float filter_radius(MipFilter filter)
+{
+    switch (filter)
+    {
+        case MIP_FILTER_KAISER:
+        case MIP_FILTER_LANCZOS:
+            return 3.0f;
+        default:
+            return 0.5f;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Evaluates the filter at a distance given in destination samples.
+static float filter_weight(MipFilter filter, float x)
+{
+    x = std::abs(x);
+
+    switch (filter)
+    {
+        case MIP_FILTER_KAISER:
+        {
+            if (x >= 3.0f)
+                return 0.0f;
+
+            float t = x / 3.0f;
+
+            return sinc(x) * bessel_i0(kKaiserAlpha * std::sqrt(1.0f - t * t)) / bessel_i0(kKaiserAlpha);
+        }
+        case MIP_FILTER_LANCZOS:
+        {
+            if (x >= 3.0f)
+                return 0.0f;
+
+            return sinc(x) * sinc(x / 3.0f);
+        }
+        default:
+            return x <= 0.5f ? 1.0f : 0.0f;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void build_kernel(uint32_t src_size, uint32_t dst_size, MipFilter filter, bool wrap, FilterKernel& kernel)
+{
+    float scale   = float(src_size) / float(dst_size);
+    float support = filter_radius(filter) * scale;
+
+    kernel.offsets.resize(dst_size + 1);
+    kernel.indices.clear();
+    kernel.weights.clear();
+
+    for (uint32_t d = 0; d < dst_size; d++)
+    {
+        float   center = (float(d) + 0.5f) * scale;
+        int32_t first  = int32_t(std::floor(center - support));
+        int32_t last   = int32_t(std::ceil(center + support));
+
+        uint32_t begin = kernel.weights.size();
+        float    total = 0.0f;
+
+        kernel.offsets[d] = begin;
+
+        for (int32_t s = first; s <= last; s++)
+        {
+            float w = filter_weight(filter, (float(s) + 0.5f - center) / scale);
+
+            if (w == 0.0f)
+                continue;
+
+            int32_t idx;
+
+            if (wrap)
+                idx = ((s % int32_t(src_size)) + int32_t(src_size)) % int32_t(src_size);
+            else
+                idx = std::min(std::max(s, 0), int32_t(src_size) - 1);
+
+            kernel.indices.push_back(uint32_t(idx));
+            kernel.weights.push_back(w);
+
+            total += w;
+        }
+
+        if (total != 0.0f)
+        {
+            for (uint32_t i = begin; i < kernel.weights.size(); i++)
+                kernel.weights[i] /= total;
+        }
+    }
+
+    kernel.offsets[dst_size] = kernel.weights.size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Separable resample: horizontally into a temporary image, then vertically into the destination.
+static void downsample(const std::vector<float>& src, uint32_t src_width, uint32_t src_height, std::vector<float>& dst, uint32_t dst_width, uint32_t dst_height, uint32_t channels, const Desc& desc, WorkerPool& pool)
+{
+    FilterKernel h_kernel;
+    FilterKernel v_kernel;
+
+    build_kernel(src_width, dst_width, desc.filter, desc.wrap, h_kernel);
+    build_kernel(src_height, dst_height, desc.filter, desc.wrap, v_kernel);
+
+    std::vector<float> temp(size_t(dst_width) * src_height * channels);
+
+    pool.parallel_for(src_height, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            const float* src_row  = &src[size_t(y) * src_width * channels];
+            float*       temp_row = &temp[size_t(y) * dst_width * channels];
+
+            for (uint32_t x = 0; x < dst_width; x++)
+            {
+                float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+                for (uint32_t t = h_kernel.offsets[x]; t < h_kernel.offsets[x + 1]; t++)
+                {
+                    const float* texel = &src_row[size_t(h_kernel.indices[t]) * channels];
+                    float        w     = h_kernel.weights[t];
+
+                    for (uint32_t c = 0; c < channels; c++)
+                        acc[c] += w * texel[c];
+                }
+
+                for (uint32_t c = 0; c < channels; c++)
+                    temp_row[x * channels + c] = acc[c];
+            }
+        }
+    });
+
+    dst.assign(size_t(dst_width) * dst_height * channels, 0.0f);
+
+    const size_t row_size = size_t(dst_width) * channels;
+
+    // Whole rows are accumulated at a time so that the inner loop is a contiguous multiply-add the compiler can vectorize.
+    pool.parallel_for(dst_height, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            float* dst_row = &dst[y * row_size];
+
+            for (uint32_t t = v_kernel.offsets[y]; t < v_kernel.offsets[y + 1]; t++)
+            {
+                const float* temp_row = &temp[v_kernel.indices[t] * row_size];
+                const float  w        = v_kernel.weights[t];
+
+                for (size_t i = 0; i < row_size; i++)
+                    dst_row[i] += w * temp_row[i];
+            }
+        }
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static int32_t alpha_channel(uint32_t channels)
+{
+    if (channels == 4)
+        return 3;
+    else if (channels == 2)
+        return 1;
+    else
+        return -1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float alpha_coverage(const std::vector<float>& pixels, uint32_t channels, float cutoff)
+{
+    int32_t alpha_idx   = alpha_channel(channels);
+    size_t  pixel_count = pixels.size() / channels;
+    size_t  covered     = 0;
+
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        if (pixels[i * channels + alpha_idx] > cutoff)
+            covered++;
+    }
+
+    return float(covered) / float(pixel_count);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Finds the alpha scale that makes this level cover the same fraction of pixels as the top level when alpha tested.
+static void scale_alpha_to_coverage(std::vector<float>& pixels, uint32_t channels, float cutoff, float target_coverage)
+{
+    float lo  = 0.0f;
+    float hi  = 1.0f;
+    float mid = cutoff;
+
+    for (int i = 0; i < 10; i++)
+    {
+        mid = (lo + hi) * 0.5f;
+
+        if (alpha_coverage(pixels, channels, mid) > target_coverage)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    float   scale       = cutoff / std::max(mid, 1e-4f);
+    int32_t alpha_idx   = alpha_channel(channels);
+    size_t  pixel_count = pixels.size() / channels;
+
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        float& a = pixels[i * channels + alpha_idx];
+        a        = std::min(a * scale, 1.0f);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float srgb_to_linear(float v)
+{
+    return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t full_mip_chain_length(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Downsamples the linear top level through the chain, handing every generated level to the emit callback.
+template <typename F>
+static void generate_chain(std::vector<float>& top, uint32_t width, uint32_t height, uint32_t channels, const Desc& desc, uint32_t num_levels, F&& emit)
+{
+    WorkerPool pool(resolve_thread_count(desc));
+    bool       coverage = desc.preserve_alpha_coverage && alpha_channel(channels) != -1;
+    float      target   = coverage ? alpha_coverage(top, channels, desc.alpha_cutoff) : 0.0f;
+
+    std::vector<float> current = std::move(top);
+    std::vector<float> next;
+    std::vector<float> scaled;
+
+    for (uint32_t level = 1; level < num_levels; level++)
+    {
+        uint32_t next_width  = std::max(1u, width / 2);
+        uint32_t next_height = std::max(1u, height / 2);
+
+        downsample(current, width, height, next, next_width, next_height, channels, desc, pool);
+
+        // Coverage is matched on a copy so that the next level is still filtered from the unscaled alpha.
+        if (coverage)
+        {
+            scaled = next;
+            scale_alpha_to_coverage(scaled, channels, desc.alpha_cutoff, target);
+            emit(level, next_width, next_height, scaled, pool);
+        }
+        else
+            emit(level, next_width, next_height, next, pool);
+
+        std::swap(current, next);
+
+        width  = next_width;
+        height = next_height;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool validate(const void* pixels, uint32_t width, uint32_t height, uint32_t channels)
+{
+    return pixels && width > 0 && height > 0 && channels > 0 && channels <= 4;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool generate(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, const Desc& desc, std::vector<MipLevel>& out_levels)
+{
+    if (!validate(pixels, width, height, channels))
+        return false;
+
+    uint32_t full_chain = full_mip_chain_length(width, height);
+    uint32_t num_levels = desc.mip_levels > 0 ? std::min(desc.mip_levels, full_chain) : full_chain;
+    int32_t  alpha_idx  = alpha_channel(channels);
+    size_t   top_size   = size_t(width) * height * channels;
+
+    // Decoding table, and the encoded midpoints between adjacent sRGB values so that encoding rounds exactly.
+    float to_linear[256];
+    float thresholds[255];
+
+    for (int i = 0; i < 256; i++)
+        to_linear[i] = desc.srgb ? srgb_to_linear(float(i) / 255.0f) : float(i) / 255.0f;
+
+    for (int i = 0; i < 255; i++)
+        thresholds[i] = desc.srgb ? srgb_to_linear((float(i) + 0.5f) / 255.0f) : (float(i) + 0.5f) / 255.0f;
+
+    out_levels.resize(num_levels);
+
+    out_levels[0].width  = width;
+    out_levels[0].height = height;
+    out_levels[0].data.assign(pixels, pixels + top_size);
+
+    std::vector<float> top(top_size);
+
+    for (size_t i = 0; i < top_size; i++)
+        top[i] = (int32_t(i % channels) == alpha_idx) ? float(pixels[i]) / 255.0f : to_linear[pixels[i]];
+
+    generate_chain(top, width, height, channels, desc, num_levels, [&](uint32_t level, uint32_t w, uint32_t h, const std::vector<float>& linear, WorkerPool& pool) {
+        MipLevel& out = out_levels[level];
+
+        out.width  = w;
+        out.height = h;
+        out.data.resize(linear.size());
+
+        const size_t row_size = size_t(w) * channels;
+
+        pool.parallel_for(h, [&](uint32_t begin, uint32_t end) {
+            for (size_t i = begin * row_size; i < end * row_size; i++)
+            {
+                if (int32_t(i % channels) == alpha_idx)
+                    out.data[i] = uint8_t(std::min(std::max(linear[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+                else
+                    out.data[i] = uint8_t(std::upper_bound(thresholds, thresholds + 255, linear[i]) - thresholds);
+            }
+        });
+    });
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool generate(const float* pixels, uint32_t width, uint32_t height, uint32_t channels, const Desc& desc, std::vector<MipLevel>& out_levels)
+{
+    if (!validate(pixels, width, height, channels))
+        return false;
+
+    uint32_t full_chain = full_mip_chain_length(width, height);
+    uint32_t num_levels = desc.mip_levels > 0 ? std::min(desc.mip_levels, full_chain) : full_chain;
+    int32_t  alpha_idx  = alpha_channel(channels);
+    size_t   top_size   = size_t(width) * height * channels;
+
+    out_levels.resize(num_levels);
+
+    out_levels[0].width  = width;
+    out_levels[0].height = height;
+    out_levels[0].data.resize(top_size * sizeof(float));
+
+    memcpy(out_levels[0].data.data(), pixels, top_size * sizeof(float));
+
+    std::vector<float> top(pixels, pixels + top_size);
+
+    generate_chain(top, width, height, channels, desc, num_levels, [&](uint32_t level, uint32_t w, uint32_t h, const std::vector<float>& linear, WorkerPool&) {
+        MipLevel& out = out_levels[level];
+
+        out.width  = w;
+        out.height = h;
+        out.data.resize(linear.size() * sizeof(float));
+
+        float* dst = (float*)out.data.data();
+
+        for (size_t i = 0; i < linear.size(); i++)
+        {
+            if (int32_t(i % channels) == alpha_idx)
+                dst[i] = std::min(std::max(linear[i], 0.0f), 1.0f);
+            else
+                dst[i] = std::max(linear[i], 0.0f);
+        }
+    });
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace mip_generator
+} // namespace dw
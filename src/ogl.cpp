@@ -4,6 +4,7 @@
 #    include <logger.h>
 #    include <ogl.h>
 #    include <utility.h>
+#    include <mip_generator.h>
 #    define STB_IMAGE_IMPLEMENTATION
 #    include <stb_image.h>
 #    define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -425,7 +426,20 @@ Texture2D::Ptr Texture2D::create(uint32_t w, uint32_t h, uint32_t array_size, in
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
-Texture2D::Ptr Texture2D::create_from_file(std::string path, bool flip_vertical, bool srgb)
+// Writes a CPU generated mip chain level by level. Rows of the smaller levels are not padded to four bytes.
+static void write_mip_chain(Texture2D::Ptr texture, std::vector<mip_generator::MipLevel>& levels)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int i = 0; i < levels.size(); i++)
+        texture->write_data(0, i, levels[i].data.data());
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Texture2D::Ptr Texture2D::create_from_file(std::string path, bool flip_vertical, bool srgb, const mip_generator::Desc* mip_desc)
 {
     int x, y, n;
     stbi_set_flip_vertically_on_load(flip_vertical);
@@ -439,9 +453,22 @@ Texture2D::Ptr Texture2D::create_from_file(std::string path, bool flip_vertical,
         if (!data)
             return nullptr;
 
-        Texture2D::Ptr texture = Texture2D::create(x, y, 1, -1, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
-        texture->write_data(0, 0, data);
-        texture->generate_mipmaps();
+        Texture2D::Ptr texture;
+
+        if (mip_desc)
+        {
+            std::vector<mip_generator::MipLevel> levels;
+            mip_generator::generate(data, (uint32_t)x, (uint32_t)y, (uint32_t)n, *mip_desc, levels);
+
+            texture = Texture2D::create(x, y, 1, (int32_t)levels.size(), 1, GL_RGB32F, GL_RGB, GL_FLOAT);
+            write_mip_chain(texture, levels);
+        }
+        else
+        {
+            texture = Texture2D::create(x, y, 1, -1, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
+            texture->write_data(0, 0, data);
+            texture->generate_mipmaps();
+        }
 
         stbi_image_free(data);
 
@@ -491,9 +518,27 @@ Texture2D::Ptr Texture2D::create_from_file(std::string path, bool flip_vertical,
             }
         }
 
-        Texture2D::Ptr texture = Texture2D::create(x, y, 1, -1, 1, internal_format, format, GL_UNSIGNED_BYTE);
-        texture->write_data(0, 0, data);
-        texture->generate_mipmaps();
+        Texture2D::Ptr texture;
+
+        if (mip_desc)
+        {
+            // Filter in linear space exactly when the format will be decoded as sRGB by the sampler.
+            mip_generator::Desc desc = *mip_desc;
+            desc.srgb                = internal_format == GL_SRGB8_ALPHA8 || internal_format == GL_SRGB8;
+
+            std::vector<mip_generator::MipLevel> levels;
+            mip_generator::generate(data, (uint32_t)x, (uint32_t)y, (uint32_t)n, desc, levels);
+
+            // Allocate exactly the generated levels so the texture is complete without touching GL_TEXTURE_MAX_LEVEL.
+            texture = Texture2D::create(x, y, 1, (int32_t)levels.size(), 1, internal_format, format, GL_UNSIGNED_BYTE);
+            write_mip_chain(texture, levels);
+        }
+        else
+        {
+            texture = Texture2D::create(x, y, 1, -1, 1, internal_format, format, GL_UNSIGNED_BYTE);
+            texture->write_data(0, 0, data);
+            texture->generate_mipmaps();
+        }
 
         stbi_image_free(data);
 
@@ -1348,6 +1393,10 @@ TextureCubeView::~TextureCubeView()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+std::weak_ptr<Framebuffer> Framebuffer::m_default;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Framebuffer::Ptr Framebuffer::create(std::vector<Texture::Ptr> color_attachments, Texture::Ptr depth_stencil_attachment)
 {
     return std::shared_ptr<Framebuffer>(new Framebuffer(color_attachments, depth_stencil_attachment));
@@ -1399,6 +1448,23 @@ void Framebuffer::unbind()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Framebuffer::set_default(Framebuffer::Ptr fbo)
+{
+    m_default = fbo;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Framebuffer::bind_default()
+{
+    if (Framebuffer::Ptr fbo = m_default.lock())
+        fbo->bind();
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Framebuffer::check_status()
 {
     GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -63,6 +63,8 @@ struct Profiler
 #endif
 
 #if defined(DWSF_VULKAN)
+        m_backend = backend;
+
         for (int i = 0; i < BUFFER_COUNT; i++)
             m_sample_buffers[i].query_pool = vk::QueryPool::create(backend, VK_QUERY_TYPE_TIMESTAMP, MAX_SAMPLES);
 #endif
@@ -266,7 +268,219 @@ struct Profiler
                 }
             }
         }
+
+#    if defined(DWSF_VULKAN)
+        latency_ui();
+        descriptor_pool_ui();
+        staging_ring_ui();
+        frame_allocator_ui();
+        pipeline_ui();
+        barrier_ui();
+        memory_ui();
+#    endif
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+#    if defined(DWSF_VULKAN)
+    void descriptor_allocator_ui(vk::DescriptorAllocator::Ptr allocator)
+    {
+        const auto& stats = allocator->stats();
+
+        ImGui::Text("%s", allocator->name().c_str());
+        ImGui::Text("    Pools: %u | Capacity: %u sets", stats.pool_count, stats.set_capacity);
+        ImGui::Text("    Allocated: %u sets | Peak: %u sets", stats.allocated_sets, stats.peak_sets);
+        ImGui::Text("    Exhaustions: %u | Resets: %u", stats.exhaustion_count, stats.reset_count);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void latency_ui()
+    {
+        auto backend = m_backend.lock();
+
+        if (!backend)
+            return;
+
+        if (ImGui::TreeNode("Frame Latency"))
+        {
+            const auto& stats = backend->latency_stats();
+
+            ImGui::Text("Frames In Flight: %u", backend->frames_in_flight());
+            ImGui::Text("Frame Wait: %.2f ms | Acquire: %.2f ms", float(stats.frame_wait_ms), float(stats.acquire_ms));
+
+            if (backend->present_wait_supported())
+            {
+                bool present_wait = backend->present_wait_enabled();
+
+                if (ImGui::Checkbox("Present Wait", &present_wait))
+                    backend->set_present_wait_enabled(present_wait);
+
+                ImGui::Text("Present Wait: %.2f ms", float(stats.present_wait_ms));
+                ImGui::Text("Present Latency: %.2f ms (%llu frames)", float(stats.present_latency_ms), (unsigned long long)stats.presented_count);
+            }
+            else
+                ImGui::Text("Present Wait: Unsupported");
+
+            ImGui::TreePop();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void descriptor_pool_ui()
+    {
+        auto backend = m_backend.lock();
+
+        if (!backend)
+            return;
+
+        if (ImGui::TreeNode("Descriptor Pools"))
+        {
+            descriptor_allocator_ui(backend->descriptor_allocator());
+
+            for (uint32_t i = 0; i < backend->frames_in_flight(); i++)
+                descriptor_allocator_ui(backend->transient_descriptor_allocator(i));
+
+            ImGui::TreePop();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void staging_ring_ui()
+    {
+        auto backend = m_backend.lock();
+
+        if (!backend || !backend->staging_ring())
+            return;
+
+        if (ImGui::TreeNode("Staging Ring"))
+        {
+            auto        ring  = backend->staging_ring();
+            const auto& stats = ring->stats();
+
+            ImGui::Text("Partitions: %u x %.1f MB", ring->partition_count(), float(ring->partition_size()) / float(1024 * 1024));
+            ImGui::Text("Copy Queue: %s", ring->async_transfer() ? "Transfer" : "Graphics");
+            ImGui::Text("Frame: %.2f MB | Dedicated: %.2f MB", float(stats.frame_bytes) / float(1024 * 1024), float(stats.frame_dedicated_bytes) / float(1024 * 1024));
+            ImGui::Text("Frame Uploads: %u | Submissions: %u", stats.frame_uploads, stats.frame_submissions);
+            ImGui::Text("Total: %.2f MB", float(stats.total_bytes) / float(1024 * 1024));
+            ImGui::Text("Average Latency: %.2f ms", float(stats.average_latency_ms));
+            ImGui::Text("Waits: %u (%.2f ms)", stats.wait_count, float(stats.wait_time_ms));
+
+            ImGui::TreePop();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void frame_allocator_ui()
+    {
+        auto backend = m_backend.lock();
+
+        if (!backend || !backend->frame_allocator())
+            return;
+
+        if (ImGui::TreeNode("Frame Allocator"))
+        {
+            auto       allocator = backend->frame_allocator();
+            const auto stats     = allocator->stats();
+
+            ImGui::Text("Pages: %u (%.1f MB)", stats.page_count, float(stats.capacity) / float(1024 * 1024));
+            ImGui::Text("Frame: %.2f MB | Allocations: %u", float(stats.frame_bytes) / float(1024 * 1024), stats.frame_allocations);
+
+            ImGui::TreePop();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void pipeline_ui()
+    {
+        auto backend = m_backend.lock();
+
+        if (!backend)
+            return;
+
+        if (ImGui::TreeNode("Pipelines"))
+        {
+            const auto& stats = backend->pipeline_stats();
+
+            if (!backend->pipeline_cache())
+                ImGui::Text("Cache: Disabled");
+            else if (stats.cache_loaded)
+                ImGui::Text("Cache: Loaded (%.1f KB)", float(stats.cache_size) / 1024.0f);
+            else
+                ImGui::Text("Cache: Empty");
+
+            ImGui::Text("Created: %u in %.2f ms", stats.pipeline_count, float(stats.creation_time_ms));
+
+            const auto& cache_stats = backend->object_cache_stats();
+
+            ImGui::Separator();
+            ImGui::Text("Samplers: %u (%u reused)", cache_stats.sampler_count, cache_stats.sampler_reuse_count);
+            ImGui::Text("Set Layouts: %u (%u reused)", cache_stats.ds_layout_count, cache_stats.ds_layout_reuse_count);
+            ImGui::Text("Pipeline Layouts: %u (%u reused)", cache_stats.pipeline_layout_count, cache_stats.pipeline_layout_reuse_count);
+
+            ImGui::TreePop();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void barrier_ui()
+    {
+        auto backend = m_backend.lock();
+
+        if (!backend)
+            return;
+
+        if (ImGui::TreeNode("Barriers"))
+        {
+            const auto& stats = backend->barrier_stats();
+
+            ImGui::Text("Emitted: %u | Skipped: %u", stats.emitted_count, stats.skipped_count);
+            ImGui::Text("Flushes: %u", stats.flush_count);
+
+            ImGui::TreePop();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void memory_ui()
+    {
+        auto backend = m_backend.lock();
+
+        if (!backend)
+            return;
+
+        if (ImGui::TreeNode("Memory"))
+        {
+            const auto stats = backend->memory_stats();
+
+            for (int i = 0; i < vk::MEMORY_CATEGORY_COUNT; i++)
+                ImGui::Text("%s: %.2f MB (%u)", vk::Backend::memory_category_name((vk::MemoryCategory)i), float(stats.category_bytes[i]) / (1024.0f * 1024.0f), stats.category_counts[i]);
+
+            ImGui::Separator();
+
+            for (uint32_t i = 0; i < stats.heaps.size(); i++)
+            {
+                const auto& heap = stats.heaps[i];
+
+                ImGui::Text("Heap %u%s: %.1f / %.1f MB", i, heap.device_local ? " (Device)" : "", float(heap.usage) / (1024.0f * 1024.0f), float(heap.budget) / (1024.0f * 1024.0f));
+
+                if (heap.budget > 0)
+                    ImGui::ProgressBar(float(heap.usage) / float(heap.budget));
+            }
+
+            if (ImGui::Button("Export JSON"))
+                backend->write_memory_stats("memory_stats.json");
+
+            ImGui::TreePop();
+        }
     }
+#    endif
 #endif
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -278,7 +492,8 @@ struct Profiler
     std::stack<bool>    m_should_pop_stack;
 
 #if defined(DWSF_VULKAN)
-    bool m_should_reset = true;
+    bool                       m_should_reset = true;
+    std::weak_ptr<vk::Backend> m_backend;
 #endif
 
 #ifdef WIN32
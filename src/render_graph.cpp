@@ -0,0 +1,1050 @@
+#include <render_graph.h>
+
+#if defined(DWSF_VULKAN)
+
+#    include <logger.h>
+#    include <profiler.h>
+#    include <vk_mem_alloc.h>
+#    include <algorithm>
+
+namespace dw
+{
+namespace vk
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static VkImageAspectFlags aspect_flags(VkFormat format)
+{
+    switch (format)
+    {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_S8_UINT:
+            return VK_IMAGE_ASPECT_STENCIL_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static VkImageViewType view_type(const RenderGraph::ImageDesc& desc)
+{
+    if (desc.type == VK_IMAGE_TYPE_3D)
+        return VK_IMAGE_VIEW_TYPE_3D;
+    else if (desc.type == VK_IMAGE_TYPE_1D)
+        return desc.array_size > 1 ? VK_IMAGE_VIEW_TYPE_1D_ARRAY : VK_IMAGE_VIEW_TYPE_1D;
+    else if ((desc.flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) && desc.array_size % 6 == 0)
+        return desc.array_size > 6 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+    else
+        return desc.array_size > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_type(VkImageType value)
+{
+    type = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_extents(uint32_t w, uint32_t h, uint32_t d)
+{
+    width  = w;
+    height = h;
+    depth  = d;
+
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_mip_levels(uint32_t value)
+{
+    mip_levels = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_array_size(uint32_t value)
+{
+    array_size = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_format(VkFormat value)
+{
+    format = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_usage(VkImageUsageFlags value)
+{
+    usage = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_sample_count(VkSampleCountFlagBits value)
+{
+    sample_count = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ImageDesc& RenderGraph::ImageDesc::set_flags(VkImageCreateFlags value)
+{
+    flags = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::BufferDesc& RenderGraph::BufferDesc::set_size(size_t value)
+{
+    size = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::BufferDesc& RenderGraph::BufferDesc::set_usage(VkBufferUsageFlags value)
+{
+    usage = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::read_texture(ResourceHandle resource, VkPipelineStageFlags2 stage)
+{
+    return add_access(resource, stage, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::read_storage_image(ResourceHandle resource, VkPipelineStageFlags2 stage)
+{
+    return add_access(resource, stage, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::write_storage_image(ResourceHandle resource, VkPipelineStageFlags2 stage)
+{
+    return add_access(resource, stage, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::write_color(ResourceHandle resource)
+{
+    return add_access(resource, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::read_depth(ResourceHandle resource)
+{
+    return add_access(resource, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::write_depth(ResourceHandle resource)
+{
+    return add_access(resource, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::read_buffer(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access)
+{
+    return add_access(resource, stage, access, VK_IMAGE_LAYOUT_UNDEFINED, false);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::write_buffer(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access)
+{
+    return add_access(resource, stage, access, VK_IMAGE_LAYOUT_UNDEFINED, true);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::read(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access, VkImageLayout layout)
+{
+    return add_access(resource, stage, access, layout, false);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::write(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access, VkImageLayout layout)
+{
+    return add_access(resource, stage, access, layout, true);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::set_side_effect(bool value)
+{
+    m_side_effect = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::Pass::add_access(ResourceHandle resource, VkPipelineStageFlags2 stage, VkAccessFlags2 access, VkImageLayout layout, bool write)
+{
+    // Several accesses to the same resource within a pass are merged, they share a single barrier.
+    for (auto& existing : m_accesses)
+    {
+        if (existing.resource == resource)
+        {
+            existing.stage |= stage;
+            existing.access |= access;
+            existing.read  = existing.read || !write;
+            existing.write = existing.write || write;
+
+            if (existing.layout != layout)
+                existing.layout = VK_IMAGE_LAYOUT_GENERAL;
+
+            return *this;
+        }
+    }
+
+    Access new_access;
+
+    new_access.resource = resource;
+    new_access.stage    = stage;
+    new_access.access   = access;
+    new_access.layout   = layout;
+    new_access.read     = !write;
+    new_access.write    = write;
+
+    m_accesses.push_back(new_access);
+
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Ptr RenderGraph::create(Backend::Ptr backend)
+{
+    return std::shared_ptr<RenderGraph>(new RenderGraph(backend));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::RenderGraph(Backend::Ptr backend) :
+    m_backend(backend)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::~RenderGraph()
+{
+    // The transient resources have to go before the memory they are bound to.
+    m_resources.clear();
+    release_heaps();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ResourceHandle RenderGraph::create_image(const std::string& name, const ImageDesc& desc)
+{
+    Resource resource;
+
+    resource.name       = name;
+    resource.is_image   = true;
+    resource.imported   = false;
+    resource.image_desc = desc;
+
+    m_resources.push_back(resource);
+    m_compiled = false;
+
+    return m_resources.size() - 1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ResourceHandle RenderGraph::create_buffer(const std::string& name, const BufferDesc& desc)
+{
+    Resource resource;
+
+    resource.name        = name;
+    resource.is_image    = false;
+    resource.imported    = false;
+    resource.buffer_desc = desc;
+
+    m_resources.push_back(resource);
+    m_compiled = false;
+
+    return m_resources.size() - 1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ResourceHandle RenderGraph::import_image(const std::string& name, Image::Ptr image)
+{
+    Resource resource;
+
+    resource.name     = name;
+    resource.is_image = true;
+    resource.imported = true;
+    resource.image    = image;
+
+    resource.image_desc.set_type(image->type())
+        .set_extents(image->width(), image->height(), image->depth())
+        .set_mip_levels(image->mip_levels())
+        .set_array_size(image->array_size())
+        .set_format(image->format())
+        .set_usage(image->usage())
+        .set_sample_count((VkSampleCountFlagBits)image->sample_count());
+
+    m_resources.push_back(resource);
+    m_compiled = false;
+
+    return m_resources.size() - 1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::ResourceHandle RenderGraph::import_buffer(const std::string& name, Buffer::Ptr buffer)
+{
+    Resource resource;
+
+    resource.name     = name;
+    resource.is_image = false;
+    resource.imported = true;
+    resource.buffer   = buffer;
+
+    resource.buffer_desc.set_size(buffer->size());
+
+    m_resources.push_back(resource);
+    m_compiled = false;
+
+    return m_resources.size() - 1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Pass& RenderGraph::add_pass(const std::string& name, ExecuteCallback execute)
+{
+    m_passes.push_back(Pass());
+
+    Pass& pass = m_passes.back();
+
+    pass.m_name    = name;
+    pass.m_execute = execute;
+
+    m_compiled = false;
+
+    return pass;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::reset()
+{
+    // Transient resources still used by frames in flight go through the backend deletion queue.
+    m_resources.clear();
+    m_passes.clear();
+    m_compiled_passes.clear();
+    m_heaps.clear();
+
+    m_stats    = Stats();
+    m_compiled = false;
+    m_realized = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::set_memory_requirements_callbacks(ImageRequirementsCallback image_callback, BufferRequirementsCallback buffer_callback)
+{
+    m_image_requirements  = image_callback;
+    m_buffer_requirements = buffer_callback;
+    m_compiled            = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::compile()
+{
+    m_compiled_passes.clear();
+    m_heaps.clear();
+
+    m_stats            = Stats();
+    m_stats.pass_count = m_passes.size();
+
+    for (auto& resource : m_resources)
+    {
+        resource.first_pass       = UINT32_MAX;
+        resource.last_pass        = 0;
+        resource.placement        = Placement();
+        resource.alignment        = 1;
+        resource.memory_type_bits = UINT32_MAX;
+    }
+
+    cull_passes();
+    compute_lifetimes();
+    place_transient_resources();
+    build_barriers();
+
+    m_compiled = true;
+    m_realized = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::execute(CommandBuffer::Ptr cmd_buf)
+{
+    if (!m_compiled)
+        compile();
+
+    if (!m_realized)
+        realize();
+
+    auto backend = m_backend.lock();
+
+    std::vector<VkImageMemoryBarrier2>  image_barriers;
+    std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+
+    for (auto& compiled_pass : m_compiled_passes)
+    {
+        Pass& pass = m_passes[compiled_pass.pass];
+
+        image_barriers.clear();
+        buffer_barriers.clear();
+
+        for (auto& barrier : compiled_pass.barriers)
+        {
+            Resource& resource = m_resources[barrier.resource];
+
+            if (resource.is_image)
+            {
+                VkImageSubresourceRange range = { aspect_flags(resource.image_desc.format), 0, resource.image->mip_levels(), 0, resource.image->array_size() };
+
+                // The tracker knows the state imported resources were left in by the rest of the frame.
+                if (resource.imported)
+                    backend->use_resource(barrier.dst_stage, barrier.dst_access, barrier.new_layout, resource.image, range);
+                else
+                {
+                    VkImageMemoryBarrier2 image_barrier = {};
+
+                    image_barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+                    image_barrier.srcStageMask        = barrier.src_stage;
+                    image_barrier.srcAccessMask       = barrier.src_access;
+                    image_barrier.dstStageMask        = barrier.dst_stage;
+                    image_barrier.dstAccessMask       = barrier.dst_access;
+                    image_barrier.oldLayout           = barrier.old_layout;
+                    image_barrier.newLayout           = barrier.new_layout;
+                    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    image_barrier.image               = resource.image->handle();
+                    image_barrier.subresourceRange    = range;
+
+                    image_barriers.push_back(image_barrier);
+                }
+            }
+            else
+            {
+                if (resource.imported)
+                    backend->use_resource(barrier.dst_stage, barrier.dst_access, resource.buffer, 0, resource.buffer->size());
+                else
+                {
+                    VkBufferMemoryBarrier2 buffer_barrier = {};
+
+                    buffer_barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+                    buffer_barrier.srcStageMask        = barrier.src_stage;
+                    buffer_barrier.srcAccessMask       = barrier.src_access;
+                    buffer_barrier.dstStageMask        = barrier.dst_stage;
+                    buffer_barrier.dstAccessMask       = barrier.dst_access;
+                    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    buffer_barrier.buffer              = resource.buffer->handle();
+                    buffer_barrier.offset              = 0;
+                    buffer_barrier.size                = VK_WHOLE_SIZE;
+
+                    buffer_barriers.push_back(buffer_barrier);
+                }
+            }
+        }
+
+        backend->flush_barriers(cmd_buf, image_barriers, buffer_barriers);
+
+        DW_SCOPED_SAMPLE(pass.m_name, cmd_buf);
+
+        if (pass.m_execute)
+            pass.m_execute(cmd_buf, this);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Image::Ptr RenderGraph::image(ResourceHandle resource)
+{
+    return m_resources[resource].image;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ImageView::Ptr RenderGraph::image_view(ResourceHandle resource)
+{
+    Resource& r = m_resources[resource];
+
+    if (!r.image_view && r.image)
+    {
+        auto backend = m_backend.lock();
+        r.image_view = ImageView::create(backend, r.image, view_type(r.image_desc), aspect_flags(r.image_desc.format), 0, r.image_desc.mip_levels, 0, r.image_desc.array_size);
+    }
+
+    return r.image_view;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Buffer::Ptr RenderGraph::buffer(ResourceHandle resource)
+{
+    return m_resources[resource].buffer;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool RenderGraph::is_culled(uint32_t pass)
+{
+    return m_passes[pass].m_culled;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::cull_passes()
+{
+    // Walk the passes backwards, keeping a pass alive if it has side effects, writes nothing, writes an imported resource or
+    // writes something a later live pass reads. Going by declaration order lets a read-modify-write pass keep the writers before
+    // it alive without its own read keeping itself alive.
+    std::vector<bool> read_later(m_resources.size(), false);
+
+    for (int32_t i = int32_t(m_passes.size()) - 1; i >= 0; i--)
+    {
+        Pass& pass   = m_passes[i];
+        bool  alive  = pass.m_side_effect;
+        bool  writes = false;
+
+        for (auto& access : pass.m_accesses)
+        {
+            if (!access.write)
+                continue;
+
+            writes = true;
+
+            if (m_resources[access.resource].imported || read_later[access.resource])
+                alive = true;
+        }
+
+        alive = alive || !writes;
+
+        pass.m_culled = !alive;
+
+        if (!alive)
+        {
+            m_stats.culled_pass_count++;
+            continue;
+        }
+
+        for (auto& access : pass.m_accesses)
+        {
+            if (access.read)
+                read_later[access.resource] = true;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::compute_lifetimes()
+{
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        if (m_passes[i].m_culled)
+            continue;
+
+        for (auto& access : m_passes[i].m_accesses)
+        {
+            Resource& resource = m_resources[access.resource];
+
+            resource.first_pass = std::min(resource.first_pass, i);
+            resource.last_pass  = std::max(resource.last_pass, i);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::place_transient_resources()
+{
+    std::vector<ResourceHandle> order;
+
+    for (uint32_t i = 0; i < m_resources.size(); i++)
+    {
+        Resource& resource = m_resources[i];
+
+        if (resource.imported || resource.first_pass == UINT32_MAX)
+            continue;
+
+        VkMemoryRequirements requirements = memory_requirements(resource);
+
+        resource.placement.size   = requirements.size;
+        resource.alignment        = requirements.alignment;
+        resource.memory_type_bits = requirements.memoryTypeBits;
+
+        m_stats.transient_count++;
+        m_stats.transient_bytes += requirements.size;
+
+        order.push_back(i);
+    }
+
+    // Placing the largest resources first leaves the smaller ones to fill the gaps.
+    std::stable_sort(order.begin(), order.end(), [this](ResourceHandle a, ResourceHandle b) {
+        return m_resources[a].placement.size > m_resources[b].placement.size;
+    });
+
+    std::vector<std::vector<ResourceHandle>> heap_resources;
+
+    for (auto handle : order)
+    {
+        Resource& resource = m_resources[handle];
+        uint32_t  heap_idx = UINT32_MAX;
+
+        // Images and buffers are kept apart so that bufferImageGranularity never has to be considered.
+        for (uint32_t i = 0; i < m_heaps.size(); i++)
+        {
+            if (m_heaps[i].images == resource.is_image && (m_heaps[i].memory_type_bits & resource.memory_type_bits) != 0)
+            {
+                heap_idx = i;
+                break;
+            }
+        }
+
+        if (heap_idx == UINT32_MAX)
+        {
+            Heap heap;
+
+            heap.images = resource.is_image;
+
+            m_heaps.push_back(heap);
+            heap_resources.push_back(std::vector<ResourceHandle>());
+
+            heap_idx = m_heaps.size() - 1;
+        }
+
+        // Only resources that are alive at the same time as this one can't share its memory.
+        std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied;
+
+        for (auto other_handle : heap_resources[heap_idx])
+        {
+            Resource& other = m_resources[other_handle];
+
+            if (other.first_pass <= resource.last_pass && resource.first_pass <= other.last_pass)
+                occupied.push_back({ other.placement.offset, other.placement.offset + other.placement.size });
+        }
+
+        std::sort(occupied.begin(), occupied.end());
+
+        VkDeviceSize offset = 0;
+
+        for (auto& range : occupied)
+        {
+            if (align_up(offset, resource.alignment) + resource.placement.size <= range.first)
+                break;
+
+            offset = std::max(offset, range.second);
+        }
+
+        Heap& heap = m_heaps[heap_idx];
+
+        resource.placement.heap   = heap_idx;
+        resource.placement.offset = align_up(offset, resource.alignment);
+
+        heap.size             = std::max(heap.size, resource.placement.offset + resource.placement.size);
+        heap.alignment        = std::max(heap.alignment, resource.alignment);
+        heap.memory_type_bits = heap.memory_type_bits & resource.memory_type_bits;
+
+        heap_resources[heap_idx].push_back(handle);
+    }
+
+    for (auto& heap : m_heaps)
+        m_stats.heap_bytes += heap.size;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::build_barriers()
+{
+    struct ResourceState
+    {
+        VkPipelineStageFlags2 write_stage    = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2        write_access   = VK_ACCESS_2_NONE;
+        VkPipelineStageFlags2 read_stages    = VK_PIPELINE_STAGE_2_NONE; // Reads since the last write.
+        VkPipelineStageFlags2 visible_stages = VK_PIPELINE_STAGE_2_NONE; // Stages the last write has been made visible to.
+        VkAccessFlags2        visible_access = VK_ACCESS_2_NONE;
+        VkImageLayout         layout         = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool                  touched        = false;
+    };
+
+    // Stages and writes of the final accesses of every resource. The first use of a transient has to wait for these on every
+    // resource sharing its memory, including itself from the previous execution of the graph.
+    std::vector<VkPipelineStageFlags2> end_stages(m_resources.size(), VK_PIPELINE_STAGE_2_NONE);
+    std::vector<VkAccessFlags2>        end_access(m_resources.size(), VK_ACCESS_2_NONE);
+
+    for (auto& pass : m_passes)
+    {
+        if (pass.m_culled)
+            continue;
+
+        for (auto& access : pass.m_accesses)
+        {
+            if (access.write)
+            {
+                end_stages[access.resource] = access.stage;
+                end_access[access.resource] = access.access;
+            }
+            else
+                end_stages[access.resource] |= access.stage;
+        }
+    }
+
+    std::vector<ResourceState> states(m_resources.size());
+
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        Pass& pass = m_passes[i];
+
+        if (pass.m_culled)
+            continue;
+
+        CompiledPass compiled_pass;
+
+        compiled_pass.pass = i;
+
+        for (auto& access : pass.m_accesses)
+        {
+            Resource&      resource = m_resources[access.resource];
+            ResourceState& state    = states[access.resource];
+            Barrier        barrier  = {};
+            bool           needed   = false;
+
+            barrier.resource   = access.resource;
+            barrier.dst_stage  = access.stage;
+            barrier.dst_access = access.access;
+            barrier.old_layout = state.layout;
+            barrier.new_layout = access.layout;
+
+            if (!state.touched)
+            {
+                // Imported resources get their source state from the tracker when the graph executes.
+                if (!resource.imported)
+                {
+                    for (uint32_t j = 0; j < m_resources.size(); j++)
+                    {
+                        Resource& other = m_resources[j];
+
+                        if (other.imported || other.placement.heap != resource.placement.heap)
+                            continue;
+
+                        if (other.placement.offset < resource.placement.offset + resource.placement.size && resource.placement.offset < other.placement.offset + other.placement.size)
+                        {
+                            barrier.src_stage |= end_stages[j];
+                            barrier.src_access |= end_access[j];
+                        }
+                    }
+                }
+
+                needed = true;
+            }
+            else if (access.write || (resource.is_image && state.layout != access.layout))
+            {
+                // Writes and layout transitions only have to wait for the reads since the last write, which were already
+                // ordered after it.
+                if (state.read_stages != VK_PIPELINE_STAGE_2_NONE)
+                    barrier.src_stage = state.read_stages;
+                else
+                {
+                    barrier.src_stage  = state.write_stage;
+                    barrier.src_access = state.write_access;
+                }
+
+                needed = true;
+            }
+            else if (state.write_stage != VK_PIPELINE_STAGE_2_NONE && ((access.stage & ~state.visible_stages) != 0 || (access.access & ~state.visible_access) != 0))
+            {
+                // A read from a stage the last write was not made visible to yet. Reads never wait for other reads.
+                barrier.src_stage  = state.write_stage;
+                barrier.src_access = state.write_access;
+
+                needed = true;
+            }
+
+            if (!resource.is_image)
+            {
+                barrier.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.new_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+
+            if (needed)
+                compiled_pass.barriers.push_back(barrier);
+
+            if (access.write)
+            {
+                state.write_stage    = access.stage;
+                state.write_access   = access.access;
+                state.read_stages    = VK_PIPELINE_STAGE_2_NONE;
+                state.visible_stages = VK_PIPELINE_STAGE_2_NONE;
+                state.visible_access = VK_ACCESS_2_NONE;
+            }
+            else
+            {
+                state.read_stages |= access.stage;
+
+                if (needed)
+                {
+                    state.visible_stages |= access.stage;
+                    state.visible_access |= access.access;
+                }
+            }
+
+            state.layout  = access.layout;
+            state.touched = true;
+        }
+
+        m_stats.barrier_count += compiled_pass.barriers.size();
+        m_compiled_passes.push_back(compiled_pass);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::realize()
+{
+    auto backend = m_backend.lock();
+
+    if (!backend)
+    {
+        DW_LOG_FATAL("(Vulkan) Render Graph executed without a Backend.");
+        throw std::runtime_error("(Vulkan) Render Graph executed without a Backend.");
+    }
+
+    // Recompiling may have moved resources around. The previous ones are destroyed once the frames using them have completed.
+    for (auto& resource : m_resources)
+    {
+        if (!resource.imported)
+        {
+            resource.image_view.reset();
+            resource.image.reset();
+            resource.buffer.reset();
+        }
+    }
+
+    // Keep the existing heaps if they can still hold the compiled layout.
+    bool reuse_heaps = m_heap_allocations.size() == m_heaps.size();
+
+    for (uint32_t i = 0; reuse_heaps && i < m_heaps.size(); i++)
+    {
+        const Heap& allocated = m_heap_allocations[i].heap;
+        const Heap& required  = m_heaps[i];
+
+        if (allocated.images != required.images || allocated.size < required.size || allocated.alignment % required.alignment != 0 || (allocated.memory_type_bits & required.memory_type_bits) != allocated.memory_type_bits)
+            reuse_heaps = false;
+    }
+
+    if (!reuse_heaps)
+    {
+        release_heaps();
+
+        for (auto& heap : m_heaps)
+        {
+            VkMemoryRequirements requirements;
+
+            requirements.size           = heap.size;
+            requirements.alignment      = heap.alignment;
+            requirements.memoryTypeBits = heap.memory_type_bits;
+
+            VmaAllocationCreateInfo alloc_create_info;
+            DW_ZERO_MEMORY(alloc_create_info);
+
+            alloc_create_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+            HeapAllocation heap_allocation;
+            VmaAllocationInfo alloc_info;
+
+            if (vmaAllocateMemory(backend->allocator(), &requirements, &alloc_create_info, &heap_allocation.allocation, &alloc_info) != VK_SUCCESS)
+            {
+                DW_LOG_FATAL("(Vulkan) Failed to allocate Render Graph heap.");
+                throw std::runtime_error("(Vulkan) Failed to allocate Render Graph heap.");
+            }
+
+            // Remember the memory type that was picked, the heap can only be reused by layouts that accept it.
+            heap_allocation.heap                  = heap;
+            heap_allocation.heap.memory_type_bits = 1u << alloc_info.memoryType;
+
+            backend->track_allocation(MEMORY_CATEGORY_RENDER_TARGET, alloc_info.size);
+
+            m_heap_allocations.push_back(heap_allocation);
+        }
+    }
+
+    for (auto& resource : m_resources)
+    {
+        if (resource.imported || resource.placement.heap == UINT32_MAX)
+            continue;
+
+        VmaAllocation_T* allocation = m_heap_allocations[resource.placement.heap].allocation;
+
+        if (resource.is_image)
+        {
+            const ImageDesc& desc = resource.image_desc;
+
+            resource.image = Image::create_aliased(backend, allocation, resource.placement.offset, desc.type, desc.width, desc.height, desc.depth, desc.mip_levels, desc.array_size, desc.format, desc.usage, desc.sample_count, desc.flags);
+            resource.image->set_name(resource.name);
+
+            resource.image_view = ImageView::create(backend, resource.image, view_type(desc), aspect_flags(desc.format), 0, desc.mip_levels, 0, desc.array_size);
+            resource.image_view->set_name(resource.name);
+        }
+        else
+        {
+            resource.buffer = Buffer::create_aliased(backend, allocation, resource.placement.offset, resource.buffer_desc.usage, resource.buffer_desc.size);
+            resource.buffer->set_name(resource.name);
+        }
+    }
+
+    m_realized = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::release_heaps()
+{
+    auto backend = m_backend.lock();
+
+    if (backend)
+    {
+        VmaAllocator_T* allocator = backend->allocator();
+
+        // Queued after the resources bound to the heaps, which are released first.
+        for (auto& heap_allocation : m_heap_allocations)
+        {
+            VmaAllocationInfo alloc_info;
+            vmaGetAllocationInfo(allocator, heap_allocation.allocation, &alloc_info);
+
+            backend->untrack_allocation(MEMORY_CATEGORY_RENDER_TARGET, alloc_info.size);
+
+            VmaAllocation_T* allocation = heap_allocation.allocation;
+            backend->queue_deletion([allocator, allocation]() { vmaFreeMemory(allocator, allocation); });
+        }
+    }
+
+    m_heap_allocations.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkMemoryRequirements RenderGraph::memory_requirements(Resource& resource)
+{
+    if (resource.is_image && m_image_requirements)
+        return m_image_requirements(resource.image_desc);
+    else if (!resource.is_image && m_buffer_requirements)
+        return m_buffer_requirements(resource.buffer_desc);
+
+    auto backend = m_backend.lock();
+
+    if (!backend)
+    {
+        DW_LOG_FATAL("(Vulkan) Render Graph needs a Backend or memory requirement callbacks to compile.");
+        throw std::runtime_error("(Vulkan) Render Graph needs a Backend or memory requirement callbacks to compile.");
+    }
+
+    VkMemoryRequirements2 requirements;
+    DW_ZERO_MEMORY(requirements);
+
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+
+    if (resource.is_image)
+    {
+        const ImageDesc& desc = resource.image_desc;
+
+        VkImageCreateInfo image_info;
+        DW_ZERO_MEMORY(image_info);
+
+        image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType     = desc.type;
+        image_info.extent.width  = desc.width;
+        image_info.extent.height = desc.height;
+        image_info.extent.depth  = desc.depth;
+        image_info.mipLevels     = desc.mip_levels;
+        image_info.arrayLayers   = desc.array_size;
+        image_info.format        = desc.format;
+        image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage         = desc.usage;
+        image_info.samples       = desc.sample_count;
+        image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.flags         = desc.flags;
+
+        VkDeviceImageMemoryRequirements info;
+        DW_ZERO_MEMORY(info);
+
+        info.sType       = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+        info.pCreateInfo = &image_info;
+
+        vkGetDeviceImageMemoryRequirements(backend->device(), &info, &requirements);
+    }
+    else
+    {
+        VkBufferCreateInfo buffer_info;
+        DW_ZERO_MEMORY(buffer_info);
+
+        buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size        = resource.buffer_desc.size;
+        buffer_info.usage       = resource.buffer_desc.usage;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkDeviceBufferMemoryRequirements info;
+        DW_ZERO_MEMORY(info);
+
+        info.sType       = VK_STRUCTURE_TYPE_DEVICE_BUFFER_MEMORY_REQUIREMENTS;
+        info.pCreateInfo = &buffer_info;
+
+        vkGetDeviceBufferMemoryRequirements(backend->device(), &info, &requirements);
+    }
+
+    return requirements.memoryRequirements;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace vk
+} // namespace dw
+
+#endif
@@ -2,6 +2,7 @@
 #include "logger.h"
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
@@ -167,6 +168,152 @@ bool read_text(std::string path, std::string& out)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+bool read_binary(const std::string& path, std::vector<uint8_t>& out)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    size_t file_size = (size_t)file.tellg();
+    out.resize(file_size);
+
+    file.seekg(0);
+    file.read((char*)out.data(), file_size);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_binary(const std::string& path, const void* data, size_t size)
+{
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open())
+        return false;
+
+    file.write((const char*)data, size);
+
+    return file.good();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static const uint64_t kXXH64Prime1 = 11400714785074694791ULL;
+static const uint64_t kXXH64Prime2 = 14029467366897019727ULL;
+static const uint64_t kXXH64Prime3 = 1609587929392839161ULL;
+static const uint64_t kXXH64Prime4 = 9650029242287828579ULL;
+static const uint64_t kXXH64Prime5 = 2870177450012600261ULL;
+
+static inline uint64_t xxh64_rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh64_read64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(uint64_t));
+    return v;
+}
+
+static inline uint32_t xxh64_read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(uint32_t));
+    return v;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * kXXH64Prime2;
+    acc = xxh64_rotl(acc, 31);
+    acc *= kXXH64Prime1;
+    return acc;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
+{
+    val = xxh64_round(0, val);
+    acc ^= val;
+    acc = acc * kXXH64Prime1 + kXXH64Prime4;
+    return acc;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t hash64(const void* data, size_t size, uint64_t seed)
+{
+    // Reference XXH64 (little-endian input).
+    const uint8_t* p   = (const uint8_t*)data;
+    const uint8_t* end = p + size;
+    uint64_t       h;
+
+    if (size >= 32)
+    {
+        const uint8_t* limit = end - 32;
+
+        uint64_t v1 = seed + kXXH64Prime1 + kXXH64Prime2;
+        uint64_t v2 = seed + kXXH64Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kXXH64Prime1;
+
+        do
+        {
+            v1 = xxh64_round(v1, xxh64_read64(p));
+            p += 8;
+            v2 = xxh64_round(v2, xxh64_read64(p));
+            p += 8;
+            v3 = xxh64_round(v3, xxh64_read64(p));
+            p += 8;
+            v4 = xxh64_round(v4, xxh64_read64(p));
+            p += 8;
+        } while (p <= limit);
+
+        h = xxh64_rotl(v1, 1) + xxh64_rotl(v2, 7) + xxh64_rotl(v3, 12) + xxh64_rotl(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    }
+    else
+        h = seed + kXXH64Prime5;
+
+    h += (uint64_t)size;
+
+    while (p + 8 <= end)
+    {
+        h ^= xxh64_round(0, xxh64_read64(p));
+        h = xxh64_rotl(h, 27) * kXXH64Prime1 + kXXH64Prime4;
+        p += 8;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)xxh64_read32(p) * kXXH64Prime1;
+        h = xxh64_rotl(h, 23) * kXXH64Prime2 + kXXH64Prime3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        h ^= (*p) * kXXH64Prime5;
+        h = xxh64_rotl(h, 11) * kXXH64Prime1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= kXXH64Prime2;
+    h ^= h >> 29;
+    h *= kXXH64Prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 template <typename T>
 bool contains(const std::vector<T>& vec, const T& obj)
 {
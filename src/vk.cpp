@@ -2,8 +2,11 @@
 #include <logger.h>
 #include <macros.h>
 #include <fstream>
+#include <json.hpp>
+#include <iomanip>
 #include <glm.hpp>
 #include <utility.h>
+#include <mip_generator.h>
 #include "aftermath_callbacks.h"
 
 #define VMA_IMPLEMENTATION
@@ -133,7 +136,39 @@ Object::Object(Backend::Ptr backend) :
 {
 }
 
-Image::Ptr Image::create_from_file(Backend::Ptr backend, std::string path, bool flip_vertical, bool srgb)
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Object::Object(std::weak_ptr<Backend> backend) :
+    m_vk_backend(backend)
+{
+}
+
+// Uploads a CPU generated mip chain, either as part of the given batch or in a batch of its own.
+static void upload_mip_chain(Backend::Ptr backend, Image::Ptr image, const std::vector<mip_generator::MipLevel>& levels, BatchUploader* uploader)
+{
+    std::vector<uint8_t> data;
+    std::vector<size_t>  sizes;
+
+    for (const auto& level : levels)
+    {
+        data.insert(data.end(), level.data.begin(), level.data.end());
+        sizes.push_back(level.data.size());
+    }
+
+    if (uploader)
+        uploader->upload_image_data(image, data.data(), sizes);
+    else
+    {
+        BatchUploader local_uploader(backend);
+
+        local_uploader.upload_image_data(image, data.data(), sizes);
+        local_uploader.submit();
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Image::Ptr Image::create_from_file(Backend::Ptr backend, std::string path, bool flip_vertical, bool srgb, BatchUploader* uploader, const mip_generator::Desc* mip_desc)
 {
     int x, y, n;
     stbi_set_flip_vertically_on_load(flip_vertical);
@@ -147,7 +182,28 @@ Image::Ptr Image::create_from_file(Backend::Ptr backend, std::string path, bool
         if (!data)
             return nullptr;
 
-        Image::Ptr image = std::shared_ptr<Image>(new Image(backend, VK_IMAGE_TYPE_2D, (uint32_t)x, (uint32_t)y, 1, 0, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, x * y * sizeof(float) * 4, data));
+        size_t     size = x * y * sizeof(float) * 4;
+        Image::Ptr image;
+
+        if (mip_desc)
+        {
+            std::vector<mip_generator::MipLevel> levels;
+            mip_generator::generate(data, (uint32_t)x, (uint32_t)y, 4, *mip_desc, levels);
+
+            image = std::shared_ptr<Image>(new Image(backend, VK_IMAGE_TYPE_2D, (uint32_t)x, (uint32_t)y, 1, levels.size(), 1, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, size, nullptr));
+
+            upload_mip_chain(backend, image, levels, uploader);
+        }
+        else
+        {
+            image = std::shared_ptr<Image>(new Image(backend, VK_IMAGE_TYPE_2D, (uint32_t)x, (uint32_t)y, 1, 0, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, size, uploader ? nullptr : data));
+
+            if (uploader)
+            {
+                uploader->upload_image_data(image, data, { size });
+                uploader->generate_mipmaps(image);
+            }
+        }
 
         stbi_image_free(data);
 
@@ -179,7 +235,32 @@ Image::Ptr Image::create_from_file(Backend::Ptr backend, std::string path, bool
                 format = VK_FORMAT_R8G8B8A8_UNORM;
         }
 
-        Image::Ptr image = std::shared_ptr<Image>(new Image(backend, VK_IMAGE_TYPE_2D, (uint32_t)x, (uint32_t)y, 1, 0, 1, format, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, x * y * n, data));
+        size_t     size = x * y * n;
+        Image::Ptr image;
+
+        if (mip_desc)
+        {
+            // Filter in linear space exactly when the format will be decoded as sRGB by the sampler.
+            mip_generator::Desc desc = *mip_desc;
+            desc.srgb                = format == VK_FORMAT_R8G8B8A8_SRGB;
+
+            std::vector<mip_generator::MipLevel> levels;
+            mip_generator::generate(data, (uint32_t)x, (uint32_t)y, (uint32_t)n, desc, levels);
+
+            image = std::shared_ptr<Image>(new Image(backend, VK_IMAGE_TYPE_2D, (uint32_t)x, (uint32_t)y, 1, levels.size(), 1, format, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, size, nullptr));
+
+            upload_mip_chain(backend, image, levels, uploader);
+        }
+        else
+        {
+            image = std::shared_ptr<Image>(new Image(backend, VK_IMAGE_TYPE_2D, (uint32_t)x, (uint32_t)y, 1, 0, 1, format, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, size, uploader ? nullptr : data));
+
+            if (uploader)
+            {
+                uploader->upload_image_data(image, data, { size });
+                uploader->generate_mipmaps(image);
+            }
+        }
 
         stbi_image_free(data);
 
@@ -203,6 +284,13 @@ Image::Ptr Image::create_from_swapchain(Backend::Ptr backend, VkImage image, VkI
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+Image::Ptr Image::create_aliased(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageCreateFlags flags)
+{
+    return std::shared_ptr<Image>(new Image(backend, allocation, offset, type, width, height, depth, mip_levels, array_size, format, usage, sample_count, flags));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Image::Image(Backend::Ptr backend, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VmaMemoryUsage memory_usage, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageLayout initial_layout, size_t size, void* data, VkImageCreateFlags flags, VkImageTiling tiling) :
     Object(backend), m_type(type), m_width(width), m_height(height), m_depth(depth), m_mip_levels(mip_levels), m_array_size(array_size), m_format(format), m_memory_usage(memory_usage), m_sample_count(sample_count), m_usage(usage), m_flags(flags), m_tiling(tiling)
 {
@@ -244,21 +332,79 @@ Image::Image(Backend::Ptr backend, VkImageType type, uint32_t width, uint32_t he
 
     m_vk_device_memory = alloc_info.deviceMemory;
     m_mapped_ptr       = alloc_info.pMappedData;
+    m_allocation_size  = alloc_info.size;
+    m_state_idx        = backend->allocate_resource_states(m_mip_levels * m_array_size);
+
+    if (m_usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT))
+        m_memory_category = MEMORY_CATEGORY_RENDER_TARGET;
+    else
+        m_memory_category = MEMORY_CATEGORY_TEXTURE;
+
+    backend->track_allocation(m_memory_category, m_allocation_size);
 
     if (data)
     {
-        upload_data(0, 0, data, size, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        upload_data_async(0, 0, data, size, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
         if (m_mip_levels > 1)
-            generate_mipmaps();
+            generate_mipmaps_async();
+
+        backend->staging_ring()->flush();
     }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 Image::Image(Backend::Ptr backend, VkImage image, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VmaMemoryUsage memory_usage, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count) :
-    Object(backend), m_vk_image(image), m_type(type), m_width(width), m_height(height), m_depth(depth), m_mip_levels(mip_levels), m_array_size(array_size), m_format(format), m_memory_usage(memory_usage), m_sample_count(sample_count)
+    Object(backend), m_vk_image(image), m_type(type), m_width(width), m_height(height), m_depth(depth), m_mip_levels(mip_levels), m_array_size(array_size), m_format(format), m_memory_usage(memory_usage), m_sample_count(sample_count), m_swap_chain_image(true)
+{
+    m_state_idx = backend->allocate_resource_states(m_mip_levels * m_array_size);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Image::Image(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkImageType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImageCreateFlags flags) :
+    Object(backend), m_type(type), m_width(width), m_height(height), m_depth(depth), m_mip_levels(mip_levels), m_array_size(array_size), m_format(format), m_memory_usage(VMA_MEMORY_USAGE_GPU_ONLY), m_sample_count(sample_count), m_usage(usage), m_flags(flags), m_tiling(VK_IMAGE_TILING_OPTIMAL), m_aliased(true)
 {
+    m_vma_allocator = backend->allocator();
+
+    VkImageCreateInfo image_info;
+    DW_ZERO_MEMORY(image_info);
+
+    image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType     = m_type;
+    image_info.extent.width  = m_width;
+    image_info.extent.height = m_height;
+    image_info.extent.depth  = m_depth;
+    image_info.mipLevels     = m_mip_levels;
+    image_info.arrayLayers   = m_array_size;
+    image_info.format        = m_format;
+    image_info.tiling        = m_tiling;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage         = m_usage;
+    image_info.samples       = m_sample_count;
+    image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.flags         = flags;
+
+    if (vkCreateImage(backend->device(), &image_info, nullptr, &m_vk_image) != VK_SUCCESS)
+    {
+        DW_LOG_FATAL("(Vulkan) Failed to create Image.");
+        throw std::runtime_error("(Vulkan) Failed to create Image.");
+    }
+
+    if (vmaBindImageMemory2(m_vma_allocator, allocation, offset, m_vk_image, nullptr) != VK_SUCCESS)
+    {
+        vkDestroyImage(backend->device(), m_vk_image, nullptr);
+
+        DW_LOG_FATAL("(Vulkan) Failed to bind aliased Image memory.");
+        throw std::runtime_error("(Vulkan) Failed to bind aliased Image memory.");
+    }
+
+    VmaAllocationInfo alloc_info;
+    vmaGetAllocationInfo(m_vma_allocator, allocation, &alloc_info);
+
+    m_vk_device_memory = alloc_info.deviceMemory;
+    m_state_idx        = backend->allocate_resource_states(m_mip_levels * m_array_size);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -271,31 +417,45 @@ Image::~Image()
         throw std::runtime_error("(Vulkan) Destructing after Device.");
     }
 
+    auto backend = m_vk_backend.lock();
+
+    if (m_state_idx != UINT32_MAX)
+        backend->release_resource_states(m_state_idx, m_mip_levels * m_array_size);
+
+    if (backend->staging_ring())
+        backend->staging_ring()->discard_pending_states(this);
+
+    // Swap chain and aliased images don't own their memory, their allocation size is zero.
+    if (m_allocation_size > 0)
+        backend->untrack_allocation(m_memory_category, m_allocation_size);
+
+    VkDevice         device     = backend->device();
+    VkImage          image      = m_vk_image;
+    VmaAllocator_T*  allocator  = m_vma_allocator;
+    VmaAllocation_T* allocation = m_vma_allocation;
+
     if (m_vma_allocator && m_vma_allocation)
-        vmaDestroyImage(m_vma_allocator, m_vk_image, m_vma_allocation);
+        backend->queue_deletion([allocator, image, allocation]() { vmaDestroyImage(allocator, image, allocation); });
+    else if (m_aliased)
+        backend->queue_deletion([device, image]() { vkDestroyImage(device, image, nullptr); });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Image::upload_data(int array_index, int mip_level, void* data, size_t size, VkImageLayout dst_layout)
+// Copy region and subresource range of a single layer and level upload.
+static void single_level_upload(int array_index, int mip_level, uint32_t width, uint32_t height, size_t buffer_offset, VkBufferImageCopy& buffer_copy_region, VkImageSubresourceRange& subresource_range)
 {
-    auto backend = m_vk_backend.lock();
-
-    Buffer::Ptr staging = Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size, VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT, data);
-
-    VkBufferImageCopy buffer_copy_region;
     DW_ZERO_MEMORY(buffer_copy_region);
 
     buffer_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
     buffer_copy_region.imageSubresource.mipLevel       = mip_level;
     buffer_copy_region.imageSubresource.baseArrayLayer = array_index;
     buffer_copy_region.imageSubresource.layerCount     = 1;
-    buffer_copy_region.imageExtent.width               = m_width;
-    buffer_copy_region.imageExtent.height              = m_height;
+    buffer_copy_region.imageExtent.width               = width;
+    buffer_copy_region.imageExtent.height              = height;
     buffer_copy_region.imageExtent.depth               = 1;
-    buffer_copy_region.bufferOffset                    = 0;
+    buffer_copy_region.bufferOffset                    = buffer_offset;
 
-    VkImageSubresourceRange subresource_range;
     DW_ZERO_MEMORY(subresource_range);
 
     subresource_range.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -303,28 +463,34 @@ void Image::upload_data(int array_index, int mip_level, void* data, size_t size,
     subresource_range.levelCount     = 1;
     subresource_range.layerCount     = 1;
     subresource_range.baseArrayLayer = array_index;
+}
 
-    CommandBuffer::Ptr cmd_buf = backend->allocate_graphics_command_buffer(true);
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    backend->use_resource(VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_vk_image, subresource_range, m_array_size, m_mip_levels);
-        
-    backend->flush_barriers(cmd_buf);
+void Image::upload_data(int array_index, int mip_level, void* data, size_t size, VkImageLayout dst_layout)
+{
+    auto backend = m_vk_backend.lock();
 
-    // Copy mip levels from staging buffer
-    vkCmdCopyBufferToImage(cmd_buf->handle(),
-                           staging->handle(),
-                           m_vk_image,
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           1,
-                           &buffer_copy_region);
+    upload_data_async(array_index, mip_level, data, size, dst_layout);
 
-    backend->use_resource(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_SHADER_READ_BIT, dst_layout, m_vk_image, subresource_range, m_array_size, m_mip_levels);
+    backend->staging_ring()->flush();
+}
 
-    backend->flush_barriers(cmd_buf);
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    vkEndCommandBuffer(cmd_buf->handle());
+void Image::upload_data_async(int array_index, int mip_level, void* data, size_t size, VkImageLayout dst_layout)
+{
+    auto backend = m_vk_backend.lock();
+    auto ring    = backend->staging_ring();
 
-    backend->flush_graphics({ cmd_buf });
+    auto staging = ring->stage(data, size, 16);
+
+    VkBufferImageCopy       buffer_copy_region;
+    VkImageSubresourceRange subresource_range;
+
+    single_level_upload(array_index, mip_level, m_width, m_height, staging.offset, buffer_copy_region, subresource_range);
+
+    ring->copy_image(staging, this, { buffer_copy_region }, subresource_range, dst_layout);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -342,7 +508,7 @@ void Image::generate_mipmaps(std::shared_ptr<CommandBuffer> cmd_buf, VkImageLayo
     initial_subresource_range.baseArrayLayer = 0;
     initial_subresource_range.baseMipLevel   = 1;
 
-    backend->use_resource(VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_vk_image, initial_subresource_range, m_array_size, m_mip_levels);
+    backend->use_resource(VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, this, initial_subresource_range);
         
     backend->flush_barriers(cmd_buf);
 
@@ -363,7 +529,7 @@ void Image::generate_mipmaps(std::shared_ptr<CommandBuffer> cmd_buf, VkImageLayo
             subresource_range.baseMipLevel   = mip_idx - 1;
             subresource_range.baseArrayLayer = arr_idx;
 
-            backend->use_resource(VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_vk_image, subresource_range, m_array_size, m_mip_levels);
+            backend->use_resource(VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, this, subresource_range);
 
             backend->flush_barriers(cmd_buf);
 
@@ -390,7 +556,7 @@ void Image::generate_mipmaps(std::shared_ptr<CommandBuffer> cmd_buf, VkImageLayo
                            &blit,
                            filter);
 
-            backend->use_resource(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_SHADER_READ_BIT, dst_layout, m_vk_image, subresource_range, m_array_size, m_mip_levels);
+            backend->use_resource(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_SHADER_READ_BIT, dst_layout, this, subresource_range);
 
             backend->flush_barriers(cmd_buf);
 
@@ -400,7 +566,7 @@ void Image::generate_mipmaps(std::shared_ptr<CommandBuffer> cmd_buf, VkImageLayo
 
         subresource_range.baseMipLevel = m_mip_levels - 1;
 
-        backend->use_resource(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_SHADER_READ_BIT, dst_layout, m_vk_image, subresource_range, m_array_size, m_mip_levels);
+        backend->use_resource(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_SHADER_READ_BIT, dst_layout, this, subresource_range);
 
         backend->flush_barriers(cmd_buf);
     }
@@ -412,13 +578,18 @@ void Image::generate_mipmaps(VkImageLayout dst_layout, VkImageAspectFlags aspect
 {
     auto backend = m_vk_backend.lock();
 
-    CommandBuffer::Ptr cmd_buf = backend->allocate_graphics_command_buffer(true);
+    generate_mipmaps_async(dst_layout, aspect_flags, filter);
 
-    generate_mipmaps(cmd_buf, dst_layout, aspect_flags, filter);
+    backend->staging_ring()->flush();
+}
 
-    vkEndCommandBuffer(cmd_buf->handle());
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Image::generate_mipmaps_async(VkImageLayout dst_layout, VkImageAspectFlags aspect_flags, VkFilter filter)
+{
+    auto backend = m_vk_backend.lock();
 
-    backend->flush_graphics({ cmd_buf });
+    backend->staging_ring()->generate_mipmaps(this, dst_layout, aspect_flags, filter);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -431,6 +602,21 @@ void Image::set_name(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Image::set_memory_category(MemoryCategory category)
+{
+    auto backend = m_vk_backend.lock();
+
+    if (m_allocation_size > 0)
+    {
+        backend->untrack_allocation(m_memory_category, m_allocation_size);
+        backend->track_allocation(category, m_allocation_size);
+    }
+
+    m_memory_category = category;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 ImageView::Ptr ImageView::create(Backend::Ptr backend, Image::Ptr image, VkImageViewType view_type, VkImageAspectFlags aspect_flags, uint32_t base_mip_level, uint32_t level_count, uint32_t base_array_layer, uint32_t layer_count)
 {
     return std::shared_ptr<ImageView>(new ImageView(backend, image, view_type, aspect_flags, base_mip_level, level_count, base_array_layer, layer_count));
@@ -473,7 +659,10 @@ ImageView::~ImageView()
 
     auto backend = m_vk_backend.lock();
 
-    vkDestroyImageView(backend->device(), m_vk_image_view, nullptr);
+    VkDevice    device     = backend->device();
+    VkImageView image_view = m_vk_image_view;
+
+    backend->queue_deletion([device, image_view]() { vkDestroyImageView(device, image_view, nullptr); });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -502,6 +691,13 @@ Buffer::Ptr Buffer::create_with_alignment(Backend::Ptr backend, VkBufferUsageFla
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+Buffer::Ptr Buffer::create_aliased(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkBufferUsageFlags usage, size_t size)
+{
+    return std::shared_ptr<Buffer>(new Buffer(backend, allocation, offset, usage, size));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Buffer::Buffer(Backend::Ptr backend, VkBufferUsageFlags usage, size_t size, size_t alignment, VmaMemoryUsage memory_usage, VkFlags create_flags, void* data) :
     Object(backend), m_size(size), m_vma_memory_usage(memory_usage)
 {
@@ -574,6 +770,19 @@ Buffer::Buffer(Backend::Ptr backend, VkBufferUsageFlags usage, size_t size, size
     }
 
     m_vk_device_memory = vma_alloc_info.deviceMemory;
+    m_allocation_size  = vma_alloc_info.size;
+
+    // Mesh buffers are also acceleration structure build inputs, so vertex and index usage takes precedence.
+    if (m_vk_usage_flags & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+        m_memory_category = MEMORY_CATEGORY_MESH;
+    else if (m_vk_usage_flags & (VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR))
+        m_memory_category = MEMORY_CATEGORY_ACCELERATION_STRUCTURE;
+    else if (m_vk_usage_flags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+        m_memory_category = MEMORY_CATEGORY_UNIFORM;
+    else if (memory_usage == VMA_MEMORY_USAGE_CPU_ONLY)
+        m_memory_category = MEMORY_CATEGORY_STAGING;
+
+    backend->track_allocation(m_memory_category, m_allocation_size);
 
     if (create_flags & VMA_ALLOCATION_CREATE_MAPPED_BIT)
         m_mapped_ptr = vma_alloc_info.pMappedData;
@@ -589,13 +798,84 @@ Buffer::Buffer(Backend::Ptr backend, VkBufferUsageFlags usage, size_t size, size
 
     if ((usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) == VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
         m_device_address = vkGetBufferDeviceAddress(backend->device(), &address_info);
+
+    m_state_idx = backend->allocate_resource_states(1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Buffer::Buffer(Backend::Ptr backend, VmaAllocation_T* allocation, VkDeviceSize offset, VkBufferUsageFlags usage, size_t size) :
+    Object(backend), m_size(size), m_vma_memory_usage(VMA_MEMORY_USAGE_GPU_ONLY)
+{
+    m_vma_allocator      = backend->allocator();
+    m_vk_memory_property = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    m_vk_usage_flags     = usage;
+
+    VkBufferCreateInfo buffer_info;
+    DW_ZERO_MEMORY(buffer_info);
+
+    buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size        = size;
+    buffer_info.usage       = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(backend->device(), &buffer_info, nullptr, &m_vk_buffer) != VK_SUCCESS)
+    {
+        DW_LOG_FATAL("(Vulkan) Failed to create Buffer.");
+        throw std::runtime_error("(Vulkan) Failed to create Buffer.");
+    }
+
+    if (vmaBindBufferMemory2(m_vma_allocator, allocation, offset, m_vk_buffer, nullptr) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(backend->device(), m_vk_buffer, nullptr);
+
+        DW_LOG_FATAL("(Vulkan) Failed to bind aliased Buffer memory.");
+        throw std::runtime_error("(Vulkan) Failed to bind aliased Buffer memory.");
+    }
+
+    VmaAllocationInfo alloc_info;
+    vmaGetAllocationInfo(m_vma_allocator, allocation, &alloc_info);
+
+    m_vk_device_memory = alloc_info.deviceMemory;
+
+    VkBufferDeviceAddressInfoKHR address_info;
+    DW_ZERO_MEMORY(address_info);
+
+    address_info.sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+    address_info.buffer = m_vk_buffer;
+
+    if ((usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) == VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+        m_device_address = vkGetBufferDeviceAddress(backend->device(), &address_info);
+
+    m_state_idx = backend->allocate_resource_states(1);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 Buffer::~Buffer()
 {
-    vmaDestroyBuffer(m_vma_allocator, m_vk_buffer, m_vma_allocation);
+    auto backend = m_vk_backend.lock();
+
+    VmaAllocator_T*  allocator  = m_vma_allocator;
+    VkBuffer         buffer     = m_vk_buffer;
+    VmaAllocation_T* allocation = m_vma_allocation;
+
+    // Aliased buffers have no allocation of their own, in which case only the buffer is destroyed.
+    auto deleter = [allocator, buffer, allocation]() { vmaDestroyBuffer(allocator, buffer, allocation); };
+
+    // Buffers owned by the backend itself are released while it is being destroyed, after the device went idle.
+    if (backend)
+    {
+        if (m_state_idx != UINT32_MAX)
+            backend->release_resource_states(m_state_idx, 1);
+
+        if (m_allocation_size > 0)
+            backend->untrack_allocation(m_memory_category, m_allocation_size);
+
+        backend->queue_deletion(deleter);
+    }
+    else
+        deleter();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -608,35 +888,30 @@ void Buffer::set_name(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Buffer::upload_data(void* data, size_t size, size_t offset)
+void Buffer::set_memory_category(MemoryCategory category)
 {
     auto backend = m_vk_backend.lock();
 
-    if (m_vma_memory_usage == VMA_MEMORY_USAGE_GPU_ONLY)
+    if (m_allocation_size > 0)
     {
-        // Create VMA_MEMORY_USAGE_CPU_ONLY staging buffer and perfom Buffer-to-Buffer copy
-        Buffer::Ptr staging = Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size, VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT, data);
-
-        CommandBuffer::Ptr cmd_buf = backend->allocate_graphics_command_buffer();
-
-        VkCommandBufferBeginInfo begin_info;
-        DW_ZERO_MEMORY(begin_info);
-
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-        vkBeginCommandBuffer(cmd_buf->handle(), &begin_info);
+        backend->untrack_allocation(m_memory_category, m_allocation_size);
+        backend->track_allocation(category, m_allocation_size);
+    }
 
-        VkBufferCopy copy_region;
-        DW_ZERO_MEMORY(copy_region);
+    m_memory_category = category;
+}
 
-        copy_region.dstOffset = offset;
-        copy_region.size      = size;
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-        vkCmdCopyBuffer(cmd_buf->handle(), staging->handle(), m_vk_buffer, 1, &copy_region);
+void Buffer::upload_data(void* data, size_t size, size_t offset)
+{
+    auto backend = m_vk_backend.lock();
 
-        vkEndCommandBuffer(cmd_buf->handle());
+    if (m_vma_memory_usage == VMA_MEMORY_USAGE_GPU_ONLY)
+    {
+        upload_data_async(data, size, offset);
 
-        backend->flush_graphics({ cmd_buf });
+        backend->staging_ring()->flush();
     }
     else
     {
@@ -663,6 +938,82 @@ void Buffer::upload_data(void* data, size_t size, size_t offset)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Buffer::upload_data_async(void* data, size_t size, size_t offset)
+{
+    // Host visible buffers are written directly, there is nothing to defer.
+    if (m_vma_memory_usage != VMA_MEMORY_USAGE_GPU_ONLY)
+    {
+        upload_data(data, size, offset);
+        return;
+    }
+
+    auto backend = m_vk_backend.lock();
+    auto ring    = backend->staging_ring();
+    auto staging = ring->stage(data, size);
+
+    ring->copy_buffer(staging, this, offset, size);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Buffer::invalidate()
+{
+    if (m_vma_allocation)
+        vmaInvalidateAllocation(m_vma_allocator, m_vma_allocation, 0, VK_WHOLE_SIZE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CommandBufferInheritanceDesc& CommandBufferInheritanceDesc::set_render_pass(VkRenderPass value, uint32_t subpass_idx, VkFramebuffer framebuffer_handle)
+{
+    render_pass = value;
+    subpass     = subpass_idx;
+    framebuffer = framebuffer_handle;
+
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CommandBufferInheritanceDesc& CommandBufferInheritanceDesc::add_color_attachment_format(VkFormat format)
+{
+    if (color_attachment_format_count == 8)
+    {
+        DW_LOG_FATAL("(Vulkan) Max color attachment format count reached.");
+        throw std::runtime_error("(Vulkan) Max color attachment format count reached.");
+    }
+
+    color_attachment_formats[color_attachment_format_count++] = format;
+
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CommandBufferInheritanceDesc& CommandBufferInheritanceDesc::set_depth_attachment_format(VkFormat format)
+{
+    depth_attachment_format = format;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CommandBufferInheritanceDesc& CommandBufferInheritanceDesc::set_stencil_attachment_format(VkFormat format)
+{
+    stencil_attachment_format = format;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CommandBufferInheritanceDesc& CommandBufferInheritanceDesc::set_samples(VkSampleCountFlagBits value)
+{
+    samples = value;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 CommandPool::Ptr CommandPool::create(Backend::Ptr backend, uint32_t queue_family_index)
 {
     return std::shared_ptr<CommandPool>(new CommandPool(backend, queue_family_index));
@@ -725,8 +1076,8 @@ void CommandPool::reset()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-CommandBuffer::CommandBuffer(Backend::Ptr backend, CommandPool::Ptr pool) :
-    Object(backend)
+CommandBuffer::CommandBuffer(Backend::Ptr backend, CommandPool::Ptr pool, VkCommandBufferLevel level) :
+    Object(backend), m_vk_level(level)
 {
     m_vk_pool = pool;
 
@@ -735,7 +1086,7 @@ CommandBuffer::CommandBuffer(Backend::Ptr backend, CommandPool::Ptr pool) :
 
     alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     alloc_info.commandPool        = pool->handle();
-    alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.level              = level;
     alloc_info.commandBufferCount = 1;
 
     if (vkAllocateCommandBuffers(backend->device(), &alloc_info, &m_vk_command_buffer) != VK_SUCCESS)
@@ -747,9 +1098,9 @@ CommandBuffer::CommandBuffer(Backend::Ptr backend, CommandPool::Ptr pool) :
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-CommandBuffer::Ptr CommandBuffer::create(Backend::Ptr backend, CommandPool::Ptr pool)
+CommandBuffer::Ptr CommandBuffer::create(Backend::Ptr backend, CommandPool::Ptr pool, VkCommandBufferLevel level)
 {
-    return std::shared_ptr<CommandBuffer>(new CommandBuffer(backend, pool));
+    return std::shared_ptr<CommandBuffer>(new CommandBuffer(backend, pool, level));
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1748,11 +2099,30 @@ GraphicsPipeline::Ptr GraphicsPipeline::create(Backend::Ptr backend, Desc desc)
 GraphicsPipeline::GraphicsPipeline(Backend::Ptr backend, Desc desc) :
     Object(backend)
 {
-    VkPipelineRenderingCreateInfoKHR rendering_create_info {};
+    m_vk_pipeline = create_handle(backend.get(), desc);
+}
 
-    desc.create_info.pStages             = &desc.shader_stages[0];
-    desc.create_info.stageCount          = desc.shader_stage_count;
-    desc.dynamic_state.dynamicStateCount = desc.dynamic_state_count;
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+GraphicsPipeline::GraphicsPipeline(std::weak_ptr<Backend> backend, VkPipeline pipeline) :
+    Object(backend), m_vk_pipeline(pipeline)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkPipeline GraphicsPipeline::create_handle(Backend* backend, Desc& desc)
+{
+    VkPipeline                       pipeline = VK_NULL_HANDLE;
+    VkPipelineRenderingCreateInfoKHR rendering_create_info {};
+
+    // The desc may be a copy so point the stages at its own entry point names.
+    for (uint32_t i = 0; i < desc.shader_stage_count; i++)
+        desc.shader_stages[i].pName = desc.shader_entry_names[i].c_str();
+
+    desc.create_info.pStages             = &desc.shader_stages[0];
+    desc.create_info.stageCount          = desc.shader_stage_count;
+    desc.dynamic_state.dynamicStateCount = desc.dynamic_state_count;
     desc.dynamic_state.pDynamicStates    = &desc.dynamic_states[0];
     desc.create_info.pDynamicState       = &desc.dynamic_state;
 
@@ -1767,11 +2137,17 @@ GraphicsPipeline::GraphicsPipeline(Backend::Ptr backend, Desc desc) :
         desc.create_info.pNext = &rendering_create_info;
     }
 
-    if (vkCreateGraphicsPipelines(backend->device(), nullptr, 1, &desc.create_info, nullptr, &m_vk_pipeline) != VK_SUCCESS)
+    auto start = std::chrono::steady_clock::now();
+
+    if (vkCreateGraphicsPipelines(backend->device(), backend->pipeline_cache(), 1, &desc.create_info, nullptr, &pipeline) != VK_SUCCESS)
     {
         DW_LOG_FATAL("(Vulkan) Failed to create Graphics Pipeline.");
         throw std::runtime_error("(Vulkan) Failed to create Graphics Pipeline.");
     }
+
+    backend->record_pipeline_creation(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    return pipeline;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1786,7 +2162,10 @@ GraphicsPipeline::~GraphicsPipeline()
 
     auto backend = m_vk_backend.lock();
 
-    vkDestroyPipeline(backend->device(), m_vk_pipeline, nullptr);
+    VkDevice   device   = backend->device();
+    VkPipeline pipeline = m_vk_pipeline;
+
+    backend->queue_deletion([device, pipeline]() { vkDestroyPipeline(device, pipeline, nullptr); });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1855,11 +2234,35 @@ ComputePipeline::Ptr ComputePipeline::create(Backend::Ptr backend, Desc desc)
 ComputePipeline::ComputePipeline(Backend::Ptr backend, Desc desc) :
     Object(backend)
 {
-    if (vkCreateComputePipelines(backend->device(), nullptr, 1, &desc.create_info, nullptr, &m_vk_pipeline) != VK_SUCCESS)
+    m_vk_pipeline = create_handle(backend.get(), desc);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ComputePipeline::ComputePipeline(std::weak_ptr<Backend> backend, VkPipeline pipeline) :
+    Object(backend), m_vk_pipeline(pipeline)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkPipeline ComputePipeline::create_handle(Backend* backend, Desc& desc)
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    desc.create_info.stage.pName = desc.shader_entry_name.c_str();
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (vkCreateComputePipelines(backend->device(), backend->pipeline_cache(), 1, &desc.create_info, nullptr, &pipeline) != VK_SUCCESS)
     {
         DW_LOG_FATAL("(Vulkan) Failed to create Compute Pipeline.");
         throw std::runtime_error("(Vulkan) Failed to create Compute Pipeline.");
     }
+
+    backend->record_pipeline_creation(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    return pipeline;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1874,7 +2277,10 @@ ComputePipeline::~ComputePipeline()
 
     auto backend = m_vk_backend.lock();
 
-    vkDestroyPipeline(backend->device(), m_vk_pipeline, nullptr);
+    VkDevice   device   = backend->device();
+    VkPipeline pipeline = m_vk_pipeline;
+
+    backend->queue_deletion([device, pipeline]() { vkDestroyPipeline(device, pipeline, nullptr); });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -1887,6 +2293,188 @@ void ComputePipeline::set_name(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+PipelineCompiler::Ptr PipelineCompiler::create(Backend::Ptr backend, uint32_t num_threads)
+{
+    return std::shared_ptr<PipelineCompiler>(new PipelineCompiler(backend, num_threads));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PipelineCompiler::PipelineCompiler(Backend::Ptr backend, uint32_t num_threads) :
+    m_backend(backend.get()), m_weak_backend(backend)
+{
+    // Leave a core for the main thread, which keeps loading assets while pipelines compile. The hardware concurrency may be
+    // reported as zero when it can't be determined.
+    if (num_threads == 0)
+    {
+        uint32_t hardware_threads = std::thread::hardware_concurrency();
+        num_threads               = hardware_threads > 1 ? hardware_threads - 1 : 1;
+    }
+
+    for (uint32_t i = 0; i < num_threads; i++)
+        m_threads.push_back(std::thread(&PipelineCompiler::worker, this));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PipelineCompiler::~PipelineCompiler()
+{
+    shutdown();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_future<GraphicsPipeline::Ptr> PipelineCompiler::compile(GraphicsPipeline::Desc desc)
+{
+    Backend*               backend      = m_backend;
+    std::weak_ptr<Backend> weak_backend = m_weak_backend;
+
+    auto task = std::make_shared<std::packaged_task<GraphicsPipeline::Ptr()>>([backend, weak_backend, desc]() mutable {
+        VkPipeline pipeline = GraphicsPipeline::create_handle(backend, desc);
+
+        // The backend only waits for the compiler while it is being destroyed, in which case the pipeline is already in the
+        // cache and nobody can use it.
+        if (weak_backend.expired())
+        {
+            vkDestroyPipeline(backend->device(), pipeline, nullptr);
+            throw std::runtime_error("(Vulkan) Pipeline compiled while Device was being destroyed.");
+        }
+
+        return std::shared_ptr<GraphicsPipeline>(new GraphicsPipeline(weak_backend, pipeline));
+    });
+
+    std::shared_future<GraphicsPipeline::Ptr> future = task->get_future().share();
+
+    enqueue([task]() { (*task)(); });
+
+    return future;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_future<ComputePipeline::Ptr> PipelineCompiler::compile(ComputePipeline::Desc desc)
+{
+    Backend*               backend      = m_backend;
+    std::weak_ptr<Backend> weak_backend = m_weak_backend;
+
+    auto task = std::make_shared<std::packaged_task<ComputePipeline::Ptr()>>([backend, weak_backend, desc]() mutable {
+        VkPipeline pipeline = ComputePipeline::create_handle(backend, desc);
+
+        if (weak_backend.expired())
+        {
+            vkDestroyPipeline(backend->device(), pipeline, nullptr);
+            throw std::runtime_error("(Vulkan) Pipeline compiled while Device was being destroyed.");
+        }
+
+        return std::shared_ptr<ComputePipeline>(new ComputePipeline(weak_backend, pipeline));
+    });
+
+    std::shared_future<ComputePipeline::Ptr> future = task->get_future().share();
+
+    enqueue([task]() { (*task)(); });
+
+    return future;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PipelineCompiler::wait_all()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_tasks.empty() && m_active_count == 0; });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PipelineCompiler::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_stop)
+            return;
+
+        m_stop = true;
+    }
+
+    m_task_available.notify_all();
+
+    // Workers drain the queue before they exit. A thread can't join itself, which would only happen if the last reference to
+    // the compiler were released by one of its own tasks.
+    for (auto& thread : m_threads)
+    {
+        if (thread.get_id() == std::this_thread::get_id())
+            thread.detach();
+        else
+            thread.join();
+    }
+
+    m_threads.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t PipelineCompiler::pending_count()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size() + m_active_count;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PipelineCompiler::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_stop)
+        {
+            DW_LOG_FATAL("(Vulkan) Pipeline compiled after the compiler was shut down.");
+            throw std::runtime_error("(Vulkan) Pipeline compiled after the compiler was shut down.");
+        }
+
+        m_tasks.push_back(task);
+    }
+
+    m_task_available.notify_one();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PipelineCompiler::worker()
+{
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task_available.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+            // Drain the queue before stopping so that no future is left without a result.
+            if (m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_active_count++;
+        }
+
+        // Failures are stored in the future by the packaged task.
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active_count--;
+
+            if (m_tasks.empty() && m_active_count == 0)
+                m_idle.notify_all();
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 ShaderBindingTable::Desc::Desc()
 {
     entry_point_names.reserve(32);
@@ -2179,9 +2767,12 @@ RayTracingPipeline::~RayTracingPipeline()
 
     auto backend = m_vk_backend.lock();
 
+    VkDevice   device   = backend->device();
+    VkPipeline pipeline = m_vk_pipeline;
+
     m_vk_buffer.reset();
     m_sbt.reset();
-    vkDestroyPipeline(backend->device(), m_vk_pipeline, nullptr);
+    backend->queue_deletion([device, pipeline]() { vkDestroyPipeline(device, pipeline, nullptr); });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -2214,12 +2805,16 @@ RayTracingPipeline::RayTracingPipeline(Backend::Ptr backend, Desc desc) :
     desc.create_info.stageCount = m_sbt->stages().size();
     desc.create_info.pStages    = m_sbt->stages().data();
 
-    if (vkCreateRayTracingPipelinesKHR(backend->device(), VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &desc.create_info, VK_NULL_HANDLE, &m_vk_pipeline) != VK_SUCCESS)
+    auto start = std::chrono::steady_clock::now();
+
+    if (vkCreateRayTracingPipelinesKHR(backend->device(), VK_NULL_HANDLE, backend->pipeline_cache(), 1, &desc.create_info, VK_NULL_HANDLE, &m_vk_pipeline) != VK_SUCCESS)
     {
         DW_LOG_FATAL("(Vulkan) Failed to create Ray Tracing Pipeline.");
         throw std::runtime_error("(Vulkan) Failed to create Ray Tracing Pipeline.");
     }
 
+    backend->record_pipeline_creation(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
     const auto& rt_pipeline_props = backend->ray_tracing_pipeline_properties();
 
     uint32_t handle_size         = rt_pipeline_props.shaderGroupHandleSize;
@@ -2350,6 +2945,14 @@ AccelerationStructure::Desc& AccelerationStructure::Desc::set_device_address(VkD
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+AccelerationStructure::Desc& AccelerationStructure::Desc::set_compacted_size(VkDeviceSize size)
+{
+    create_info.size = size;
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 AccelerationStructure::Ptr AccelerationStructure::create(Backend::Ptr backend, Desc desc)
 {
     return std::shared_ptr<AccelerationStructure>(new AccelerationStructure(backend, desc));
@@ -2367,7 +2970,11 @@ AccelerationStructure::~AccelerationStructure()
 
     auto backend = m_vk_backend.lock();
 
-    vkDestroyAccelerationStructureKHR(backend->device(), m_vk_acceleration_structure, nullptr);
+    VkDevice                   device                 = backend->device();
+    VkAccelerationStructureKHR acceleration_structure = m_vk_acceleration_structure;
+
+    // Queued before the buffer is released, so the structure goes before the memory backing it.
+    backend->queue_deletion([device, acceleration_structure]() { vkDestroyAccelerationStructureKHR(device, acceleration_structure, nullptr); });
     m_buffer.reset();
 }
 
@@ -2383,12 +2990,18 @@ AccelerationStructure::AccelerationStructure(Backend::Ptr backend, Desc desc) :
 
     m_build_sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
 
-    vkGetAccelerationStructureBuildSizesKHR(
-        backend->device(),
-        VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-        &desc.build_geometry_info,
-        desc.max_primitive_counts.data(),
-        &m_build_sizes);
+    // Compaction targets are never built, they only need to be large enough for the compacted copy.
+    if (desc.create_info.size > 0)
+        m_build_sizes.accelerationStructureSize = desc.create_info.size;
+    else
+    {
+        vkGetAccelerationStructureBuildSizesKHR(
+            backend->device(),
+            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+            &desc.build_geometry_info,
+            desc.max_primitive_counts.data(),
+            &m_build_sizes);
+    }
 
     // Allocate buffer
     m_buffer = vk::Buffer::create(backend, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, m_build_sizes.accelerationStructureSize, VMA_MEMORY_USAGE_GPU_ONLY, 0);
@@ -2427,15 +3040,98 @@ void AccelerationStructure::set_name(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void AccelerationStructure::swap(AccelerationStructure& other)
+{
+    std::swap(m_buffer, other.m_buffer);
+    std::swap(m_device_address, other.m_device_address);
+    std::swap(m_vk_acceleration_structure_info, other.m_vk_acceleration_structure_info);
+    std::swap(m_vk_acceleration_structure, other.m_vk_acceleration_structure);
+
+    m_generation++;
+    other.m_generation++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+static inline uint64_t hash_value(const T& value, uint64_t seed)
+{
+    return utility::hash64(&value, sizeof(T), seed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t Sampler::Desc::hash() const
+{
+    uint64_t h = 0;
+
+    h = hash_value(flags, h);
+    h = hash_value(mag_filter, h);
+    h = hash_value(min_filter, h);
+    h = hash_value(mipmap_mode, h);
+    h = hash_value(address_mode_u, h);
+    h = hash_value(address_mode_v, h);
+    h = hash_value(address_mode_w, h);
+    h = hash_value(mip_lod_bias, h);
+    h = hash_value(anisotropy_enable, h);
+    h = hash_value(max_anisotropy, h);
+    h = hash_value(compare_enable, h);
+    h = hash_value(compare_op, h);
+    h = hash_value(min_lod, h);
+    h = hash_value(max_lod, h);
+    h = hash_value(border_color, h);
+    h = hash_value(unnormalized_coordinates, h);
+
+    return h;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Sampler::Desc::operator==(const Desc& other) const
+{
+    return flags == other.flags && mag_filter == other.mag_filter && min_filter == other.min_filter && mipmap_mode == other.mipmap_mode &&
+        address_mode_u == other.address_mode_u && address_mode_v == other.address_mode_v && address_mode_w == other.address_mode_w &&
+        mip_lod_bias == other.mip_lod_bias && anisotropy_enable == other.anisotropy_enable && max_anisotropy == other.max_anisotropy &&
+        compare_enable == other.compare_enable && compare_op == other.compare_op && min_lod == other.min_lod && max_lod == other.max_lod &&
+        border_color == other.border_color && unnormalized_coordinates == other.unnormalized_coordinates;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 Sampler::Ptr Sampler::create(Backend::Ptr backend, Desc desc)
 {
-    return std::shared_ptr<Sampler>(new Sampler(backend, desc));
+    const uint64_t hash = desc.hash();
+
+    std::lock_guard<std::mutex> lock(backend->m_object_cache_mutex);
+
+    auto range = backend->m_sampler_cache.equal_range(hash);
+
+    for (auto it = range.first; it != range.second;)
+    {
+        Sampler::Ptr sampler = it->second.lock();
+
+        if (!sampler)
+            it = backend->m_sampler_cache.erase(it);
+        else if (sampler->m_desc == desc)
+        {
+            backend->m_object_cache_stats.sampler_reuse_count++;
+            return sampler;
+        }
+        else
+            it++;
+    }
+
+    Sampler::Ptr sampler = std::shared_ptr<Sampler>(new Sampler(backend, desc));
+    backend->m_sampler_cache.emplace(hash, sampler);
+    backend->m_object_cache_stats.sampler_count++;
+
+    return sampler;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 Sampler::Sampler(Backend::Ptr backend, Desc desc) :
-    Object(backend)
+    Object(backend), m_desc(desc)
 {
     VkSamplerCreateInfo info;
     DW_ZERO_MEMORY(info);
@@ -2477,13 +3173,19 @@ Sampler::~Sampler()
 
     auto backend = m_vk_backend.lock();
 
-    vkDestroySampler(backend->device(), m_vk_sampler, nullptr);
+    VkDevice  device  = backend->device();
+    VkSampler sampler = m_vk_sampler;
+
+    backend->queue_deletion([device, sampler]() { vkDestroySampler(device, sampler, nullptr); });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 void Sampler::set_name(const std::string& name)
 {
+    if (m_named.exchange(true))
+        return;
+
     auto backend = m_vk_backend.lock();
     utilities::set_object_name(backend->device(), (uint64_t)m_vk_sampler, name, VK_OBJECT_TYPE_SAMPLER);
 }
@@ -2496,6 +3198,14 @@ DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::set_next_ptr(void* pnext)
     return *this;
 }
 
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::set_create_flags(VkDescriptorSetLayoutCreateFlags flags)
+{
+    create_flags = flags;
+    return *this;
+}
+
 DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::add_binding(uint32_t binding, VkDescriptorType descriptor_type, uint32_t descriptor_count, VkShaderStageFlags stage_flags)
 {
     bindings.push_back({ binding, descriptor_type, descriptor_count, stage_flags, nullptr });
@@ -2515,86 +3225,376 @@ DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::add_binding(uint32_t bindi
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-DescriptorSetLayout::Ptr DescriptorSetLayout::create(Backend::Ptr backend, Desc desc)
+static size_t descriptor_info_size(VkDescriptorType type)
 {
-    return std::shared_ptr<DescriptorSetLayout>(new DescriptorSetLayout(backend, desc));
+    switch (type)
+    {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+            return sizeof(VkDescriptorBufferInfo);
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return sizeof(VkBufferView);
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+            return sizeof(VkAccelerationStructureKHR);
+        default:
+            return sizeof(VkDescriptorImageInfo);
+    }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-DescriptorSetLayout::DescriptorSetLayout(Backend::Ptr backend, Desc desc) :
-    Object(backend)
+DescriptorSetLayout::Desc& DescriptorSetLayout::Desc::add_template_entry(uint32_t binding, size_t offset, size_t stride, uint32_t array_element, uint32_t descriptor_count)
 {
-    VkDescriptorSetLayoutCreateInfo layout_info;
-    DW_ZERO_MEMORY(layout_info);
+    for (const auto& layout_binding : bindings)
+    {
+        if (layout_binding.binding == binding)
+        {
+            VkDescriptorUpdateTemplateEntry entry;
 
-    layout_info.pNext        = desc.pnext_ptr;
-    layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layout_info.bindingCount = desc.bindings.size();
-    layout_info.pBindings    = desc.bindings.data();
+            entry.dstBinding      = binding;
+            entry.dstArrayElement = array_element;
+            entry.descriptorCount = descriptor_count == 0 ? layout_binding.descriptorCount - array_element : descriptor_count;
+            entry.descriptorType  = layout_binding.descriptorType;
+            entry.offset          = offset;
+            entry.stride          = stride == 0 ? descriptor_info_size(layout_binding.descriptorType) : stride;
 
-    if (vkCreateDescriptorSetLayout(backend->device(), &layout_info, nullptr, &m_vk_ds_layout) != VK_SUCCESS)
-    {
-        DW_LOG_FATAL("(Vulkan) Failed to create Descriptor Set Layout.");
-        throw std::runtime_error("(Vulkan) Failed to create Descriptor Set Layout.");
+            template_entries.push_back(entry);
+
+            return *this;
+        }
     }
+
+    DW_LOG_FATAL("(Vulkan) Template entry added for a binding that is not part of the Descriptor Set Layout.");
+    throw std::runtime_error("(Vulkan) Template entry added for a binding that is not part of the Descriptor Set Layout.");
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-DescriptorSetLayout::~DescriptorSetLayout()
+uint64_t DescriptorSetLayout::Desc::hash() const
 {
-    if (m_vk_backend.expired())
+    uint64_t h = hash_value(create_flags, 0);
+
+    for (const auto& binding : bindings)
     {
-        DW_LOG_FATAL("(Vulkan) Destructing after Device.");
-        throw std::runtime_error("(Vulkan) Destructing after Device.");
+        h = hash_value(binding.binding, h);
+        h = hash_value(binding.descriptorType, h);
+        h = hash_value(binding.descriptorCount, h);
+        h = hash_value(binding.stageFlags, h);
+
+        if (binding.pImmutableSamplers)
+            h = utility::hash64(binding.pImmutableSamplers, sizeof(VkSampler) * binding.descriptorCount, h);
     }
 
-    auto backend = m_vk_backend.lock();
+    for (const auto& entry : template_entries)
+    {
+        h = hash_value(entry.dstBinding, h);
+        h = hash_value(entry.dstArrayElement, h);
+        h = hash_value(entry.descriptorCount, h);
+        h = hash_value(entry.descriptorType, h);
+        h = hash_value(entry.offset, h);
+        h = hash_value(entry.stride, h);
+    }
 
-    vkDestroyDescriptorSetLayout(backend->device(), m_vk_ds_layout, nullptr);
+    return h;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void DescriptorSetLayout::set_name(const std::string& name)
+bool DescriptorSetLayout::Desc::operator==(const Desc& other) const
 {
-    auto backend = m_vk_backend.lock();
-    utilities::set_object_name(backend->device(), (uint64_t)m_vk_ds_layout, name, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT);
-}
+    if (create_flags != other.create_flags || bindings.size() != other.bindings.size() || template_entries.size() != other.template_entries.size())
+        return false;
 
-// -----------------------------------------------------------------------------------------------------------------------------------
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        const VkDescriptorSetLayoutBinding& a = bindings[i];
+        const VkDescriptorSetLayoutBinding& b = other.bindings[i];
 
-PipelineLayout::Desc& PipelineLayout::Desc::add_descriptor_set_layout(DescriptorSetLayout::Ptr layout)
-{
-    layouts.push_back(layout);
-    return *this;
-}
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+            return false;
 
-// -----------------------------------------------------------------------------------------------------------------------------------
+        // Immutable samplers are compared by value, the pointers point into the desc they belong to.
+        if ((a.pImmutableSamplers == nullptr) != (b.pImmutableSamplers == nullptr))
+            return false;
 
-PipelineLayout::Desc& PipelineLayout::Desc::add_push_constant_range(VkShaderStageFlags stage_flags, uint32_t offset, uint32_t size)
-{
-    push_constant_ranges.push_back({ stage_flags, offset, size });
-    return *this;
-}
+        if (a.pImmutableSamplers && memcmp(&binding_samplers[a.binding][0], &other.binding_samplers[b.binding][0], sizeof(VkSampler) * a.descriptorCount) != 0)
+            return false;
+    }
 
-// -----------------------------------------------------------------------------------------------------------------------------------
+    for (uint32_t i = 0; i < template_entries.size(); i++)
+    {
+        const VkDescriptorUpdateTemplateEntry& a = template_entries[i];
+        const VkDescriptorUpdateTemplateEntry& b = other.template_entries[i];
 
-PipelineLayout::Ptr PipelineLayout::create(Backend::Ptr backend, Desc desc)
-{
-    return std::shared_ptr<PipelineLayout>(new PipelineLayout(backend, desc));
+        if (a.dstBinding != b.dstBinding || a.dstArrayElement != b.dstArrayElement || a.descriptorCount != b.descriptorCount || a.descriptorType != b.descriptorType || a.offset != b.offset || a.stride != b.stride)
+            return false;
+    }
+
+    return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-PipelineLayout::PipelineLayout(Backend::Ptr backend, Desc desc) :
-    Object(backend)
+DescriptorSetLayout::Ptr DescriptorSetLayout::create(Backend::Ptr backend, Desc desc)
 {
-    std::vector<VkDescriptorSetLayout> vk_layouts(desc.layouts.size());
+    if (desc.pnext_ptr)
+        return std::shared_ptr<DescriptorSetLayout>(new DescriptorSetLayout(backend, desc));
 
-    for (uint32_t i = 0; i < desc.layouts.size(); i++)
-        vk_layouts[i] = desc.layouts[i]->handle();
+    const uint64_t hash = desc.hash();
+
+    std::lock_guard<std::mutex> lock(backend->m_object_cache_mutex);
+
+    auto range = backend->m_ds_layout_cache.equal_range(hash);
+
+    for (auto it = range.first; it != range.second;)
+    {
+        DescriptorSetLayout::Ptr ds_layout = it->second.lock();
+
+        if (!ds_layout)
+            it = backend->m_ds_layout_cache.erase(it);
+        else if (ds_layout->m_desc == desc)
+        {
+            backend->m_object_cache_stats.ds_layout_reuse_count++;
+            return ds_layout;
+        }
+        else
+            it++;
+    }
+
+    DescriptorSetLayout::Ptr ds_layout = std::shared_ptr<DescriptorSetLayout>(new DescriptorSetLayout(backend, desc));
+    ds_layout->m_cached                = true;
+    backend->m_ds_layout_cache.emplace(hash, ds_layout);
+    backend->m_object_cache_stats.ds_layout_count++;
+
+    return ds_layout;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorSetLayout::DescriptorSetLayout(Backend::Ptr backend, Desc desc) :
+    Object(backend), m_desc(desc)
+{
+    // The copied bindings still point at the immutable samplers of the desc they were copied from.
+    for (auto& binding : m_desc.bindings)
+    {
+        if (binding.pImmutableSamplers)
+            binding.pImmutableSamplers = &m_desc.binding_samplers[binding.binding][0];
+    }
+
+    // The pNext chain isn't owned by the desc.
+    m_desc.pnext_ptr = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layout_info;
+    DW_ZERO_MEMORY(layout_info);
+
+    layout_info.pNext        = desc.pnext_ptr;
+    layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.flags        = desc.create_flags;
+    layout_info.bindingCount = desc.bindings.size();
+    layout_info.pBindings    = desc.bindings.data();
+
+    if (vkCreateDescriptorSetLayout(backend->device(), &layout_info, nullptr, &m_vk_ds_layout) != VK_SUCCESS)
+    {
+        DW_LOG_FATAL("(Vulkan) Failed to create Descriptor Set Layout.");
+        throw std::runtime_error("(Vulkan) Failed to create Descriptor Set Layout.");
+    }
+
+    m_template_entries = desc.template_entries;
+    m_push_descriptor  = (desc.create_flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) != 0;
+
+    if (m_template_entries.size() > 0 && !m_push_descriptor)
+    {
+        VkDescriptorUpdateTemplateCreateInfo template_info;
+        DW_ZERO_MEMORY(template_info);
+
+        template_info.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        template_info.descriptorUpdateEntryCount = m_template_entries.size();
+        template_info.pDescriptorUpdateEntries   = m_template_entries.data();
+        template_info.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        template_info.descriptorSetLayout        = m_vk_ds_layout;
+
+        if (vkCreateDescriptorUpdateTemplate(backend->device(), &template_info, nullptr, &m_vk_update_template) != VK_SUCCESS)
+        {
+            DW_LOG_FATAL("(Vulkan) Failed to create Descriptor Update Template.");
+            throw std::runtime_error("(Vulkan) Failed to create Descriptor Update Template.");
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorSetLayout::~DescriptorSetLayout()
+{
+    if (m_vk_backend.expired())
+    {
+        DW_LOG_FATAL("(Vulkan) Destructing after Device.");
+        throw std::runtime_error("(Vulkan) Destructing after Device.");
+    }
+
+    auto backend = m_vk_backend.lock();
+
+    if (m_vk_update_template)
+        vkDestroyDescriptorUpdateTemplate(backend->device(), m_vk_update_template, nullptr);
+
+    vkDestroyDescriptorSetLayout(backend->device(), m_vk_ds_layout, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DescriptorSetLayout::set_name(const std::string& name)
+{
+    if (m_named.exchange(true) && m_cached)
+        return;
+
+    auto backend = m_vk_backend.lock();
+    utilities::set_object_name(backend->device(), (uint64_t)m_vk_ds_layout, name, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT);
+
+    if (m_vk_update_template)
+        utilities::set_object_name(backend->device(), (uint64_t)m_vk_update_template, name, VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DescriptorSetLayout::update(const std::shared_ptr<DescriptorSet>& ds, const void* data)
+{
+    if (!m_vk_update_template)
+    {
+        DW_LOG_FATAL("(Vulkan) Descriptor Set Layout has no template entries to update a set with.");
+        throw std::runtime_error("(Vulkan) Descriptor Set Layout has no template entries to update a set with.");
+    }
+
+    auto backend = m_vk_backend.lock();
+
+    vkUpdateDescriptorSetWithTemplate(backend->device(), ds->handle(), m_vk_update_template, data);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DescriptorSetLayout::push(const std::shared_ptr<CommandBuffer>& cmd_buf, VkPipelineBindPoint bind_point, const std::shared_ptr<PipelineLayout>& pipeline_layout, uint32_t set, const void* data)
+{
+    auto backend = m_vk_backend.lock();
+
+    if (!m_push_descriptor || !backend->push_descriptors_supported())
+    {
+        DW_LOG_FATAL("(Vulkan) Descriptor Set Layout can't be pushed, VK_KHR_push_descriptor is missing or the layout was not created for it.");
+        throw std::runtime_error("(Vulkan) Descriptor Set Layout can't be pushed, VK_KHR_push_descriptor is missing or the layout was not created for it.");
+    }
+
+    if (set >= pipeline_layout->m_desc.layouts.size() || pipeline_layout->m_desc.layouts[set].get() != this)
+    {
+        DW_LOG_FATAL("(Vulkan) Descriptor Set Layout is not used for set " + std::to_string(set) + " of the Pipeline Layout it is pushed with.");
+        throw std::runtime_error("(Vulkan) Descriptor Set Layout is not used for set " + std::to_string(set) + " of the Pipeline Layout it is pushed with.");
+    }
+
+    VkDescriptorUpdateTemplate handle = pipeline_layout->push_template(bind_point, set);
+
+    vkCmdPushDescriptorSetWithTemplateKHR(cmd_buf->handle(), handle, pipeline_layout->handle(), set, data);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PipelineLayout::Desc& PipelineLayout::Desc::add_descriptor_set_layout(DescriptorSetLayout::Ptr layout)
+{
+    layouts.push_back(layout);
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PipelineLayout::Desc& PipelineLayout::Desc::add_push_constant_range(VkShaderStageFlags stage_flags, uint32_t offset, uint32_t size)
+{
+    push_constant_ranges.push_back({ stage_flags, offset, size });
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t PipelineLayout::Desc::hash() const
+{
+    uint64_t h = 0;
+
+    for (const auto& layout : layouts)
+        h = hash_value(layout->handle(), h);
+
+    for (const auto& range : push_constant_ranges)
+    {
+        h = hash_value(range.stageFlags, h);
+        h = hash_value(range.offset, h);
+        h = hash_value(range.size, h);
+    }
+
+    return h;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool PipelineLayout::Desc::operator==(const Desc& other) const
+{
+    if (layouts.size() != other.layouts.size() || push_constant_ranges.size() != other.push_constant_ranges.size())
+        return false;
+
+    for (uint32_t i = 0; i < layouts.size(); i++)
+    {
+        if (layouts[i]->handle() != other.layouts[i]->handle())
+            return false;
+    }
+
+    for (uint32_t i = 0; i < push_constant_ranges.size(); i++)
+    {
+        const VkPushConstantRange& a = push_constant_ranges[i];
+        const VkPushConstantRange& b = other.push_constant_ranges[i];
+
+        if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+            return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PipelineLayout::Ptr PipelineLayout::create(Backend::Ptr backend, Desc desc)
+{
+    const uint64_t hash = desc.hash();
+
+    std::lock_guard<std::mutex> lock(backend->m_object_cache_mutex);
+
+    auto range = backend->m_pipeline_layout_cache.equal_range(hash);
+
+    for (auto it = range.first; it != range.second;)
+    {
+        PipelineLayout::Ptr pipeline_layout = it->second.lock();
+
+        if (!pipeline_layout)
+            it = backend->m_pipeline_layout_cache.erase(it);
+        else if (pipeline_layout->m_desc == desc)
+        {
+            backend->m_object_cache_stats.pipeline_layout_reuse_count++;
+            return pipeline_layout;
+        }
+        else
+            it++;
+    }
+
+    PipelineLayout::Ptr pipeline_layout = std::shared_ptr<PipelineLayout>(new PipelineLayout(backend, desc));
+    backend->m_pipeline_layout_cache.emplace(hash, pipeline_layout);
+    backend->m_object_cache_stats.pipeline_layout_count++;
+
+    return pipeline_layout;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PipelineLayout::PipelineLayout(Backend::Ptr backend, Desc desc) :
+    Object(backend), m_desc(desc)
+{
+    std::vector<VkDescriptorSetLayout> vk_layouts(desc.layouts.size());
+
+    for (uint32_t i = 0; i < desc.layouts.size(); i++)
+        vk_layouts[i] = desc.layouts[i]->handle();
 
     VkPipelineLayoutCreateInfo info;
     DW_ZERO_MEMORY(info);
@@ -2624,6 +3624,9 @@ PipelineLayout::~PipelineLayout()
 
     auto backend = m_vk_backend.lock();
 
+    for (const auto& push_template : m_push_templates)
+        vkDestroyDescriptorUpdateTemplate(backend->device(), push_template.handle, nullptr);
+
     vkDestroyPipelineLayout(backend->device(), m_vk_pipeline_layout, nullptr);
 }
 
@@ -2631,12 +3634,56 @@ PipelineLayout::~PipelineLayout()
 
 void PipelineLayout::set_name(const std::string& name)
 {
+    if (m_named.exchange(true))
+        return;
+
     auto backend = m_vk_backend.lock();
     utilities::set_object_name(backend->device(), (uint64_t)m_vk_pipeline_layout, name, VK_OBJECT_TYPE_PIPELINE_LAYOUT);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+VkDescriptorUpdateTemplate PipelineLayout::push_template(VkPipelineBindPoint bind_point, uint32_t set)
+{
+    std::lock_guard<std::mutex> lock(m_push_template_mutex);
+
+    for (const auto& push_template : m_push_templates)
+    {
+        if (push_template.bind_point == bind_point && push_template.set == set)
+            return push_template.handle;
+    }
+
+    auto backend = m_vk_backend.lock();
+
+    const DescriptorSetLayout::Ptr& ds_layout = m_desc.layouts[set];
+
+    VkDescriptorUpdateTemplateCreateInfo template_info;
+    DW_ZERO_MEMORY(template_info);
+
+    template_info.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    template_info.descriptorUpdateEntryCount = ds_layout->m_template_entries.size();
+    template_info.pDescriptorUpdateEntries   = ds_layout->m_template_entries.data();
+    template_info.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+    template_info.descriptorSetLayout        = ds_layout->handle();
+    template_info.pipelineBindPoint          = bind_point;
+    template_info.pipelineLayout             = m_vk_pipeline_layout;
+    template_info.set                        = set;
+
+    VkDescriptorUpdateTemplate handle = VK_NULL_HANDLE;
+
+    if (vkCreateDescriptorUpdateTemplate(backend->device(), &template_info, nullptr, &handle) != VK_SUCCESS)
+    {
+        DW_LOG_FATAL("(Vulkan) Failed to create Push Descriptor Update Template.");
+        throw std::runtime_error("(Vulkan) Failed to create Push Descriptor Update Template.");
+    }
+
+    m_push_templates.push_back({ bind_point, set, handle });
+
+    return handle;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 DescriptorPool::Desc& DescriptorPool::Desc::set_max_sets(uint32_t num)
 {
     max_sets = num;
@@ -2701,7 +3748,11 @@ DescriptorPool::~DescriptorPool()
 
     auto backend = m_vk_backend.lock();
 
-    vkDestroyDescriptorPool(backend->device(), m_vk_ds_pool, nullptr);
+    VkDevice         device = backend->device();
+    VkDescriptorPool pool   = m_vk_ds_pool;
+
+    // Sets allocated from the pool may still be bound by in-flight command buffers.
+    backend->queue_deletion([device, pool]() { vkDestroyDescriptorPool(device, pool, nullptr); });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -2714,6 +3765,22 @@ void DescriptorPool::set_name(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void DescriptorPool::reset()
+{
+    auto backend = m_vk_backend.lock();
+
+    if (vkResetDescriptorPool(backend->device(), m_vk_ds_pool, 0) != VK_SUCCESS)
+    {
+        DW_LOG_FATAL("(Vulkan) Failed to reset Descriptor Pool.");
+        throw std::runtime_error("(Vulkan) Failed to reset Descriptor Pool.");
+    }
+
+    m_reset_count++;
+    m_allocated_sets = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 DescriptorSet::Ptr DescriptorSet::create(Backend::Ptr backend, DescriptorSetLayout::Ptr layout, DescriptorPool::Ptr pool, void* pnext)
 {
     return std::shared_ptr<DescriptorSet>(new DescriptorSet(backend, layout, pool, pnext));
@@ -2721,6 +3788,31 @@ DescriptorSet::Ptr DescriptorSet::create(Backend::Ptr backend, DescriptorSetLayo
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+DescriptorSet::Ptr DescriptorSet::try_create(Backend::Ptr backend, DescriptorSetLayout::Ptr layout, DescriptorPool::Ptr pool, void* pnext)
+{
+    VkDescriptorSetAllocateInfo info;
+    DW_ZERO_MEMORY(info);
+
+    VkDescriptorSetLayout vk_layout = layout->handle();
+
+    info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.descriptorPool     = pool->handle();
+    info.descriptorSetCount = 1;
+    info.pSetLayouts        = &vk_layout;
+    info.pNext              = pnext;
+
+    VkDescriptorSet vk_ds = VK_NULL_HANDLE;
+
+    if (vkAllocateDescriptorSets(backend->device(), &info, &vk_ds) != VK_SUCCESS)
+        return nullptr;
+
+    pool->m_allocated_sets++;
+
+    return std::shared_ptr<DescriptorSet>(new DescriptorSet(backend, vk_ds, pool));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 DescriptorSet::DescriptorSet(Backend::Ptr backend, DescriptorSetLayout::Ptr layout, DescriptorPool::Ptr pool, void* pnext) :
     Object(backend)
 {
@@ -2745,6 +3837,19 @@ DescriptorSet::DescriptorSet(Backend::Ptr backend, DescriptorSetLayout::Ptr layo
         DW_LOG_FATAL("(Vulkan) Failed to allocate descriptor set.");
         throw std::runtime_error("(Vulkan) Failed to allocate descriptor set.");
     }
+
+    pool->m_allocated_sets++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorSet::DescriptorSet(Backend::Ptr backend, VkDescriptorSet ds, DescriptorPool::Ptr pool) :
+    Object(backend), m_vk_ds(ds)
+{
+    m_vk_pool = pool;
+
+    if ((pool->create_flags() & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) == VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+        m_should_destroy = true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -2758,10 +3863,25 @@ DescriptorSet::~DescriptorSet()
     }
 
     auto backend = m_vk_backend.lock();
-    auto pool    = m_vk_pool.lock();
 
+    VkDevice                      device         = backend->device();
+    VkDescriptorSet               descriptor_set = m_vk_ds;
+    std::weak_ptr<DescriptorPool> weak_pool      = m_vk_pool;
+    uint32_t                      reset_count    = m_vk_pool.lock()->reset_count();
+
+    // Destroying or resetting the pool frees its sets along with it, in which case there is nothing left to do.
     if (m_should_destroy)
-        vkFreeDescriptorSets(backend->device(), pool->handle(), 1, &m_vk_ds);
+    {
+        backend->queue_deletion([device, weak_pool, reset_count, descriptor_set]() {
+            auto pool = weak_pool.lock();
+
+            if (pool && pool->reset_count() == reset_count)
+            {
+                vkFreeDescriptorSets(device, pool->handle(), 1, &descriptor_set);
+                pool->m_allocated_sets--;
+            }
+        });
+    }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -2774,47 +3894,233 @@ void DescriptorSet::set_name(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Fence::Ptr Fence::create(Backend::Ptr backend)
+DescriptorAllocator::Desc& DescriptorAllocator::Desc::set_sets_per_pool(uint32_t num)
 {
-    return std::shared_ptr<Fence>(new Fence(backend));
+    sets_per_pool = num;
+    return *this;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Fence::~Fence()
+DescriptorAllocator::Desc& DescriptorAllocator::Desc::set_max_sets_per_pool(uint32_t num)
 {
-    if (m_vk_backend.expired())
-    {
-        DW_LOG_FATAL("(Vulkan) Destructing after Device.");
-        throw std::runtime_error("(Vulkan) Destructing after Device.");
-    }
-
-    auto backend = m_vk_backend.lock();
-
-    vkDestroyFence(backend->device(), m_vk_fence, nullptr);
+    max_sets_per_pool = num;
+    return *this;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Fence::wait_for_completion()
+DescriptorAllocator::Desc& DescriptorAllocator::Desc::set_growth_factor(float factor)
 {
-    auto backend = m_vk_backend.lock();
-
-    vkWaitForFences(backend->device(), 1, &m_vk_fence, VK_TRUE, UINT64_MAX);
-    vkResetFences(backend->device(), 1, &m_vk_fence);
+    growth_factor = factor;
+    return *this;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Fence::set_name(const std::string& name)
+DescriptorAllocator::Desc& DescriptorAllocator::Desc::set_create_flags(VkDescriptorPoolCreateFlags flags)
 {
-    auto backend = m_vk_backend.lock();
-    utilities::set_object_name(backend->device(), (uint64_t)m_vk_fence, name, VK_OBJECT_TYPE_FENCE);
+    create_flags = flags;
+    return *this;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Fence::Fence(Backend::Ptr backend) :
+DescriptorAllocator::Desc& DescriptorAllocator::Desc::add_pool_size_ratio(VkDescriptorType type, float ratio)
+{
+    pool_size_ratios.push_back({ type, ratio });
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorAllocator::Ptr DescriptorAllocator::create(Backend::Ptr backend, Desc desc)
+{
+    return std::shared_ptr<DescriptorAllocator>(new DescriptorAllocator(backend, desc));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorAllocator::DescriptorAllocator(Backend::Ptr backend, Desc desc) :
+    Object(backend), m_desc(desc), m_next_pool_size(desc.sets_per_pool)
+{
+    m_pools.push_back(create_pool());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    m_pools.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorSet::Ptr DescriptorAllocator::allocate(DescriptorSetLayout::Ptr layout, void* pnext)
+{
+    auto backend = m_vk_backend.lock();
+
+    DescriptorSet::Ptr ds = DescriptorSet::try_create(backend, layout, m_pools[m_current_pool], pnext);
+
+    if (!ds)
+    {
+        m_stats.exhaustion_count++;
+
+        // Sets can only be returned to a pool if it was created with the free flag, so earlier pools are only worth revisiting in that case.
+        if (m_desc.create_flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+        {
+            for (uint32_t i = 1; i < m_pools.size() && !ds; i++)
+            {
+                uint32_t idx = (m_current_pool + i) % m_pools.size();
+
+                ds = DescriptorSet::try_create(backend, layout, m_pools[idx], pnext);
+
+                if (ds)
+                    m_current_pool = idx;
+            }
+        }
+        else
+        {
+            // Pools that have been reset are reused before growing the chain.
+            while (!ds && m_current_pool + 1 < m_pools.size())
+                ds = DescriptorSet::try_create(backend, layout, m_pools[++m_current_pool], pnext);
+        }
+
+        if (!ds)
+        {
+            m_pools.push_back(create_pool());
+            m_current_pool = m_pools.size() - 1;
+
+            ds = DescriptorSet::try_create(backend, layout, m_pools[m_current_pool], pnext);
+
+            if (!ds)
+            {
+                DW_LOG_FATAL("(Vulkan) Failed to allocate descriptor set. The layout may require more descriptors than a pool provides.");
+                throw std::runtime_error("(Vulkan) Failed to allocate descriptor set.");
+            }
+        }
+    }
+
+    m_stats.allocated_sets = allocated_sets();
+    m_stats.peak_sets      = std::max(m_stats.peak_sets, m_stats.allocated_sets);
+
+    return ds;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const DescriptorAllocator::Stats& DescriptorAllocator::stats()
+{
+    // Sets are freed from their destructors, so the count is gathered from the pools rather than tracked here.
+    m_stats.allocated_sets = allocated_sets();
+
+    return m_stats;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t DescriptorAllocator::allocated_sets()
+{
+    uint32_t count = 0;
+
+    for (const auto& pool : m_pools)
+        count += pool->allocated_sets();
+
+    return count;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DescriptorAllocator::reset()
+{
+    for (auto& pool : m_pools)
+        pool->reset();
+
+    m_current_pool          = 0;
+    m_stats.allocated_sets  = 0;
+    m_stats.reset_count++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DescriptorAllocator::set_name(const std::string& name)
+{
+    m_name = name;
+
+    for (uint32_t i = 0; i < m_pools.size(); i++)
+        m_pools[i]->set_name(m_name + " " + std::to_string(i));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DescriptorPool::Ptr DescriptorAllocator::create_pool()
+{
+    auto backend = m_vk_backend.lock();
+
+    DescriptorPool::Desc dp_desc;
+
+    dp_desc.set_max_sets(m_next_pool_size)
+        .set_create_flags(m_desc.create_flags);
+
+    for (const auto& ratio : m_desc.pool_size_ratios)
+        dp_desc.add_pool_size(ratio.first, std::max(1u, uint32_t(ratio.second * float(m_next_pool_size))));
+
+    DescriptorPool::Ptr pool = DescriptorPool::create(backend, dp_desc);
+
+    if (!m_name.empty())
+        pool->set_name(m_name + " " + std::to_string(m_pools.size()));
+
+    m_stats.pool_count++;
+    m_stats.set_capacity += m_next_pool_size;
+
+    m_next_pool_size = std::min(m_desc.max_sets_per_pool, uint32_t(float(m_next_pool_size) * m_desc.growth_factor));
+
+    return pool;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Fence::Ptr Fence::create(Backend::Ptr backend)
+{
+    return std::shared_ptr<Fence>(new Fence(backend));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Fence::~Fence()
+{
+    if (m_vk_backend.expired())
+    {
+        DW_LOG_FATAL("(Vulkan) Destructing after Device.");
+        throw std::runtime_error("(Vulkan) Destructing after Device.");
+    }
+
+    auto backend = m_vk_backend.lock();
+
+    vkDestroyFence(backend->device(), m_vk_fence, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Fence::wait_for_completion()
+{
+    auto backend = m_vk_backend.lock();
+
+    vkWaitForFences(backend->device(), 1, &m_vk_fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(backend->device(), 1, &m_vk_fence);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Fence::set_name(const std::string& name)
+{
+    auto backend = m_vk_backend.lock();
+    utilities::set_object_name(backend->device(), (uint64_t)m_vk_fence, name, VK_OBJECT_TYPE_FENCE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Fence::Fence(Backend::Ptr backend) :
     Object(backend)
 {
     VkFenceCreateInfo fence_info;
@@ -2832,9 +4138,9 @@ Fence::Fence(Backend::Ptr backend) :
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Semaphore::Ptr Semaphore::create(Backend::Ptr backend)
+Semaphore::Ptr Semaphore::create(Backend::Ptr backend, bool timeline, uint64_t initial_value)
 {
-    return std::shared_ptr<Semaphore>(new Semaphore(backend));
+    return std::shared_ptr<Semaphore>(new Semaphore(backend, timeline, initial_value));
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -2854,6 +4160,36 @@ Semaphore::~Semaphore()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+uint64_t Semaphore::value()
+{
+    auto backend = m_vk_backend.lock();
+
+    uint64_t value = 0;
+
+    vkGetSemaphoreCounterValue(backend->device(), m_vk_semaphore, &value);
+
+    return value;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Semaphore::wait(uint64_t value, uint64_t timeout)
+{
+    auto backend = m_vk_backend.lock();
+
+    VkSemaphoreWaitInfo wait_info;
+    DW_ZERO_MEMORY(wait_info);
+
+    wait_info.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores    = &m_vk_semaphore;
+    wait_info.pValues        = &value;
+
+    return vkWaitSemaphores(backend->device(), &wait_info, timeout) == VK_SUCCESS;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 void Semaphore::set_name(const std::string& name)
 {
     auto backend = m_vk_backend.lock();
@@ -2862,13 +4198,21 @@ void Semaphore::set_name(const std::string& name)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Semaphore::Semaphore(Backend::Ptr backend) :
-    Object(backend)
+Semaphore::Semaphore(Backend::Ptr backend, bool timeline, uint64_t initial_value) :
+    Object(backend), m_timeline(timeline)
 {
+    VkSemaphoreTypeCreateInfo type_info;
+    DW_ZERO_MEMORY(type_info);
+
+    type_info.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue  = initial_value;
+
     VkSemaphoreCreateInfo semaphore_info;
     DW_ZERO_MEMORY(semaphore_info);
 
     semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = timeline ? &type_info : nullptr;
 
     if (vkCreateSemaphore(backend->device(), &semaphore_info, nullptr, &m_vk_semaphore) != VK_SUCCESS)
     {
@@ -2966,21 +4310,23 @@ StagingBuffer::~StagingBuffer()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-size_t StagingBuffer::insert_data(void* data, const size_t& size)
+size_t StagingBuffer::insert_data(void* data, const size_t& size, const size_t& alignment)
 {
     // If not enough space to insert the data, throw an error!
-    if (size > remaining_size())
+    if (size > remaining_size(alignment))
         throw std::runtime_error("(Vulkan) Not enough space available in Staging Buffer.");
 
-    // Keep current size as the offset to the start of this data segment.
-    size_t offset = m_current_size;
+    // Pad the start of this data segment up to the requested alignment and use it as the offset.
+    size_t offset = aligned_offset(alignment);
+
+    m_mapped_ptr += offset - m_current_size;
 
     // Copy data into the mapped buffer.
     memcpy(m_mapped_ptr, data, size);
 
     // Increment pointer and current size.
     m_mapped_ptr += size;
-    m_current_size += size;
+    m_current_size = offset + size;
 
     // Return offset to the data segment.
     return offset;
@@ -2988,212 +4334,1204 @@ size_t StagingBuffer::insert_data(void* data, const size_t& size)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-BatchUploader::BatchUploader(Backend::Ptr backend) :
-    m_backend(backend)
+StagingRingBuffer::Ptr StagingRingBuffer::create(Backend::Ptr backend, size_t partition_size, uint32_t partition_count)
 {
-    if (!m_backend.expired())
-    {
-        auto backend = m_backend.lock();
-        m_cmd        = backend->allocate_graphics_command_buffer(true);
-    }
+    return std::shared_ptr<StagingRingBuffer>(new StagingRingBuffer(backend, partition_size, partition_count));
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-BatchUploader::~BatchUploader()
+StagingRingBuffer::StagingRingBuffer(Backend::Ptr backend, size_t partition_size, uint32_t partition_count) :
+    m_backend(backend), m_partition_size(partition_size)
 {
-}
+    m_graphics_queue_family = backend->queue_infos().graphics_queue_index;
+    m_transfer_queue_family = backend->queue_infos().transfer_queue_index;
+    m_async_transfer        = m_transfer_queue_family != m_graphics_queue_family;
 
-// -----------------------------------------------------------------------------------------------------------------------------------
+    m_buffer     = Buffer::create(backend, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, partition_size * partition_count, VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    m_mapped_ptr = (uint8_t*)m_buffer->mapped_ptr();
 
-void BatchUploader::upload_buffer_data(Buffer::Ptr buffer, void* data, const size_t& offset, const size_t& size)
-{
-    if (!m_backend.expired())
-    {
-        auto backend = m_backend.lock();
+    m_buffer->set_name("Staging Ring Buffer");
 
-        auto staging_buffer = insert_data(data, size);
+    m_partitions.resize(partition_count);
 
-        VkBufferCopy copy_region;
-        DW_ZERO_MEMORY(copy_region);
+    for (uint32_t i = 0; i < partition_count; i++)
+    {
+        m_partitions[i].begin    = partition_size * i;
+        m_partitions[i].head     = m_partitions[i].begin;
+        m_partitions[i].cmd_pool = CommandPool::create(backend, m_graphics_queue_family);
 
-        copy_region.dstOffset = offset;
-        copy_region.size      = size;
+        m_partitions[i].cmd_pool->set_name("Staging Ring Command Pool " + std::to_string(i));
 
-        vkCmdCopyBuffer(m_cmd->handle(), staging_buffer->handle(), buffer->handle(), 1, &copy_region);
+        if (m_async_transfer)
+        {
+            m_partitions[i].transfer_cmd_pool = CommandPool::create(backend, m_transfer_queue_family);
+            m_partitions[i].transfer_cmd_pool->set_name("Staging Ring Transfer Command Pool " + std::to_string(i));
+        }
     }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BatchUploader::upload_image_data(Image::Ptr image, void* data, const std::vector<size_t>& mip_level_sizes, VkImageLayout dst_layout)
+StagingRingBuffer::~StagingRingBuffer()
 {
-    if (!m_backend.expired())
-    {
-        auto backend = m_backend.lock();
-
-        size_t size = 0;
-
-        for (const auto& region_size : mip_level_sizes)
-            size += region_size;
-
-        auto buffer = insert_data(data, size);
-
-        std::vector<VkBufferImageCopy> copy_regions;
-        size_t                         offset     = 0;
-        uint32_t                       region_idx = 0;
+    m_recording_cmd.reset();
+    m_recording_transfer_cmd.reset();
+    m_partitions.clear();
+    m_dedicated_recording.clear();
+    m_dedicated_in_flight.clear();
+    m_dedicated_free.clear();
+    m_buffer.reset();
+}
 
-        for (int array_idx = 0; array_idx < image->array_size(); array_idx++)
-        {
-            int width  = image->width();
-            int height = image->height();
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-            for (int i = 0; i < image->mip_levels(); i++)
-            {
-                VkBufferImageCopy buffer_copy_region;
-                DW_ZERO_MEMORY(buffer_copy_region);
+StagingRingBuffer::Allocation StagingRingBuffer::allocate(size_t size, size_t alignment)
+{
+    Partition& partition = m_partitions[m_current_partition];
+    Allocation allocation;
 
-                buffer_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-                buffer_copy_region.imageSubresource.mipLevel       = i;
-                buffer_copy_region.imageSubresource.baseArrayLayer = array_idx;
-                buffer_copy_region.imageSubresource.layerCount     = 1;
-                buffer_copy_region.imageExtent.width               = width;
-                buffer_copy_region.imageExtent.height              = height;
-                buffer_copy_region.imageExtent.depth               = 1;
-                buffer_copy_region.bufferOffset                    = offset;
+    size_t offset = ((partition.head + alignment - 1) / alignment) * alignment;
 
-                copy_regions.push_back(buffer_copy_region);
+    if (offset + size <= partition.begin + m_partition_size)
+    {
+        partition.head = offset + size;
 
-                width  = std::max(1, width / 2);
-                height = std::max(1, (height / 2));
+        allocation.buffer     = m_buffer;
+        allocation.offset     = offset;
+        allocation.mapped_ptr = m_mapped_ptr + offset;
+    }
+    else
+    {
+        // Too large for what is left of this partition. A dedicated buffer keeps the upload from stalling on the GPU, the
+        // smallest idle one that fits is reused before creating a new one.
+        Buffer::Ptr buffer;
+        uint32_t    best_idx = UINT32_MAX;
 
-                offset += mip_level_sizes[region_idx++];
-            }
+        for (uint32_t i = 0; i < m_dedicated_free.size(); i++)
+        {
+            if (m_dedicated_free[i]->size() >= size && (best_idx == UINT32_MAX || m_dedicated_free[i]->size() < m_dedicated_free[best_idx]->size()))
+                best_idx = i;
         }
 
-        VkImageSubresourceRange subresource_range;
-        DW_ZERO_MEMORY(subresource_range);
+        if (best_idx != UINT32_MAX)
+        {
+            buffer = m_dedicated_free[best_idx];
+            m_dedicated_free.erase(m_dedicated_free.begin() + best_idx);
+        }
+        else
+            buffer = Buffer::create(m_backend.lock(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size, VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT);
 
-        subresource_range.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        subresource_range.baseMipLevel   = 0;
-        subresource_range.levelCount     = image->mip_levels();
-        subresource_range.layerCount     = image->array_size();
-        subresource_range.baseArrayLayer = 0;
+        m_dedicated_recording.push_back(buffer);
 
-        backend->use_resource(VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image, subresource_range);
-        
-        backend->flush_barriers(m_cmd);
+        allocation.buffer     = buffer;
+        allocation.offset     = 0;
+        allocation.mapped_ptr = (uint8_t*)buffer->mapped_ptr();
 
-        // Copy mip levels from staging buffer
-        vkCmdCopyBufferToImage(m_cmd->handle(),
-                               buffer->handle(),
-                               image->handle(),
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               copy_regions.size(),
-                               copy_regions.data());
+        m_pending_stats.frame_dedicated_bytes += size;
+    }
 
-        backend->use_resource(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_SHADER_READ_BIT, dst_layout, image, subresource_range);
+    m_pending_stats.frame_bytes += size;
+    m_pending_stats.total_bytes += size;
+    m_pending_stats.frame_uploads++;
 
-        backend->flush_barriers(m_cmd);
-    }
+    return allocation;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BatchUploader::build_blas(AccelerationStructure::Ptr acceleration_structure, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR> build_ranges)
+StagingRingBuffer::Allocation StagingRingBuffer::stage(void* data, size_t size, size_t alignment)
 {
-    if (geometries.size() > 0 || build_ranges.size() > 0)
-        m_blas_build_requests.push_back({ acceleration_structure, geometries, build_ranges });
-    else
-    {
-        DW_LOG_FATAL("(Vulkan) Building a BLAS requires one or more Geometry and Build Offset structures.");
-        throw std::runtime_error("(Vulkan) Building a BLAS requires one or more Geometry and Build Offset structures.");
-    }
+    Allocation allocation = allocate(size, alignment);
+
+    memcpy(allocation.mapped_ptr, data, size);
+
+    return allocation;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Buffer::Ptr BatchUploader::insert_data(void* data, const size_t& size)
+static void record_barrier(CommandBuffer::Ptr cmd_buf, const VkBufferMemoryBarrier2* buffer_barrier, const VkImageMemoryBarrier2* image_barrier, const VkMemoryBarrier2* memory_barrier = nullptr)
 {
-    add_staging_buffer(size);
+    VkDependencyInfo dependency_info = {};
 
-    m_staging_buffers.top()->insert_data(data, size);
+    dependency_info.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency_info.memoryBarrierCount       = memory_barrier ? 1 : 0;
+    dependency_info.pMemoryBarriers          = memory_barrier;
+    dependency_info.bufferMemoryBarrierCount = buffer_barrier ? 1 : 0;
+    dependency_info.pBufferMemoryBarriers    = buffer_barrier;
+    dependency_info.imageMemoryBarrierCount  = image_barrier ? 1 : 0;
+    dependency_info.pImageMemoryBarriers     = image_barrier;
 
-    return m_staging_buffers.top()->buffer();
+    vkCmdPipelineBarrier2(cmd_buf->handle(), &dependency_info);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BatchUploader::submit()
+void StagingRingBuffer::copy_buffer(const Allocation& src, Buffer* dst, size_t dst_offset, size_t size)
 {
-    if (!m_backend.expired())
-    {
-        auto backend = m_backend.lock();
+    VkBufferCopy copy_region;
+    DW_ZERO_MEMORY(copy_region);
 
-        vk::Buffer::Ptr blas_scratch_buffer;
+    copy_region.srcOffset = src.offset;
+    copy_region.dstOffset = dst_offset;
+    copy_region.size      = size;
 
-        if (m_blas_build_requests.size() > 0)
-        {
-            VkMemoryBarrier memory_barrier;
-            memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-            memory_barrier.pNext         = nullptr;
-            memory_barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
-            memory_barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+    // The graphics queue may already have used the buffer. Without acquiring it first the transfer queue would leave everything
+    // outside of the written range undefined, so only a copy that replaces all of the contents can skip that.
+    if (!m_async_transfer || dst_offset != 0 || size != dst->size())
+    {
+        auto cmd_buf = command_buffer();
 
-            VkDeviceSize scratch_buffer_size = 0;
+        // Earlier uses of the buffer are on the same queue, waiting on all commands orders the copy after them. flush() makes
+        // the write visible to later ones.
+        VkBufferMemoryBarrier2 barrier = {};
 
-            for (int i = 0; i < m_blas_build_requests.size(); i++)
-                scratch_buffer_size = std::max(scratch_buffer_size, m_blas_build_requests[i].acceleration_structure->build_sizes().buildScratchSize);
+        barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        barrier.srcStageMask        = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.srcAccessMask       = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        barrier.dstStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+        barrier.dstAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer              = dst->handle();
+        barrier.offset              = dst_offset;
+        barrier.size                = size;
 
-            blas_scratch_buffer = vk::Buffer::create_with_alignment(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, scratch_buffer_size, backend->acceleration_structure_properties().minAccelerationStructureScratchOffsetAlignment, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+        record_barrier(cmd_buf, &barrier, nullptr);
 
-            for (int i = 0; i < m_blas_build_requests.size(); i++)
-            {
-                const VkAccelerationStructureBuildRangeInfoKHR* ptr_build_ranges = &m_blas_build_requests[i].build_ranges[0];
+        vkCmdCopyBuffer(cmd_buf->handle(), src.buffer->handle(), dst->handle(), 1, &copy_region);
+        return;
+    }
 
-                VkAccelerationStructureBuildGeometryInfoKHR build_info;
-                DW_ZERO_MEMORY(build_info);
+    vkCmdCopyBuffer(transfer_command_buffer()->handle(), src.buffer->handle(), dst->handle(), 1, &copy_region);
 
-                build_info.sType                     = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-                build_info.type                      = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-                build_info.flags                     = m_blas_build_requests[i].acceleration_structure->flags();
-                build_info.mode                      = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-                build_info.srcAccelerationStructure  = VK_NULL_HANDLE;
-                build_info.dstAccelerationStructure  = m_blas_build_requests[i].acceleration_structure->handle();
-                build_info.geometryCount             = (uint32_t)m_blas_build_requests[i].geometries.size();
-                build_info.pGeometries               = m_blas_build_requests[i].geometries.data();
-                build_info.scratchData.deviceAddress = blas_scratch_buffer->device_address();
+    // Buffers are not layout tracked and can be bound without going through the tracker, so any of them may still be read by
+    // graphics work that has already been submitted.
+    m_transfer_waits = true;
 
-                vkCmdBuildAccelerationStructuresKHR(m_cmd->handle(), 1, &build_info, &ptr_build_ranges);
+    // Release the buffer to the graphics queue family...
+    VkBufferMemoryBarrier2 barrier = {};
 
-                vkCmdPipelineBarrier(m_cmd->handle(), VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &memory_barrier, 0, 0, 0, 0);
-            }
-        }
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.srcStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+    barrier.srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask        = VK_PIPELINE_STAGE_2_NONE;
+    barrier.dstAccessMask       = VK_ACCESS_2_NONE;
+    barrier.srcQueueFamilyIndex = m_transfer_queue_family;
+    barrier.dstQueueFamilyIndex = m_graphics_queue_family;
+    barrier.buffer              = dst->handle();
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
 
-        vkEndCommandBuffer(m_cmd->handle());
+    record_barrier(m_recording_transfer_cmd, &barrier, nullptr);
 
-        backend->flush_graphics({ m_cmd });
+    // ...and acquire it on the graphics queue.
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask = VK_ACCESS_2_NONE;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
 
-        blas_scratch_buffer.reset();
-    }
+    record_barrier(command_buffer(), &barrier, nullptr);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BatchUploader::add_staging_buffer(const size_t& size)
+void StagingRingBuffer::copy_image(const Allocation& src, Image* dst, const std::vector<VkBufferImageCopy>& regions, VkImageSubresourceRange range, VkImageLayout dst_layout)
 {
-    if (!m_backend.expired())
+    const VkImageLayout old_layout = current_layout(dst, range);
+
+    // An image that has left the undefined layout may be in use by the graphics queue. Updating it there orders the copy after
+    // those uses and keeps the rest of its contents from having to change queue family ownership.
+    if (!m_async_transfer || old_layout != VK_IMAGE_LAYOUT_UNDEFINED)
     {
-        auto backend = m_backend.lock();
-        m_staging_buffers.push(StagingBuffer::create(backend, size));
-    }
+        auto cmd_buf = command_buffer();
+
+        // The barriers are recorded here rather than through use_resource(), which would update the tracked state before the
+        // copy is submitted. Earlier uses of the image are on the same queue, so waiting on all commands covers them.
+        VkImageMemoryBarrier2 barrier = {};
+
+        barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask        = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.srcAccessMask       = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        barrier.dstStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+        barrier.dstAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout           = old_layout;
+        barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image               = dst->handle();
+        barrier.subresourceRange    = range;
+
+        record_barrier(cmd_buf, nullptr, &barrier);
+
+        vkCmdCopyBufferToImage(cmd_buf->handle(), src.buffer->handle(), dst->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+
+        barrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = dst_layout;
+
+        record_barrier(cmd_buf, nullptr, &barrier);
+
+        m_pending_states.push_back({ dst, range, dst_layout });
+
+        return;
+    }
+
+    auto transfer_cmd_buf = transfer_command_buffer();
+
+    VkImageMemoryBarrier2 barrier = {};
+
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcStageMask        = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask       = VK_ACCESS_2_NONE;
+    barrier.dstStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+    barrier.dstAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.oldLayout           = old_layout;
+    barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = dst->handle();
+    barrier.subresourceRange    = range;
+
+    record_barrier(transfer_cmd_buf, nullptr, &barrier);
+
+    vkCmdCopyBufferToImage(transfer_cmd_buf->handle(), src.buffer->handle(), dst->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+
+    // The layout transition is part of the ownership transfer, so the release and the acquire have to specify the same layouts.
+    barrier.srcStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+    barrier.srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask        = VK_PIPELINE_STAGE_2_NONE;
+    barrier.dstAccessMask       = VK_ACCESS_2_NONE;
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout           = dst_layout;
+    barrier.srcQueueFamilyIndex = m_transfer_queue_family;
+    barrier.dstQueueFamilyIndex = m_graphics_queue_family;
+
+    record_barrier(transfer_cmd_buf, nullptr, &barrier);
+
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask = VK_ACCESS_2_NONE;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+
+    record_barrier(command_buffer(), nullptr, &barrier);
+
+    m_pending_states.push_back({ dst, range, dst_layout });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void StagingRingBuffer::generate_mipmaps(Image* image, VkImageLayout dst_layout, VkImageAspectFlags aspect_flags, VkFilter filter)
+{
+    if (image->mip_levels() <= 1)
+        return;
+
+    auto cmd_buf = command_buffer();
+
+    VkImageMemoryBarrier2 barrier = {};
+
+    barrier.sType                       = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                       = image->handle();
+    barrier.subresourceRange.aspectMask = aspect_flags;
+    barrier.subresourceRange.layerCount = 1;
+
+    for (uint32_t arr_idx = 0; arr_idx < image->array_size(); arr_idx++)
+    {
+        barrier.subresourceRange.baseArrayLayer = arr_idx;
+
+        // The first level is the source of the chain, the others are overwritten entirely.
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount   = 1;
+        barrier.srcStageMask                  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.srcAccessMask                 = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        barrier.dstStageMask                  = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+        barrier.dstAccessMask                 = VK_ACCESS_2_TRANSFER_READ_BIT;
+        barrier.oldLayout                     = current_layout(image, barrier.subresourceRange);
+        barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        record_barrier(cmd_buf, nullptr, &barrier);
+
+        barrier.subresourceRange.baseMipLevel = 1;
+        barrier.subresourceRange.levelCount   = image->mip_levels() - 1;
+        barrier.dstAccessMask                 = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout                     = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+        record_barrier(cmd_buf, nullptr, &barrier);
+
+        int32_t mip_width  = image->width();
+        int32_t mip_height = image->height();
+
+        barrier.subresourceRange.levelCount = 1;
+
+        for (uint32_t mip_idx = 1; mip_idx < image->mip_levels(); mip_idx++)
+        {
+            VkImageBlit blit                   = {};
+            blit.srcOffsets[0]                 = { 0, 0, 0 };
+            blit.srcOffsets[1]                 = { mip_width, mip_height, 1 };
+            blit.srcSubresource.aspectMask     = aspect_flags;
+            blit.srcSubresource.mipLevel       = mip_idx - 1;
+            blit.srcSubresource.baseArrayLayer = arr_idx;
+            blit.srcSubresource.layerCount     = 1;
+            blit.dstOffsets[0]                 = { 0, 0, 0 };
+            blit.dstOffsets[1]                 = { mip_width > 1 ? mip_width / 2 : 1, mip_height > 1 ? mip_height / 2 : 1, 1 };
+            blit.dstSubresource.aspectMask     = aspect_flags;
+            blit.dstSubresource.mipLevel       = mip_idx;
+            blit.dstSubresource.baseArrayLayer = arr_idx;
+            blit.dstSubresource.layerCount     = 1;
+
+            vkCmdBlitImage(cmd_buf->handle(), image->handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+
+            // The source level is done...
+            barrier.subresourceRange.baseMipLevel = mip_idx - 1;
+            barrier.srcStageMask                  = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+            barrier.srcAccessMask                 = VK_ACCESS_2_TRANSFER_READ_BIT;
+            barrier.dstStageMask                  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            barrier.dstAccessMask                 = VK_ACCESS_2_SHADER_READ_BIT;
+            barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout                     = dst_layout;
+
+            record_barrier(cmd_buf, nullptr, &barrier);
+
+            // ...and the level just written is the source of the next blit, or final if it is the last one.
+            const bool last = mip_idx == image->mip_levels() - 1;
+
+            barrier.subresourceRange.baseMipLevel = mip_idx;
+            barrier.srcAccessMask                 = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            barrier.dstStageMask                  = last ? VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+            barrier.dstAccessMask                 = last ? VK_ACCESS_2_SHADER_READ_BIT : VK_ACCESS_2_TRANSFER_READ_BIT;
+            barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout                     = last ? dst_layout : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+            record_barrier(cmd_buf, nullptr, &barrier);
+
+            if (mip_width > 1) mip_width /= 2;
+            if (mip_height > 1) mip_height /= 2;
+        }
+    }
+
+    VkImageSubresourceRange range;
+    DW_ZERO_MEMORY(range);
+
+    range.aspectMask = aspect_flags;
+    range.levelCount = image->mip_levels();
+    range.layerCount = image->array_size();
+
+    m_pending_states.push_back({ image, range, dst_layout });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void StagingRingBuffer::discard_pending_states(Image* image)
+{
+    m_pending_states.erase(std::remove_if(m_pending_states.begin(), m_pending_states.end(), [image](const PendingState& state) { return state.image == image; }), m_pending_states.end());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool range_contains(const VkImageSubresourceRange& outer, const VkImageSubresourceRange& inner)
+{
+    return inner.baseMipLevel >= outer.baseMipLevel && inner.baseMipLevel + inner.levelCount <= outer.baseMipLevel + outer.levelCount && inner.baseArrayLayer >= outer.baseArrayLayer && inner.baseArrayLayer + inner.layerCount <= outer.baseArrayLayer + outer.layerCount;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkImageLayout StagingRingBuffer::current_layout(Image* image, VkImageSubresourceRange range)
+{
+    // Commands recorded into the ring but not submitted yet have not reached the tracker, the latest one covering the range wins.
+    for (auto it = m_pending_states.rbegin(); it != m_pending_states.rend(); it++)
+    {
+        if (it->image == image && range_contains(it->range, range))
+            return it->layout;
+    }
+
+    return m_backend.lock()->tracked_layout(image, range);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void StagingRingBuffer::ensure_slot()
+{
+    auto       backend   = m_backend.lock();
+    Partition& partition = m_partitions[m_current_partition];
+
+    // Command buffers are reused every time the partition comes around, new ones are only created when a frame submits more
+    // often than any frame before it.
+    if (partition.num_submitted == partition.cmd_bufs.size())
+    {
+        partition.cmd_bufs.push_back(CommandBuffer::create(backend, partition.cmd_pool));
+        partition.tickets.push_back(Ticket());
+        partition.submit_times.push_back(Clock::now());
+
+        if (m_async_transfer)
+            partition.transfer_cmd_bufs.push_back(CommandBuffer::create(backend, partition.transfer_cmd_pool));
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CommandBuffer::Ptr StagingRingBuffer::command_buffer()
+{
+    if (!m_recording_cmd)
+    {
+        ensure_slot();
+
+        Partition& partition = m_partitions[m_current_partition];
+
+        m_recording_cmd = partition.cmd_bufs[partition.num_submitted];
+
+        VkCommandBufferBeginInfo begin_info;
+        DW_ZERO_MEMORY(begin_info);
+
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(m_recording_cmd->handle(), &begin_info);
+    }
+
+    return m_recording_cmd;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CommandBuffer::Ptr StagingRingBuffer::transfer_command_buffer()
+{
+    if (!m_recording_transfer_cmd)
+    {
+        ensure_slot();
+
+        Partition& partition = m_partitions[m_current_partition];
+
+        m_recording_transfer_cmd = partition.transfer_cmd_bufs[partition.num_submitted];
+
+        VkCommandBufferBeginInfo begin_info;
+        DW_ZERO_MEMORY(begin_info);
+
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(m_recording_transfer_cmd->handle(), &begin_info);
+    }
+
+    return m_recording_transfer_cmd;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Ticket StagingRingBuffer::flush(bool wait)
+{
+    // The ring submits through the backend, which flushes the ring first.
+    if (m_flushing)
+        return Ticket();
+
+    auto backend = m_backend.lock();
+
+    if (m_recording_cmd || m_recording_transfer_cmd)
+    {
+        Partition& partition = m_partitions[m_current_partition];
+        uint32_t   slot      = partition.num_submitted;
+
+        m_flushing = true;
+
+        std::vector<Ticket> wait_tickets;
+
+        if (m_recording_transfer_cmd)
+        {
+            std::vector<Ticket> transfer_wait_tickets;
+
+            // Every graphics submission made before the copies were recorded has been submitted by now, so the last one covers
+            // every earlier use of their destinations. Later graphics submissions wait for the upload ticket.
+            if (m_transfer_waits)
+            {
+                Ticket last_use;
+
+                last_use.queue = QUEUE_TYPE_GRAPHICS;
+                last_use.value = backend->submitted_value(QUEUE_TYPE_GRAPHICS);
+
+                transfer_wait_tickets.push_back(last_use);
+            }
+
+            vkEndCommandBuffer(m_recording_transfer_cmd->handle());
+
+            wait_tickets.push_back(backend->submit_transfer({ m_recording_transfer_cmd }, {}, {}, nullptr, transfer_wait_tickets));
+
+            m_transfer_waits = false;
+        }
+
+        // The graphics submission always follows, it acquires the copy destinations and its ticket covers the whole upload.
+        auto cmd_buf = command_buffer();
+
+        // Make every copy visible to whatever consumes the resources afterwards.
+        backend->memory_barrier(cmd_buf, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT);
+
+        vkEndCommandBuffer(cmd_buf->handle());
+
+        m_last_ticket = backend->submit_graphics({ cmd_buf }, {}, {}, nullptr, wait_tickets);
+
+        // Now that the transitions are on the queue the tracker can see them.
+        for (const auto& state : m_pending_states)
+            backend->track_resource(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_SHADER_READ_BIT, state.layout, state.image, state.range);
+
+        for (auto& buffer : m_dedicated_recording)
+            m_dedicated_in_flight.push_back({ buffer, m_last_ticket });
+
+        m_pending_states.clear();
+        m_dedicated_recording.clear();
+
+        partition.tickets[slot]      = m_last_ticket;
+        partition.submit_times[slot] = Clock::now();
+        partition.num_submitted++;
+
+        m_recording_cmd.reset();
+        m_recording_transfer_cmd.reset();
+        m_pending_stats.frame_submissions++;
+
+        m_flushing = false;
+    }
+
+    if (wait)
+        backend->wait(m_last_ticket);
+
+    return m_last_ticket;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void StagingRingBuffer::next_frame()
+{
+    flush();
+    poll_completion();
+
+    m_stats                    = m_pending_stats;
+    m_stats.average_latency_ms = m_latency_samples > 0 ? m_latency_total_ms / double(m_latency_samples) : 0.0;
+
+    m_pending_stats.frame_bytes           = 0;
+    m_pending_stats.frame_dedicated_bytes = 0;
+    m_pending_stats.frame_uploads         = 0;
+    m_pending_stats.frame_submissions     = 0;
+
+    m_current_partition = (m_current_partition + 1) % m_partitions.size();
+
+    retire(m_partitions[m_current_partition]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void StagingRingBuffer::retire(Partition& partition)
+{
+    auto backend = m_backend.lock();
+
+    if (partition.num_submitted > 0)
+    {
+        // Submissions complete in order, so the last one of the partition covers all of them.
+        const Ticket& last_ticket = partition.tickets[partition.num_submitted - 1];
+
+        // The GPU has fallen a full ring behind, this is the only place where uploading can stall.
+        if (!backend->is_complete(last_ticket))
+        {
+            auto start = Clock::now();
+
+            backend->wait(last_ticket);
+
+            m_pending_stats.wait_count++;
+            m_pending_stats.wait_time_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        poll_completion();
+
+        partition.cmd_pool->reset();
+
+        if (partition.transfer_cmd_pool)
+            partition.transfer_cmd_pool->reset();
+    }
+
+    partition.head          = partition.begin;
+    partition.num_submitted = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void StagingRingBuffer::poll_completion()
+{
+    auto backend   = m_backend.lock();
+    auto now       = Clock::now();
+    auto completed = backend->completed_value(QUEUE_TYPE_GRAPHICS);
+
+    for (auto& partition : m_partitions)
+    {
+        for (uint32_t i = 0; i < partition.num_submitted; i++)
+        {
+            if (partition.tickets[i].value > m_sampled_value && partition.tickets[i].value <= completed)
+            {
+                m_latency_total_ms += std::chrono::duration<double, std::milli>(now - partition.submit_times[i]).count();
+                m_latency_samples++;
+            }
+        }
+    }
+
+    m_sampled_value = std::max(m_sampled_value, completed);
+
+    // Dedicated buffers whose copies have executed become available to later overflows.
+    for (uint32_t i = 0; i < m_dedicated_in_flight.size();)
+    {
+        if (m_dedicated_in_flight[i].ticket.value <= completed)
+        {
+            m_dedicated_free.push_back(m_dedicated_in_flight[i].buffer);
+            m_dedicated_in_flight[i] = m_dedicated_in_flight.back();
+            m_dedicated_in_flight.pop_back();
+        }
+        else
+            i++;
+    }
+
+    if (m_dedicated_free.size() > kMaxFreeDedicatedBuffers)
+        m_dedicated_free.erase(m_dedicated_free.begin(), m_dedicated_free.begin() + (m_dedicated_free.size() - kMaxFreeDedicatedBuffers));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameAllocator::Ptr FrameAllocator::create(Backend::Ptr backend, size_t page_size, uint32_t frame_count)
+{
+    return std::shared_ptr<FrameAllocator>(new FrameAllocator(backend, page_size, frame_count));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameAllocator::FrameAllocator(Backend::Ptr backend, size_t page_size, uint32_t frame_count) :
+    m_backend(backend), m_page_size(page_size)
+{
+    const VkPhysicalDeviceLimits& limits = backend->physical_device_properties().limits;
+
+    m_min_alignment = std::max<size_t>(std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment), 16);
+
+    m_frames.resize(frame_count);
+
+    // The first page of every frame is created up front, most frames never need a second one.
+    for (auto& frame : m_frames)
+        add_page(frame, m_page_size);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameAllocator::~FrameAllocator()
+{
+    m_frames.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameAllocator::Allocation FrameAllocator::allocate(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Frame& frame = m_frames[m_current_frame];
+
+    // First allocation since the frame came around again. Normally the application has already waited for the frame, in
+    // which case this doesn't block.
+    if (!frame.retired)
+    {
+        auto backend = m_backend.lock();
+
+        for (int i = 0; i < QUEUE_TYPE_COUNT; i++)
+        {
+            Ticket ticket;
+
+            ticket.queue = (QueueType)i;
+            ticket.value = frame.retire_values[i];
+
+            backend->wait(ticket);
+        }
+
+        frame.current_page = 0;
+        frame.head         = 0;
+        frame.retired      = true;
+    }
+
+    if (alignment == 0)
+        alignment = m_min_alignment;
+
+    size_t offset = ((frame.head + alignment - 1) / alignment) * alignment;
+
+    // Move on to the next page that fits, pages added in earlier frames are reused before new ones are created.
+    while (offset + size > frame.pages[frame.current_page].size)
+    {
+        frame.current_page++;
+        offset = 0;
+
+        if (frame.current_page == frame.pages.size())
+            add_page(frame, size);
+    }
+
+    const Page& page = frame.pages[frame.current_page];
+
+    frame.head = offset + size;
+
+    Allocation allocation;
+
+    allocation.buffer     = page.buffer;
+    allocation.offset     = offset;
+    allocation.mapped_ptr = page.mapped_ptr + offset;
+
+    m_pending_stats.frame_bytes += size;
+    m_pending_stats.frame_allocations++;
+
+    return allocation;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameAllocator::Allocation FrameAllocator::upload(const void* data, size_t size, size_t alignment)
+{
+    Allocation allocation = allocate(size, alignment);
+
+    memcpy(allocation.mapped_ptr, data, size);
+
+    return allocation;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameAllocator::next_frame(const uint64_t* retire_values)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Frame& frame = m_frames[m_current_frame];
+
+    for (int i = 0; i < QUEUE_TYPE_COUNT; i++)
+        frame.retire_values[i] = retire_values[i];
+
+    frame.retired = false;
+
+    m_pending_stats.page_count = 0;
+    m_pending_stats.capacity   = 0;
+
+    for (const auto& f : m_frames)
+    {
+        m_pending_stats.page_count += f.pages.size();
+
+        for (const auto& page : f.pages)
+            m_pending_stats.capacity += page.size;
+    }
+
+    m_stats         = m_pending_stats;
+    m_pending_stats = Stats();
+
+    m_current_frame = (m_current_frame + 1) % m_frames.size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameAllocator::add_page(Frame& frame, size_t min_size)
+{
+    auto backend = m_backend.lock();
+
+    Page page;
+
+    page.size       = std::max(m_page_size, min_size);
+    page.buffer     = Buffer::create(backend, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, page.size, VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    page.mapped_ptr = (uint8_t*)page.buffer->mapped_ptr();
+
+    page.buffer->set_name("Frame Allocator Page " + std::to_string(&frame - &m_frames[0]) + "." + std::to_string(frame.pages.size()));
+
+    frame.pages.push_back(page);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BatchUploader::BatchUploader(Backend::Ptr backend) :
+    m_backend(backend)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BatchUploader::~BatchUploader()
+{
+    wait();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::upload_buffer_data(Buffer::Ptr buffer, void* data, const size_t& offset, const size_t& size)
+{
+    if (!m_backend.expired())
+    {
+        auto backend = m_backend.lock();
+        auto ring    = backend->staging_ring();
+
+        auto staging = ring->stage(data, size);
+
+        ring->copy_buffer(staging, buffer.get(), offset, size);
+
+        m_upload_count++;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::upload_image_data(Image::Ptr image, void* data, const std::vector<size_t>& mip_level_sizes, VkImageLayout dst_layout)
+{
+    if (!m_backend.expired())
+    {
+        auto backend = m_backend.lock();
+        auto ring    = backend->staging_ring();
+
+        size_t size = 0;
+
+        for (const auto& region_size : mip_level_sizes)
+            size += region_size;
+
+        // 16 bytes satisfies the buffer-to-image copy offset requirements of every uncompressed format in use.
+        auto   staging = ring->stage(data, size, 16);
+        size_t offset  = staging.offset;
+
+        std::vector<VkBufferImageCopy> copy_regions;
+        uint32_t                       region_idx = 0;
+        uint32_t                       mip_levels = std::min(image->mip_levels(), uint32_t(mip_level_sizes.size() / image->array_size()));
+
+        for (int array_idx = 0; array_idx < image->array_size(); array_idx++)
+        {
+            int width  = image->width();
+            int height = image->height();
+
+            for (int i = 0; i < mip_levels; i++)
+            {
+                VkBufferImageCopy buffer_copy_region;
+                DW_ZERO_MEMORY(buffer_copy_region);
+
+                buffer_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+                buffer_copy_region.imageSubresource.mipLevel       = i;
+                buffer_copy_region.imageSubresource.baseArrayLayer = array_idx;
+                buffer_copy_region.imageSubresource.layerCount     = 1;
+                buffer_copy_region.imageExtent.width               = width;
+                buffer_copy_region.imageExtent.height              = height;
+                buffer_copy_region.imageExtent.depth               = 1;
+                buffer_copy_region.bufferOffset                    = offset;
+
+                copy_regions.push_back(buffer_copy_region);
+
+                width  = std::max(1, width / 2);
+                height = std::max(1, (height / 2));
+
+                offset += mip_level_sizes[region_idx++];
+            }
+        }
+
+        VkImageSubresourceRange subresource_range;
+        DW_ZERO_MEMORY(subresource_range);
+
+        subresource_range.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresource_range.baseMipLevel   = 0;
+        subresource_range.levelCount     = image->mip_levels();
+        subresource_range.layerCount     = image->array_size();
+        subresource_range.baseArrayLayer = 0;
+
+        // Copy mip levels from staging buffer
+        ring->copy_image(staging, image.get(), copy_regions, subresource_range, dst_layout);
+
+        m_upload_count++;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::generate_mipmaps(Image::Ptr image, VkImageLayout dst_layout, VkImageAspectFlags aspect_flags, VkFilter filter)
+{
+    if (!m_backend.expired() && image->mip_levels() > 1)
+    {
+        auto backend = m_backend.lock();
+        backend->staging_ring()->generate_mipmaps(image.get(), dst_layout, aspect_flags, filter);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::build_blas(AccelerationStructure::Ptr acceleration_structure, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR> build_ranges)
+{
+    if (geometries.size() > 0 || build_ranges.size() > 0)
+        m_blas_build_requests.push_back({ acceleration_structure, geometries, build_ranges });
+    else
+    {
+        DW_LOG_FATAL("(Vulkan) Building a BLAS requires one or more Geometry and Build Offset structures.");
+        throw std::runtime_error("(Vulkan) Building a BLAS requires one or more Geometry and Build Offset structures.");
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::record_blas_builds(CommandBuffer::Ptr cmd)
+{
+    auto backend = m_backend.lock();
+
+    // Geometry uploaded earlier in this batch has to land before it is read by the builds.
+    if (m_upload_count > 0)
+        backend->memory_barrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+
+    const VkAccessFlags2 build_access = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+
+    const uint32_t     build_count       = m_blas_build_requests.size();
+    const VkDeviceSize scratch_alignment = backend->acceleration_structure_properties().minAccelerationStructureScratchOffsetAlignment;
+
+    // Every build gets its own range of a shared scratch arena, so independent builds can run concurrently. Once the arena is
+    // full the remaining builds start a new group that reuses it from the beginning.
+    std::vector<VkDeviceSize> scratch_offsets(build_count);
+    std::vector<uint32_t>     group_ends;
+    VkDeviceSize              group_size = 0;
+    VkDeviceSize              arena_size = 0;
+
+    for (uint32_t i = 0; i < build_count; i++)
+    {
+        const VkDeviceSize scratch_size = ((m_blas_build_requests[i].acceleration_structure->build_sizes().buildScratchSize + scratch_alignment - 1) / scratch_alignment) * scratch_alignment;
+
+        if (group_size > 0 && group_size + scratch_size > kMaxBLASScratchArenaSize)
+        {
+            group_ends.push_back(i);
+            group_size = 0;
+        }
+
+        scratch_offsets[i] = group_size;
+        group_size += scratch_size;
+        arena_size = std::max(arena_size, group_size);
+    }
+
+    group_ends.push_back(build_count);
+
+    m_blas_scratch_buffer = vk::Buffer::create_with_alignment(backend, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, arena_size, scratch_alignment, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    m_blas_scratch_buffer->set_name("BLAS Scratch Arena");
+
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR>     build_infos(build_count);
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> build_ranges(build_count);
+
+    for (uint32_t i = 0; i < build_count; i++)
+    {
+        BLASBuildRequest&                            request    = m_blas_build_requests[i];
+        VkAccelerationStructureBuildGeometryInfoKHR& build_info = build_infos[i];
+
+        DW_ZERO_MEMORY(build_info);
+
+        build_info.sType                     = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+        build_info.type                      = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+        build_info.flags                     = request.acceleration_structure->flags();
+        build_info.mode                      = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+        build_info.srcAccelerationStructure  = VK_NULL_HANDLE;
+        build_info.dstAccelerationStructure  = request.acceleration_structure->handle();
+        build_info.geometryCount             = (uint32_t)request.geometries.size();
+        build_info.pGeometries               = request.geometries.data();
+        build_info.scratchData.deviceAddress = m_blas_scratch_buffer->device_address() + scratch_offsets[i];
+
+        build_ranges[i] = request.build_ranges.data();
+
+        if (request.acceleration_structure->flags() & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR)
+            m_compaction_requests.push_back(request.acceleration_structure);
+    }
+
+    uint32_t group_begin = 0;
+
+    for (uint32_t group_end : group_ends)
+    {
+        // The previous group has to finish with the scratch arena before it is reused.
+        if (group_begin > 0)
+            backend->memory_barrier(cmd, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, build_access, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, build_access);
+
+        vkCmdBuildAccelerationStructuresKHR(cmd->handle(), group_end - group_begin, &build_infos[group_begin], &build_ranges[group_begin]);
+
+        group_begin = group_end;
+    }
+
+    // Makes the results visible to the compaction queries and to TLAS builds submitted later.
+    backend->memory_barrier(cmd, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, build_access, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, build_access);
+
+    if (m_compaction_requests.size() > 0)
+    {
+        std::vector<VkAccelerationStructureKHR> handles;
+
+        for (auto& acceleration_structure : m_compaction_requests)
+            handles.push_back(acceleration_structure->handle());
+
+        m_compaction_query_pool = QueryPool::create(backend, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, handles.size());
+
+        vkCmdResetQueryPool(cmd->handle(), m_compaction_query_pool->handle(), 0, handles.size());
+        vkCmdWriteAccelerationStructuresPropertiesKHR(cmd->handle(), handles.size(), handles.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, m_compaction_query_pool->handle(), 0);
+    }
+
+    m_blas_stats.build_count += build_count;
+    m_blas_stats.build_groups += group_ends.size();
+    m_blas_stats.scratch_bytes = std::max(m_blas_stats.scratch_bytes, arena_size);
+
+    m_blas_build_requests.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::record_blas_compaction(CommandBuffer::Ptr cmd)
+{
+    auto backend = m_backend.lock();
+
+    std::vector<VkDeviceSize> compacted_sizes(m_compaction_requests.size(), 0);
+
+    m_compaction_query_pool->results(0, compacted_sizes.size(), compacted_sizes.size() * sizeof(VkDeviceSize), compacted_sizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+    VkDeviceSize original_bytes  = 0;
+    VkDeviceSize compacted_bytes = 0;
+    uint32_t     compacted_count = 0;
+
+    for (uint32_t i = 0; i < m_compaction_requests.size(); i++)
+    {
+        AccelerationStructure::Ptr acceleration_structure = m_compaction_requests[i];
+
+        if (compacted_sizes[i] == 0 || compacted_sizes[i] >= acceleration_structure->info().size)
+            continue;
+
+        AccelerationStructure::Desc desc;
+
+        desc.set_type(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR);
+        desc.set_flags(acceleration_structure->flags());
+        desc.set_compacted_size(compacted_sizes[i]);
+
+        AccelerationStructure::Ptr compacted = AccelerationStructure::create(backend, desc);
+
+        VkCopyAccelerationStructureInfoKHR copy_info;
+        DW_ZERO_MEMORY(copy_info);
+
+        copy_info.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+        copy_info.src   = acceleration_structure->handle();
+        copy_info.dst   = compacted->handle();
+        copy_info.mode  = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+
+        vkCmdCopyAccelerationStructureKHR(cmd->handle(), &copy_info);
+
+        original_bytes += acceleration_structure->info().size;
+        compacted_bytes += compacted_sizes[i];
+        compacted_count++;
+
+        // The original structure now belongs to the temporary object and goes through the deletion queue with it, after the
+        // copy has executed.
+        acceleration_structure->swap(*compacted);
+    }
+
+    if (compacted_count > 0)
+        backend->memory_barrier(cmd, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+
+    m_blas_stats.compacted_count += compacted_count;
+    m_blas_stats.original_bytes += original_bytes;
+    m_blas_stats.compacted_bytes += compacted_bytes;
+
+    if (compacted_count > 0)
+        DW_LOG_INFO("(Vulkan) Compacted " + std::to_string(compacted_count) + " BLAS: " + std::to_string(original_bytes / 1024) + " KB -> " + std::to_string(compacted_bytes / 1024) + " KB");
+
+    m_compaction_requests.clear();
+    m_compaction_query_pool.reset();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::submit()
+{
+    submit_async();
+    wait();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Ticket BatchUploader::submit_async()
+{
+    if (!m_backend.expired())
+    {
+        auto backend = m_backend.lock();
+        auto ring    = backend->staging_ring();
+
+        // Compactions of an earlier submission use the same query pool, so they have to be recorded first.
+        if (m_compaction_requests.size() > 0)
+            submit_compaction(true);
+
+        // A scratch buffer still used by an earlier submission is released through the deletion queue, which waits for it.
+        if (m_blas_build_requests.size() > 0)
+            record_blas_builds(ring->command_buffer());
+
+        m_ticket  = ring->flush();
+        m_pending = true;
+    }
+
+    return m_ticket;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The compacted sizes are only known once the builds have executed, so the copies go into a submission of their own. Returns
+// false without recording anything if the builds are still running and waiting wasn't requested.
+bool BatchUploader::submit_compaction(bool wait)
+{
+    auto backend = m_backend.lock();
+
+    if (!wait && !backend->is_complete(m_ticket))
+        return false;
+
+    backend->wait(m_ticket);
+
+    auto ring = backend->staging_ring();
+
+    record_blas_compaction(ring->command_buffer());
+
+    m_ticket = ring->flush();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BatchUploader::is_complete()
+{
+    if (!m_pending || m_backend.expired())
+        return true;
+
+    if (m_compaction_requests.size() > 0 && !submit_compaction(false))
+        return false;
+
+    auto backend = m_backend.lock();
+
+    return backend->is_complete(m_ticket);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BatchUploader::wait()
+{
+    if (!m_pending || m_backend.expired())
+        return;
+
+    if (m_compaction_requests.size() > 0)
+        submit_compaction(true);
+
+    auto backend = m_backend.lock();
+
+    backend->wait(m_ticket);
+
+    m_blas_scratch_buffer.reset();
+
+    m_pending = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Backend::Ptr Backend::create(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enable_validation_layers, bool enable_nsight_aftermath, bool require_ray_tracing, std::vector<const char*> additional_device_extensions, std::string pipeline_cache_path, uint32_t frames_in_flight)
+{
+    std::shared_ptr<Backend> backend = std::shared_ptr<Backend>(new Backend(window, { 0, 0 }, vsync, srgb_swapchain, enable_validation_layers, enable_nsight_aftermath, require_ray_tracing, additional_device_extensions, pipeline_cache_path, frames_in_flight));
+    backend->initialize();
+
+    return backend;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Backend::Ptr Backend::create(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enable_validation_layers, bool enable_nsight_aftermath, bool require_ray_tracing, std::vector<const char*> additional_device_extensions)
+Backend::Ptr Backend::create_headless(uint32_t width, uint32_t height, bool srgb_swapchain, bool enable_validation_layers, bool require_ray_tracing, std::vector<const char*> additional_device_extensions, std::string pipeline_cache_path, uint32_t frames_in_flight)
 {
-    std::shared_ptr<Backend> backend = std::shared_ptr<Backend>(new Backend(window, vsync, srgb_swapchain, enable_validation_layers, enable_nsight_aftermath, require_ray_tracing, additional_device_extensions));
+    std::shared_ptr<Backend> backend = std::shared_ptr<Backend>(new Backend(nullptr, { width, height }, false, srgb_swapchain, enable_validation_layers, false, require_ray_tracing, additional_device_extensions, pipeline_cache_path, frames_in_flight));
     backend->initialize();
 
     return backend;
@@ -3201,10 +5539,15 @@ Backend::Ptr Backend::create(GLFWwindow* window, bool vsync, bool srgb_swapchain
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-Backend::Backend(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enable_validation_layers, bool enable_nsight_aftermath, bool require_ray_tracing, std::vector<const char*> additional_device_extensions) :
-    m_vsync(vsync), m_srgb_swapchain(srgb_swapchain), m_window(window)
+Backend::Backend(GLFWwindow* window, VkExtent2D headless_extent, bool vsync, bool srgb_swapchain, bool enable_validation_layers, bool enable_nsight_aftermath, bool require_ray_tracing, std::vector<const char*> additional_device_extensions, std::string pipeline_cache_path, uint32_t frames_in_flight) :
+    m_vsync(vsync), m_srgb_swapchain(srgb_swapchain), m_window(window), m_pipeline_cache_path(pipeline_cache_path)
 {
     m_ray_tracing_enabled = require_ray_tracing;
+    m_headless            = window == nullptr;
+    m_frames_in_flight    = std::min(std::max(frames_in_flight, 1u), kMaxFramesInFlight);
+
+    if (m_headless)
+        m_swap_chain_extent = headless_extent;
 
     if (volkInitialize() != VK_SUCCESS)
     {
@@ -3280,13 +5623,16 @@ Backend::Backend(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enabl
     if (enable_validation_layers && create_debug_utils_messenger(m_vk_instance, &debug_create_info, nullptr, &m_vk_debug_messenger) != VK_SUCCESS)
         DW_LOG_FATAL("(Vulkan) Failed to create Vulkan debug messenger.");
 
-    if (!create_surface(window))
+    if (!m_headless && !create_surface(window))
     {
         DW_LOG_FATAL("(Vulkan) Failed to create Vulkan surface.");
         throw std::runtime_error("(Vulkan) Failed to create Vulkan surface.");
     }
 
-    std::vector<const char*> device_extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    std::vector<const char*> device_extensions;
+
+    if (!m_headless)
+        device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
     if (require_ray_tracing)
     {
@@ -3317,6 +5663,57 @@ Backend::Backend(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enabl
         throw std::runtime_error("(Vulkan) Failed to find a suitable GPU.");
     }
 
+    // Not needed to present when headless, but enabled when available so that the offscreen images can be moved into the
+    // present layout just like swap chain images.
+    if (m_headless && check_device_extension_support(m_vk_physical_device, { VK_KHR_SWAPCHAIN_EXTENSION_NAME }))
+        device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+    // Optional, lets VMA report the budgets the driver actually grants instead of an estimate.
+    m_memory_budget_supported = check_device_extension_support(m_vk_physical_device, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+
+    if (m_memory_budget_supported)
+        device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // Optional, writes per-draw descriptors straight into the command buffer instead of allocating sets for them.
+    m_push_descriptors_supported = check_device_extension_support(m_vk_physical_device, { VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME });
+
+    if (m_push_descriptors_supported)
+        device_extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+
+    // Optional, lets the CPU wait until a frame is displayed and measure the latency of a frame.
+    m_present_wait_supported = !m_headless && check_device_extension_support(m_vk_physical_device, { VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME });
+
+    // Drivers may advertise the extensions without supporting the features, enabling them anyway fails device creation.
+    if (m_present_wait_supported)
+    {
+        VkPhysicalDevicePresentIdFeaturesKHR present_id_features;
+        DW_ZERO_MEMORY(present_id_features);
+
+        present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+
+        VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features;
+        DW_ZERO_MEMORY(present_wait_features);
+
+        present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        present_wait_features.pNext = &present_id_features;
+
+        VkPhysicalDeviceFeatures2 features;
+        DW_ZERO_MEMORY(features);
+
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &present_wait_features;
+
+        vkGetPhysicalDeviceFeatures2(m_vk_physical_device, &features);
+
+        m_present_wait_supported = present_id_features.presentId == VK_TRUE && present_wait_features.presentWait == VK_TRUE;
+    }
+
+    if (m_present_wait_supported)
+    {
+        device_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        device_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+
     if (!create_logical_device(device_extensions, require_ray_tracing, enable_nsight_aftermath))
     {
         DW_LOG_FATAL("(Vulkan) Failed to create logical device.");
@@ -3335,6 +5732,9 @@ Backend::Backend(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enabl
     allocator_info.instance               = m_vk_instance;
     allocator_info.pVulkanFunctions       = (const VmaVulkanFunctions*)&vulkan_functions;
 
+    if (m_memory_budget_supported)
+        allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
     if (vmaCreateAllocator(&allocator_info, &m_vma_allocator) != VK_SUCCESS)
     {
         DW_LOG_FATAL("(Vulkan) Failed to create Allocator.");
@@ -3343,14 +5743,33 @@ Backend::Backend(GLFWwindow* window, bool vsync, bool srgb_swapchain, bool enabl
 
     m_buffer_memory_barriers.reserve(256);
     m_image_memory_barriers.reserve(256);
+    m_resource_states.reserve(4096);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 Backend::~Backend()
 {
-    m_image_usage_info.clear();
-    m_buffer_usage_info.clear();
+    // Finish any queued compiles so that their results make it into the saved cache. Someone else may still hold the compiler,
+    // so stop its workers explicitly rather than relying on the reset.
+    if (m_pipeline_compiler)
+    {
+        m_pipeline_compiler->wait_all();
+        m_pipeline_compiler->shutdown();
+        m_pipeline_compiler.reset();
+    }
+
+    vkDeviceWaitIdle(m_vk_device);
+
+    flush_deletion_queue();
+
+    save_pipeline_cache();
+
+    if (m_vk_pipeline_cache)
+    {
+        vkDestroyPipelineCache(m_vk_device, m_vk_pipeline_cache, nullptr);
+        m_vk_pipeline_cache = nullptr;
+    }
 
     m_default_cubemap_image_view.reset();
     m_default_cubemap_image.reset();
@@ -3366,7 +5785,17 @@ Backend::~Backend()
     m_compute_command_pools.clear();
     m_transfer_command_pools.clear();
 
-    m_descriptor_pool.reset();
+    m_thread_command_pool_frames.clear();
+
+    m_staging_ring.reset();
+    m_frame_allocator.reset();
+    m_readback_buffers.clear();
+
+    for (int i = 0; i < QUEUE_TYPE_COUNT; i++)
+        m_timeline_semaphores[i].reset();
+
+    m_transient_descriptor_allocators.clear();
+    m_descriptor_allocator.reset();
 
     for (int i = 0; i < m_swap_chain_images.size(); i++)
         m_swap_chain_image_views[i].reset();
@@ -3417,29 +5846,50 @@ void Backend::initialize()
 {
     create_swapchain();
 
-    // Create Descriptor Pools
-    DescriptorPool::Desc dp_desc;
+    load_pipeline_cache();
 
-    dp_desc.set_max_sets(512)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 16)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4096)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1024)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1024)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 16)
-        .add_pool_size(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 32);
+    m_pipeline_compiler = PipelineCompiler::create(shared_from_this());
 
-    m_descriptor_pool = DescriptorPool::create(shared_from_this(), dp_desc);
+    // Create Descriptor Allocators. The ratios match the original fixed pool of 512 sets.
+    DescriptorAllocator::Desc da_desc;
 
-    m_graphics_command_pools.resize(m_swap_chain_images.size());
-    m_compute_command_pools.resize(m_swap_chain_images.size());
-    m_transfer_command_pools.resize(m_swap_chain_images.size());
+    da_desc.set_sets_per_pool(512)
+        .set_max_sets_per_pool(4096)
+        .set_create_flags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+        .add_pool_size_ratio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f)
+        .add_pool_size_ratio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0.03125f)
+        .add_pool_size_ratio(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8.0f)
+        .add_pool_size_ratio(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2.0f)
+        .add_pool_size_ratio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f)
+        .add_pool_size_ratio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.03125f)
+        .add_pool_size_ratio(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 0.0625f);
 
-    m_graphics_command_buffers.resize(m_swap_chain_images.size());
-    m_compute_command_buffers.resize(m_swap_chain_images.size());
-    m_transfer_command_buffers.resize(m_swap_chain_images.size());
+    m_descriptor_allocator = DescriptorAllocator::create(shared_from_this(), da_desc);
+    m_descriptor_allocator->set_name("Descriptor Allocator");
 
-    for (int i = 0; i < m_swap_chain_images.size(); i++)
+    // Transient sets are never freed individually, the whole chain is reset once the frame that used them has completed.
+    DescriptorAllocator::Desc transient_da_desc = da_desc;
+
+    transient_da_desc.set_sets_per_pool(256)
+        .set_create_flags(0);
+
+    m_transient_descriptor_allocators.resize(m_frames_in_flight);
+
+    for (int i = 0; i < m_frames_in_flight; i++)
+    {
+        m_transient_descriptor_allocators[i] = DescriptorAllocator::create(shared_from_this(), transient_da_desc);
+        m_transient_descriptor_allocators[i]->set_name("Transient Descriptor Allocator " + std::to_string(i));
+    }
+
+    m_graphics_command_pools.resize(m_frames_in_flight);
+    m_compute_command_pools.resize(m_frames_in_flight);
+    m_transfer_command_pools.resize(m_frames_in_flight);
+
+    m_graphics_command_buffers.resize(m_frames_in_flight);
+    m_compute_command_buffers.resize(m_frames_in_flight);
+    m_transfer_command_buffers.resize(m_frames_in_flight);
+
+    for (int i = 0; i < m_frames_in_flight; i++)
     {
         m_graphics_command_pools[i] = CommandPool::create(shared_from_this(), m_selected_queues.graphics_queue_index);
         m_compute_command_pools[i] = CommandPool::create(shared_from_this(), m_selected_queues.compute_queue_index);
@@ -3450,6 +5900,19 @@ void Backend::initialize()
         m_transfer_command_buffers[i] = CommandBuffer::create(shared_from_this(), m_transfer_command_pools[i]);
     }
 
+    m_thread_command_pool_frames.resize(m_frames_in_flight);
+
+    const char* queue_names[] = { "Graphics", "Compute", "Transfer" };
+
+    for (int i = 0; i < QUEUE_TYPE_COUNT; i++)
+    {
+        m_timeline_semaphores[i] = Semaphore::create(shared_from_this(), true);
+        m_timeline_semaphores[i]->set_name(std::string(queue_names[i]) + " Timeline Semaphore");
+    }
+
+    m_staging_ring    = StagingRingBuffer::create(shared_from_this(), kStagingRingPartitionSize, m_frames_in_flight);
+    m_frame_allocator = FrameAllocator::create(shared_from_this(), kFrameAllocatorPageSize, m_frames_in_flight);
+
     Sampler::Desc sampler_desc;
 
     sampler_desc.mag_filter        = VK_FILTER_LINEAR;
@@ -3598,16 +6061,199 @@ std::shared_ptr<CommandPool> Backend::transfer_command_pool()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+std::shared_ptr<CommandBuffer> Backend::allocate_thread_command_buffer(uint32_t thread_idx, bool begin)
+{
+    ThreadCommandPool* thread_pool = thread_command_pool(thread_idx);
+
+    if (thread_pool->primary_count == thread_pool->primary_cmd_bufs.size())
+        thread_pool->primary_cmd_bufs.push_back(CommandBuffer::create(shared_from_this(), thread_pool->pool));
+
+    auto cmd = thread_pool->primary_cmd_bufs[thread_pool->primary_count++];
+
+    if (begin)
+    {
+        VkCommandBufferBeginInfo begin_info;
+        DW_ZERO_MEMORY(begin_info);
+
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(cmd->handle(), &begin_info);
+    }
+
+    return cmd;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<CommandBuffer> Backend::allocate_secondary_command_buffer(uint32_t thread_idx, const CommandBufferInheritanceDesc& desc)
+{
+    ThreadCommandPool* thread_pool = thread_command_pool(thread_idx);
+
+    if (thread_pool->secondary_count == thread_pool->secondary_cmd_bufs.size())
+        thread_pool->secondary_cmd_bufs.push_back(CommandBuffer::create(shared_from_this(), thread_pool->pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+
+    auto cmd = thread_pool->secondary_cmd_bufs[thread_pool->secondary_count++];
+
+    VkCommandBufferInheritanceRenderingInfo rendering_info;
+    DW_ZERO_MEMORY(rendering_info);
+
+    VkCommandBufferInheritanceInfo inheritance_info;
+    DW_ZERO_MEMORY(inheritance_info);
+
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    VkCommandBufferBeginInfo begin_info;
+    DW_ZERO_MEMORY(begin_info);
+
+    begin_info.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    if (desc.render_pass)
+    {
+        inheritance_info.renderPass  = desc.render_pass;
+        inheritance_info.subpass     = desc.subpass;
+        inheritance_info.framebuffer = desc.framebuffer;
+
+        begin_info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+    else if (desc.color_attachment_format_count > 0 || desc.depth_attachment_format != VK_FORMAT_UNDEFINED || desc.stencil_attachment_format != VK_FORMAT_UNDEFINED)
+    {
+        // Dynamic rendering, the primary has to begin rendering with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT.
+        rendering_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        rendering_info.colorAttachmentCount    = desc.color_attachment_format_count;
+        rendering_info.pColorAttachmentFormats = &desc.color_attachment_formats[0];
+        rendering_info.depthAttachmentFormat   = desc.depth_attachment_format;
+        rendering_info.stencilAttachmentFormat = desc.stencil_attachment_format;
+        rendering_info.rasterizationSamples    = desc.samples;
+
+        inheritance_info.pNext = &rendering_info;
+
+        begin_info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+
+    vkBeginCommandBuffer(cmd->handle(), &begin_info);
+
+    return cmd;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::execute_secondary_command_buffers(const std::shared_ptr<CommandBuffer>& cmd_buf, const std::vector<std::shared_ptr<CommandBuffer>>& secondary_cmd_bufs)
+{
+    if (secondary_cmd_bufs.size() == 0)
+        return;
+
+    std::vector<VkCommandBuffer> handles(secondary_cmd_bufs.size());
+
+    for (int i = 0; i < secondary_cmd_bufs.size(); i++)
+        handles[i] = secondary_cmd_bufs[i]->handle();
+
+    vkCmdExecuteCommands(cmd_buf->handle(), handles.size(), handles.data());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t Backend::thread_command_pool_count()
+{
+    std::lock_guard<std::mutex> lock(m_thread_command_pool_mutex);
+    return m_thread_command_pool_frames[m_frame_idx % m_thread_command_pool_frames.size()].threads.size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Backend::ThreadCommandPool* Backend::thread_command_pool(uint32_t thread_idx)
+{
+    std::lock_guard<std::mutex> lock(m_thread_command_pool_mutex);
+
+    ThreadCommandPoolFrame& frame = m_thread_command_pool_frames[m_frame_idx % m_thread_command_pool_frames.size()];
+
+    // First request of the frame. Wait for the last submission made with these pools and reset all of them in bulk, which
+    // is much cheaper than resetting command buffers individually.
+    if (frame.frame_idx != m_frame_idx)
+    {
+        m_timeline_semaphores[QUEUE_TYPE_GRAPHICS]->wait(frame.retire_value);
+
+        for (auto& thread_pool : frame.threads)
+        {
+            thread_pool->pool->reset();
+            thread_pool->primary_count   = 0;
+            thread_pool->secondary_count = 0;
+        }
+
+        frame.frame_idx = m_frame_idx;
+    }
+
+    while (frame.threads.size() <= thread_idx)
+    {
+        std::unique_ptr<ThreadCommandPool> thread_pool = std::unique_ptr<ThreadCommandPool>(new ThreadCommandPool());
+
+        thread_pool->pool = CommandPool::create(shared_from_this(), m_selected_queues.graphics_queue_index);
+        thread_pool->pool->set_name("Thread " + std::to_string(frame.threads.size()) + " Command Pool (Frame " + std::to_string(m_frame_idx % m_thread_command_pool_frames.size()) + ")");
+
+        frame.threads.push_back(std::move(thread_pool));
+    }
+
+    return frame.threads[thread_idx].get();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 std::shared_ptr<DescriptorSet> Backend::allocate_descriptor_set(std::shared_ptr<DescriptorSetLayout> layout)
 {
-    return DescriptorSet::create(shared_from_this(), layout, m_descriptor_pool);
+    return m_descriptor_allocator->allocate(layout);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<DescriptorSet> Backend::allocate_transient_descriptor_set(std::shared_ptr<DescriptorSetLayout> layout)
+{
+    return transient_descriptor_allocator()->allocate(layout);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::reset_transient_descriptor_allocator()
+{
+    transient_descriptor_allocator()->reset();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<DescriptorAllocator> Backend::descriptor_allocator()
+{
+    return m_descriptor_allocator;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<DescriptorAllocator> Backend::transient_descriptor_allocator()
+{
+    return m_transient_descriptor_allocators[m_frame_idx % m_transient_descriptor_allocators.size()];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<DescriptorAllocator> Backend::transient_descriptor_allocator(uint32_t idx)
+{
+    return m_transient_descriptor_allocators[idx];
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-std::shared_ptr<DescriptorPool> Backend::descriptor_pool()
+static const VkAccessFlags2 kWriteAccessFlags = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// A transition needs no barrier when neither side writes and the earlier barrier already made the resource visible to the
+// requested stages and accesses.
+static bool is_redundant_transition(VkPipelineStageFlags2 old_stage, VkAccessFlags2 old_access, VkPipelineStageFlags2 new_stage, VkAccessFlags2 new_access)
 {
-    return m_descriptor_pool;
+    if ((old_access & kWriteAccessFlags) != 0 || (new_access & kWriteAccessFlags) != 0)
+        return false;
+
+    return (new_stage & ~old_stage) == 0 && (new_access & ~old_access) == 0;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -3618,7 +6264,7 @@ void Backend::use_resource(VkPipelineStageFlags2          _stage,
                            size_t                         _offset,
                            size_t                         _size)
 {
-    use_resource(_stage, _access, _buffer->handle(), _offset, _size);
+    use_resource(_stage, _access, _buffer.get(), _offset, _size);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -3629,7 +6275,7 @@ void Backend::use_resource(VkPipelineStageFlags2         _stage,
                            const std::shared_ptr<Image>& _image,
                            VkImageSubresourceRange       _range)
 {
-    use_resource(_stage, _access, _layout, _image->handle(), _range, _image->array_size(), _image->mip_levels());
+    use_resource(_stage, _access, _layout, _image.get(), _range);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -3637,10 +6283,8 @@ void Backend::use_resource(VkPipelineStageFlags2         _stage,
 void Backend::use_resource(VkPipelineStageFlags2   _stage,
                            VkAccessFlags2          _access,
                            VkImageLayout           _layout,
-                           VkImage                 _image,
-                           VkImageSubresourceRange _range,
-                           uint32_t                _num_layers,
-                           uint32_t                _num_levels)
+                           Image*                  _image,
+                           VkImageSubresourceRange _range)
 {
     VkImageMemoryBarrier2 barrier = {};
 
@@ -3651,146 +6295,275 @@ void Backend::use_resource(VkPipelineStageFlags2   _stage,
     barrier.dstAccessMask    = _access;
     barrier.oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED;
     barrier.newLayout        = _layout;
-    barrier.image            = _image;
+    barrier.image            = _image->handle();
     barrier.subresourceRange = _range;
 
-    ImageUsageInfo new_usage = {};
+    const uint32_t num_levels  = _image->mip_levels();
+    const uint32_t layer_count = _range.layerCount == VK_REMAINING_ARRAY_LAYERS ? _image->array_size() - _range.baseArrayLayer : _range.layerCount;
+    const uint32_t level_count = _range.levelCount == VK_REMAINING_MIP_LEVELS ? num_levels - _range.baseMipLevel : _range.levelCount;
 
-    new_usage.stage          = barrier.dstStageMask;
-    new_usage.access         = barrier.dstAccessMask;
-    new_usage.layout         = barrier.newLayout;
-    new_usage.last_frame_idx = m_frame_idx;
+    VkImageLayout first_old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bool          barrier_needed   = false;
 
-    bool is_swap_chain_image = false;
-
-    for (auto& swap_chain_image : m_swap_chain_images)
+    for (uint32_t layer_idx = 0; layer_idx < layer_count; layer_idx++)
     {
-        if (_image == swap_chain_image->handle())
+        ResourceState* states = &m_resource_states[_image->state_idx() + num_levels * (_range.baseArrayLayer + layer_idx) + _range.baseMipLevel];
+
+        for (uint32_t level_idx = 0; level_idx < level_count; level_idx++)
         {
-            is_swap_chain_image = true;
-            break;
+            const ResourceState& old_state = states[level_idx];
+
+            // Add up all the old stage masks and access masks.
+            barrier.srcStageMask |= old_state.stage;
+            barrier.srcAccessMask |= old_state.access;
+
+            // Use the first encountered old layout as the overall old layout.
+            barrier.oldLayout = old_state.layout;
+
+            if (_image->is_swap_chain_image() && old_state.last_frame_idx != m_frame_idx)
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            else
+            {
+                // Make sure the other layers and levels have the same old layout.
+                // If not, we've done something wrong.
+                if (first_old_layout == VK_IMAGE_LAYOUT_UNDEFINED)
+                    first_old_layout = old_state.layout;
+                else if (first_old_layout != old_state.layout)
+                    throw std::runtime_error("(Vulkan) Attempting an Image Layout Transition across multiple subresources that have different old layouts! Transition them to a common layout before attempting this!");
+            }
+
+            if (barrier.oldLayout != _layout || !is_redundant_transition(old_state.stage, old_state.access, _stage, _access))
+                barrier_needed = true;
         }
     }
 
-    if (m_image_usage_info.find((uint64_t)_image) != m_image_usage_info.end())
+    if (!barrier_needed)
     {
-        std::vector<ImageUsageInfo>& usages = m_image_usage_info[(uint64_t)_image];
+        m_pending_barrier_stats.skipped_count++;
+        return;
+    }
 
-        // If the resource size was changed for some reason, resize the vector and reset the old usages.
-        if (usages.size() != (_num_levels * _num_layers))
-        {
-            usages.resize(_num_levels * _num_layers);
+    track_resource(_stage, _access, _layout, _image, _range);
 
-            for (uint32_t layer_idx = 0; layer_idx < _range.layerCount; layer_idx++)
-            {
-                for (uint32_t level_idx = 0; level_idx < _range.levelCount; level_idx++)
-                {
-                    const uint32_t idx = (_num_levels * (_range.baseArrayLayer + layer_idx)) + (_range.baseMipLevel + level_idx);
+    m_image_memory_barriers.emplace_back(barrier);
+}
 
-                    ImageUsageInfo default_usage = {};
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-                    default_usage.stage          = VK_PIPELINE_STAGE_2_NONE;
-                    default_usage.access         = VK_ACCESS_2_NONE;
-                    default_usage.layout         = VK_IMAGE_LAYOUT_UNDEFINED;
-                    default_usage.last_frame_idx = 0;
+void Backend::use_resource(VkPipelineStageFlags2 _stage,
+                           VkAccessFlags2        _access,
+                           Buffer*               _buffer,
+                           size_t                _offset,
+                           size_t                _size)
+{
+    ResourceState& state = m_resource_states[_buffer->state_idx()];
 
-                    usages[idx] = default_usage;
-                }
-            }
-        }
+    // Nothing has touched the buffer since it was created, there is nothing to wait for.
+    if (state.stage == VK_PIPELINE_STAGE_2_NONE && state.access == VK_ACCESS_2_NONE)
+    {
+        state.stage  = _stage;
+        state.access = _access;
+
+        m_pending_barrier_stats.skipped_count++;
+        return;
+    }
+
+    if (is_redundant_transition(state.stage, state.access, _stage, _access))
+    {
+        m_pending_barrier_stats.skipped_count++;
+        return;
+    }
+
+    VkBufferMemoryBarrier2 barrier = {};
+
+    barrier.sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.srcStageMask  = state.stage;
+    barrier.srcAccessMask = state.access;
+    barrier.dstStageMask  = _stage;
+    barrier.dstAccessMask = _access;
+    barrier.buffer        = _buffer->handle();
+    barrier.offset        = _offset;
+    barrier.size          = _size == 0 ? VK_WHOLE_SIZE : _size;
+
+    state.stage  = _stage;
+    state.access = _access;
+
+    m_buffer_memory_barriers.emplace_back(barrier);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::track_resource(VkPipelineStageFlags2   _stage,
+                             VkAccessFlags2          _access,
+                             VkImageLayout           _layout,
+                             Image*                  _image,
+                             VkImageSubresourceRange _range)
+{
+    const uint32_t num_levels  = _image->mip_levels();
+    const uint32_t layer_count = _range.layerCount == VK_REMAINING_ARRAY_LAYERS ? _image->array_size() - _range.baseArrayLayer : _range.layerCount;
+    const uint32_t level_count = _range.levelCount == VK_REMAINING_MIP_LEVELS ? num_levels - _range.baseMipLevel : _range.levelCount;
+
+    ResourceState new_state;
+
+    new_state.stage          = _stage;
+    new_state.access         = _access;
+    new_state.layout         = _layout;
+    new_state.last_frame_idx = m_frame_idx;
+
+    for (uint32_t layer_idx = 0; layer_idx < layer_count; layer_idx++)
+    {
+        ResourceState* states = &m_resource_states[_image->state_idx() + num_levels * (_range.baseArrayLayer + layer_idx) + _range.baseMipLevel];
+
+        for (uint32_t level_idx = 0; level_idx < level_count; level_idx++)
+            states[level_idx] = new_state;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkImageLayout Backend::tracked_layout(Image* _image, VkImageSubresourceRange _range)
+{
+    const ResourceState& state = m_resource_states[_image->state_idx() + _image->mip_levels() * _range.baseArrayLayer + _range.baseMipLevel];
+
+    if (_image->is_swap_chain_image() && state.last_frame_idx != m_frame_idx)
+        return VK_IMAGE_LAYOUT_UNDEFINED;
+
+    return state.layout;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::transfer_ownership(const std::shared_ptr<CommandBuffer>& _src_cmd_buf,
+                                 QueueType                             _src_queue,
+                                 const std::shared_ptr<CommandBuffer>& _dst_cmd_buf,
+                                 QueueType                             _dst_queue,
+                                 VkPipelineStageFlags2                 _stage,
+                                 VkAccessFlags2                        _access,
+                                 VkImageLayout                         _layout,
+                                 const std::shared_ptr<Image>&         _image,
+                                 VkImageSubresourceRange               _range)
+{
+    const uint32_t src_family = queue_family_index(_src_queue);
+    const uint32_t dst_family = queue_family_index(_dst_queue);
 
-        VkImageLayout first_old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (src_family == dst_family)
+    {
+        use_resource(_stage, _access, _layout, _image, _range);
+        flush_barriers(_dst_cmd_buf);
 
-        for (uint32_t layer_idx = 0; layer_idx < _range.layerCount; layer_idx++)
-        {
-            for (uint32_t level_idx = 0; level_idx < _range.levelCount; level_idx++)
-            {
-                const uint32_t idx = (_num_levels * (_range.baseArrayLayer + layer_idx)) + (_range.baseMipLevel + level_idx);
+        return;
+    }
 
-                ImageUsageInfo& old_usage = usages[idx];
+    VkImageMemoryBarrier2 barrier = {};
 
-                // Add up all the old stage masks and access masks.
-                barrier.srcStageMask |= old_usage.stage;
-                barrier.srcAccessMask |= old_usage.access;
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcStageMask        = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask       = VK_ACCESS_2_NONE;
+    barrier.dstStageMask        = VK_PIPELINE_STAGE_2_NONE;
+    barrier.dstAccessMask       = VK_ACCESS_2_NONE;
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout           = _layout;
+    barrier.srcQueueFamilyIndex = src_family;
+    barrier.dstQueueFamilyIndex = dst_family;
+    barrier.image               = _image->handle();
+    barrier.subresourceRange    = _range;
 
-                // Use the first encountered old layout as the overall old layout.
-                barrier.oldLayout = old_usage.layout;
+    const uint32_t num_levels  = _image->mip_levels();
+    const uint32_t layer_count = _range.layerCount == VK_REMAINING_ARRAY_LAYERS ? _image->array_size() - _range.baseArrayLayer : _range.layerCount;
+    const uint32_t level_count = _range.levelCount == VK_REMAINING_MIP_LEVELS ? num_levels - _range.baseMipLevel : _range.levelCount;
 
-                if (is_swap_chain_image && old_usage.last_frame_idx != m_frame_idx)
-                    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-                else
-                {
-                    // Make sure the other layers and levels have the same old layout.
-                    // If not, we've done something wrong.
-                    if (first_old_layout == VK_IMAGE_LAYOUT_UNDEFINED)
-                        first_old_layout = old_usage.layout;
-                    else if (first_old_layout != old_usage.layout)
-                        throw std::runtime_error("(Vulkan) Attempting an Image Layout Transition across multiple subresources that have different old layouts! Transition them to a common layout before attempting this!");
-                }
-                
-                old_usage = new_usage;
-            }
+    // The release waits for the last use on the source queue, which is the tracked state of the range.
+    for (uint32_t layer_idx = 0; layer_idx < layer_count; layer_idx++)
+    {
+        ResourceState* states = &m_resource_states[_image->state_idx() + num_levels * (_range.baseArrayLayer + layer_idx) + _range.baseMipLevel];
+
+        for (uint32_t level_idx = 0; level_idx < level_count; level_idx++)
+        {
+            barrier.srcStageMask |= states[level_idx].stage;
+            barrier.srcAccessMask |= states[level_idx].access;
+            barrier.oldLayout = states[level_idx].layout;
         }
     }
-    else
-    {
-        std::vector<ImageUsageInfo> usages;
 
-        usages.resize(_num_levels * _num_layers);
+    record_barrier(_src_cmd_buf, nullptr, &barrier);
 
-        for (uint32_t layer_idx = 0; layer_idx < _range.layerCount; layer_idx++)
-        {
-            for (uint32_t level_idx = 0; level_idx < _range.levelCount; level_idx++)
-            {
-                const uint32_t idx = (_num_levels * (_range.baseArrayLayer + layer_idx)) + (_range.baseMipLevel + level_idx);
+    // The layout transition is part of the transfer, the acquire has to repeat the layouts of the release.
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask = VK_ACCESS_2_NONE;
+    barrier.dstStageMask  = _stage;
+    barrier.dstAccessMask = _access;
 
-                usages[idx] = new_usage;
-            }
-        }
+    record_barrier(_dst_cmd_buf, nullptr, &barrier);
 
-        m_image_usage_info[(uint64_t)_image] = usages;
-    }
+    track_resource(_stage, _access, _layout, _image.get(), _range);
 
-    m_image_memory_barriers.emplace_back(barrier);
+    m_pending_barrier_stats.emitted_count += 2;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Backend::use_resource(VkPipelineStageFlags2 _stage,
-                           VkAccessFlags2        _access,
-                           VkBuffer              _buffer,
-                           size_t                _offset,
-                           size_t                _size)
+void Backend::memory_barrier(const std::shared_ptr<CommandBuffer>& _cmd_buf,
+                             VkPipelineStageFlags2                 _src_stage,
+                             VkAccessFlags2                        _src_access,
+                             VkPipelineStageFlags2                 _dst_stage,
+                             VkAccessFlags2                        _dst_access)
 {
-    VkBufferMemoryBarrier2 barrier = {};
+    VkMemoryBarrier2 barrier = {};
 
-    barrier.sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
-    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
-    barrier.srcAccessMask = VK_ACCESS_2_NONE;
-    barrier.dstStageMask  = _stage;
-    barrier.dstAccessMask = _access;
-    barrier.buffer        = _buffer;
-    barrier.offset        = _offset;
-    barrier.size          = _size == 0 ? VK_WHOLE_SIZE : _size;
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask  = _src_stage;
+    barrier.srcAccessMask = _src_access;
+    barrier.dstStageMask  = _dst_stage;
+    barrier.dstAccessMask = _dst_access;
 
-    BufferUsageInfo new_usage = {};
+    record_barrier(_cmd_buf, nullptr, nullptr, &barrier);
 
-    new_usage.stage  = barrier.dstStageMask;
-    new_usage.access = barrier.dstAccessMask;
+    m_pending_barrier_stats.emitted_count++;
+    m_pending_barrier_stats.flush_count++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    if (m_buffer_usage_info.find((uint64_t)_buffer) != m_buffer_usage_info.end())
+uint32_t Backend::allocate_resource_states(uint32_t count)
+{
+    // Reuse a released range if one is large enough, giving back whatever is left of it.
+    for (uint32_t i = 0; i < m_free_resource_states.size(); i++)
     {
-        BufferUsageInfo& old_usage = m_buffer_usage_info[(uint64_t)_buffer];
+        if (m_free_resource_states[i].first >= count)
+        {
+            const uint32_t first = m_free_resource_states[i].second;
 
-        barrier.srcStageMask  = old_usage.stage;
-        barrier.srcAccessMask = old_usage.access;
+            if (m_free_resource_states[i].first == count)
+            {
+                m_free_resource_states[i] = m_free_resource_states.back();
+                m_free_resource_states.pop_back();
+            }
+            else
+            {
+                m_free_resource_states[i].first -= count;
+                m_free_resource_states[i].second += count;
+            }
 
-        old_usage = new_usage;
+            return first;
+        }
     }
-    else
-        m_buffer_usage_info[(uint64_t)_buffer] = new_usage;
 
-    m_buffer_memory_barriers.emplace_back(barrier);
+    const uint32_t first = m_resource_states.size();
+
+    m_resource_states.resize(m_resource_states.size() + count);
+
+    return first;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::release_resource_states(uint32_t first, uint32_t count)
+{
+    // A new resource created with the same handle must not inherit the state of this one.
+    for (uint32_t i = 0; i < count; i++)
+        m_resource_states[first + i] = ResourceState();
+
+    m_free_resource_states.push_back({ count, first });
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -3811,6 +6584,9 @@ void Backend::flush_barriers(const std::shared_ptr<CommandBuffer>& _cmd_buf)
         dependency_info.pImageMemoryBarriers     = m_image_memory_barriers.data();
 
         vkCmdPipelineBarrier2(_cmd_buf->handle(), &dependency_info);
+
+        m_pending_barrier_stats.emitted_count += m_buffer_memory_barriers.size() + m_image_memory_barriers.size();
+        m_pending_barrier_stats.flush_count++;
     }
 
     m_buffer_memory_barriers.clear();
@@ -3819,39 +6595,54 @@ void Backend::flush_barriers(const std::shared_ptr<CommandBuffer>& _cmd_buf)
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Backend::submit_graphics(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
-                              const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
-                              const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                              const std::shared_ptr<Fence>&                      signal_fence)
+void Backend::flush_barriers(const std::shared_ptr<CommandBuffer>&     _cmd_buf,
+                             const std::vector<VkImageMemoryBarrier2>&  _image_barriers,
+                             const std::vector<VkBufferMemoryBarrier2>& _buffer_barriers)
+{
+    m_image_memory_barriers.insert(m_image_memory_barriers.end(), _image_barriers.begin(), _image_barriers.end());
+    m_buffer_memory_barriers.insert(m_buffer_memory_barriers.end(), _buffer_barriers.begin(), _buffer_barriers.end());
+
+    flush_barriers(_cmd_buf);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Ticket Backend::submit_graphics(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
+                                const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
+                                const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
+                                const std::shared_ptr<Fence>&                      signal_fence,
+                                const std::vector<Ticket>&                         wait_tickets)
 {
-    submit(m_vk_graphics_queue, cmd_bufs, wait_semaphores, signal_semaphores, signal_fence);
+    return submit(QUEUE_TYPE_GRAPHICS, cmd_bufs, wait_semaphores, signal_semaphores, signal_fence, wait_tickets);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Backend::submit_compute(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
-                             const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
-                             const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                             const std::shared_ptr<Fence>&                      signal_fence)
+Ticket Backend::submit_compute(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
+                               const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
+                               const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
+                               const std::shared_ptr<Fence>&                      signal_fence,
+                               const std::vector<Ticket>&                         wait_tickets)
 {
-    submit(m_vk_compute_queue, cmd_bufs, wait_semaphores, signal_semaphores, signal_fence);
+    return submit(QUEUE_TYPE_COMPUTE, cmd_bufs, wait_semaphores, signal_semaphores, signal_fence, wait_tickets);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Backend::submit_transfer(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
-                              const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
-                              const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                              const std::shared_ptr<Fence>&                      signal_fence)
+Ticket Backend::submit_transfer(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
+                                const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
+                                const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
+                                const std::shared_ptr<Fence>&                      signal_fence,
+                                const std::vector<Ticket>&                         wait_tickets)
 {
-    submit(m_vk_transfer_queue, cmd_bufs, wait_semaphores, signal_semaphores, signal_fence);
+    return submit(QUEUE_TYPE_TRANSFER, cmd_bufs, wait_semaphores, signal_semaphores, signal_fence, wait_tickets);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
 void Backend::flush_graphics(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs)
 {
-    flush(m_vk_graphics_queue, cmd_bufs);
+    flush(QUEUE_TYPE_GRAPHICS, cmd_bufs);
 
     m_graphics_command_pools[m_frame_idx % m_graphics_command_pools.size()]->reset();
 }
@@ -3860,7 +6651,7 @@ void Backend::flush_graphics(const std::vector<std::shared_ptr<CommandBuffer>>&
 
 void Backend::flush_compute(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs)
 {
-    flush(m_vk_compute_queue, cmd_bufs);
+    flush(QUEUE_TYPE_COMPUTE, cmd_bufs);
 
     m_compute_command_pools[m_frame_idx % m_compute_command_pools.size()]->reset();
 }
@@ -3869,24 +6660,162 @@ void Backend::flush_compute(const std::vector<std::shared_ptr<CommandBuffer>>& c
 
 void Backend::flush_transfer(const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs)
 {
-    flush(m_vk_transfer_queue, cmd_bufs);
+    flush(QUEUE_TYPE_TRANSFER, cmd_bufs);
 
     m_transfer_command_pools[m_frame_idx % m_transfer_command_pools.size()]->reset();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Backend::submit(VkQueue                                            queue,
-                     const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
-                     const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
-                     const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
-                     const std::shared_ptr<Fence>&                      signal_fence)
+bool Backend::is_complete(const Ticket& ticket)
+{
+    if (ticket.value <= m_completed_values[ticket.queue])
+        return true;
+
+    m_completed_values[ticket.queue] = m_timeline_semaphores[ticket.queue]->value();
+
+    return ticket.value <= m_completed_values[ticket.queue];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Backend::wait(const Ticket& ticket, uint64_t timeout)
+{
+    if (is_complete(ticket))
+        return true;
+
+    if (!m_timeline_semaphores[ticket.queue]->wait(ticket.value, timeout))
+        return false;
+
+    m_completed_values[ticket.queue] = std::max(m_completed_values[ticket.queue], ticket.value);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t Backend::completed_value(QueueType queue)
+{
+    m_completed_values[queue] = m_timeline_semaphores[queue]->value();
+
+    return m_completed_values[queue];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t Backend::submitted_value(QueueType queue)
+{
+    return m_timeline_values[queue];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::wait_for_frame(const Ticket& ticket)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_latency_stats.present_wait_ms = 0.0;
+
+    // Keeps the CPU at most one frame ahead of the display instead of the number of frames in flight. The timeout keeps a
+    // minimized window from blocking the loop.
+    if (m_present_wait_enabled && m_present_id > 0)
+    {
+        vkWaitForPresentKHR(m_vk_device, m_vk_swap_chain, m_present_id, 100000000);
+
+        m_latency_stats.present_wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    wait(ticket);
+
+    m_latency_stats.frame_wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    update_present_latency();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::set_present_wait_enabled(bool value)
+{
+    m_present_wait_enabled = value && m_present_wait_supported;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::update_present_latency()
+{
+    // Presents complete in order. The display time is only known once polled, so the latency is an upper bound that gets tighter
+    // the more often this is called.
+    while (m_pending_presents.size() > 0)
+    {
+        VkResult result = vkWaitForPresentKHR(m_vk_device, m_vk_swap_chain, m_pending_presents.front().id, 0);
+
+        if (result == VK_TIMEOUT)
+            break;
+
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+        {
+            m_latency_stats.present_latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_pending_presents.front().frame_start).count();
+            m_latency_stats.presented_count++;
+            m_pending_presents.pop_front();
+        }
+        else
+        {
+            m_pending_presents.clear();
+            break;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VkQueue Backend::queue(QueueType type)
+{
+    if (type == QUEUE_TYPE_COMPUTE)
+        return m_vk_compute_queue;
+    else if (type == QUEUE_TYPE_TRANSFER)
+        return m_vk_transfer_queue;
+    else
+        return m_vk_graphics_queue;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t Backend::queue_family_index(QueueType type)
+{
+    if (type == QUEUE_TYPE_COMPUTE)
+        return m_selected_queues.compute_queue_index;
+    else if (type == QUEUE_TYPE_TRANSFER)
+        return m_selected_queues.transfer_queue_index;
+    else
+        return m_selected_queues.graphics_queue_index;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Ticket Backend::submit(QueueType                                          type,
+                       const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs,
+                       const std::vector<std::shared_ptr<Semaphore>>&     wait_semaphores,
+                       const std::vector<std::shared_ptr<Semaphore>>&     signal_semaphores,
+                       const std::shared_ptr<Fence>&                      signal_fence,
+                       const std::vector<Ticket>&                         wait_tickets)
 {
-    VkSemaphoreSubmitInfo vk_wait_semaphores[16];
+    Ticket upload_ticket;
+
+    // Pending uploads go first. Submissions to other queues wait for them on the GPU through the upload ticket.
+    if (m_staging_ring)
+        upload_ticket = m_staging_ring->flush();
+
+    // The submit infos are built in member arrays that only ever grow, so submitting allocates nothing once they are warm.
+    m_submit_wait_infos.resize(wait_semaphores.size() + wait_tickets.size() + 1);
+    m_submit_cmd_buf_infos.resize(cmd_bufs.size());
+    m_submit_signal_infos.resize(signal_semaphores.size() + 1);
+
+    VkSemaphoreSubmitInfo* vk_wait_semaphores = m_submit_wait_infos.data();
+    uint32_t               wait_count         = 0;
 
     for (int i = 0; i < wait_semaphores.size(); i++)
     {
-        VkSemaphoreSubmitInfo& info = vk_wait_semaphores[i];
+        VkSemaphoreSubmitInfo& info = vk_wait_semaphores[wait_count++];
 
         info.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
         info.pNext         = nullptr;
@@ -3896,7 +6825,25 @@ void Backend::submit(VkQueue                                            queue,
         info.deviceIndex   = 0;
     }
 
-    VkCommandBufferSubmitInfo vk_cmd_bufs[32];
+    for (int i = 0; i <= wait_tickets.size(); i++)
+    {
+        const Ticket& ticket = i < wait_tickets.size() ? wait_tickets[i] : upload_ticket;
+
+        // Work on the same queue is already ordered, and completed tickets need no wait.
+        if (ticket.queue == type || is_complete(ticket))
+            continue;
+
+        VkSemaphoreSubmitInfo& info = vk_wait_semaphores[wait_count++];
+
+        info.sType       = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        info.pNext       = nullptr;
+        info.semaphore   = m_timeline_semaphores[ticket.queue]->handle();
+        info.value       = ticket.value;
+        info.stageMask   = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        info.deviceIndex = 0;
+    }
+
+    VkCommandBufferSubmitInfo* vk_cmd_bufs = m_submit_cmd_buf_infos.data();
 
     for (int i = 0; i < cmd_bufs.size(); i++)
     {
@@ -3908,7 +6855,7 @@ void Backend::submit(VkQueue                                            queue,
         info.deviceMask    = 0;
     }
 
-    VkSemaphoreSubmitInfo vk_signal_semaphores[16];
+    VkSemaphoreSubmitInfo* vk_signal_semaphores = m_submit_signal_infos.data();
 
     for (int i = 0; i < signal_semaphores.size(); i++)
     {
@@ -3922,101 +6869,338 @@ void Backend::submit(VkQueue                                            queue,
         info.deviceIndex = 0;
     }
 
+    // Every submission advances the timeline of its queue.
+    Ticket ticket;
+
+    ticket.queue = type;
+    ticket.value = ++m_timeline_values[type];
+
+    // Thread command buffers of this frame can only be reused once everything submitted during the frame has completed.
+    if (type == QUEUE_TYPE_GRAPHICS)
+    {
+        std::lock_guard<std::mutex> lock(m_thread_command_pool_mutex);
+        m_thread_command_pool_frames[m_frame_idx % m_thread_command_pool_frames.size()].retire_value = ticket.value;
+    }
+
+    VkSemaphoreSubmitInfo& timeline_info = vk_signal_semaphores[signal_semaphores.size()];
+
+    timeline_info.sType       = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.pNext       = nullptr;
+    timeline_info.semaphore   = m_timeline_semaphores[type]->handle();
+    timeline_info.value       = ticket.value;
+    timeline_info.stageMask   = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    timeline_info.deviceIndex = 0;
+
     VkSubmitInfo2 submit_info = {};
 
     submit_info.sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
     submit_info.pNext                    = nullptr;
     submit_info.flags                    = 0;
-    submit_info.waitSemaphoreInfoCount   = wait_semaphores.size();
+    submit_info.waitSemaphoreInfoCount   = wait_count;
     submit_info.pWaitSemaphoreInfos      = vk_wait_semaphores;
     submit_info.commandBufferInfoCount   = cmd_bufs.size();
     submit_info.pCommandBufferInfos      = vk_cmd_bufs;
-    submit_info.signalSemaphoreInfoCount = signal_semaphores.size();
+    submit_info.signalSemaphoreInfoCount = signal_semaphores.size() + 1;
     submit_info.pSignalSemaphoreInfos    = vk_signal_semaphores;
 
     // Submit to queue
-    VkResult result = vkQueueSubmit2(queue, 1, &submit_info, signal_fence->handle());
+    VkResult result = vkQueueSubmit2(queue(type), 1, &submit_info, signal_fence ? signal_fence->handle() : VK_NULL_HANDLE);
+
+    m_queue_submit_count++;
 
     if (result != VK_SUCCESS)
     {
         DW_LOG_FATAL("(Vulkan) Failed to submit command buffer!");
         throw std::runtime_error("(Vulkan) Failed to submit command buffer!");
     }
+
+    return ticket;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::flush(QueueType type, const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs)
+{
+    // Wait on this submission only, instead of creating a fence for it.
+    wait(submit(type, cmd_bufs, {}, {}, nullptr, {}));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Backend::acquire_next_swap_chain_image(const std::shared_ptr<Semaphore>& semaphore)
+{
+    m_frame_start = std::chrono::steady_clock::now();
+
+    if (m_headless)
+    {
+        // The images are used in order. An empty submission signals the semaphore, so the frame can wait on it like on a
+        // real acquire.
+        m_image_index = m_frame_idx % m_swap_chain_images.size();
+
+        submit_graphics({}, {}, { semaphore }, nullptr);
+
+        m_latency_stats.acquire_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_frame_start).count();
+
+        return true;
+    }
+
+    VkResult result = vkAcquireNextImageKHR(m_vk_device, m_vk_swap_chain, UINT64_MAX, semaphore->handle(), VK_NULL_HANDLE, &m_image_index);
+
+    m_latency_stats.acquire_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_frame_start).count();
+
+    return result == VK_SUCCESS;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::present(const std::vector<std::shared_ptr<Semaphore>>& semaphores)
+{
+    if (m_headless)
+    {
+        // The semaphores still have to be waited on before they are signaled again, either by the readback copy or by an
+        // empty submission.
+        if (m_readback_enabled)
+            read_back_frame(semaphores);
+        else
+            submit_graphics({}, semaphores, {}, nullptr);
+
+        advance_frame();
+
+        return;
+    }
+
+    m_present_wait_semaphores.resize(semaphores.size());
+
+    for (int i = 0; i < semaphores.size(); i++)
+        m_present_wait_semaphores[i] = semaphores[i]->handle();
+
+    VkPresentInfoKHR present_info;
+    DW_ZERO_MEMORY(present_info);
+
+    present_info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.waitSemaphoreCount = semaphores.size();
+    present_info.pWaitSemaphores    = m_present_wait_semaphores.data();
+
+    VkSwapchainKHR swap_chains[] = { m_vk_swap_chain };
+    present_info.swapchainCount  = 1;
+    present_info.pSwapchains     = swap_chains;
+    present_info.pImageIndices   = &m_image_index;
+
+    VkPresentIdKHR present_id;
+    DW_ZERO_MEMORY(present_id);
+
+    if (m_present_wait_supported)
+    {
+        m_present_id++;
+
+        present_id.sType          = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        present_id.swapchainCount = 1;
+        present_id.pPresentIds    = &m_present_id;
+
+        present_info.pNext = &present_id;
+    }
+
+    if (vkQueuePresentKHR(m_vk_presentation_queue, &present_info) != VK_SUCCESS)
+    {
+        DW_LOG_FATAL("(Vulkan) Failed to submit draw command buffer!");
+        throw std::runtime_error("failed to present swap chain image!");
+    }
+
+    if (m_present_wait_supported)
+    {
+        // Ids that are never reported as displayed must not pile up.
+        if (m_pending_presents.size() == 16)
+            m_pending_presents.pop_front();
+
+        m_pending_presents.push_back({ m_present_id, m_frame_start });
+    }
+
+    advance_frame();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::advance_frame()
+{
+    m_barrier_stats         = m_pending_barrier_stats;
+    m_pending_barrier_stats = BarrierStats();
+
+    process_deletion_queue();
+
+    vmaSetCurrentFrameIndex(m_vma_allocator, m_frame_idx + 1);
+
+    check_memory_budget();
+
+    m_frame_idx++;
+
+    m_current_frame = m_frame_idx % m_frames_in_flight;
+
+    m_staging_ring->next_frame();
+    m_frame_allocator->next_frame(m_timeline_values);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::set_readback_enabled(bool value)
+{
+    if (!m_headless)
+    {
+        DW_LOG_ERROR("(Vulkan) Frame readback is only available on headless backends.");
+        return;
+    }
+
+    m_readback_enabled = value;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Backend::read_back_last_frame(std::vector<uint8_t>& texels)
+{
+    if (m_readback_image_index == -1)
+        return false;
+
+    wait(m_readback_ticket);
+
+    Buffer::Ptr buffer = m_readback_buffers[m_readback_image_index];
+
+    // GPU_TO_CPU memory is only guaranteed to be host visible, not coherent.
+    buffer->invalidate();
+
+    texels.resize(buffer->size());
+    memcpy(texels.data(), buffer->mapped_ptr(), buffer->size());
+
+    return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Backend::flush(VkQueue queue, const std::vector<std::shared_ptr<CommandBuffer>>& cmd_bufs)
+void Backend::read_back_frame(const std::vector<std::shared_ptr<Semaphore>>& semaphores)
 {
-    VkCommandBuffer vk_cmd_bufs[32];
+    Image::Ptr image = m_swap_chain_images[m_image_index];
 
-    for (int i = 0; i < cmd_bufs.size(); i++)
-        vk_cmd_bufs[i] = cmd_bufs[i]->handle();
+    // The offscreen images use 4 byte formats.
+    const size_t size = m_swap_chain_extent.width * m_swap_chain_extent.height * 4;
 
-    VkSubmitInfo submit_info;
-    DW_ZERO_MEMORY(submit_info);
+    if (m_readback_buffers.size() != m_swap_chain_images.size())
+        m_readback_buffers.resize(m_swap_chain_images.size());
 
-    submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers    = &vk_cmd_bufs[0];
+    if (!m_readback_buffers[m_image_index] || m_readback_buffers[m_image_index]->size() != size)
+    {
+        m_readback_buffers[m_image_index] = Buffer::create(shared_from_this(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, size, VMA_MEMORY_USAGE_GPU_TO_CPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        m_readback_buffers[m_image_index]->set_name("Readback Buffer " + std::to_string(m_image_index));
+    }
 
-    // Create fence to ensure that the command buffer has finished executing
-    VkFenceCreateInfo fence_info;
-    DW_ZERO_MEMORY(fence_info);
+    CommandBuffer::Ptr cmd_buf = allocate_thread_command_buffer(0, true);
 
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkImageSubresourceRange subresource_range;
+    DW_ZERO_MEMORY(subresource_range);
 
-    VkFence fence;
-    vkCreateFence(m_vk_device, &fence_info, nullptr, &fence);
+    subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.levelCount = 1;
+    subresource_range.layerCount = 1;
+
+    use_resource(VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, subresource_range);
+    flush_barriers(cmd_buf);
+
+    VkBufferImageCopy region;
+    DW_ZERO_MEMORY(region);
 
-    // Submit to the queue
-    vkQueueSubmit(queue, 1, &submit_info, fence);
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width           = m_swap_chain_extent.width;
+    region.imageExtent.height          = m_swap_chain_extent.height;
+    region.imageExtent.depth           = 1;
 
-    // Wait for the fence to signal that command buffer has finished executing
-    vkWaitForFences(m_vk_device, 1, &fence, VK_TRUE, 100000000000);
+    vkCmdCopyImageToBuffer(cmd_buf->handle(), image->handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_readback_buffers[m_image_index]->handle(), 1, &region);
 
-    vkDestroyFence(m_vk_device, fence, nullptr);
+    vkEndCommandBuffer(cmd_buf->handle());
+
+    m_readback_ticket      = submit_graphics({ cmd_buf }, semaphores, {}, nullptr);
+    m_readback_image_index = m_image_index;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-bool Backend::acquire_next_swap_chain_image(const std::shared_ptr<Semaphore>& semaphore)
+void Backend::queue_deletion(std::function<void()> deleter)
 {
-    VkResult result = vkAcquireNextImageKHR(m_vk_device, m_vk_swap_chain, UINT64_MAX, semaphore->handle(), VK_NULL_HANDLE, &m_image_index);
-
-    return result == VK_SUCCESS;
+    std::lock_guard<std::mutex> lock(m_deletion_mutex);
+    m_frame_deletions.push_back(deleter);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void Backend::present(const std::vector<std::shared_ptr<Semaphore>>& semaphores)
+void Backend::process_deletion_queue()
 {
-    VkSemaphore signal_semaphores[16];
-
-    for (int i = 0; i < semaphores.size(); i++)
-        signal_semaphores[i] = semaphores[i]->handle();
+    {
+        std::lock_guard<std::mutex> lock(m_deletion_mutex);
 
-    VkPresentInfoKHR present_info;
-    DW_ZERO_MEMORY(present_info);
+        // Everything the frame submitted is covered by the current timeline values of each queue.
+        if (!m_frame_deletions.empty())
+        {
+            DeletionBatch batch;
 
-    present_info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    present_info.waitSemaphoreCount = semaphores.size();
-    present_info.pWaitSemaphores    = signal_semaphores;
+            for (int i = 0; i < QUEUE_TYPE_COUNT; i++)
+                batch.retire_values[i] = m_timeline_values[i];
 
-    VkSwapchainKHR swap_chains[] = { m_vk_swap_chain };
-    present_info.swapchainCount  = 1;
-    present_info.pSwapchains     = swap_chains;
-    present_info.pImageIndices   = &m_image_index;
+            batch.deleters.swap(m_frame_deletions);
+            m_deletion_queue.push_back(std::move(batch));
+        }
+    }
 
-    if (vkQueuePresentKHR(m_vk_presentation_queue, &present_info) != VK_SUCCESS)
+    // Batches retire in order, so stop at the first one that is still in flight.
+    while (!m_deletion_queue.empty())
     {
-        DW_LOG_FATAL("(Vulkan) Failed to submit draw command buffer!");
-        throw std::runtime_error("failed to present swap chain image!");
+        DeletionBatch& batch = m_deletion_queue.front();
+
+        for (int i = 0; i < QUEUE_TYPE_COUNT; i++)
+        {
+            Ticket ticket;
+
+            ticket.queue = (QueueType)i;
+            ticket.value = batch.retire_values[i];
+
+            if (!is_complete(ticket))
+                return;
+        }
+
+        // Deleters may release objects that queue further deletions, so run them once the batch is off the queue.
+        std::vector<std::function<void()>> deleters;
+        deleters.swap(batch.deleters);
+
+        m_deletion_queue.pop_front();
+
+        for (auto& deleter : deleters)
+            deleter();
     }
+}
 
-    m_frame_idx++;
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::flush_deletion_queue()
+{
+    // Deleters can queue more deletions, keep going until nothing is left.
+    while (!m_deletion_queue.empty() || !m_frame_deletions.empty())
+    {
+        std::vector<std::function<void()>> deleters;
+
+        while (!m_deletion_queue.empty())
+        {
+            auto& batch = m_deletion_queue.front().deleters;
+
+            deleters.insert(deleters.end(), batch.begin(), batch.end());
+            m_deletion_queue.pop_front();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_deletion_mutex);
 
-    m_current_frame = m_frame_idx % kMaxFramesInFlight;
+            deleters.insert(deleters.end(), m_frame_deletions.begin(), m_frame_deletions.end());
+            m_frame_deletions.clear();
+        }
+
+        for (auto& deleter : deleters)
+            deleter();
+    }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -4161,6 +7345,252 @@ VkFormat Backend::find_supported_format(const std::vector<VkFormat>& candidates,
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
+void Backend::load_pipeline_cache()
+{
+    if (m_pipeline_cache_path.empty())
+        return;
+
+    std::vector<uint8_t> data;
+
+    // Only hand the driver data that was written by the same driver for the same device, it is allowed to trust whatever it is given.
+    if (utility::read_binary(m_pipeline_cache_path, data))
+    {
+        VkPipelineCacheHeaderVersionOne header;
+
+        bool valid = data.size() >= sizeof(header);
+
+        if (valid)
+        {
+            memcpy(&header, data.data(), sizeof(header));
+
+            valid = header.headerSize >= sizeof(header) &&
+                    header.headerSize <= data.size() &&
+                    header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                    header.vendorID == m_device_properties.vendorID &&
+                    header.deviceID == m_device_properties.deviceID &&
+                    memcmp(header.pipelineCacheUUID, m_device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+
+        if (!valid)
+        {
+            DW_LOG_INFO("(Vulkan) Discarding pipeline cache created for a different device or driver: " + m_pipeline_cache_path);
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo info;
+    DW_ZERO_MEMORY(info);
+
+    info.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.initialDataSize = data.size();
+    info.pInitialData    = data.size() > 0 ? data.data() : nullptr;
+
+    if (vkCreatePipelineCache(m_vk_device, &info, nullptr, &m_vk_pipeline_cache) != VK_SUCCESS)
+    {
+        DW_LOG_FATAL("(Vulkan) Failed to create Pipeline Cache.");
+        throw std::runtime_error("(Vulkan) Failed to create Pipeline Cache.");
+    }
+
+    m_pipeline_stats.cache_loaded = data.size() > 0;
+    m_pipeline_stats.cache_size   = data.size();
+
+    if (m_pipeline_stats.cache_loaded)
+        DW_LOG_INFO("(Vulkan) Loaded pipeline cache (" + std::to_string(data.size()) + " bytes): " + m_pipeline_cache_path);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::save_pipeline_cache()
+{
+    if (!m_vk_pipeline_cache)
+        return;
+
+    DW_LOG_INFO("(Vulkan) Created " + std::to_string(m_pipeline_stats.pipeline_count) + " pipelines in " + std::to_string(m_pipeline_stats.creation_time_ms) + " ms (" + (m_pipeline_stats.cache_loaded ? "warm" : "cold") + " pipeline cache).");
+
+    size_t size = 0;
+
+    if (vkGetPipelineCacheData(m_vk_device, m_vk_pipeline_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return;
+
+    std::vector<uint8_t> data(size);
+
+    if (vkGetPipelineCacheData(m_vk_device, m_vk_pipeline_cache, &size, data.data()) != VK_SUCCESS)
+        return;
+
+    if (!utility::write_binary(m_pipeline_cache_path, data.data(), size))
+        DW_LOG_ERROR("(Vulkan) Failed to write pipeline cache: " + m_pipeline_cache_path);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::record_pipeline_creation(double time_ms)
+{
+    std::lock_guard<std::mutex> lock(m_pipeline_stats_mutex);
+
+    m_pipeline_stats.pipeline_count++;
+    m_pipeline_stats.creation_time_ms += time_ms;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::track_allocation(MemoryCategory category, VkDeviceSize size)
+{
+    m_category_bytes[category] += size;
+    m_category_counts[category]++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::untrack_allocation(MemoryCategory category, VkDeviceSize size)
+{
+    m_category_bytes[category] -= size;
+    m_category_counts[category]--;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Backend::MemoryStats Backend::memory_stats()
+{
+    MemoryStats stats;
+
+    for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        stats.category_bytes[i]  = m_category_bytes[i];
+        stats.category_counts[i] = m_category_counts[i];
+    }
+
+    const VkPhysicalDeviceMemoryProperties* memory_properties = nullptr;
+    vmaGetMemoryProperties(m_vma_allocator, &memory_properties);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(m_vma_allocator, budgets);
+
+    stats.heaps.resize(memory_properties->memoryHeapCount);
+
+    for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++)
+    {
+        MemoryHeapStats& heap = stats.heaps[i];
+
+        heap.usage        = budgets[i].usage;
+        heap.budget       = budgets[i].budget;
+        heap.block_bytes  = budgets[i].statistics.blockBytes;
+        heap.device_local = (memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    return stats;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Backend::write_memory_stats(const std::string& path)
+{
+    MemoryStats stats = memory_stats();
+
+    nlohmann::json j;
+
+    for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        nlohmann::json category;
+
+        category["bytes"] = stats.category_bytes[i];
+        category["count"] = stats.category_counts[i];
+
+        j["categories"][memory_category_name((MemoryCategory)i)] = category;
+    }
+
+    for (uint32_t i = 0; i < stats.heaps.size(); i++)
+    {
+        nlohmann::json heap;
+
+        heap["index"]        = i;
+        heap["usage"]        = stats.heaps[i].usage;
+        heap["budget"]       = stats.heaps[i].budget;
+        heap["block_bytes"]  = stats.heaps[i].block_bytes;
+        heap["device_local"] = stats.heaps[i].device_local;
+
+        j["heaps"].push_back(heap);
+    }
+
+    j["budget_from_driver"] = m_memory_budget_supported;
+
+    std::ofstream o(path);
+
+    if (!o.is_open())
+    {
+        DW_LOG_ERROR("(Vulkan) Failed to open memory stats file: " + path);
+        return false;
+    }
+
+    o << std::setw(4) << j << std::endl;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::set_memory_budget_warning_threshold(float fraction)
+{
+    m_memory_budget_warning_threshold = fraction;
+    m_memory_budget_warned            = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const char* Backend::memory_category_name(MemoryCategory category)
+{
+    switch (category)
+    {
+        case MEMORY_CATEGORY_MESH:
+            return "Meshes";
+        case MEMORY_CATEGORY_TEXTURE:
+            return "Textures";
+        case MEMORY_CATEGORY_RENDER_TARGET:
+            return "Render Targets";
+        case MEMORY_CATEGORY_ACCELERATION_STRUCTURE:
+            return "Acceleration Structures";
+        case MEMORY_CATEGORY_UNIFORM:
+            return "Uniform Buffers";
+        case MEMORY_CATEGORY_STAGING:
+            return "Staging";
+        default:
+            return "Other";
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::check_memory_budget()
+{
+    const VkPhysicalDeviceMemoryProperties* memory_properties = nullptr;
+    vmaGetMemoryProperties(m_vma_allocator, &memory_properties);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(m_vma_allocator, budgets);
+
+    bool over_threshold = false;
+
+    for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++)
+    {
+        if ((memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0 || budgets[i].budget == 0)
+            continue;
+
+        const float fraction = float(budgets[i].usage) / float(budgets[i].budget);
+
+        if (fraction > m_memory_budget_warning_threshold)
+        {
+            over_threshold = true;
+
+            // Only warn once per crossing, not every frame.
+            if (!m_memory_budget_warned)
+                DW_LOG_WARNING("(Vulkan) Memory heap " + std::to_string(i) + " is at " + std::to_string(int(fraction * 100.0f)) + "% of its budget (" + std::to_string(budgets[i].usage / (1024 * 1024)) + " MB of " + std::to_string(budgets[i].budget / (1024 * 1024)) + " MB).");
+        }
+    }
+
+    m_memory_budget_warned = over_threshold;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
 VkFormat Backend::find_depth_format()
 {
     return find_supported_format({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
@@ -4253,11 +7683,17 @@ bool Backend::check_validation_layer_support(std::vector<const char*> layers)
 
 std::vector<const char*> Backend::required_extensions(bool enable_validation_layers)
 {
-    uint32_t     glfw_extension_count = 0;
-    const char** glfw_extensions;
-    glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
+    // Headless backends don't need the surface extensions, which also means GLFW doesn't have to be initialized.
+    if (!m_headless)
+    {
+        uint32_t     glfw_extension_count = 0;
+        const char** glfw_extensions;
+        glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+
+        extensions.insert(extensions.end(), glfw_extensions, glfw_extensions + glfw_extension_count);
+    }
 
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
@@ -4309,33 +7745,24 @@ bool Backend::find_physical_device(std::vector<const char*> extensions, bool req
 
     vkEnumeratePhysicalDevices(m_vk_instance, &device_count, devices.data());
 
-    // Try to find a discrete GPU...
-    for (const auto& device : devices)
-    {
-        QueueInfos              infos;
-        SwapChainSupportDetails details;
-
-        if (is_device_suitable(device, VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, infos, details, extensions, require_ray_tracing))
-        {
-            m_vk_physical_device = device;
-            m_selected_queues    = infos;
-            m_swapchain_details  = details;
-            return true;
-        }
-    }
+    // Try to find a discrete GPU, if not an integrated GPU. Virtual GPUs and software rasterizers such as lavapipe are only
+    // picked when nothing else is available, e.g. on CI machines.
+    const VkPhysicalDeviceType types[] = { VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU };
 
-    // ...If not, try to find an integrated GPU...
-    for (const auto& device : devices)
+    for (const auto& type : types)
     {
-        QueueInfos              infos;
-        SwapChainSupportDetails details;
-
-        if (is_device_suitable(device, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, infos, details, extensions, require_ray_tracing))
+        for (const auto& device : devices)
         {
-            m_vk_physical_device = device;
-            m_selected_queues    = infos;
-            m_swapchain_details  = details;
-            return true;
+            QueueInfos              infos;
+            SwapChainSupportDetails details;
+
+            if (is_device_suitable(device, type, infos, details, extensions, require_ray_tracing))
+            {
+                m_vk_physical_device = device;
+                m_selected_queues    = infos;
+                m_swapchain_details  = details;
+                return true;
+            }
         }
     }
 
@@ -4353,9 +7780,15 @@ bool Backend::is_device_suitable(VkPhysicalDevice device, VkPhysicalDeviceType t
     if (m_device_properties.deviceType == type)
     {
         bool extensions_supported = check_device_extension_support(device, extensions);
-        query_swap_chain_support(device, details);
+        bool swapchain_supported  = m_headless;
 
-        if (details.format.size() > 0 && details.present_modes.size() > 0 && extensions_supported)
+        if (!m_headless)
+        {
+            query_swap_chain_support(device, details);
+            swapchain_supported = details.format.size() > 0 && details.present_modes.size() > 0;
+        }
+
+        if (swapchain_supported && extensions_supported)
         {
             if (require_ray_tracing)
             {
@@ -4396,7 +7829,9 @@ bool Backend::find_queues(VkPhysicalDevice device, QueueInfos& infos)
         VkQueueFlags bits = families[i].queueFlags;
 
         VkBool32 present_support = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_vk_surface, &present_support);
+
+        if (!m_headless)
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_vk_surface, &present_support);
 
         // Look for Presentation Queue
         if (present_support && infos.presentation_queue_index == -1)
@@ -4466,6 +7901,10 @@ bool Backend::find_queues(VkPhysicalDevice device, QueueInfos& infos)
         }
     }
 
+    // Nothing is presented when headless, the graphics queue stands in for the presentation queue.
+    if (m_headless)
+        infos.presentation_queue_index = infos.graphics_queue_index;
+
     if (infos.presentation_queue_index == -1)
     {
         DW_LOG_INFO("(Vulkan) No Presentation Queue Found");
@@ -4610,12 +8049,34 @@ bool Backend::create_logical_device(std::vector<const char*> extensions, bool re
     features13.dynamicRendering               = VK_TRUE;
     features13.synchronization2               = VK_TRUE;
 
+    // Present Id Features
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features;
+    DW_ZERO_MEMORY(present_id_features);
+
+    present_id_features.sType     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    present_id_features.presentId = VK_TRUE;
+
+    // Present Wait Features
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features;
+    DW_ZERO_MEMORY(present_wait_features);
+
+    present_wait_features.sType       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    present_wait_features.pNext       = &present_id_features;
+    present_wait_features.presentWait = VK_TRUE;
+
+    if (m_present_wait_supported)
+    {
+        present_id_features.pNext = features13.pNext;
+        features13.pNext          = &present_wait_features;
+    }
+
     // Vulkan 1.2 Features
     VkPhysicalDeviceVulkan12Features features12;
     DW_ZERO_MEMORY(features12);
 
-    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
-    features12.pNext = &features13;
+    features12.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext             = &features13;
+    features12.timelineSemaphore = VK_TRUE;
 
     // Vulkan 1.1 Features
     VkPhysicalDeviceVulkan11Features features11;
@@ -4709,7 +8170,7 @@ bool Backend::create_logical_device(std::vector<const char*> extensions, bool re
     else if (m_selected_queues.transfer_queue_index == m_selected_queues.graphics_queue_index)
         m_vk_transfer_queue = m_vk_graphics_queue;
     else if (m_selected_queues.transfer_queue_index == m_selected_queues.compute_queue_index)
-        m_vk_transfer_queue = m_vk_transfer_queue;
+        m_vk_transfer_queue = m_vk_compute_queue;
     else
         vkGetDeviceQueue(m_vk_device, m_selected_queues.transfer_queue_index, 0, &m_vk_transfer_queue);
 
@@ -4720,6 +8181,9 @@ bool Backend::create_logical_device(std::vector<const char*> extensions, bool re
 
 bool Backend::create_swapchain()
 {
+    if (m_headless)
+        return create_offscreen_images();
+
     m_current_frame                   = 0;
     VkSurfaceFormatKHR surface_format = choose_swap_surface_format(m_swapchain_details.format);
     VkPresentModeKHR   present_mode   = choose_swap_present_mode(m_swapchain_details.present_modes);
@@ -4779,6 +8243,55 @@ bool Backend::create_swapchain()
     if (vkGetSwapchainImagesKHR(m_vk_device, m_vk_swap_chain, &swap_image_count, &images[0]) != VK_SUCCESS)
         return false;
 
+    create_swapchain_depth();
+
+    for (int i = 0; i < swap_image_count; i++)
+    {
+        m_swap_chain_images[i] = Image::create_from_swapchain(shared_from_this(), images[i], VK_IMAGE_TYPE_2D, m_swap_chain_extent.width, m_swap_chain_extent.height, 1, 1, 1, m_swap_chain_image_format, VMA_MEMORY_USAGE_UNKNOWN, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_SAMPLE_COUNT_1_BIT);
+
+        m_swap_chain_images[i]->set_name("Swap Chain Image " + std::to_string(i));
+
+        m_swap_chain_image_views[i] = ImageView::create(shared_from_this(), m_swap_chain_images[i], VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        m_swap_chain_image_views[i]->set_name("Swap Chain Image View " + std::to_string(i));
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Backend::create_offscreen_images()
+{
+    m_current_frame           = 0;
+    m_swap_chain_image_format = m_srgb_swapchain ? VK_FORMAT_B8G8R8A8_SRGB : VK_FORMAT_B8G8R8A8_UNORM;
+
+    m_swap_chain_images.resize(m_frames_in_flight);
+    m_swap_chain_image_views.resize(m_frames_in_flight);
+
+    create_swapchain_depth();
+
+    for (int i = 0; i < m_frames_in_flight; i++)
+    {
+        m_swap_chain_images[i] = Image::create(shared_from_this(), VK_IMAGE_TYPE_2D, m_swap_chain_extent.width, m_swap_chain_extent.height, 1, 1, 1, m_swap_chain_image_format, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT);
+
+        m_swap_chain_images[i]->set_name("Offscreen Swap Chain Image " + std::to_string(i));
+
+        m_swap_chain_image_views[i] = ImageView::create(shared_from_this(), m_swap_chain_images[i], VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        m_swap_chain_image_views[i]->set_name("Offscreen Swap Chain Image View " + std::to_string(i));
+    }
+
+    m_readback_buffers.clear();
+    m_readback_image_index = -1;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Backend::create_swapchain_depth()
+{
     m_swap_chain_depth_format = find_depth_format();
 
     m_swap_chain_depth = Image::create(shared_from_this(),
@@ -4798,19 +8311,6 @@ bool Backend::create_swapchain()
     m_swap_chain_depth_view = ImageView::create(shared_from_this(), m_swap_chain_depth, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_DEPTH_BIT);
 
     m_swap_chain_depth_view->set_name("Swap Chain Depth Image View");
-
-    for (int i = 0; i < swap_image_count; i++)
-    {
-        m_swap_chain_images[i] = Image::create_from_swapchain(shared_from_this(), images[i], VK_IMAGE_TYPE_2D, m_swap_chain_extent.width, m_swap_chain_extent.height, 1, 1, 1, m_swap_chain_image_format, VMA_MEMORY_USAGE_UNKNOWN, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_SAMPLE_COUNT_1_BIT);
-
-        m_swap_chain_images[i]->set_name("Swap Chain Image " + std::to_string(i));
-
-        m_swap_chain_image_views[i] = ImageView::create(shared_from_this(), m_swap_chain_images[i], VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
-
-        m_swap_chain_image_views[i]->set_name("Swap Chain Image View " + std::to_string(i));
-    }
-
-    return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -4828,7 +8328,12 @@ void Backend::recreate_swapchain(bool vsync)
         m_swap_chain_image_views[i].reset();
     }
 
-    vkDestroySwapchainKHR(m_vk_device, m_vk_swap_chain, nullptr);
+    if (m_vk_swap_chain)
+        vkDestroySwapchainKHR(m_vk_device, m_vk_swap_chain, nullptr);
+
+    // Present ids belong to a swap chain.
+    m_present_id = 0;
+    m_pending_presents.clear();
 
     if (!create_swapchain())
     {
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+
+// Failed checks are counted instead of aborting, so that a single run reports all of them.
+static int g_failures = 0;
+
+#define CHECK(x)                                                          \
+    do                                                                    \
+    {                                                                     \
+        if (!(x))                                                         \
+        {                                                                 \
+            printf("%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #x); \
+            g_failures++;                                                 \
+        }                                                                 \
+    } while (0)
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Prints the summary of all checks and returns the exit code of the test.
+static inline int check_results()
+{
+    if (g_failures > 0)
+    {
+        printf("%d check(s) failed.\n", g_failures);
+        return 1;
+    }
+
+    printf("All checks passed.\n");
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
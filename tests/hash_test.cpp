@@ -0,0 +1,44 @@
+#include <utility.h>
+#include <cstdio>
+#include <cstring>
+#include "check.h"
+
+using namespace dw;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint64_t hash_string(const char* str, uint64_t seed = 0)
+{
+    return utility::hash64(str, strlen(str), seed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Published XXH64 vectors, covering the short input paths and a full 32 byte stripe followed by a tail.
+static void test_known_vectors()
+{
+    CHECK(hash_string("") == 0xEF46DB3751D8E999ULL);
+    CHECK(hash_string("a") == 0xD24EC4F1A98C6E5BULL);
+    CHECK(hash_string("abc") == 0x44BC2CF5AD770999ULL);
+    CHECK(hash_string("Nobody inspects the spammish repetition") == 0xFBCEA83C8A378BF1ULL);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The material content cache folds the color space into the seed, so a different seed must give a different hash.
+static void test_seed_changes_hash()
+{
+    CHECK(hash_string("abc", 0) != hash_string("abc", 1));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main()
+{
+    test_known_vectors();
+    test_seed_changes_hash();
+
+    return check_results();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
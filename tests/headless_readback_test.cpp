@@ -0,0 +1,129 @@
+#include <application.h>
+#include <cstdio>
+#include <stdexcept>
+#include "check.h"
+#if defined(DWSF_IMGUI)
+#    include <imgui.h>
+#endif
+
+// ctest reports a test that exits with this code as skipped.
+#define SKIP_RETURN_CODE 77
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Clears every frame to a different color without a window, then checks that the readback returns the color of the last one.
+class HeadlessReadbackTest : public dw::Application
+{
+protected:
+    bool init(int argc, const char* argv[]) override
+    {
+        m_vk_backend->set_readback_enabled(true);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void update(double delta) override
+    {
+        dw::vk::CommandBuffer::Ptr cmd_buf = m_vk_backend->allocate_graphics_command_buffer(true);
+
+        VkImageSubresourceRange subresource_range;
+        DW_ZERO_MEMORY(subresource_range);
+
+        subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresource_range.levelCount = 1;
+        subresource_range.layerCount = 1;
+
+        dw::vk::Image::Ptr image = m_vk_backend->swapchain_image();
+
+        m_vk_backend->use_resource(VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image, subresource_range);
+        m_vk_backend->flush_barriers(cmd_buf);
+
+        VkClearColorValue clear_color;
+        DW_ZERO_MEMORY(clear_color);
+
+        // Red on even frames, green on odd ones.
+        clear_color.float32[0] = (m_frame_index % 2) == 0 ? 1.0f : 0.0f;
+        clear_color.float32[1] = (m_frame_index % 2) == 0 ? 0.0f : 1.0f;
+        clear_color.float32[3] = 1.0f;
+
+        vkCmdClearColorImage(cmd_buf->handle(), image->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color, 1, &subresource_range);
+
+        vkEndCommandBuffer(cmd_buf->handle());
+
+#if defined(DWSF_IMGUI)
+        // Nothing is drawn, but the frame begun by the application still has to be ended.
+        ImGui::Render();
+#endif
+
+        submit_and_present({ cmd_buf });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void shutdown() override
+    {
+        std::vector<uint8_t> texels;
+
+        CHECK(m_vk_backend->read_back_last_frame(texels));
+        CHECK(texels.size() == size_t(m_width) * m_height * 4);
+
+        // The offscreen images are BGRA, the last of the two frames is green.
+        const uint8_t expected[4] = { 0, 255, 0, 255 };
+        uint32_t      mismatches  = 0;
+
+        for (size_t i = 0; i + 3 < texels.size(); i += 4)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                if (texels[i + c] != expected[c])
+                    mismatches++;
+            }
+        }
+
+        CHECK(mismatches == 0);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    dw::AppSettings intial_app_settings() override
+    {
+        dw::AppSettings settings;
+
+        settings.width                = 64;
+        settings.height               = 32;
+        settings.title                = "Headless Readback Test";
+        settings.headless             = true;
+        settings.headless_frame_count = 2;
+        settings.pipeline_cache_path  = "";
+
+        return settings;
+    }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, const char* argv[])
+{
+    HeadlessReadbackTest app;
+
+    try
+    {
+        if (app.run(argc, argv) != 0)
+        {
+            printf("Failed to initialize the headless application.\n");
+            return 1;
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        // Backend creation throws when there is no Vulkan device, not even a software one.
+        printf("Skipped: %s\n", e.what());
+        return SKIP_RETURN_CODE;
+    }
+
+    return check_results();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,162 @@
+#include <mip_generator.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "check.h"
+
+using namespace dw;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::vector<uint8_t> random_image(uint32_t width, uint32_t height, uint32_t channels)
+{
+    std::vector<uint8_t> pixels(size_t(width) * height * channels);
+
+    srand(1337);
+
+    for (auto& p : pixels)
+        p = uint8_t(rand() % 256);
+
+    return pixels;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void test_level_sizes()
+{
+    std::vector<uint8_t>                 pixels = random_image(13, 5, 3);
+    std::vector<mip_generator::MipLevel> levels;
+
+    CHECK(mip_generator::full_mip_chain_length(13, 5) == 4);
+    CHECK(mip_generator::generate(pixels.data(), 13, 5, 3, mip_generator::Desc(), levels));
+    CHECK(levels.size() == 4);
+
+    const uint32_t expected[4][2] = { { 13, 5 }, { 6, 2 }, { 3, 1 }, { 1, 1 } };
+
+    for (uint32_t i = 0; i < levels.size() && i < 4; i++)
+    {
+        CHECK(levels[i].width == expected[i][0]);
+        CHECK(levels[i].height == expected[i][1]);
+        CHECK(levels[i].data.size() == size_t(expected[i][0]) * expected[i][1] * 3);
+    }
+
+    mip_generator::Desc desc;
+    desc.set_mip_levels(2);
+
+    CHECK(mip_generator::generate(pixels.data(), 13, 5, 3, desc, levels));
+    CHECK(levels.size() == 2);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// An even sized box filtered level must be the rounded average of each 2x2 quad, regardless of the thread count.
+static void test_box_reference(uint32_t num_threads)
+{
+    const uint32_t kSize     = 128;
+    const uint32_t kChannels = 4;
+
+    std::vector<uint8_t>                 pixels = random_image(kSize, kSize, kChannels);
+    std::vector<mip_generator::MipLevel> levels;
+
+    mip_generator::Desc desc;
+    desc.set_filter(mip_generator::MIP_FILTER_BOX).set_srgb(false).set_wrap(false).set_num_threads(num_threads);
+
+    CHECK(mip_generator::generate(pixels.data(), kSize, kSize, kChannels, desc, levels));
+    CHECK(levels.size() == mip_generator::full_mip_chain_length(kSize, kSize));
+
+    const uint32_t half       = kSize / 2;
+    uint32_t       mismatches = 0;
+
+    for (uint32_t y = 0; y < half; y++)
+    {
+        for (uint32_t x = 0; x < half; x++)
+        {
+            for (uint32_t c = 0; c < kChannels; c++)
+            {
+                uint32_t sum = 0;
+
+                for (uint32_t dy = 0; dy < 2; dy++)
+                {
+                    for (uint32_t dx = 0; dx < 2; dx++)
+                        sum += pixels[((y * 2 + dy) * kSize + (x * 2 + dx)) * kChannels + c];
+                }
+
+                int32_t reference = int32_t(std::floor(float(sum) / 4.0f + 0.5f));
+                int32_t actual    = levels[1].data[(y * half + x) * kChannels + c];
+
+                // Allow one step for float rounding at exact .5 averages.
+                if (std::abs(reference - actual) > 1)
+                    mismatches++;
+            }
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void test_threads_match_serial()
+{
+    const uint32_t kWidth    = 200;
+    const uint32_t kHeight   = 96;
+    const uint32_t kChannels = 4;
+
+    std::vector<uint8_t>                 pixels = random_image(kWidth, kHeight, kChannels);
+    std::vector<mip_generator::MipLevel> serial;
+    std::vector<mip_generator::MipLevel> threaded;
+
+    mip_generator::Desc desc;
+    desc.set_srgb(true).set_preserve_alpha_coverage(true);
+
+    CHECK(mip_generator::generate(pixels.data(), kWidth, kHeight, kChannels, desc.set_num_threads(1), serial));
+    CHECK(mip_generator::generate(pixels.data(), kWidth, kHeight, kChannels, desc.set_num_threads(8), threaded));
+    CHECK(serial.size() == threaded.size());
+
+    for (uint32_t i = 0; i < serial.size() && i < threaded.size(); i++)
+        CHECK(serial[i].data == threaded[i].data);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void test_float_constant()
+{
+    const uint32_t kSize = 32;
+
+    std::vector<float>                   pixels(kSize * kSize * 3, 2.5f);
+    std::vector<mip_generator::MipLevel> levels;
+
+    CHECK(mip_generator::generate(pixels.data(), kSize, kSize, 3, mip_generator::Desc(), levels));
+
+    for (const auto& level : levels)
+    {
+        const float* data  = (const float*)level.data.data();
+        size_t       count = level.data.size() / sizeof(float);
+
+        CHECK(count == size_t(level.width) * level.height * 3);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (std::abs(data[i] - 2.5f) > 1e-4f)
+            {
+                CHECK(std::abs(data[i] - 2.5f) <= 1e-4f);
+                break;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main()
+{
+    test_level_sizes();
+    test_box_reference(1);
+    test_box_reference(4);
+    test_threads_match_serial();
+    test_float_constant();
+
+    return check_results();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
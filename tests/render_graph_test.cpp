@@ -0,0 +1,293 @@
+#include <render_graph.h>
+#include <cstdio>
+#include "check.h"
+
+using namespace dw;
+using namespace dw::vk;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// A graph without a backend, every transient needs 1 MB of memory.
+static RenderGraph::Ptr create_graph()
+{
+    RenderGraph::Ptr graph = RenderGraph::create(nullptr);
+
+    graph->set_memory_requirements_callbacks(
+        [](const RenderGraph::ImageDesc& desc) {
+            VkMemoryRequirements requirements = {};
+
+            requirements.size           = 1024 * 1024;
+            requirements.alignment      = 256;
+            requirements.memoryTypeBits = 1;
+
+            return requirements;
+        },
+        [](const RenderGraph::BufferDesc& desc) {
+            VkMemoryRequirements requirements = {};
+
+            requirements.size           = desc.size;
+            requirements.alignment      = 256;
+            requirements.memoryTypeBits = 1;
+
+            return requirements;
+        });
+
+    return graph;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static RenderGraph::ImageDesc storage_image_desc()
+{
+    RenderGraph::ImageDesc desc;
+
+    desc.set_extents(256, 256).set_format(VK_FORMAT_R16G16B16A16_SFLOAT).set_usage(VK_IMAGE_USAGE_STORAGE_BIT);
+
+    return desc;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Reading and writing a resource in the same pass must keep both flags, and the read must keep the producer alive.
+static void test_read_modify_write_chain()
+{
+    RenderGraph::Ptr            graph = create_graph();
+    RenderGraph::ResourceHandle image = graph->create_image("image", storage_image_desc());
+
+    graph->add_pass("produce", nullptr).write_storage_image(image);
+
+    std::vector<RenderGraph::Access> accesses = graph->add_pass("modify", nullptr).read_storage_image(image).write_storage_image(image).accesses();
+
+    graph->add_pass("consume", nullptr).read_storage_image(image).set_side_effect();
+
+    graph->compile();
+
+    CHECK(!graph->is_culled(0));
+    CHECK(!graph->is_culled(1));
+    CHECK(!graph->is_culled(2));
+    CHECK(graph->stats().culled_pass_count == 0);
+    CHECK(accesses.size() == 1);
+
+    if (accesses.size() == 1)
+    {
+        CHECK(accesses[0].read);
+        CHECK(accesses[0].write);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The read-modify-write pass is the last user, so only its side effect keeps the producer around.
+static void test_read_modify_write_side_effect()
+{
+    RenderGraph::Ptr            graph = create_graph();
+    RenderGraph::ResourceHandle image = graph->create_image("image", storage_image_desc());
+
+    graph->add_pass("produce", nullptr).write_storage_image(image);
+    graph->add_pass("modify", nullptr).read_storage_image(image).write_storage_image(image).set_side_effect();
+
+    graph->compile();
+
+    CHECK(!graph->is_culled(0));
+    CHECK(!graph->is_culled(1));
+
+    // The modify pass has to wait for the producer's write.
+    const auto& compiled = graph->compiled_passes();
+
+    CHECK(compiled.size() == 2);
+
+    if (compiled.size() == 2)
+    {
+        CHECK(compiled[1].barriers.size() == 1);
+
+        if (compiled[1].barriers.size() == 1)
+        {
+            CHECK(compiled[1].barriers[0].src_stage == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+            CHECK(compiled[1].barriers[0].src_access == VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+            CHECK(compiled[1].barriers[0].dst_access == (VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Without anyone using the final result the whole chain goes, the modify pass's own read doesn't keep it alive.
+static void test_unused_chain_is_culled()
+{
+    RenderGraph::Ptr            graph = create_graph();
+    RenderGraph::ResourceHandle image = graph->create_image("image", storage_image_desc());
+    RenderGraph::ResourceHandle other = graph->create_image("other", storage_image_desc());
+
+    graph->add_pass("produce", nullptr).write_storage_image(image);
+    graph->add_pass("modify", nullptr).read_storage_image(image).write_storage_image(image);
+    graph->add_pass("unrelated", nullptr).write_storage_image(other).set_side_effect();
+
+    graph->compile();
+
+    CHECK(graph->is_culled(0));
+    CHECK(graph->is_culled(1));
+    CHECK(!graph->is_culled(2));
+    CHECK(graph->stats().culled_pass_count == 2);
+    CHECK(graph->placement(image).heap == UINT32_MAX);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Transients that are never alive at the same time share the same memory, and the second one waits for everything the first did.
+static void test_disjoint_lifetimes_alias()
+{
+    RenderGraph::Ptr graph = create_graph();
+
+    RenderGraph::ImageDesc color_desc;
+
+    color_desc.set_extents(256, 256).set_format(VK_FORMAT_R8G8B8A8_UNORM).set_usage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
+    RenderGraph::ResourceHandle a = graph->create_image("a", storage_image_desc());
+    RenderGraph::ResourceHandle b = graph->create_image("b", color_desc);
+
+    graph->add_pass("write_a", nullptr).write_storage_image(a);
+    graph->add_pass("read_a", nullptr).read_texture(a).set_side_effect();
+    graph->add_pass("write_b", nullptr).write_color(b);
+    graph->add_pass("read_b", nullptr).read_texture(b).set_side_effect();
+
+    graph->compile();
+
+    CHECK(graph->placement(a).heap != UINT32_MAX);
+    CHECK(graph->placement(a).heap == graph->placement(b).heap);
+    CHECK(graph->placement(a).offset == graph->placement(b).offset);
+    CHECK(graph->stats().transient_count == 2);
+    CHECK(graph->stats().transient_bytes == 2 * 1024 * 1024);
+    CHECK(graph->stats().heap_bytes == 1024 * 1024);
+
+    const auto& compiled = graph->compiled_passes();
+
+    CHECK(compiled.size() == 4);
+
+    if (compiled.size() == 4)
+    {
+        CHECK(compiled[2].barriers.size() == 1);
+
+        if (compiled[2].barriers.size() == 1)
+        {
+            const RenderGraph::Barrier& barrier = compiled[2].barriers[0];
+
+            CHECK(barrier.resource == b);
+            CHECK((barrier.src_stage & VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT) != 0);
+            CHECK((barrier.src_stage & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT) != 0);
+            CHECK((barrier.src_access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT) != 0);
+            CHECK(barrier.old_layout == VK_IMAGE_LAYOUT_UNDEFINED);
+            CHECK(barrier.new_layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Transients that are alive at the same time must not overlap.
+static void test_overlapping_lifetimes_do_not_alias()
+{
+    RenderGraph::Ptr            graph = create_graph();
+    RenderGraph::ResourceHandle a     = graph->create_image("a", storage_image_desc());
+    RenderGraph::ResourceHandle b     = graph->create_image("b", storage_image_desc());
+
+    graph->add_pass("write_a", nullptr).write_storage_image(a);
+    graph->add_pass("write_b", nullptr).write_storage_image(b);
+    graph->add_pass("read_both", nullptr).read_texture(a).read_texture(b).set_side_effect();
+
+    graph->compile();
+
+    CHECK(graph->placement(a).heap == graph->placement(b).heap);
+    CHECK(graph->placement(a).offset != graph->placement(b).offset);
+    CHECK(graph->stats().heap_bytes == graph->stats().transient_bytes);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Several accesses to one resource within a pass become a single access with a single barrier.
+static void test_accesses_in_a_pass_merge()
+{
+    RenderGraph::Ptr            graph = create_graph();
+    RenderGraph::ResourceHandle image = graph->create_image("image", storage_image_desc());
+
+    graph->add_pass("produce", nullptr).write_storage_image(image);
+
+    std::vector<RenderGraph::Access> sampled = graph->add_pass("sample", nullptr).read_texture(image, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT).read_texture(image, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT).set_side_effect().accesses();
+    std::vector<RenderGraph::Access> mixed   = graph->add_pass("mixed", nullptr).read_texture(image).read_storage_image(image).set_side_effect().accesses();
+
+    graph->compile();
+
+    CHECK(sampled.size() == 1);
+    CHECK(mixed.size() == 1);
+
+    // Sampling and storage access need different layouts, so the merged access falls back to GENERAL.
+    if (mixed.size() == 1)
+        CHECK(mixed[0].layout == VK_IMAGE_LAYOUT_GENERAL);
+
+    const auto& compiled = graph->compiled_passes();
+
+    CHECK(compiled.size() == 3);
+
+    if (compiled.size() == 3)
+    {
+        CHECK(compiled[1].barriers.size() == 1);
+
+        if (compiled[1].barriers.size() == 1)
+            CHECK(compiled[1].barriers[0].dst_stage == (VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT));
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Once a write is visible to a stage, further reads from that stage need no barrier, reads from a new stage still do.
+static void test_redundant_reads_skip_barriers()
+{
+    RenderGraph::Ptr graph = create_graph();
+
+    RenderGraph::BufferDesc desc;
+
+    desc.set_size(4096).set_usage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    RenderGraph::ResourceHandle buffer = graph->create_buffer("buffer", desc);
+
+    graph->add_pass("produce", nullptr).write_buffer(buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    graph->add_pass("read_0", nullptr).read_buffer(buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT).set_side_effect();
+    graph->add_pass("read_1", nullptr).read_buffer(buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT).set_side_effect();
+    graph->add_pass("read_2", nullptr).read_buffer(buffer, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT).set_side_effect();
+
+    graph->compile();
+
+    const auto& compiled = graph->compiled_passes();
+
+    CHECK(compiled.size() == 4);
+
+    if (compiled.size() == 4)
+    {
+        CHECK(compiled[1].barriers.size() == 1);
+        CHECK(compiled[2].barriers.empty());
+        CHECK(compiled[3].barriers.size() == 1);
+
+        if (compiled[3].barriers.size() == 1)
+        {
+            CHECK(compiled[3].barriers[0].src_stage == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+            CHECK(compiled[3].barriers[0].src_access == VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+            CHECK(compiled[3].barriers[0].dst_stage == VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main()
+{
+    test_read_modify_write_chain();
+    test_read_modify_write_side_effect();
+    test_unused_chain_is_culled();
+    test_disjoint_lifetimes_alias();
+    test_overlapping_lifetimes_do_not_alias();
+    test_accesses_in_a_pass_merge();
+    test_redundant_reads_skip_barriers();
+
+    return check_results();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------